@@ -8,6 +8,12 @@ mv v.0000002 v.0000002ref
 mv w.0000002 w.0000002ref
 mv b.0000002 b.0000002ref
 mv time.0000002 time.0000002ref
+mv average.0000002 average.0000002ref
+for var in u v w b; do
+  mv ${var}mean.0000002 ${var}mean.0000002ref
+  mv ${var}var.0000002 ${var}var.0000002ref
+  mv ${var}m2.0000002 ${var}m2.0000002ref
+done
 mpiexec -n 4 ./microhh run drycbl_flow_restart
 cmp u.0000002 u.0000002ref
 diffu=$?
@@ -17,7 +23,13 @@ cmp w.0000002 w.0000002ref
 diffw=$?
 cmp b.0000002 b.0000002ref
 diffs=$?
-error=$(($diffu + $diffv + $diffw + $diffs))
+# the averages of the restarted run contain the same samples as those of the reference, the restart
+# falls at five samples, such that the sum of the squared deviations has to be continued bitwise
+diffavg=0
+for file in average.0000002 umean.0000002 vmean.0000002 wmean.0000002 bmean.0000002 uvar.0000002 vvar.0000002 wvar.0000002 bvar.0000002 um2.0000002 vm2.0000002 wm2.0000002 bm2.0000002; do
+  cmp $file ${file}ref || diffavg=$(($diffavg + 1))
+done
+error=$(($diffu + $diffv + $diffw + $diffs + $diffavg))
 if [ $error = 0 ]; then
   echo "TEST PASSED!"
 else
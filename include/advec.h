@@ -48,9 +48,13 @@ class Advec
         std::string get_switch();
 
         // Pure virtual functions that have to be implemented in derived class.
-        virtual void exec() = 0; ///< Execute the advection scheme.
-        virtual unsigned long get_time_limit(unsigned long, double) = 0; ///< Get the maximum time step imposed by advection scheme
-        virtual double get_cfl(double) = 0; ///< Retrieve the CFL number.
+        virtual void exec() = 0; ///< Execute the advection scheme, the first substep stores the CFL number per unit time.
+        virtual double get_cfl(double) = 0; ///< Calculate the CFL number in a separate pass over the fields.
+
+        virtual unsigned long get_time_limit(unsigned long, double, double); ///< Get the maximum time step for a given CFL number per unit time.
+
+        void calc_cfl_rate();  ///< Calculate the CFL number per unit time in a separate pass, for when no sweep has been done yet.
+        double get_cfl_rate(); ///< Retrieve the CFL number per unit time of this process.
 
     protected:
         Master* master; ///< Pointer to master class.
@@ -58,7 +62,8 @@ class Advec
         Grid*   grid;   ///< Pointer to grid class.
         Fields* fields; ///< Pointer to fields class.
 
-        double cflmax; ///< Maximum allowed value for the CFL criterion.
+        double cflmax;   ///< Maximum allowed value for the CFL criterion.
+        double cfl_rate; ///< Maximum CFL number per unit time of this process, stored by the sweep of the first substep.
         static const double cflmin; ///< Minimum value for CFL used to avoid overflows.
 
         std::string swadvec;
@@ -38,13 +38,13 @@ class Advec_2i4 : public Advec
         ~Advec_2i4();              ///< Destructor of the advection class.
 
         void exec(); ///< Execute the advection scheme.
-        unsigned long get_time_limit(long unsigned int, double); ///< Get the limit on the time step imposed by the advection scheme.
         double get_cfl(double); ///< Get the CFL number.
 
     private:
         double calc_cfl(double*, double*, double*, double*, double); ///< Calculate the CFL number.
 
-        void advec_u(double*, double*, double*, double*, double*, double*, double*);          ///< Calculate longitudinal velocity advection.
+        template<bool>
+        double advec_u(double*, double*, double*, double*, double*, double*, double*);        ///< Calculate longitudinal velocity advection, optionally returning the CFL number per unit time.
         void advec_v(double*, double*, double*, double*, double*, double*, double*);          ///< Calculate latitudinal velocity advection.
         void advec_w(double*, double*, double*, double*, double*, double*, double*);          ///< Calculate vertical velocity advection.
         void advec_s(double*, double*, double*, double*, double*, double*, double*, double*); ///< Calculate scalar advection.
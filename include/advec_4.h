@@ -39,14 +39,13 @@ class Advec_4 : public Advec
         ~Advec_4();              ///< Destructor of the advection class.
 
         void exec(); ///< Execute the advection scheme.
-        unsigned long get_time_limit(long unsigned int, double); ///< Get the limit on the time step imposed by the advection scheme.
         double get_cfl(double); ///< Get the CFL number.
 
     private:
         double calc_cfl(double*, double*, double*, double*, double); ///< Calculate the CFL number.
 
-        template<bool>
-        void advec_u(double* restrict, double* restrict, double* restrict, double* restrict, double* restrict); ///< Calculate longitudinal velocity advection.
+        template<bool, bool>
+        double advec_u(double* restrict, double* restrict, double* restrict, double* restrict, double* restrict, double* restrict); ///< Calculate longitudinal velocity advection, optionally returning the CFL number per unit time.
         template<bool>
         void advec_v(double* restrict, double* restrict, double* restrict, double* restrict, double* restrict); ///< Calculate latitudinal velocity advection.
         template<bool>
@@ -39,7 +39,7 @@ class Advec_disabled : public Advec
 
         void exec(); ///< Execute the advection scheme.
 
-        unsigned long get_time_limit(unsigned long, double); ///< Get the maximum time step imposed by advection scheme
+        unsigned long get_time_limit(unsigned long, double, double); ///< Get the maximum time step imposed by advection scheme
 
         double get_cfl(double); ///< Retrieve the CFL number.
 };
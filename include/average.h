@@ -0,0 +1,88 @@
+/*
+ * MicroHH
+ * Copyright (c) 2011-2017 Chiel van Heerwaarden
+ * Copyright (c) 2011-2017 Thijs Heus
+ * Copyright (c) 2014-2017 Bart van Stratum
+ *
+ * This file is part of MicroHH
+ *
+ * MicroHH is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * MicroHH is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with MicroHH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef AVERAGE
+#define AVERAGE
+
+#include <map>
+#include <string>
+#include <vector>
+
+class Master;
+class Model;
+class Input;
+class Grid;
+class Fields;
+
+// struct for the running averages of a field
+struct Average_var
+{
+    double* data;   ///< Field that is averaged.
+    double  offset; ///< Offset that is added to the mean when it is saved.
+    double* mean;   ///< Running mean of the field.
+    double* m2;     ///< Running sum of the squared deviations from the mean, only allocated with swmoments.
+};
+
+typedef std::map<std::string, Average_var> Average_map;
+
+/**
+ * Class for the online time averages of 3d fields.
+ * The running means, and optionally the variances, of the fields in averagelist are updated in memory at
+ * every sampling time. They are only written at the restart times and at the end of the run, and are read
+ * back at the start of a run, such that the averages continue over restarts.
+ */
+class Average
+{
+    public:
+        Average(Model*, Input*);
+        ~Average();
+
+        void init(double);
+        void create();
+
+        unsigned long get_time_limit(unsigned long);
+        std::string get_switch();
+        bool do_average();
+
+        void exec();     ///< Adds the current fields to the running averages.
+        void save(int);  ///< Saves the averages and the number of samples.
+        void load(int);  ///< Loads the averages of a previous run, if they exist.
+
+    private:
+        Master* master;
+        Model*  model;
+        Grid*   grid;
+        Fields* fields;
+
+        std::string swaverage;
+        std::string swmoments;
+
+        std::vector<std::string> averagelist; ///< List with all averaged fields from the ini file.
+        Average_map averages;
+
+        int nsamples;   ///< Number of samples in the averages.
+        int iotimesave; ///< Output time of the last save, to prevent saving twice at the end of the run.
+
+        double sampletime;
+        unsigned long isampletime;
+};
+#endif
@@ -59,7 +59,7 @@ class Boundary
         virtual void exec_stats(Mask*); ///< Execute statistics of surface
         virtual void exec_cross(int);       ///< Execute cross sections of surface
 
-        virtual void get_mask(Field3d*, Field3d*, Mask*); ///< Calculate statistics mask
+        virtual void get_mask(Mask*); ///< Calculate statistics mask
         virtual void get_surface_mask(Field3d*);          ///< Calculate surface mask
 
         std::string get_switch();
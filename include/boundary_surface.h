@@ -91,8 +91,9 @@ class Boundary_surface : public Boundary
                    double*, double*, double*,
                    double, int);
 
-        double calc_obuk_noslip_flux     (const float* const, const float* const, int&, double, double, double);
-        double calc_obuk_noslip_dirichlet(const float* const, const float* const, int&, double, double, double);
+        double calc_obuk_noslip_flux     (double, double, double);
+        double calc_obuk_noslip_dirichlet(double, double, double);
+        double find_zL(float);
 
         double ustarin;
 
@@ -100,9 +101,17 @@ class Boundary_surface : public Boundary
         float* zL_sl;
         float* f_sl;
 
+        // Uniform-in-Ri index into the monotonic branch of the lookup table.
+        int*  nzL_bucket; ///< First index of f_sl that is larger than or equal to the lower bound of each bucket.
+        int   nzL_branch; ///< Number of points of f_sl that are on the monotonically increasing branch.
+        float Ri_min;     ///< Lower bound of the bucketed range of Ri.
+        float Ri_max;     ///< Upper bound of the bucketed range of Ri.
+        float dRii;       ///< Reciprocal of the bucket width in Ri.
+
 #ifdef USECUDA
         float* zL_sl_g;
         float* f_sl_g;
+        int*   nzL_bucket_g;
 #endif
         int thermobc;
 
@@ -24,6 +24,7 @@
 #define BUDGET
 
 #include <string>
+#include <vector>
 
 class Input;
 class Master;
@@ -64,6 +65,17 @@ class Budget
         Stats&  stats;
 
         std::string swbudget;
+
+        // The kernels add their local sums to a list, which is reduced over all processes in one call
+        // at the end of exec_stats. Dividing the local sums by the number of points is therefore allowed.
+        void add_to_sum(double*); ///< Adds a profile to the sum over all processes at the end of the sample.
+        void sum_profs();         ///< Sums all added profiles over all processes in one call.
+
+        void calc_means(const std::vector<double*>&, const std::vector<const double*>&); ///< Calculates the mean profiles of several fields in one call.
+
+    private:
+        std::vector<double*> sum_list; ///< Profiles of the current sample that have not been summed yet.
+        std::vector<double> sum_buffer; ///< Buffer in which the profiles are packed for the sum.
 };
 #endif
 
@@ -53,7 +53,7 @@ class Budget_2 : public Budget
 
         void calc_advection_terms(double*, double*, double*, double*, double*, double*, double*, double*, double*, double*, double*,
                                   const double*, const double*, const double*, const double*, const double*,
-                                  double*, double*, const double*, const double*); 
+                                  const double*, const double*, const double*, const double*); 
 
         void calc_advection_terms_scalar(double*, double*, double*, double*,
                                          const double*, const double*, const double*, const double*, const double*);
@@ -69,7 +69,7 @@ class Budget_2 : public Budget
                                         const double*, const double*, const double*);
 
         void calc_diffusion_terms_DNS(double*, double*, double*, double*, double*, double*,
-                                      double*, double*, double*, double*, double*, double*, double*,
+                                      double*, double*, double*, double*, double*, const double*, const double*,
                                       const double*, const double*, const double*, const double*,
                                       const double*, const double*, const double*,
                                       const double, const double, const double);
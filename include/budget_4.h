@@ -49,6 +49,8 @@ class Budget_4 : public Budget
         double* umodel;
         double* vmodel;
 
+        bool bsort_sorted; ///< Whether the sorted buoyancy profile is nondecreasing, such that it can be bisected.
+
         void calc_ke(double*, double*, double*,
                      double*, double*,
                      double, double,
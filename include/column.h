@@ -36,7 +36,9 @@ class Fields;
 struct Column_var
 {
     NcVar ncvar;
-    double* data;
+    double* data;               ///< Profiles of the columns owned by this process, kcells per column.
+    int nlev;                   ///< Number of levels that is written, kmax or kmax+1.
+    std::vector<double> buffer; ///< Samples of all columns that are not yet written (only on the root).
 };
 
 // typedefs for containers of profiles and time series
@@ -60,17 +62,39 @@ class Column
         void add_prof(std::string, std::string, std::string, std::string);
         void calc_column(double* const, const double* const,
                        const double);
+        void flush();
         std::string name;
         NcFile* dataFile;
         NcDim z_dim;
         NcDim zh_dim;
         NcDim t_dim;
+        NcDim station_dim;
         NcVar iter_var;
         NcVar t_var;
         Column_map profs;
 
     private:
-        int ncolumn;
+        int ncolumn; ///< Number of samples taken.
+        int nwrite;  ///< Number of samples handed to the output thread.
+
+        std::vector<double> xcolumn; ///< Requested x-coordinates of the columns.
+        std::vector<double> ycolumn; ///< Requested y-coordinates of the columns.
+        std::vector<int> icolumn;    ///< Global i-index of the columns.
+        std::vector<int> jcolumn;    ///< Global j-index of the columns.
+
+        std::vector<int> ijlocal;    ///< Local ij-index of the columns owned by this process.
+
+        // Gather layout on the root process.
+        std::vector<int> owner;      ///< Rank that owns each column.
+        std::vector<int> ilocal;     ///< Index of each column within the columns of its owner.
+        std::vector<int> recvcounts; ///< Number of values received from each process per sample.
+        std::vector<int> displs;     ///< Offset of the block of each process in the receive buffer.
+        std::vector<double> sendbuf;
+        std::vector<double> recvbuf;
+
+        int buffersize;                   ///< Number of samples that are collected before writing.
+        std::vector<double> time_buffer;  ///< Times of the buffered samples.
+        std::vector<int> iter_buffer;     ///< Iterations of the buffered samples.
 
         // mask calculations
         void calc_column(double* const, const double* const,
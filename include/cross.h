@@ -45,6 +45,7 @@ class Cross
         //int exec(double, unsigned long, int);
 
         std::string swcross;
+        std::string swcontainer; ///< Switch for appending all output times of a slice to one container file.
         bool do_cross();
 
         int cross_simple(double*, double*, std::string, int);
@@ -64,6 +65,8 @@ class Cross
 
         std::vector<std::string> crosslist; ///< List with all crosses from the ini file.
 
+        std::map<std::string, Encoding::Format> encodings; ///< Output encoding per cross variable.
+
         std::vector<int> jxz;   ///< Index of nearest full y position of xz input
         std::vector<int> ixz;   ///< Index of nearest full x position of yz input
         std::vector<int> kxy;   ///< Index of nearest full height level of xy input
@@ -82,6 +85,9 @@ class Cross
 
         int check_list(std::vector<std::string> *, FieldMap *, std::string crossname);
         int check_save(int, char *);
+        const Encoding::Format& get_encoding(const std::string&);
+        void set_filename(char*, const std::string&, const char*, int, int);
+        int get_container_time(int);
 };
 #endif
 
@@ -43,8 +43,12 @@ class Diff
         virtual void exec_viscosity() = 0;
         virtual void exec() = 0;
 
-        virtual unsigned long get_time_limit(unsigned long, double) = 0;
-        virtual double get_dn(double) = 0;
+        virtual double get_dn(double) = 0; ///< Calculate the diffusion number in a separate pass over the fields.
+
+        virtual unsigned long get_time_limit(unsigned long, double, double); ///< Get the maximum time step for a given diffusion number per unit time.
+
+        void calc_dn_rate();  ///< Calculate the diffusion number per unit time in a separate pass, for when no sweep has been done yet.
+        double get_dn_rate(); ///< Retrieve the diffusion number per unit time of this process.
 
         #ifdef USECUDA
         // GPU functions and variables
@@ -60,6 +64,7 @@ class Diff
         std::string swdiff;
 
         double dnmax;
+        double dn_rate; ///< Maximum diffusion number per unit time of this process, stored by the sweep of the first substep.
 
 };
 #endif
@@ -34,7 +34,6 @@ class Diff_2 : public Diff
         void set_values();
         void exec();
 
-        unsigned long get_time_limit(unsigned long, double);
         double get_dn(double);
 
         // Empty functions, these are allowed to pass.
@@ -35,7 +35,6 @@ class Diff_4 : public Diff
         void set_values();
         void exec();
 
-        unsigned long get_time_limit(unsigned long, double);
         double get_dn(double);
 
         #ifdef USECUDA
@@ -36,7 +36,7 @@ class Diff_disabled : public Diff
         ~Diff_disabled();
 
         std::string get_name();
-        unsigned long get_time_limit(unsigned long, double);
+        unsigned long get_time_limit(unsigned long, double, double);
         double get_dn(double);
 
         // Empty functions.
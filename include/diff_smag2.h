@@ -24,6 +24,7 @@
 #define DIFF_SMAG_2
 
 #include "diff.h"
+#include "thermo.h"
 
 class Diff_smag_2 : public Diff
 {
@@ -34,7 +35,6 @@ class Diff_smag_2 : public Diff
         void exec();
         void exec_viscosity();
 
-        unsigned long get_time_limit(unsigned long, double);
         double get_dn(double);
 
         double tPr;
@@ -56,12 +56,13 @@ class Diff_smag_2 : public Diff
                           double*, double*,
                           double*, double*, double*);
 
+        template<bool>
         void calc_evisc(double*,
-                        double*, double*, double*, double*,
                         double*, double*, double*,
-                        double*, double*,
                         double*, double*, double*,
-                        double);
+                        double*, double*, const N2_functor,
+                        double*, double*, double*, double*,
+                        double, double);
 
         template<bool>
         void calc_evisc_neutral(double*,
@@ -70,8 +71,8 @@ class Diff_smag_2 : public Diff
                                 double*, double*,
                                 double, double);
 
-        template<bool>
-        void diff_u(double*, double*, double*, double*, double*, double*, double*, double*, double*, double*, double*);
+        template<bool, bool>
+        double diff_u(double*, double*, double*, double*, double*, double*, double*, double*, double*, double*, double*);
         template<bool>
         void diff_v(double*, double*, double*, double*, double*, double*, double*, double*, double*, double*, double*);
 
@@ -53,6 +53,11 @@ class Dump
 
         std::vector<std::string> dumplist; ///< List with all dumps from the ini file.
 
+        std::map<std::string, Encoding::Format> encodings; ///< Output encoding per dump variable.
+        std::map<std::string, Field3d_region> regions;     ///< Saved region per dump variable, if not the full field.
+
+        int get_region(Field3d_region*, Input*, const std::string&); ///< Reads the region of a variable from the ini file.
+
         double sampletime;
         unsigned long isampletime;
 };
@@ -0,0 +1,78 @@
+/*
+ * MicroHH
+ * Copyright (c) 2011-2017 Chiel van Heerwaarden
+ * Copyright (c) 2011-2017 Thijs Heus
+ * Copyright (c) 2014-2017 Bart van Stratum
+ *
+ * This file is part of MicroHH
+ *
+ * MicroHH is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * MicroHH is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with MicroHH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENCODING
+#define ENCODING
+
+#include <vector>
+#include <string>
+
+class Master;
+class Input;
+
+/**
+ * Encodings of the cross-section and 3d dump output. Files with a non-raw encoding start with
+ * a header that describes the encoding, followed by one record per block (a part of the array
+ * that is written by one process) and the concatenated encoded blocks. The header contains
+ * the magic string "MHHENC01", the precision, the compression (all int32), the array size
+ * itot, jtot, ktot and the number of blocks (all int32) and the tolerance (double). Each block
+ * record contains the start and count in i, j and k (int32), the number of encoded bytes (int64)
+ * and the scale and offset of int16 quantization (double). The raw encoding writes plain doubles
+ * without header.
+ */
+namespace Encoding
+{
+    enum Precision {Float64, Float32, Float16, Int16};
+    enum Compression {None, Deflate, Lossy};
+
+    struct Format
+    {
+        Precision precision;     ///< Precision of the stored values.
+        Compression compression; ///< Compression of the stored values.
+        double tolerance;        ///< Absolute error bound of the lossy compression.
+    };
+
+    struct Block
+    {
+        int start[3];  ///< Start index of the block in the array in x, y and z.
+        int count[3];  ///< Size of the block in x, y and z.
+        double scale;  ///< Scale factor of the int16 quantization.
+        double offset; ///< Offset of the int16 quantization.
+        std::vector<unsigned char> data; ///< Encoded values of the block.
+    };
+
+    const Format raw = {Float64, None, 0.}; ///< Format of plain doubles without header.
+
+    const int header_size = 40; ///< Size of the file header in bytes.
+    const int record_size = 48; ///< Size of a block record in bytes.
+
+    const short int16_fill = -32768; ///< Quantized value of NC_FILL_DOUBLE in int16 precision.
+
+    bool is_raw(const Format&); ///< Checks whether values are written as plain doubles.
+    int get_format(Format*, Input*, Master*, const std::string&, const std::string&); ///< Reads the format of a variable from the ini file.
+
+    int encode_block(Block&, const double*, const Format&); ///< Encodes the values of a block.
+    int get_nclamped(); ///< Returns and resets the number of blocks that could not be stored within the lossy tolerance.
+    void pack_header(unsigned char*, const Format&, int, int, int, int); ///< Writes the file header to a buffer.
+    void pack_record(unsigned char*, const Block&); ///< Writes the record of a block to a buffer.
+}
+#endif
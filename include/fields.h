@@ -24,6 +24,9 @@
 #define FIELDS
 #include <map>
 #include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include "field3d.h"
 
 class Master;
@@ -33,9 +36,45 @@ class Grid;
 class Stats;
 class Column;
 struct Mask;
+struct Prefetch_buffer;
+class Fields;
 
 typedef std::map<std::string, Field3d *> FieldMap;
 
+/**
+ * A prognostic field and its tendency, to loop over in the kernels without looking up fields by name.
+ */
+struct Field_pair
+{
+    Field3d* fld;  ///< Prognostic field.
+    Field3d* fldt; ///< Tendency of the prognostic field.
+};
+
+/**
+ * Scoped checkout of a temporary field from the pool in Fields. The field is reserved for the owner
+ * of this object and returns to the pool when it goes out of scope. It converts to a Field3d pointer,
+ * such that it can be passed to the functions that take a tmp field.
+ */
+class Tmp_field
+{
+    public:
+        Tmp_field(Fields*, Field3d*);
+        Tmp_field(Tmp_field&&);
+        ~Tmp_field();
+
+        Tmp_field(const Tmp_field&) = delete;
+        Tmp_field& operator=(const Tmp_field&) = delete;
+
+        void release(); ///< Returns the field to the pool before the end of the scope.
+
+        Field3d* operator->() const { return fld; }
+        operator Field3d*()   const { return fld; }
+
+    private:
+        Fields* fields;
+        Field3d* fld;
+};
+
 class Fields
 {
     public:
@@ -49,7 +88,7 @@ class Fields
         void create_column(); ///< Initialization of the column output.
         
         void exec();
-        void get_mask(Field3d*, Field3d*, Mask*);
+        void get_mask(Mask*);
         void exec_stats(Mask*);
 
         void init_momentum_field  (Field3d*&, Field3d*&, std::string, std::string, std::string);
@@ -57,8 +96,17 @@ class Fields
         void init_diagnostic_field(std::string, std::string, std::string);
         void init_tmp_field       (std::string, std::string, std::string);
 
+        // The registry assigns a handle to each field at creation. The names are meant for setup code,
+        // the hot paths store the handles or loop over the precomputed pairs.
+        int get_handle(const std::string&);          ///< Returns the handle of a prognostic, diagnostic or tmp field.
+        int get_tendency_handle(const std::string&); ///< Returns the handle of the tendency of a prognostic field.
+        Field_pair get_pair(const std::string&);     ///< Returns a prognostic field and its tendency.
+        Field3d* get_field(const int h) { return registry[h]; } ///< Returns the field belonging to a handle.
+
         void save(int);
         void load(int);
+        void prefetch(int); ///< Starts reading the prognostic fields of an output time in the background.
+        void get_load_times(double*, double*); ///< Returns the time spent reading the fields and the time the model waited for them.
 
         double check_momentum();
         double check_tke();
@@ -67,6 +115,10 @@ class Fields
         void set_calc_mean_profs(bool);
         void set_minimum_tmp_fields(int);
 
+        Tmp_field get_tmp();                     ///< Checks out a tmp field from the pool until the end of the scope.
+        int get_tmp_peak() { return n_tmp_peak; } ///< Returns the maximum number of tmp fields in use at once.
+        void check_tmp_fields();                 ///< Checks that all tmp fields are returned to the pool (TMPCHECKS only).
+
         void exec_cross(int);
         void exec_dump(int);
         void exec_column();
@@ -92,6 +144,9 @@ class Fields
 
         FieldMap atmp; ///< Map containing all temporary field3d instances
 
+        std::vector<Field_pair> prognostic_pairs; ///< All prognostic fields with their tendencies, including momentum.
+        std::vector<Field_pair> scalar_pairs;     ///< All prognostic scalars with their tendencies.
+
         double* rhoref;  ///< Reference density at full levels 
         double* rhorefh; ///< Reference density at half levels
 
@@ -143,8 +198,8 @@ class Fields
         void check_added_cross(std::string, std::string, std::vector<std::string>*, std::vector<std::string>*);
 
         // masks
-        void calc_mask_wplus(double*, double*, double*, int*, int*, int*, double*);
-        void calc_mask_wmin (double*, double*, double*, int*, int*, int*, double*);
+        void calc_mask_wplus(unsigned char*, unsigned char*, unsigned char*, double*);
+        void calc_mask_wmin (unsigned char*, unsigned char*, unsigned char*, double*);
 
         // perturbations
         double rndamp;
@@ -167,7 +222,28 @@ class Fields
         double* umodel;
         double* vmodel;
 
-        int n_tmp_fields;   // number of temporary fields
+        int n_tmp_fields;   // number of temporary fields that are allocated at init
+
+        // pool of tmp fields, which grows when more fields are checked out at once than exist
+        friend class Tmp_field;
+        std::vector<Field3d*> tmp_pool;  ///< All tmp fields, in order of creation.
+        std::vector<bool> tmp_in_use;    ///< Whether the tmp field with the same index is checked out.
+        int n_tmp_in_use;                ///< Number of tmp fields that are checked out.
+        int n_tmp_peak;                  ///< Maximum number of tmp fields that were checked out at once.
+        std::mutex tmp_mutex;            ///< Mutex protecting the pool, the statistics may run on a separate thread.
+        void release_tmp(Field3d*);      ///< Returns a tmp field to the pool.
+
+        std::vector<Field3d*> registry;          ///< All fields, indexed by their handle.
+        std::map<std::string, int> handles;      ///< Handles of the prognostic, diagnostic and tmp fields by name.
+        std::map<std::string, int> thandles;     ///< Handles of the tendencies by the name of their prognostic field.
+        int add_to_registry(Field3d*);           ///< Adds a field to the registry and returns its handle.
+
+        // prognostic fields that are read ahead in post processing mode, in the order of ap
+        typedef std::vector<std::shared_ptr<Prefetch_buffer>> Prefetch_set;
+        std::deque<std::pair<int, Prefetch_set>> prefetched; ///< Buffers that are being read, with their output time.
+        std::vector<Prefetch_set> prefetch_pool;             ///< Buffers of loaded output times, reused by the next prefetch.
+        double load_read_time; ///< Wall clock time spent reading the fields.
+        double load_wait_time; ///< Wall clock time that the model waited for the fields.
 
         /* 
          *Device (GPU) functions and variables
@@ -30,6 +30,7 @@
 class Model;
 class Grid;
 class Fields;
+class Field3d;
 class Master;
 class Input;
 
@@ -89,6 +90,15 @@ class Force
 
         double* nudge_factor;  ///< Height varying nudging factor (1/s)
 
+        struct Force_term
+        {
+            Field3d* fld;  ///< Forced prognostic field.
+            Field3d* fldt; ///< Tendency of the forced field.
+            double* prof;  ///< Profile of the forcing.
+        };
+        std::vector<Force_term> lsterms;    ///< Large-scale sources in the order of lslist.
+        std::vector<Force_term> nudgeterms; ///< Nudged fields in the order of nudgelist.
+
         // Time dependence geostrophic wind
         std::string swtimedep_geo;
         std::map<std::string, std::vector<double>> timedeptime_geo;
@@ -27,13 +27,117 @@
 #include <mpi.h>
 #endif
 #include <fftw3.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include <cstdio>
 #include "input.h"
+#include "encoding.h"
 
 class Model;
 class Master;
 
 enum Edge {East_west_edge, North_south_edge, Both_edges};
 
+/**
+ * Description of the blocks that are exchanged in a transpose. Block n starts at n*nstride
+ * and contains ni x nj x nk values with strides jj and kk.
+ */
+struct Transpose_block
+{
+    int nstride; ///< Offset between two consecutive blocks.
+    int ni;      ///< Number of values in the x-direction.
+    int nj;      ///< Number of values in the y-direction.
+    int nk;      ///< Number of values in the z-direction.
+    int jj;      ///< Stride in the y-direction.
+    int kk;      ///< Stride in the z-direction.
+};
+
+/**
+ * Container file that collects the slices of all output times of one cross-section. The file starts
+ * with the magic string "MHHCNT01" and the number of entries per index table (int32, 4 bytes padding).
+ * Each index table contains the offset of the next table (int64, 0 for the last table) followed by
+ * entries with the output time (int32, 4 bytes padding), offset and size (both int64) of a slice.
+ * Unused entries have size 0. The slices are appended after the tables and are stored exactly as
+ * in a separate file, which depends on the encoding.
+ */
+struct Output_container
+{
+#ifdef USEMPI
+    MPI_File fh;     ///< File handle, which is kept open to avoid metadata operations.
+#else
+    FILE* fh;        ///< File handle, which is kept open to avoid metadata operations.
+#endif
+    int capacity;    ///< Number of entries per index table.
+    int nentries;    ///< Number of used entries in the current index table.
+    long long table; ///< Offset of the current index table.
+    long long end;   ///< Offset of the end of the file, where the next slice is written.
+};
+
+/**
+ * Buffer of a 3d field that is read ahead on the output thread. The data is stored in file order
+ * and is unpacked into the field by load_field3d once the job that reads it has finished.
+ */
+struct Prefetch_buffer
+{
+    std::vector<double> data; ///< Data of the field in file order.
+    std::string filename;     ///< Name of the file that is read.
+    unsigned long job;        ///< Number of the job that reads the file.
+    int nerror;               ///< Number of errors of the read.
+    double readtime;          ///< Wall clock time that the read took.
+};
+
+/**
+ * Region of a 3d field that is saved instead of the full field. The region is the box of global
+ * indices from begin up to but not including end, from which every stride-th point is taken.
+ */
+struct Field3d_region
+{
+    int begin [3]; ///< First global index in x, y and z.
+    int end   [3]; ///< Global index past the last one in x, y and z.
+    int stride[3]; ///< Distance between the saved points in x, y and z.
+};
+
+namespace Container
+{
+    const int header_size = 16;   ///< Size of the file header in bytes.
+    const int entry_size  = 24;   ///< Size of an index entry in bytes.
+    const int capacity    = 1024; ///< Number of entries per index table of new containers.
+
+    inline long long table_size(const int capacity) { return sizeof(long long) + static_cast<long long>(capacity)*entry_size; }
+
+    void pack_header(unsigned char*, int);         ///< Writes the file header to a buffer.
+    int unpack_header(const unsigned char*, int*); ///< Reads the capacity from a file header, returns 1 if it is not a container.
+    void pack_entry(unsigned char*, int, long long, long long); ///< Writes an index entry to a buffer.
+    long long unpack_table(const unsigned char*, int, int*);    ///< Counts the used entries of a table and returns the offset of the next.
+}
+
+#ifdef USEMPI
+/**
+ * Node layout and shared memory of a communicator for node-aware transposes. The processes on a
+ * node exchange their blocks through a shared memory window, only the node leaders communicate.
+ */
+struct Transpose_node
+{
+    int rank;             ///< Rank of this process in the communicator.
+    MPI_Comm commnode;    ///< Processes of the communicator that share this node.
+    MPI_Comm commleader;  ///< Node leaders of the communicator, MPI_COMM_NULL on the other processes.
+    MPI_Win win;          ///< Shared memory window with the send and receive buffers of the processes on the node.
+    std::vector<double*> segments; ///< Buffers of the processes on this node, by local rank.
+    std::vector<int> node;         ///< Node index of each process of the communicator.
+    std::vector<int> local;        ///< Local rank on its node of each process of the communicator.
+    std::vector<std::vector<int>> members; ///< Processes of the communicator per node.
+    std::vector<double> aggsend;   ///< Blocks of this node that are sent to the other nodes.
+    std::vector<double> aggrecv;   ///< Blocks of the other nodes that are received by this node.
+};
+#endif
+
 /**
  * Class for the grid settings and operators.
  * This class contains the grid properties, such as dimensions and resolution.
@@ -119,28 +223,51 @@ class Grid
         void exit_mpi(); ///< Destructs the MPI data types used in grid operations.
         void boundary_cyclic   (double*, Edge=Both_edges); ///< Fills the ghost cells in the periodic directions.
         void boundary_cyclic_2d(double*); ///< Fills the ghost cells of one slice in the periodic direction.
+        void boundary_cyclic   (unsigned char*); ///< Fills the ghost cells of a field of flags in the periodic directions.
         void transpose_zx(double*, double*); ///< Changes the transpose orientation from z to x.
         void transpose_xz(double*, double*); ///< Changes the transpose orientation from x to z.
         void transpose_xy(double*, double*); ///< changes the transpose orientation from x to y.
         void transpose_yx(double*, double*); ///< Changes the transpose orientation from y to x.
         void transpose_yz(double*, double*); ///< Changes the transpose orientation from y to z.
         void transpose_zy(double*, double*); ///< Changes the transpose orientation from z to y.
+        void benchmark_transposes(); ///< Times the transpose backends for the current decomposition.
+
+        bool   profile;        ///< Switch to time the transposes and the exchange of the ghost cells, set with swprofile.
+        double time_transpose; ///< Wall clock time spent in the communication of the transposes.
+        double time_halo;      ///< Wall clock time spent in the exchange of the ghost cells.
 
         void get_max (double*);      ///< Gets the maximum of a number over all processes.
         void get_max (int*);         ///< Gets the maximum of a number over all processes.
+        void get_max (double*, int); ///< Gets the maximum of an array of numbers over all processes in one call.
         void get_sum (double*);      ///< Gets the sum of a number over all processes.
         void get_prof(double*, int); ///< Averages a vertical profile over all processes.
         void calc_mean(double*, const double*, int);
 
         // IO functions
-        int save_field3d(double*, double*, double*, char*, double); ///< Saves a full 3d field.
+        int save_field3d(double*, double*, double*, char*, double,
+                         const Encoding::Format& = Encoding::raw); ///< Saves a full 3d field.
+        int save_field3d(double*, char*, double, const Field3d_region&,
+                         const Encoding::Format& = Encoding::raw); ///< Saves a region of a 3d field.
         int load_field3d(double*, double*, double*, char*, double); ///< Loads a full 3d field.
-
-        int save_xz_slice(double*, double*, char*, int);           ///< Saves a xz-slice from a 3d field.
-        int save_yz_slice(double*, double*, char*, int);           ///< Saves a yz-slice from a 3d field.
-        int save_xy_slice(double*, double*, char*, int kslice=-1); ///< Saves a xy-slice from a 3d field.
+        int load_field3d(double*, double*, Prefetch_buffer&, double); ///< Loads a full 3d field from a prefetched buffer.
+        void prefetch_field3d(std::shared_ptr<Prefetch_buffer>, const std::string&); ///< Starts reading a full 3d field in the background.
+
+        // Slices are appended to a container file if the output time is given (iotime >= 0)
+        int save_xz_slice(double*, double*, char*, int,
+                          const Encoding::Format& = Encoding::raw, int iotime=-1); ///< Saves a xz-slice from a 3d field.
+        int save_yz_slice(double*, double*, char*, int,
+                          const Encoding::Format& = Encoding::raw, int iotime=-1); ///< Saves a yz-slice from a 3d field.
+        int save_xy_slice(double*, double*, char*, int kslice=-1,
+                          const Encoding::Format& = Encoding::raw, int iotime=-1); ///< Saves a xy-slice from a 3d field.
         int load_xy_slice(double*, double*, char*, int kslice=-1); ///< Loads a xy-slice.
 
+        // Output thread functions
+        int  exec_output(std::function<int()>, const std::string&); ///< Executes an output job, or queues it for the output thread.
+        void set_output_queue(bool); ///< Switches the queueing of output jobs on or off.
+        int  wait_output();          ///< Waits until all queued output is written and returns the number of errors.
+        unsigned long exec_input(std::function<int()>); ///< Executes an input job, or queues it for the output thread, and returns its number.
+        void wait_input(unsigned long); ///< Waits until the input job with the given number is done.
+
         // Fourier tranforms
         double*fftini, *fftouti; ///< Help arrays for fast-fourier transforms in x-direction.
         double*fftinj, *fftoutj; ///< Help arrays for fast-fourier transforms in y-direction.
@@ -186,15 +313,57 @@ class Grid
         bool mpitypes;  ///< Boolean to check whether MPI datatypes are created.
         bool fftwplan;  ///< Boolean to check whether FFTW3 plans are created.
 
+        std::string swasyncio;   ///< Switch for writing the output on a helper thread.
+        std::string swtranspose; ///< Switch for the communication backend of the transposes.
+        bool queue_output;     ///< Boolean to check whether output jobs are currently queued.
+
+        std::thread output_thread;             ///< Helper thread that writes the queued output.
+        std::mutex output_mutex;               ///< Mutex protecting the output queue.
+        std::condition_variable output_cond;   ///< Condition variable to signal changes in the output queue.
+        std::deque<std::pair<std::function<int()>, std::string>> output_jobs; ///< Queue of output jobs and their file names.
+        bool output_busy;                      ///< Boolean to check whether the output thread is writing.
+        bool output_exit;                      ///< Boolean to signal the output thread to stop once the queue is empty.
+        int  output_nerror;                    ///< Number of failed output jobs since the last wait.
+        unsigned long output_nqueued;          ///< Number of jobs that have been queued.
+        unsigned long output_ndone;            ///< Number of queued jobs that have been executed.
+
+        void run_output(); ///< Loop of the output thread.
+
+        std::map<std::string, Output_container> containers; ///< Open container files, only accessed by output jobs.
+        void close_containers(); ///< Closes the open container files.
+        void unpack_field3d(double*, double*, double*, double); ///< Copies a field in file order into a 3d field.
+        void pack_region(std::vector<double>&, const double*, double, const Field3d_region&,
+                         int[3], int[3], int[3]); ///< Copies the local points of a region of a 3d field into a buffer.
+#ifdef USEMPI
+        int read_field3d(double*, const char*, MPI_Comm); ///< Reads a full 3d field in file order.
+#else
+        int read_field3d(double*, const char*); ///< Reads a full 3d field in file order.
+#endif
+
+#ifdef USEMPI
+        int append_container(const std::string&, MPI_Comm, int,
+                             std::function<int(MPI_File, MPI_Offset, long long*)>); ///< Appends a slice written by a function to a container.
+#else
+        int append_container(const std::string&, int, const std::vector<unsigned char>&); ///< Appends a slice to a container.
+#endif
+
         void calculate(); ///< Computation of dimensions, faces and ghost cells.
         void check_ghost_cells(); ///< Check whether slice thickness is at least equal to number of ghost cells.
 
+        int  create_fftw_plans(unsigned int); ///< Creates the FFTW3 plans for the current decomposition.
+        void save_fftw_plans();    ///< Creates the FFTW3 plans and saves the wisdom.
+        void load_fftw_plans();    ///< Loads the FFTW3 wisdom and creates the plans, regenerating missing ones.
+        void export_fftw_wisdom(); ///< Writes the FFTW3 wisdom to file.
+        void share_fftw_wisdom();  ///< Sends the FFTW3 wisdom of the first ensemble member to the others.
+
 #ifdef USEMPI
         // MPI Datatypes
         MPI_Datatype eastwestedge;     ///< MPI datatype containing the ghostcells at the east-west sides.
         MPI_Datatype northsouthedge;   ///< MPI datatype containing the ghostcells at the north-south sides.
         MPI_Datatype eastwestedge2d;   ///< MPI datatype containing the ghostcells for one slice at the east-west sides.
         MPI_Datatype northsouthedge2d; ///< MPI datatype containing the ghostcells for one slice at the north-south sides.
+        MPI_Datatype eastwestedgeflag;   ///< MPI datatype containing the ghostcells of a field of flags at the east-west sides.
+        MPI_Datatype northsouthedgeflag; ///< MPI datatype containing the ghostcells of a field of flags at the north-south sides.
 
         MPI_Datatype transposez;  ///< MPI datatype containing base blocks for z-orientation in zx-transpose.
         MPI_Datatype transposez2; ///< MPI datatype containing base blocks for z-orientation in zy-transpose.
@@ -211,6 +380,19 @@ class Grid
         MPI_Datatype subxyslice; ///< MPI datatype containing only one xy-slice.
 
         double* profl; ///< Help array used in profile writing.
+
+        MPI_Comm commxgraph; ///< Graph communicator with all processes of commx as neighbors.
+        MPI_Comm commygraph; ///< Graph communicator with all processes of commy as neighbors.
+
+        double* transpose_sendbuf; ///< Buffer containing the packed blocks to be sent in a transpose.
+        double* transpose_recvbuf; ///< Buffer containing the packed blocks received in a transpose.
+
+        bool transpose_shared;  ///< Boolean to check whether the shared memory windows are created.
+        Transpose_node nodex;   ///< Node layout of commx for the node-aware transposes.
+        Transpose_node nodey;   ///< Node layout of commy for the node-aware transposes.
+
+        void transpose(double*, double*, const Transpose_block&, const Transpose_block&,
+                       MPI_Datatype, MPI_Datatype, MPI_Comm, MPI_Comm, Transpose_node&, int, int); ///< Exchanges the blocks of a transpose.
 #endif
 };
 #endif
@@ -61,6 +61,7 @@ class Input
 
         void print_unused();
         void flag_as_used(std::string, std::string);
+        int add_override(std::string);
 
     private:
         Master* master;
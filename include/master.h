@@ -27,10 +27,28 @@
 #include <mpi.h>
 #endif
 #include <string>
+#include <vector>
+#include <thread>
+#include <cstdio>
 #include "input.h"
 
 class Input;
 
+// Communication routines that are accounted in the communication statistics.
+namespace Comm_kind
+{
+    enum {halo, halo_2d, transpose_zx, transpose_xz, transpose_xy, transpose_yx, transpose_yz, transpose_zy,
+          prof, grid_reduce, reduce, broadcast, gather, size};
+}
+
+struct Comm_counter
+{
+    double calls;    ///< Number of calls of the routine.
+    double messages; ///< Number of messages sent to other processes.
+    double bytes;    ///< Number of bytes sent to other processes.
+    double time;     ///< Wall clock time spent in the MPI calls, including the waiting for their completion.
+};
+
 class Master
 {
     public:
@@ -38,6 +56,7 @@ class Master
         ~Master();
 
         void start(int, char**);
+        void start_ensemble(Input*);
         void init(Input*);
 
         double get_wall_clock_time();
@@ -61,6 +80,18 @@ class Master
         // overload the min function
         void min(double *, int);
 
+        // gather blocks of doubles of varying size on the root process
+        void gather(double *, int, double *, const int *, const int *);
+
+        // reduce records of doubles with a user-defined merge function
+        void merge(double *, int, int, void (*)(double*, const double*));
+
+        // accounting of the communication of the model
+        void add_comm(int, double, double, double); ///< Adds a call of a communication routine to the statistics.
+        bool get_comm_stats(); ///< Returns whether the communication is accounted.
+        void start_comm_stats(); ///< Resets the communication statistics and starts the accounting.
+        void print_comm_stats(int, int, bool); ///< Writes the statistics of the last interval to <simname>.comm, or prints those of the whole run.
+
         void print_message(const char *format, ...);
         void print_warning(const char *format, ...);
         void print_error  (const char *format, ...);
@@ -77,16 +108,29 @@ class Master
         int mpicoordx;
         int mpicoordy;
 
+        int nmembers; // number of ensemble members that share the executable
+        int member;   // ensemble member of this process
+
+        bool thread_multiple; // MPI may be called concurrently from multiple threads
+
 #ifdef USEMPI
         int nnorth;
         int nsouth;
         int neast;
         int nwest;
 
+        MPI_Comm commmember; // all processes of this ensemble member
+        MPI_Comm commens;    // the processes with the same rank in each ensemble member
+
         MPI_Comm commxy;
         MPI_Comm commx;
         MPI_Comm commy;
 
+        // duplicates of the communicators for the output thread
+        MPI_Comm commxyio;
+        MPI_Comm commxio;
+        MPI_Comm commyio;
+
         MPI_Request *reqs;
         int reqsn;
 #endif
@@ -98,6 +142,16 @@ class Master
         double wall_clock_start;
         double wall_clock_end;
 
+        std::string ensemblefile;
+        std::string member_label();
+
+        bool comm_stats;                        ///< Boolean to check whether the communication is accounted.
+        std::thread::id comm_thread;            ///< Thread of which the communication is accounted, the output thread is excluded.
+        std::vector<Comm_counter> comm_total;    ///< Communication statistics of the whole run.
+        std::vector<Comm_counter> comm_interval; ///< Communication statistics since the last write to <simname>.comm.
+        FILE* commout;                          ///< File <simname>.comm, only open on the main process.
+        bool commout_failed;                    ///< Boolean that is set if <simname>.comm cannot be opened.
+
 #ifdef USEMPI
         int check_error(int);
 #endif
@@ -24,6 +24,8 @@
 #define MODEL
 
 #include <string>
+#include <vector>
+#include <cstdio>
 #include <thread>
 
 class Master;
@@ -42,7 +44,11 @@ class Stats;
 class Cross;
 class Dump;
 class Column;
+class Average;
 class Budget;
+#ifdef USEPERFCOUNTERS
+class Perf_counters;
+#endif
 
 class Model
 {
@@ -78,19 +84,43 @@ class Model
         Dump*   dump;
         Budget* budget;
         Column* column;
+        Average* average;
 
     private:
         // list of masks for statistics
         std::vector<std::string> masklist;
+
+        void finish_output(); ///< Waits for the queued output and checks its errors over all processes.
         #ifdef USECUDA
         std::thread t_stat;
         #endif
 
+        double cfl_rate; ///< CFL number per unit time over all processes, as used for the last time step.
+        double dn_rate;  ///< Diffusion number per unit time over all processes, as used for the last time step.
+
+        FILE* dnsout; ///< Status file <simname>.out, only open on the main process.
+
+        // Profiling of the stages of the time loop.
+        std::string swprofile;
+        std::vector<double> stage_times; ///< Wall clock time spent per stage of the time loop.
+        double stage_start;              ///< Wall clock time at which the current stage started.
+        void end_stage(int);             ///< Adds the time since the end of the previous stage to a stage.
+        void print_profile(int, double); ///< Prints the stage times and writes them to <simname>.timing.
+        // Accounting of the communication.
+        std::string swcommstats;
+        int comm_iteration; ///< Iteration of the previous write of the communication statistics.
+
+        #ifdef USEPERFCOUNTERS
+        Perf_counters* counters; ///< Hardware performance counters of the stages, only created with swprofile.
+        #endif
+
         void delete_objects();
 
         void print_status();
+        void print_load_times();
+        void prefetch_post_proc(int);
         void calc_stats(std::string);
         void set_time_step();
-        void do_stat(bool doStats, bool doCross, bool doDump, bool doColumn, int iteration, double time, unsigned long itime, int iotime);
+        void do_stat(bool doStats, bool doCross, bool doDump, bool doColumn, bool doAverage, int iteration, double time, unsigned long itime, int iotime);
 };
 #endif
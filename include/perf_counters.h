@@ -0,0 +1,61 @@
+/*
+ * MicroHH
+ * Copyright (c) 2011-2017 Chiel van Heerwaarden
+ * Copyright (c) 2011-2017 Thijs Heus
+ * Copyright (c) 2014-2017 Bart van Stratum
+ *
+ * This file is part of MicroHH
+ *
+ * MicroHH is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * MicroHH is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with MicroHH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PERF_COUNTERS
+#define PERF_COUNTERS
+
+#ifdef USEPERFCOUNTERS
+
+#include <vector>
+
+class Master;
+
+/**
+ * Hardware performance counters of the stages of the time loop, read with the Linux perf_event_open
+ * interface. The counters count the main thread of each process in user space only. Counters that
+ * the hardware or the kernel settings (perf_event_paranoid) do not provide are reported as not available.
+ */
+class Perf_counters
+{
+    public:
+        Perf_counters(Master*, int); ///< Constructor of the counters of a given number of stages.
+        ~Perf_counters();
+
+        void start();         ///< Opens the counters if needed and resets the counts of all stages.
+        void end_stage(int);  ///< Adds the counts since the end of the previous stage to a stage.
+        void print(const char* const*, const std::vector<double>&); ///< Sums the counts over all processes and writes them to <simname>.counters.
+
+    private:
+        Master* master;
+        int nstages; ///< Number of stages.
+        int nopen;   ///< Number of counters in the group that are open.
+
+        std::vector<int> fds;     ///< File descriptors of the counters, the first is the group leader.
+        std::vector<int> index;   ///< Position of each event in the group, -1 if the event is not available.
+        std::vector<double> last;   ///< Counts at the end of the previous stage.
+        std::vector<double> counts; ///< Counts per stage and event.
+
+        void open();                        ///< Opens the counters as one group.
+        void read_counts(std::vector<double>&); ///< Reads the counts of all events.
+};
+#endif
+#endif
@@ -24,6 +24,7 @@
 #define STATS
 
 //#include <netcdfcpp.h>
+#include <vector>
 #include <netcdf>
 using namespace netCDF;
 
@@ -37,6 +38,7 @@ struct Prof_var
 {
     NcVar ncvar;
     double* data;
+    int nlev; ///< Number of levels that is written, kmax or kmax+1.
 };
 
 // struct for time series
@@ -46,9 +48,19 @@ struct Time_series_var
     double data;
 };
 
+// struct for spectra at the selected heights
+struct Spec_var
+{
+    NcVar ncvar;
+    double* data; ///< Spectral density per selected height, the wavenumber index runs fastest.
+    int nlev;     ///< Number of selected heights.
+    int nk;       ///< Number of wavenumbers.
+};
+
 // typedefs for containers of profiles and time series
 typedef std::map<std::string, Prof_var> Prof_map;
 typedef std::map<std::string, Time_series_var> Time_series_map;
+typedef std::map<std::string, Spec_var> Spec_map;
 
 // structure
 struct Mask
@@ -60,12 +72,26 @@ struct Mask
     NcDim t_dim;
     NcVar iter_var;
     NcVar t_var;
+    NcDim zs_dim;  ///< Full levels at which the spectra are computed.
+    NcDim zhs_dim; ///< Half levels at which the spectra are computed.
+    NcDim kx_dim;
+    NcDim ky_dim;
+    NcDim kh_dim;
     Prof_map profs;
     Time_series_map tseries;
+    Spec_map specs;
 };
 
 typedef std::map<std::string, Mask> Mask_map;
 
+// Lists of the cells inside the mask, for the levels in which the mask is sparse
+struct Mask_index
+{
+    std::vector<int> ijk;     ///< Indices of the cells inside the mask, ordered per level.
+    std::vector<int> kbegin;  ///< Position of the first cell of each level in ijk.
+    std::vector<bool> sparse; ///< Levels that are sampled through the index list.
+};
+
 class Stats
 {
     public:
@@ -76,13 +102,17 @@ class Stats
         void create(int);
 
         unsigned long get_time_limit(unsigned long);
-        void get_mask(Field3d*, Field3d*, Mask*);
+        void get_mask(Mask*);
+        void calc_mask_index();
         void exec(int, double, unsigned long);
         bool doStats();
         std::string get_switch();
 
         // Container for all stats, masks as uppermost in hierarchy
         Mask_map masks;
+        unsigned char* mask;    ///< Flag per cell that is one inside the mask at the full levels.
+        unsigned char* maskh;   ///< Flag per cell that is one inside the mask at the half levels.
+        unsigned char* maskbot; ///< Flag per cell that is one inside the mask at the surface.
         int* nmask;
         int* nmaskh;
         int nmaskbot;
@@ -92,42 +122,43 @@ class Stats
         void add_prof(std::string, std::string, std::string, std::string);
         void add_fixed_prof(std::string, std::string, std::string, std::string, double*);
         void add_time_series(std::string, std::string, std::string);
+        void add_spectra(std::string, std::string, std::string, std::string);
 
-        void calc_area(double*, const int[3], int*);
+        void calc_area(double*, const int[3]);
 
         void calc_mean(double* const, const double* const,
-                       const double, const int[3],
-                       const double* const, const int* const);
+                       const double, const int[3]);
 
         void calc_mean2d(double* const, const double* const,
-                         const double,
-                         const double* const, const int* const);
-
-        void calc_moment  (double*, double*, double*, double, const int[3], double*, int*);
+                         const double);
 
-        void calc_diff_2nd(double*, double*, double*, double, const int[3], double*, int*);
-        void calc_diff_2nd(double*, double*, double*, double*, double*,
-                           double*, double*, double, const int[3], double*, int*);
-        void calc_diff_4th(double*, double*, double*, double, const int[3], double*, int*);
-
-        void calc_grad_2nd(double*, double*, double*, const int[3], double*, int*);
-        void calc_grad_4th(double*, double*, double*, const int[3], double*, int*);
-
-        void calc_flux_2nd(double*, double*, double*, double*, double*, double*, const int[3], double*, int*);
-        void calc_flux_4th(double*, double*, double*, double*, const int[3], double*, int*);
+        void calc_stats   (Mask*, const std::string, double*, const double, const int[3],
+                           double*, double*, double*, double*, double*, const double);
 
         void add_fluxes   (double*, double*, double*);
-        void calc_count   (double*, double*, double, double*, int*);
-        void calc_path    (double*, double*, int*, double*);
-        void calc_cover   (double*, double*, int*, double*, double);
+        void calc_count   (double*, double*, double);
+        void calc_path    (double*, double*);
+        void calc_cover   (double*, double*, double);
 
         void calc_sorted_prof(double*, double*, double*);
 
+        void calc_spectra(Mask*, const std::string, const double*, const double, const int[3]);
+
     private:
         int nstats;
 
+        Mask_index index;  ///< Index lists of the mask at the full levels.
+        Mask_index indexh; ///< Index lists of the mask at the half levels.
+
         // mask calculations
-        void calc_mask(double*, double*, double*, int*, int*, int*);
+        void calc_mask(unsigned char*, unsigned char*, unsigned char*);
+        void calc_mask_index(unsigned char*, int*, Mask_index&, const int);
+
+        template<class F>
+        double calc_masked_sum(const int, const int[3], F);
+
+        template<class F>
+        void visit_masked(const int, const int[3], F);
 
     protected:
         Model*  model;
@@ -140,6 +171,21 @@ class Stats
 
         std::string swstats;
 
+        // spectra
+        std::string swspectra;
+        std::vector<double> spectraz;         ///< Requested heights of the spectra.
+        std::vector<std::string> spectralist; ///< Variables of which spectra are computed, all if empty.
+        std::vector<int> spectrak;            ///< Full levels (without ghost cells) of the spectra.
+        std::vector<int> spectrakh;           ///< Half levels (without ghost cells) of the spectra.
+        int nkx;   ///< Number of wavenumbers in the x-direction.
+        int nky;   ///< Number of wavenumbers in the y-direction.
+        int nkh;   ///< Number of bins of the horizontal wavenumber.
+        double dkx;
+        double dky;
+        double dkh;
+
+        void create_spectra(Mask*);
+
         static const int nthres = 0;
 };
 #endif
@@ -29,6 +29,25 @@ class Grid;
 class Fields;
 struct Mask;
 
+/**
+ * Functor that evaluates the Brunt-Vaisala frequency of a single grid cell.
+ * All thermo schemes compute N2 as a centered vertical difference of their
+ * prognostic stratification variable times a level dependent factor, this
+ * allows other classes to get N2 inline in their kernels without a 3d field.
+ */
+struct N2_functor
+{
+    const double* s;   ///< Prognostic field that carries the stratification.
+    const double* fac; ///< Factor per level that converts the difference of s into N2.
+    int kk;            ///< Stride of one vertical level.
+    double bg;         ///< Background N2 that is not contained in s.
+
+    inline double operator()(const int ijk, const int k) const
+    {
+        return fac[k]*(s[ijk+kk] - s[ijk-kk]) + bg;
+    }
+};
+
 /**
  * Base class for the thermo scheme. This class is abstract and only
  * derived classes can be instantiated. Derived classes are
@@ -46,20 +65,22 @@ class Thermo
         virtual void init() = 0;
         virtual void create(Input*) = 0;
         virtual void exec() = 0;
-        virtual unsigned long get_time_limit(unsigned long, double) = 0;
+        virtual unsigned long get_time_limit(unsigned long, double, double) = 0; ///< Get the maximum time step for a given CFL number per unit time.
+        virtual double get_cfl_rate() = 0; ///< Calculate the CFL number per unit time of the thermodynamics on this process.
 
         virtual void exec_stats(Mask*) = 0;
         virtual void exec_cross(int) = 0;
         virtual void exec_dump(int) = 0;
         virtual void exec_column() = 0;
         
-        virtual void get_mask(Field3d*, Field3d*, Mask*) = 0;
+        virtual void get_mask(Mask*) = 0;
 
         // Interfacing functions to get buoyancy properties from other classes.
         virtual bool check_field_exists(std::string name) = 0;
         virtual void get_thermo_field(Field3d*, Field3d*, std::string name, bool cyclic) = 0;
         virtual void get_buoyancy_surf(Field3d*) = 0;
         virtual void get_buoyancy_fluxbot(Field3d*) = 0;
+        virtual N2_functor get_N2_functor(double*) = 0; ///< Get the N2 functor, the factors are stored in the passed profile.
         virtual void get_prog_vars(std::vector<std::string>*) = 0;
 
         virtual double get_buoyancy_diffusivity() = 0;
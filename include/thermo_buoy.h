@@ -42,13 +42,15 @@ class Thermo_buoy : public Thermo
         virtual ~Thermo_buoy();        ///< Destructor of the dry thermodynamics class.
 
         void exec(); ///< Add the tendencies belonging to the buoyancy.
-        unsigned long get_time_limit(unsigned long, double); ///< Compute the time limit (n/a for thermo_buoy)
+        unsigned long get_time_limit(unsigned long, double, double); ///< Compute the time limit (n/a for thermo_buoy)
+        double get_cfl_rate() { return 0.; }
 
         bool check_field_exists(std::string name);
         void get_buoyancy_surf(Field3d *);             ///< Compute the near-surface and bottom buoyancy for usage in another routine.
         void get_buoyancy_fluxbot(Field3d*);           ///< Compute the bottom buoyancy flux for usage in another routine.
+        N2_functor get_N2_functor(double*);            ///< Get the functor for the local N2 for usage in another routine.
         void get_prog_vars(std::vector<std::string>*); ///< Retrieve a list of prognostic variables.
-        void get_thermo_field(Field3d*, Field3d*, std::string name, bool cyclic); ///< Compute the buoyancy for usage in another routine.
+        void get_thermo_field(Field3d*, Field3d*, std::string name, bool cyclic); ///< Compute the buoyancy or N2 for usage in another routine.
         double get_buoyancy_diffusivity();
 
         // Empty functions that are allowed to pass.
@@ -58,7 +60,7 @@ class Thermo_buoy : public Thermo
         void exec_column() {}
         void exec_cross(int) {}
         void exec_dump(int) {}
-        void get_mask(Field3d*, Field3d*, Mask*) {}
+        void get_mask(Mask*) {}
         void update_time_dependent() {}
         
 #ifdef USECUDA
@@ -70,6 +72,7 @@ class Thermo_buoy : public Thermo
 
 private:
         void calc_buoyancy(double*, double*);              ///< Calculation of the buoyancy.
+        void calc_N2(double*, double*, double*);           ///< Calculation of the Brunt-Vaisala frequency.
         void calc_buoyancy_bot(double*, double*,
                                double*, double*);          ///< Calculation of the near-surface and surface buoyancy.
         void calc_buoyancy_fluxbot(double*, double*);      ///< Calculation of the buoyancy flux at the bottom.
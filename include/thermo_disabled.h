@@ -46,12 +46,13 @@ class Thermo_disabled : public Thermo
         void exec_column() {}        
         void exec_cross(int) {}
         void exec_dump(int) {}
-        void get_mask(Field3d*, Field3d*, Mask*) {}
+        void get_mask(Mask*) {}
         void get_prog_vars(std::vector<std::string>*) {}
         void update_time_dependent() {}
         double get_buoyancy_diffusivity();
 
-        unsigned long get_time_limit(unsigned long, double);
+        unsigned long get_time_limit(unsigned long, double, double);
+        double get_cfl_rate() { return 0.; }
 
 #ifdef USECUDA
         void prepare_device() {};
@@ -64,5 +65,6 @@ class Thermo_disabled : public Thermo
         void get_thermo_field(Field3d*, Field3d*, std::string name, bool cyclic) { throw 1; }
         void get_buoyancy_surf(Field3d*) { throw 1; }
         void get_buoyancy_fluxbot(Field3d*) { throw 1; }
+        N2_functor get_N2_functor(double*) { throw 1; }
 };
 #endif
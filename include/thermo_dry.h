@@ -45,7 +45,8 @@ class Thermo_dry : public Thermo
         void init();
         void create(Input*);
         void exec();                ///< Add the tendencies belonging to the buoyancy.
-        unsigned long get_time_limit(unsigned long, double); ///< Compute the time limit (n/a for thermo_dry)
+        unsigned long get_time_limit(unsigned long, double, double); ///< Compute the time limit (n/a for thermo_dry)
+        double get_cfl_rate() { return 0.; }
 
 
         void exec_stats(Mask*);
@@ -57,6 +58,7 @@ class Thermo_dry : public Thermo
         void get_thermo_field(Field3d*, Field3d*, std::string name, bool cyclic);
         void get_buoyancy_surf(Field3d *);             ///< Compute the near-surface and bottom buoyancy for usage in another routine.
         void get_buoyancy_fluxbot(Field3d*);           ///< Compute the bottom buoyancy flux for usage in another routine.
+        N2_functor get_N2_functor(double*);            ///< Get the functor for the local N2 for usage in another routine.
         void get_prog_vars(std::vector<std::string>*); ///< Retrieve a list of prognostic variables.
         double get_buoyancy_diffusivity();
 
@@ -69,7 +71,7 @@ class Thermo_dry : public Thermo
 #endif
 
         // Empty functions that are allowed to pass.
-        void get_mask(Field3d*, Field3d*, Mask*) {}
+        void get_mask(Mask*) {}
         void update_time_dependent() {}
 
     private:
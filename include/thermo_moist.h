@@ -40,9 +40,10 @@ class Thermo_moist : public Thermo
         void init();
         void create(Input*);
         void exec();
-        unsigned long get_time_limit(unsigned long, double); ///< Compute the time limit (only for sw_micro=1)
+        unsigned long get_time_limit(unsigned long, double, double); ///< Compute the time limit (only for sw_micro=2mom_warm)
+        double get_cfl_rate(); ///< Compute the sedimentation CFL number per unit time (only for sw_micro=2mom_warm)
 
-        void get_mask(Field3d*, Field3d*, Mask*);
+        void get_mask(Mask*);
         void exec_stats(Mask*);
         void exec_cross(int);
         void exec_dump(int);
@@ -53,6 +54,7 @@ class Thermo_moist : public Thermo
         void get_thermo_field(Field3d*, Field3d*, std::string name, bool cyclic);
         void get_buoyancy_surf(Field3d*);
         void get_buoyancy_fluxbot(Field3d*);
+        N2_functor get_N2_functor(double*);
         void get_prog_vars(std::vector<std::string>*); ///< Retrieve a list of prognostic variables.
         void update_time_dependent();
         double get_buoyancy_diffusivity();
@@ -75,6 +77,16 @@ class Thermo_moist : public Thermo
         int swtimedep_pbot; ///< Update surface pressure
         std::string thvar; ///< Name of prognostic potential temperature variable
 
+        // Field handles of the variables used every time step, set in init().
+        struct Handles
+        {
+            int thl, thlt; ///< Handles of the potential temperature and its tendency.
+            int qt,  qtt;  ///< Handles of the total water and its tendency.
+            int qr,  qrt;  ///< Handles of the rain water and its tendency (microphysics only).
+            int nr,  nrt;  ///< Handles of the rain number density and its tendency (microphysics only).
+        };
+        Handles h;
+
         // cross sections
         std::vector<std::string> crosslist;        ///< List with all crosses from ini file
         std::vector<std::string> allowedcrossvars; ///< List with allowed cross variables
@@ -86,8 +98,8 @@ class Thermo_moist : public Thermo
         Stats *stats;
 
         // masks
-        void calc_mask_ql    (double*, double*, double*, int *, int *, int *, double*);
-        void calc_mask_qlcore(double*, double*, double*, int *, int *, int *, double*, double*, double*);
+        void calc_mask_ql    (unsigned char*, unsigned char*, unsigned char*, double*);
+        void calc_mask_qlcore(unsigned char*, unsigned char*, unsigned char*, double*, double*, double*);
 
         void calc_buoyancy_tend_2nd(double*, double*, double*, double*, double*, double*, double*, double*);
         void calc_buoyancy_tend_4th(double*, double*, double*, double*, double*, double*, double*, double*);
@@ -40,9 +40,10 @@ class Thermo_vapor : public Thermo
         void init();
         void create(Input*);
         void exec();
-        unsigned long get_time_limit(unsigned long, double); ///< Compute the time limit (n/a for thermo_vapor)
+        unsigned long get_time_limit(unsigned long, double, double); ///< Compute the time limit (n/a for thermo_vapor)
+        double get_cfl_rate() { return 0.; }
 
-        void get_mask(Field3d*, Field3d*, Mask*){}
+        void get_mask(Mask*){}
         void exec_stats(Mask*);
         void exec_cross(int);
         void exec_dump(int);
@@ -53,6 +54,7 @@ class Thermo_vapor : public Thermo
         void get_thermo_field(Field3d*, Field3d*, std::string name, bool cyclic);
         void get_buoyancy_surf(Field3d*);
         void get_buoyancy_fluxbot(Field3d*);
+        N2_functor get_N2_functor(double*);
         void get_prog_vars(std::vector<std::string>*); ///< Retrieve a list of prognostic variables.
         void update_time_dependent();
         double get_buoyancy_diffusivity();
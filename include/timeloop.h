@@ -41,6 +41,7 @@ class Timeloop
 
         void step_time();
         void step_post_proc_time();
+        int  get_post_proc_iotime(int);
         void set_time_step();
         void set_time_step_limit();
         void set_time_step_limit(unsigned long);
@@ -70,6 +71,7 @@ class Timeloop
         unsigned long get_idt()   { return idt;   }
         int get_iotime()    { return iotime;    }
         int get_iteration() { return iteration; }
+        int get_post_proc_prefetch() { return postprefetch; }
 
     private:
         Master* master;
@@ -107,6 +109,7 @@ class Timeloop
         int iteration;
         int iotime;
         int iotimeprec;
+        int postprefetch;
 
         unsigned long itime;
         unsigned long istarttime;
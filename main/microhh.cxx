@@ -39,6 +39,9 @@ int main(int argc, char *argv[])
         // Initialize the input class and read the input data from disk.
         Input input(&master);
 
+        // Split the processes over the ensemble members, if an ensemble file is given.
+        master.start_ensemble(&input);
+
         // Initialize the model class.
         Model model(&master, &input);
 
@@ -0,0 +1,358 @@
+#
+#  MicroHH
+#  Copyright (c) 2011-2017 Chiel van Heerwaarden
+#  Copyright (c) 2011-2017 Thijs Heus
+#  Copyright (c) 2014-2017 Bart van Stratum
+#
+#  This file is part of MicroHH
+#
+#  MicroHH is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  MicroHH is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with MicroHH.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Performance regression suite. Runs reduced-size versions of a set of cases
+for a fixed number of time steps with [master] swprofile=1, collects the
+time per stage of the time loop and the throughput in cells per second from
+<simname>.timing, and compares them against a stored baseline.
+
+    python perf.py --microhh ../build/microhh
+    python perf.py --microhh ../build/microhh --nprocs 4 --mpirun "mpirun -np"
+    python perf.py --microhh ../build/microhh --update
+
+The report is written as plain text, such that two reports can be diffed.
+The script exits with 1 if any case is slower than the baseline allows.
+
+The baseline is stored in perf/baseline.json, with one entry per case and
+number of processes. Timings are machine-specific, so no baseline is shipped:
+create it on the machine that runs the suite with --update (make perf_update
+from the build directory), which stores the results of the cases that are run.
+Cases without a baseline are reported as NEW and never fail.
+"""
+
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+
+import numpy as np
+
+# Reduced-size cases. All cases run with a fixed time step, such that the
+# number of iterations is identical between runs, and with all output other
+# than the restart files at the end switched off.
+cases = {
+    'drycbl' : {
+        'case' : 'drycbl',
+        'simname' : 'drycbl',
+        'settings' : {
+            'grid' : {'itot' : 64, 'jtot' : 64, 'ktot' : 64},
+            'time' : {'dt' : 0.001} } },
+
+    'bomex' : {
+        'case' : 'bomex',
+        'simname' : 'bomex',
+        'settings' : {
+            'grid' : {'itot' : 32, 'jtot' : 32, 'ktot' : 32},
+            'time' : {'dt' : 2.} } },
+
+    # The stretched vertical grid of moser180 is flattened to an equidistant
+    # grid by regrid_prof, so the case does not cover the stretched grid.
+    'moser180' : {
+        'case' : 'moser180',
+        'simname' : 'moser180',
+        'settings' : {
+            'grid' : {'itot' : 64, 'jtot' : 48, 'ktot' : 64},
+            'time' : {'dt' : 0.5} } },
+
+    'taylorgreen' : {
+        'case' : 'taylorgreen/taylorgreen16_4th',
+        'simname' : 'taylorgreen',
+        'settings' : {
+            'grid' : {'itot' : 64, 'jtot' : 8, 'ktot' : 32},
+            'time' : {'dt' : 0.0025} } },
+
+    # The surface cases cover the regimes of the Obukhov length solver of
+    # Boundary_surface: unstable with a fixed buoyancy flux (drycblles) and
+    # stable with a fixed surface temperature (gabls1).
+    'drycblles' : {
+        'case' : 'drycblles',
+        'simname' : 'drycblles',
+        'settings' : {
+            'grid' : {'itot' : 32, 'jtot' : 32, 'ktot' : 32},
+            'time' : {'dt' : 6.} } },
+
+    'gabls1' : {
+        'case' : 'gabls1',
+        'simname' : 'gabls1',
+        'settings' : {
+            'grid' : {'itot' : 32, 'jtot' : 32, 'ktot' : 32},
+            'time' : {'dt' : 1.} } },
+}
+
+# Stages as written by Model::print_profile.
+stages = ['advec', 'diff', 'thermo', 'buffer', 'force', 'pres', 'boundary', 'output', 'timeloop', 'other']
+
+def read_ini(filename):
+    """ Read an .ini file as a list of lines. """
+    with open(filename) as f:
+        return f.read().splitlines()
+
+def set_ini_value(lines, block, item, value):
+    """ Set item in [block] to value, adding the item or the block if they do not exist. """
+    header = '[{}]'.format(block)
+    start = None
+    for n, line in enumerate(lines):
+        if line.strip() == header:
+            start = n
+            continue
+        if start is not None and line.strip().startswith('['):
+            break
+        if start is not None and line.split('=')[0].strip() == item:
+            lines[n] = '{}={}'.format(item, value)
+            return
+
+    if start is None:
+        lines += ['', header, '{}={}'.format(item, value)]
+    else:
+        # Insert directly after the last non-empty line of the block.
+        end = start + 1
+        for n in range(start+1, len(lines)):
+            if lines[n].strip().startswith('['):
+                break
+            if lines[n].strip() != '':
+                end = n + 1
+        lines.insert(end, '{}={}'.format(item, value))
+
+def get_ini_value(lines, block, item):
+    """ Return the value of item in [block], or None if it does not exist. """
+    inblock = False
+    for line in lines:
+        if line.strip().startswith('['):
+            inblock = line.strip() == '[{}]'.format(block)
+        elif inblock and line.split('=')[0].strip() == item:
+            return line.split('=', 1)[1].strip()
+    return None
+
+def regrid_prof(filename, ktot, zsize):
+    """ Interpolate all columns of a .prof file onto an equidistant grid of ktot levels. """
+    with open(filename) as f:
+        header = f.readline()
+    data = np.loadtxt(filename, skiprows=1, ndmin=2)
+
+    dz = zsize / ktot
+    z = np.linspace(0.5*dz, zsize-0.5*dz, ktot)
+
+    with open(filename, 'w') as f:
+        f.write(header)
+        for k in range(ktot):
+            row = [z[k]] + [np.interp(z[k], data[:,0], data[:,n]) for n in range(1, data.shape[1])]
+            f.write(' '.join('{0:1.14E}'.format(v) for v in row) + '\n')
+
+def prepare_case(name, case, srcdir, workdir, nsteps, npx, npy):
+    """ Copy a case into the work directory and reduce it. Returns the case directory and simulation name. """
+    casedir = os.path.join(workdir, name)
+    if os.path.exists(casedir):
+        shutil.rmtree(casedir)
+    shutil.copytree(os.path.join(srcdir, case['case']), casedir)
+
+    simname = case['simname']
+    inifile = os.path.join(casedir, simname + '.ini')
+
+    lines = read_ini(inifile)
+    for block, items in case['settings'].items():
+        for item, value in items.items():
+            set_ini_value(lines, block, item, value)
+
+    # Fix the number of time steps and switch off everything but the restart files.
+    dt = case['settings']['time']['dt']
+    endtime = '{0:.10g}'.format(nsteps*dt)
+    for block, item, value in [
+            ('master' , 'npx'         , npx       ),
+            ('master' , 'npy'         , npy       ),
+            ('master' , 'swprofile'   , 1         ),
+            ('time'   , 'adaptivestep', 'false'   ),
+            ('time'   , 'starttime'   , 0         ),
+            ('time'   , 'endtime'     , endtime   ),
+            ('time'   , 'savetime'    , endtime   ),
+            ('time'   , 'iotimeprec'  , -4        ),
+            ('time'   , 'outputiter'  , nsteps    ),
+            ('stats'  , 'swstats'     , 0         ),
+            ('budget' , 'swbudget'    , 0         ),
+            ('cross'  , 'swcross'     , 0         ),
+            ('dump'   , 'swdump'      , 0         ),
+            ('column' , 'swcolumn'    , 0         ),
+            ('average', 'swaverage'   , 0         )]:
+        set_ini_value(lines, block, item, value)
+
+    with open(inifile, 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+
+    # Create the profiles with the script of the case, and put them on the reduced grid.
+    env = dict(os.environ, MPLBACKEND='Agg')
+    profscript = [f for f in os.listdir(casedir) if f.endswith('prof.py')]
+    for script in profscript:
+        subprocess.check_call([sys.executable, script], cwd=casedir, env=env, stdout=subprocess.DEVNULL)
+
+    ktot = int(get_ini_value(lines, 'grid', 'ktot'))
+    zsize = float(get_ini_value(lines, 'grid', 'zsize'))
+    regrid_prof(os.path.join(casedir, simname + '.prof'), ktot, zsize)
+
+    return casedir, simname
+
+def read_timing(filename):
+    """ Read the <simname>.timing file written by MicroHH. """
+    timing = {'stages' : {}}
+    with open(filename) as f:
+        for line in f:
+            words = line.split()
+            if len(words) == 0 or words[0].startswith('#'):
+                continue
+            if words[0] in stages:
+                timing['stages'][words[0]] = {'time' : float(words[1]), 'fraction' : float(words[2])}
+            elif words[0] in ['iterations', 'nprocs']:
+                timing[words[0]] = int(words[1])
+            else:
+                timing[words[0]] = float(words[1])
+    return timing
+
+def run_case(microhh, mpirun, nprocs, casedir, simname, logfile):
+    """ Run the init and run phase of a case. """
+    cmd = [os.path.abspath(microhh)]
+    if nprocs > 1:
+        cmd = mpirun.split() + [str(nprocs)] + cmd
+    with open(logfile, 'w') as log:
+        for mode in ['init', 'run']:
+            subprocess.check_call(cmd + [mode, simname], cwd=casedir, stdout=log, stderr=subprocess.STDOUT)
+    return read_timing(os.path.join(casedir, simname + '.timing'))
+
+def compare(result, base, tol_throughput, tol_stage, min_fraction):
+    """ Compare a result against its baseline. Returns a list of regression messages. """
+    messages = []
+    if result['iterations'] != base['iterations'] or result['cells'] != base['cells']:
+        messages.append('iterations or cells differ from the baseline, update the baseline')
+        return messages
+
+    change = result['cellspersecond'] / base['cellspersecond'] - 1.
+    if change < -tol_throughput:
+        messages.append('throughput {0:+.1f}% (tolerance -{1:.1f}%)'.format(100.*change, 100.*tol_throughput))
+
+    for stage in stages:
+        if stage not in base['stages'] or stage not in result['stages']:
+            continue
+        tbase = base['stages'][stage]['time']
+        if base['stages'][stage]['fraction'] < min_fraction or tbase <= 0.:
+            continue
+        change = result['stages'][stage]['time'] / tbase - 1.
+        if change > tol_stage:
+            messages.append('{0} {1:+.1f}% (tolerance +{2:.1f}%)'.format(stage, 100.*change, 100.*tol_stage))
+    return messages
+
+def write_report(f, key, result, base, messages):
+    f.write('case {}\n'.format(key))
+    f.write('  {0:<14s} {1:>14d}\n'.format('iterations', result['iterations']))
+    f.write('  {0:<14s} {1:>14.0f}\n'.format('cells', result['cells']))
+    f.write('  {0:<14s} {1:>14s} {2:>14s} {3:>8s}\n'.format('', 'value', 'baseline', 'change'))
+
+    def row(label, value, basevalue):
+        if basevalue is None or basevalue <= 0.:
+            f.write('  {0:<14s} {1:14.4E} {2:>14s} {3:>8s}\n'.format(label, value, '-', '-'))
+        else:
+            f.write('  {0:<14s} {1:14.4E} {2:14.4E} {3:+7.1f}%\n'.format(label, value, basevalue, 100.*(value/basevalue-1.)))
+
+    row('cells/s', result['cellspersecond'], base['cellspersecond'] if base else None)
+    row('total [s]', result['total'], base['total'] if base else None)
+    for stage in stages:
+        if stage in result['stages']:
+            basetime = base['stages'][stage]['time'] if (base and stage in base['stages']) else None
+            row(stage + ' [s]', result['stages'][stage]['time'], basetime)
+
+    if base is None:
+        f.write('  status NEW, no baseline, create it with --update\n')
+    elif len(messages) == 0:
+        f.write('  status OK\n')
+    else:
+        f.write('  status REGRESSION\n')
+        for m in messages:
+            f.write('    {}\n'.format(m))
+    f.write('\n')
+
+def main():
+    path = os.path.dirname(os.path.abspath(__file__))
+
+    parser = argparse.ArgumentParser(description='MicroHH performance regression suite')
+    parser.add_argument('--microhh', required=True, help='path to the microhh executable')
+    parser.add_argument('--cases', nargs='+', default=sorted(cases.keys()), choices=sorted(cases.keys()))
+    parser.add_argument('--steps', type=int, default=50, help='number of time steps per case')
+    parser.add_argument('--nprocs', type=int, default=1, help='number of MPI processes')
+    parser.add_argument('--npx', type=int, default=1, help='number of processes in x, npy = nprocs/npx')
+    parser.add_argument('--mpirun', default='mpirun -np', help='MPI launcher, followed by the number of processes')
+    parser.add_argument('--workdir', default='perf_work', help='directory in which the cases are run')
+    parser.add_argument('--baseline', default=os.path.join(path, 'baseline.json'))
+    parser.add_argument('--report', default='perf_report.txt')
+    parser.add_argument('--update', action='store_true', help='store the results as the new baseline')
+    parser.add_argument('--tol-throughput', type=float, default=0.10, help='allowed relative loss of throughput')
+    parser.add_argument('--tol-stage', type=float, default=0.25, help='allowed relative increase of the time of a stage')
+    parser.add_argument('--min-fraction', type=float, default=0.05, help='only check stages above this fraction of the total')
+    args = parser.parse_args()
+
+    if args.nprocs % args.npx != 0:
+        parser.error('nprocs = {} is not a multiple of npx = {}'.format(args.nprocs, args.npx))
+    npy = args.nprocs // args.npx
+
+    baseline = {}
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    if not os.path.exists(args.workdir):
+        os.makedirs(args.workdir)
+
+    nregressions = 0
+    with open(args.report, 'w') as report:
+        report.write('MicroHH performance report, {} steps, nprocs = {} (npx = {}, npy = {})\n\n'.format(
+            args.steps, args.nprocs, args.npx, npy))
+
+        for name in args.cases:
+            # Baselines depend on the decomposition, so store them per number of processes.
+            key = '{}/np{}'.format(name, args.nprocs)
+            print('Running {}'.format(key))
+
+            casedir, simname = prepare_case(name, cases[name], os.path.join(path, '..', 'cases'),
+                                            args.workdir, args.steps, args.npx, npy)
+            result = run_case(args.microhh, args.mpirun, args.nprocs, casedir, simname,
+                              os.path.join(casedir, 'perf.log'))
+
+            base = baseline.get(key)
+            messages = [] if base is None else compare(result, base, args.tol_throughput, args.tol_stage, args.min_fraction)
+            nregressions += len(messages) > 0
+            write_report(report, key, result, base, messages)
+
+            if args.update:
+                baseline[key] = result
+
+        report.write('{} of {} cases regressed\n'.format(nregressions, len(args.cases)))
+
+    if args.update:
+        with open(args.baseline, 'w') as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+            f.write('\n')
+
+    with open(args.report) as f:
+        sys.stdout.write(f.read())
+
+    return 1 if (nregressions > 0 and not args.update) else 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -2,6 +2,8 @@ import numpy   as np
 import struct  as st
 import netCDF4 as nc4
 
+import microhh_tools as mht     # available in microhh/python directory
+
 # Settings -------
 variable   = 'w'
 nx         = 32
@@ -91,12 +93,10 @@ for t in range(nt):
 
     var_t[t] = time * 10**iotimeprec
 
-    fin = open("%s.%07i"%(variable, time),"rb")
+    field = mht.read_output_file("%s.%07i"%(variable, time), nx, ny, nz, endian)
     for k in range(nzsave):
-        raw = fin.read(nx*ny*8)
-        tmp = np.array(st.unpack('{0}{1}d'.format(en, nx*ny), raw))
-        var_3d[t,k,:,:] = tmp.reshape((ny, nx))[:nysave,:nxsave]
-    fin.close()
+        var_3d[t,k,:,:] = field[k,:nysave,:nxsave]
+    del(field)
     ncfile.sync()
 
 ncfile.close()
@@ -2,7 +2,9 @@ import netCDF4 as nc4
 import numpy   as np
 import struct  as st
 import glob
+import os
 import re
+import zlib
 
 # -------------------------
 # General help functions
@@ -218,11 +220,149 @@ def write_restart_file(data, itot, jtot, ktot, path, per_slice=True, endian='lit
         fout.close()  
 
 
+def _decode_output(raw, itot, jtot, ktot, en):
+    """ Decode the bytes of a cross-section or 3D dump into a 3D numpy array, ordered as [z,y,x] """
+
+    if raw[:8] != b'MHHENC01':
+        return np.frombuffer(raw, dtype='{}f8'.format(en), count=itot*jtot*ktot).reshape((ktot, jtot, itot))
+
+    precision, compression, itot, jtot, ktot, nblocks = st.unpack('{}6i'.format(en), raw[8:32])
+    tolerance, = st.unpack('{}d'.format(en), raw[32:40])
+
+    dtype = np.dtype('{0}{1}'.format(en, ['f8', 'f4', 'f2', 'i2'][precision]))
+    field = np.empty((ktot, jtot, itot))
+
+    pos = 40 + 48*nblocks
+    for b in range(nblocks):
+        i0, j0, k0, ni, nj, nk, nbytes, scale, offset = st.unpack('{}6iq2d'.format(en), raw[40+48*b:88+48*b])
+        n     = ni*nj*nk
+        block = raw[pos:pos+nbytes]
+        pos  += nbytes
+
+        # undo the compression and the byte shuffle
+        if (compression != 0):
+            shuffled = np.frombuffer(zlib.decompress(block), dtype=np.uint8)
+            block = shuffled.reshape((dtype.itemsize, n)).T.tobytes()
+
+        values = np.frombuffer(block, dtype=dtype, count=n).astype(np.float64)
+        # the fill value overflows to infinity in half precision
+        if (precision == 2):
+            values[np.isinf(values)] = nc4.default_fillvals['f8']
+        elif (precision == 3):
+            fill   = values == -32768
+            values = offset + scale*values
+            values[fill] = nc4.default_fillvals['f8']
+
+        field[k0:k0+nk, j0:j0+nj, i0:i0+ni] = values.reshape((nk, nj, ni))
+
+    return field
+
+
+def read_output_file(path, itot, jtot, ktot, endian='little'):
+    """ Read a cross-section or 3D dump into a 3D numpy array, ordered as [z,y,x]. Files without
+        header contain plain doubles, files written with a [cross] or [dump] precision or compression
+        start with the header "MHHENC01" that describes the encoding of the blocks """
+
+    en = _process_endian(endian)
+
+    f = open(path, 'rb')
+    magic = f.read(8)
+    if magic != b'MHHENC01':
+        f.close()
+        return np.memmap(path, dtype='{}f8'.format(en), mode='r', shape=(ktot, jtot, itot))
+
+    raw = magic + f.read()
+    f.close()
+    return _decode_output(raw, itot, jtot, ktot, en)
+
+
+def read_container_index(path, endian='little'):
+    """ Read the time index of a cross-section container ([cross] swcontainer=1) into a
+        dictionary that gives the offset and size of the slice for each output time """
+
+    en = _process_endian(endian)
+
+    f = open(path, 'rb')
+    if f.read(8) != b'MHHCNT01':
+        f.close()
+        raise Exception('{} is not a cross-section container'.format(path))
+
+    capacity, = st.unpack('{}i'.format(en), f.read(8)[:4])
+
+    index = {}
+    table = 16
+    while (table != 0):
+        f.seek(table)
+        raw   = f.read(8 + 24*capacity)
+        table, = st.unpack('{}q'.format(en), raw[:8])
+        for n in range(capacity):
+            iotime, pad, offset, nbytes = st.unpack('{}2i2q'.format(en), raw[8+24*n:32+24*n])
+            if (nbytes == 0):
+                break
+            index[iotime] = (offset, nbytes)
+
+    f.close()
+    return index
+
+
+# Index of each container that has been read, with the size and modification time of the file at that moment
+_container_indices = {}
+
+def _get_container_index(name, endian):
+    """ Return the index of a container, which is only read again if the container has changed """
+
+    stat = os.stat(name)
+    key  = (name, endian)
+    if key not in _container_indices or _container_indices[key][0] != (stat.st_size, stat.st_mtime):
+        _container_indices[key] = ((stat.st_size, stat.st_mtime), read_container_index(name, endian))
+    return _container_indices[key][1]
+
+
+def read_cross_section(variable, mode, index, iotime, itot, jtot, ktot, endian='little'):
+    """ Read a cross-section from its own file, or from the container of the slice if that file does
+        not exist. The index is None for planes without index (e.g. surface fluxes). The returned array
+        is ordered as [z,y,x], None is returned if the cross-section does not exist """
+
+    if index is None:
+        name = '{0}.{1}'.format(variable, mode)
+    else:
+        name = '{0}.{1}.{2:05d}'.format(variable, mode, index)
+
+    path = '{0}.{1:07d}'.format(name, iotime)
+    try:
+        return read_output_file(path, itot, jtot, ktot, endian)
+    except IOError:
+        pass
+
+    try:
+        entries = _get_container_index(name, endian)
+    except (IOError, OSError):
+        return None
+
+    if iotime not in entries:
+        return None
+
+    offset, nbytes = entries[iotime]
+    f = open(name, 'rb')
+    f.seek(offset)
+    raw = f.read(nbytes)
+    f.close()
+
+    return _decode_output(raw, itot, jtot, ktot, _process_endian(endian))
+
+
 def get_cross_indices(variable, mode):
     """ Find the cross-section indices given a variable name and mode (in 'xy','xz','yz') """
     if mode not in ['xy','xz','yz']:
         raise ValueError('\"mode\" should be in {\"xy\", \"xz\", \"yz\"}')
 
+    # Get a list of all the cross-section containers, which have no time in their name
+    files = glob.glob('{}.{}.[0-9][0-9][0-9][0-9][0-9]'.format(variable, mode))
+    if len(files) > 0:
+        indices = [int(f.split('.')[-1]) for f in files]
+        indices.sort()
+        return indices
+
     # Get a list of all the cross-section files
     files = glob.glob('{}.{}.*.*'.format(variable, mode))
     if len(files) == 0:
@@ -107,12 +107,10 @@ for crossname in variables:
         for k in range(np.size(indexes_local)):
             index = indexes_local[k]
             otime = int((starttime + t*sampletime) / 10**iotimeprec)
-            f_in  = "{0:}.xy.{1:05d}.{2:07d}".format(crossname, index, otime)
-    
-            try:
-                fin = open(f_in, "rb")
-            except:
-                print('Stopping: cannot find file {}'.format(f_in))
+            s     = mht.read_cross_section(crossname, 'xy', index, otime, nx, ny, 1, endian)
+
+            if s is None:
+                print('Stopping: cannot find cross-section {0}.xy.{1:05d} at time {2:07d}'.format(crossname, index, otime))
                 crossfile.sync()
                 stop = True
                 break
@@ -121,15 +119,7 @@ for crossname in variables:
 
             var_t[t] = otime * 10**iotimeprec
             var_z[k] = z[index] if locz=='z' else zh[index] 
-    
-            fin = open("{0:}.xy.{1:05d}.{2:07d}".format(crossname, index, otime), "rb")
-            raw = fin.read(nx*ny*8)
-            tmp = np.array(st.unpack('{0}{1}d'.format(en, nx*ny), raw))
-            del(raw)
-            s = tmp.reshape((ny, nx))
-            del(tmp)
-            var_s[t,k,:,:] = s[:nysave,:nxsave]
+
+            var_s[t,k,:,:] = s[0,:nysave,:nxsave]
             del(s)
-    
-            fin.close()
     crossfile.close() 
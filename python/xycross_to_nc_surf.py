@@ -2,6 +2,8 @@ import numpy   as np
 import struct  as st
 import netCDF4 as nc4
 
+import microhh_tools as mht     # available in microhh/python directory
+
 # Settings -------
 variables  = ['bfluxbot']
 nx         = 2048
@@ -91,24 +93,16 @@ for crossname in variables:
     for t in range(niter):
         otime = int((starttime + t*sampletime) / 10**iotimeprec)
     
-        try:
-            fin = open("{0:}.xy.{1:07d}".format(crossname, otime), "rb")
-        except:
+        s = mht.read_cross_section(crossname, 'xy', None, otime, nx, ny, 1, endian)
+        if s is None:
             crossfile.sync()
             break
     
         print("Processing %8s, time=%7i"%(crossname, otime))
 
         var_t[t] = otime * 10**iotimeprec
-    
-        raw = fin.read(nx*ny*8)
-        tmp = np.array(st.unpack('{0}{1}d'.format(en, nx*ny), raw))
-        del(raw)
-        s = tmp.reshape((ny, nx))
-        del(tmp)
-        var_s[t,:,:] = s[:nysave,:nxsave]
+
+        var_s[t,:,:] = s[0,:nysave,:nxsave]
         del(s)
-    
-        fin.close()
 
     crossfile.close() 
@@ -107,12 +107,10 @@ for crossname in variables:
         for i in range(np.size(indexes_local)):
             index = indexes_local[i]
             otime = int((starttime + t*sampletime) / 10**iotimeprec)
-            f_in  = "{0:}.xz.{1:05d}.{2:07d}".format(crossname, index, otime)
+            s     = mht.read_cross_section(crossname, 'xz', index, otime, nx, 1, nz, endian)
 
-            try:
-                fin = open(f_in, "rb")
-            except:
-                print('Stopping: cannot find file {}'.format(f_in))
+            if s is None:
+                print('Stopping: cannot find cross-section {0}.xz.{1:05d} at time {2:07d}'.format(crossname, index, otime))
                 crossfile.sync()
                 stop = True
                 break
@@ -121,14 +119,8 @@ for crossname in variables:
 
             var_t[t] = otime * 10**iotimeprec
             var_y[i] = y[index] if locy=='y' else yh[index] 
-    
-            raw = fin.read(nx*nz*8)
-            tmp = np.array(st.unpack('{0}{1}d'.format(en, nx*nz), raw))
-            del(raw)
-            s = tmp.reshape((nz, nx))
-            del(tmp)
-            var_s[t,:,:,i] = s[:nzsave,:nxsave]
+
+            var_s[t,:,:,i] = s[:nzsave,0,:nxsave]
             del(s)
-            fin.close()
 
     crossfile.close() 
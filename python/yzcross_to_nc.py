@@ -107,12 +107,10 @@ for crossname in variables:
         for i in range(np.size(indexes_local)):
             index = indexes_local[i]
             otime = int((starttime + t*sampletime) / 10**iotimeprec)
-            f_in  = "{0:}.yz.{1:05d}.{2:07d}".format(crossname, index, otime)
+            s     = mht.read_cross_section(crossname, 'yz', index, otime, 1, ny, nz, endian)
 
-            try:
-                fin = open(f_in, "rb")
-            except:
-                print('Stopping: cannot find file {}'.format(f_in))
+            if s is None:
+                print('Stopping: cannot find cross-section {0}.yz.{1:05d} at time {2:07d}'.format(crossname, index, otime))
                 crossfile.sync()
                 stop = True
                 break
@@ -121,14 +119,8 @@ for crossname in variables:
 
             var_t[t] = otime * 10**iotimeprec
             var_x[i] = x[index] if locy=='x' else xh[index] 
-    
-            raw = fin.read(ny*nz*8)
-            tmp = np.array(st.unpack('{0}{1}d'.format(en, ny*nz), raw))
-            del(raw)
-            s = tmp.reshape((nz, ny))
-            del(tmp)
-            var_s[t,:,i,:] = s[:nzsave,:nysave]
+
+            var_s[t,:,i,:] = s[:nzsave,:nysave,0]
             del(s)
-            fin.close()
 
     crossfile.close() 
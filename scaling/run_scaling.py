@@ -0,0 +1,225 @@
+#
+#  MicroHH
+#  Copyright (c) 2011-2017 Chiel van Heerwaarden
+#  Copyright (c) 2011-2017 Thijs Heus
+#  Copyright (c) 2014-2017 Bart van Stratum
+#
+#  This file is part of MicroHH
+#
+#  MicroHH is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  MicroHH is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with MicroHH.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Local scaling driver. Runs the strongscaling or weakscaling case for a sweep
+over process decompositions with a local MPI launcher and [master] swprofile=1,
+and writes speedup and efficiency tables per part of the time loop.
+
+Strong scaling keeps the total grid fixed:
+    python run_scaling.py strong --microhh ../build/microhh --grid 128 128 128 --decomp 1x1 1x2 2x2 2x4
+Weak scaling keeps the grid per process fixed:
+    python run_scaling.py weak --microhh ../build/microhh --block 32 32 --ktot 128 --decomp 1x1 1x2 2x2 2x4
+
+The total time per iteration is written to <mode>scaling.<grid>.local in the format
+of the timing tables in this directory, such that scaling.py can plot it.
+"""
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'perf'))
+from perf import set_ini_value, get_ini_value, read_ini, regrid_prof, read_timing, stages
+
+# Parts of the time loop that are shown in the tables. The communication is
+# measured inside the stages, so compute is the total minus the communication.
+parts = ['total', 'compute', 'transpose', 'halo'] + stages
+
+def decompositions(names):
+    decomp = []
+    for name in names:
+        npx, npy = name.split('x')
+        decomp.append((int(npx), int(npy)))
+    return sorted(decomp, key=lambda d: (d[0]*d[1], d[0]))
+
+def check_grid(itot, jtot, ktot, npx, npy):
+    """ Returns the reason why a grid cannot be decomposed, or None. Mirrors the checks in Grid. """
+    if itot % npx != 0 or itot % npy != 0:
+        return 'itot = {} is not a multiple of npx and npy'.format(itot)
+    if jtot % npx != 0 or jtot % npy != 0:
+        return 'jtot = {} is not a multiple of npx and npy'.format(jtot)
+    if ktot % npx != 0:
+        return 'ktot = {} is not a multiple of npx'.format(ktot)
+    return None
+
+def prepare_run(casedir, simname, rundir, itot, jtot, ktot, npx, npy, nsteps):
+    """ Copy the case to the run directory and set the grid, decomposition and number of steps. """
+    if os.path.exists(rundir):
+        shutil.rmtree(rundir)
+    shutil.copytree(casedir, rundir)
+
+    inifile = os.path.join(rundir, simname + '.ini')
+    lines = read_ini(inifile)
+
+    dt = float(get_ini_value(lines, 'time', 'dt'))
+    endtime = '{0:.10g}'.format(nsteps*dt)
+    for block, item, value in [
+            ('master', 'npx'         , npx    ),
+            ('master', 'npy'         , npy    ),
+            ('master', 'swprofile'   , 1      ),
+            ('grid'  , 'itot'        , itot   ),
+            ('grid'  , 'jtot'        , jtot   ),
+            ('grid'  , 'ktot'        , ktot   ),
+            ('time'  , 'adaptivestep', 'false'),
+            ('time'  , 'starttime'   , 0      ),
+            ('time'  , 'endtime'     , endtime),
+            ('time'  , 'savetime'    , endtime),
+            ('time'  , 'iotimeprec'  , -4     ),
+            ('time'  , 'outputiter'  , nsteps ),
+            ('stats' , 'swstats'     , 0      ),
+            ('cross' , 'swcross'     , 0      )]:
+        set_ini_value(lines, block, item, value)
+
+    with open(inifile, 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+
+    # The profile scripts of the scaling cases have a fixed number of levels.
+    env = dict(os.environ, MPLBACKEND='Agg')
+    subprocess.check_call([sys.executable, simname + 'prof.py'], cwd=rundir, env=env, stdout=subprocess.DEVNULL)
+    regrid_prof(os.path.join(rundir, simname + '.prof'), ktot, float(get_ini_value(lines, 'grid', 'zsize')))
+
+def run(microhh, mpirun, nprocs, rundir, simname):
+    cmd = mpirun.split() + [str(nprocs), os.path.abspath(microhh)]
+    with open(os.path.join(rundir, 'scaling.log'), 'w') as log:
+        for mode in ['init', 'run']:
+            subprocess.check_call(cmd + [mode, simname], cwd=rundir, stdout=log, stderr=subprocess.STDOUT)
+    return read_timing(os.path.join(rundir, simname + '.timing'))
+
+def part_times(timing):
+    """ Time per iteration of each part of the time loop. """
+    niter = max(timing['iterations'], 1)
+    times = {'total'     : timing['total'],
+             'transpose' : timing.get('transpose', 0.),
+             'halo'      : timing.get('halo', 0.)}
+    times['compute'] = times['total'] - times['transpose'] - times['halo']
+    for stage in stages:
+        times[stage] = timing['stages'][stage]['time'] if stage in timing['stages'] else 0.
+    return dict((part, t/niter) for part, t in times.items())
+
+def write_tables(f, mode, results):
+    """ Write the time per iteration, speedup and efficiency relative to the first run. """
+    p0, t0 = results[0]['nprocs'], results[0]['times']
+
+    f.write('# {} scaling, times in s per iteration, speedup and efficiency relative to {} processes\n'.format(mode, p0))
+    f.write('# {0:>6s} {1:>4s} {2:>4s} {3:>6s} {4:>6s} {5:>6s}\n'.format('nprocs', 'npx', 'npy', 'itot', 'jtot', 'ktot'))
+    for r in results:
+        f.write('  {0:6d} {1:4d} {2:4d} {3:6d} {4:6d} {5:6d}\n'.format(
+            r['nprocs'], r['npx'], r['npy'], r['itot'], r['jtot'], r['ktot']))
+    f.write('\n')
+
+    for part in parts:
+        f.write('[{}]\n'.format(part))
+        f.write('  {0:>6s} {1:>12s} {2:>10s} {3:>10s}\n'.format('nprocs', 'time', 'speedup', 'efficiency'))
+        for r in results:
+            t = r['times'][part]
+            p = r['nprocs']
+            if t <= 0. or t0[part] <= 0.:
+                f.write('  {0:6d} {1:12.4E} {2:>10s} {3:>10s}\n'.format(p, t, '-', '-'))
+                continue
+
+            # In strong scaling the work per process drops with the number of processes,
+            # in weak scaling it stays constant, such that the ideal time is t0.
+            if mode == 'strong':
+                speedup = t0[part] / t
+                efficiency = speedup * p0 / p
+            else:
+                efficiency = t0[part] / t
+                speedup = efficiency * p / p0
+            f.write('  {0:6d} {1:12.4E} {2:10.3f} {3:10.3f}\n'.format(p, t, speedup, efficiency))
+        f.write('\n')
+
+def main():
+    path = os.path.dirname(os.path.abspath(__file__))
+
+    parser = argparse.ArgumentParser(description='MicroHH local scaling driver')
+    parser.add_argument('--microhh', required=True, help='path to the microhh executable')
+    parser.add_argument('--mpirun', default='mpirun -np', help='MPI launcher, followed by the number of processes')
+    parser.add_argument('--decomp', nargs='+', default=['1x1', '1x2', '2x2', '2x4'], help='decompositions as npxXnpy')
+    parser.add_argument('--steps', type=int, default=20, help='number of time steps per run')
+    parser.add_argument('--workdir', default='scaling_work', help='directory in which the runs are done')
+    parser.add_argument('mode', choices=['strong', 'weak'], help='strong: fixed total grid, weak: fixed grid per process')
+    parser.add_argument('--grid', type=int, nargs=3, default=[128, 128, 128], metavar=('ITOT', 'JTOT', 'KTOT'),
+                        help='total grid of the strong scaling')
+    parser.add_argument('--block', type=int, nargs=2, default=[32, 32], metavar=('IMAX', 'JMAX'),
+                        help='horizontal grid per process of the weak scaling')
+    parser.add_argument('--ktot', type=int, default=128, help='vertical grid of the weak scaling')
+    args = parser.parse_args()
+
+    simname = 'strongscaling' if args.mode == 'strong' else 'weakscaling'
+    casedir = os.path.join(path, '..', 'cases', simname)
+
+    if not os.path.exists(args.workdir):
+        os.makedirs(args.workdir)
+
+    results = []
+    for npx, npy in decompositions(args.decomp):
+        if args.mode == 'strong':
+            itot, jtot, ktot = args.grid
+        else:
+            itot, jtot, ktot = args.block[0]*npx, args.block[1]*npy, args.ktot
+
+        error = check_grid(itot, jtot, ktot, npx, npy)
+        if error is not None:
+            print('Skipping {}x{}: {}'.format(npx, npy, error))
+            continue
+
+        print('Running {}x{} on a {}x{}x{} grid'.format(npx, npy, itot, jtot, ktot))
+        rundir = os.path.join(args.workdir, '{}_{}x{}'.format(args.mode, npx, npy))
+        prepare_run(casedir, simname, rundir, itot, jtot, ktot, npx, npy, args.steps)
+        timing = run(args.microhh, args.mpirun, npx*npy, rundir, simname)
+
+        results.append({'nprocs' : npx*npy, 'npx' : npx, 'npy' : npy,
+                        'itot' : itot, 'jtot' : jtot, 'ktot' : ktot, 'times' : part_times(timing)})
+
+    if len(results) == 0:
+        print('No decomposition could be run')
+        return 1
+
+    if args.mode == 'strong':
+        label = '{}x{}x{}'.format(*args.grid)
+    else:
+        label = '{}x{}x{}'.format(args.block[0], args.block[1], args.ktot)
+
+    # Full tables per part of the time loop.
+    tablefile = '{}scaling.{}.tables'.format(args.mode, label)
+    with open(tablefile, 'w') as f:
+        write_tables(f, args.mode, results)
+
+    # Total time per iteration in the format of the other timing tables.
+    with open('{}scaling.{}.local'.format(args.mode, label), 'w') as f:
+        if args.mode == 'strong':
+            f.write('#strongscaling case {}, procs, time per iteration\n'.format(label))
+        else:
+            f.write('#weak scaling, every proc has {} grid points, nprocs, time per iteration\n'.format(label))
+        for r in results:
+            f.write('{0:d}\t{1:.6f}\n'.format(r['nprocs'], r['times']['total']))
+
+    with open(tablefile) as f:
+        sys.stdout.write(f.read())
+
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -48,6 +48,7 @@ Advec::Advec(Model* modelin, Input* inputin)
     nerror += inputin->get_item(&cflmax, "advec", "cflmax", "", 1.);
 
     swadvec = "0";
+    cfl_rate = 0.;
 
     if (nerror)
         throw 1;
@@ -85,4 +86,22 @@ std::string Advec::get_switch()
     return swadvec;
 }
 
+unsigned long Advec::get_time_limit(unsigned long idt, double dt, double cflrate)
+{
+    // Prevent zero divisions.
+    const double cfl = std::max(cflmin, cflrate*dt);
+    return idt * cflmax / cfl;
+}
+
+void Advec::calc_cfl_rate()
+{
+    // The CFL number is linear in the time step.
+    cfl_rate = get_cfl(1.);
+}
+
+double Advec::get_cfl_rate()
+{
+    return cfl_rate;
+}
+
 const double Advec::cflmin = 1.E-5;
@@ -27,6 +27,8 @@
 #include "constants.h"
 #include "tools.h"
 #include "finite_difference.h"
+#include "model.h"
+#include "timeloop.h"
 
 using namespace Finite_difference::O2;
 
@@ -136,16 +138,6 @@ namespace
 }
 
 #ifdef USECUDA
-unsigned long Advec_2::get_time_limit(unsigned long idt, double dt)
-{
-    // Calculate cfl and prevent zero divisons.
-    double cfl = get_cfl(dt);
-    cfl = std::max(cflmin, cfl);
-    const unsigned long idtlim = idt * cflmax / cfl;
-
-    return idtlim;
-}
-
 double Advec_2::get_cfl(const double dt)
 {
     const int blocki = grid->ithread_block;
@@ -178,6 +170,10 @@ double Advec_2::get_cfl(const double dt)
 
 void Advec_2::exec()
 {
+    // On the GPU, the CFL number per unit time of the first substep is computed in a separate kernel.
+    if (!model->timeloop->in_substep())
+        cfl_rate = get_cfl(1.);
+
     const int blocki = grid->ithread_block;
     const int blockj = grid->jthread_block;
     const int gridi  = grid->imax/blocki + (grid->imax%blocki > 0);
@@ -30,9 +30,21 @@
 #include "constants.h"
 #include "finite_difference.h"
 #include "model.h"
+#include "timeloop.h"
 
 using namespace Finite_difference::O2;
 
+namespace
+{
+    // CFL number per unit time of a single grid cell.
+    inline double calc_cfl_cell(const double* const restrict u, const double* const restrict v, const double* const restrict w,
+                                const int ijk, const int ii, const int jj, const int kk,
+                                const double dxi, const double dyi, const double dzi)
+    {
+        return std::abs(interp2(u[ijk], u[ijk+ii]))*dxi + std::abs(interp2(v[ijk], v[ijk+jj]))*dyi + std::abs(interp2(w[ijk], w[ijk+kk]))*dzi;
+    }
+}
+
 Advec_2::Advec_2(Model* modelin, Input* inputin) : Advec(modelin, inputin)
 {
     swadvec = "2";
@@ -48,25 +60,22 @@ double Advec_2::get_cfl(double dt)
     return calc_cfl(fields->u->data, fields->v->data, fields->w->data, grid->dzi, dt);
 }
 
-unsigned long Advec_2::get_time_limit(unsigned long idt, double dt)
-{
-    // Calculate cfl and prevent zero divisons.
-    double cfl = calc_cfl(fields->u->data, fields->v->data, fields->w->data, grid->dzi, dt);
-    cfl = std::max(cflmin, cfl);
-    return idt * cflmax / cfl;
-}
-
 void Advec_2::exec()
 {
-    advec_u(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi,
-            fields->rhoref, fields->rhorefh);
+    // In the first substep, the CFL number per unit time is a by-product of the u-advection.
+    if (model->timeloop->in_substep())
+        advec_u<false>(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi,
+                       fields->rhoref, fields->rhorefh);
+    else
+        cfl_rate = advec_u<true>(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi,
+                                 fields->rhoref, fields->rhorefh);
     advec_v(fields->vt->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi,
             fields->rhoref, fields->rhorefh);
     advec_w(fields->wt->data, fields->u->data, fields->v->data, fields->w->data, grid->dzhi,
             fields->rhoref, fields->rhorefh);
 
-    for (FieldMap::const_iterator it = fields->st.begin(); it!=fields->st.end(); it++)
-        advec_s(it->second->data, fields->sp[it->first]->data, fields->u->data, fields->v->data, fields->w->data,
+    for (const Field_pair& s : fields->scalar_pairs)
+        advec_s(s.fldt->data, s.fld->data, fields->u->data, fields->v->data, fields->w->data,
                 grid->dzi, fields->rhoref, fields->rhorefh);
 }
 #endif
@@ -88,7 +97,7 @@ double Advec_2::calc_cfl(double* restrict u, double* restrict v, double* restric
             for (int i=grid->istart; i<grid->iend; ++i)
             {
                 const int ijk = i + j*jj + k*kk;
-                cfl = std::max(cfl, std::abs(interp2(u[ijk], u[ijk+ii]))*dxi + std::abs(interp2(v[ijk], v[ijk+jj]))*dyi + std::abs(interp2(w[ijk], w[ijk+kk]))*dzi[k]);
+                cfl = std::max(cfl, calc_cfl_cell(u, v, w, ijk, ii, jj, kk, dxi, dyi, dzi[k]));
             }
 
     grid->get_max(&cfl);
@@ -98,8 +107,9 @@ double Advec_2::calc_cfl(double* restrict u, double* restrict v, double* restric
     return cfl;
 }
 
-void Advec_2::advec_u(double* restrict ut, double* restrict u, double* restrict v, double* restrict w,
-                      double* restrict dzi, double* restrict rhoref, double* restrict rhorefh)
+template<bool calc_cfl>
+double Advec_2::advec_u(double* restrict ut, double* restrict u, double* restrict v, double* restrict w,
+                        double* restrict dzi, double* restrict rhoref, double* restrict rhorefh)
 {
     const int ii = 1;
     const int jj = grid->icells;
@@ -108,6 +118,8 @@ void Advec_2::advec_u(double* restrict ut, double* restrict u, double* restrict
     const double dxi = 1./grid->dx;
     const double dyi = 1./grid->dy;
 
+    double cfl = 0;
+
     for (int k=grid->kstart; k<grid->kend; ++k)
         for (int j=grid->jstart; j<grid->jend; ++j)
 #pragma ivdep
@@ -123,7 +135,12 @@ void Advec_2::advec_u(double* restrict ut, double* restrict u, double* restrict
 
                          - ( rhorefh[k+1] * interp2(w[ijk-ii+kk], w[ijk+kk]) * interp2(u[ijk   ], u[ijk+kk])
                            - rhorefh[k  ] * interp2(w[ijk-ii   ], w[ijk   ]) * interp2(u[ijk-kk], u[ijk   ]) ) / rhoref[k] * dzi[k];
+
+                if (calc_cfl)
+                    cfl = std::max(cfl, calc_cfl_cell(u, v, w, ijk, ii, jj, kk, dxi, dyi, dzi[k]));
             }
+
+    return cfl;
 }
 
 void Advec_2::advec_v(double* restrict vt, double* restrict u, double* restrict v, double* restrict w,
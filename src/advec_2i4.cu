@@ -28,6 +28,8 @@
 #include "finite_difference.h"
 #include "tools.h"
 #include "constants.h"
+#include "model.h"
+#include "timeloop.h"
 
 using namespace Finite_difference::O2;
 using namespace Finite_difference::O4;
@@ -387,17 +389,6 @@ namespace
     }
 }
 
-#ifdef USECUDA
-unsigned long Advec_2i4::get_time_limit(unsigned long idt, double dt)
-{
-    // Calculate cfl and prevent zero divisons.
-    double cfl = get_cfl(dt);
-    cfl = std::max(cflmin, cfl);
-    const unsigned long idtlim = idt * cflmax / cfl;
-    return idtlim;
-}
-#endif
-
 #ifdef USECUDA
 double Advec_2i4::get_cfl(const double dt)
 {
@@ -434,6 +425,10 @@ double Advec_2i4::get_cfl(const double dt)
 #ifdef USECUDA
 void Advec_2i4::exec()
 {
+    // On the GPU, the CFL number per unit time of the first substep is computed in a separate kernel.
+    if (!model->timeloop->in_substep())
+        cfl_rate = get_cfl(1.);
+
     const int blocki = grid->ithread_block;
     const int blockj = grid->jthread_block;
     const int gridi  = grid->imax/blocki + (grid->imax%blocki > 0);
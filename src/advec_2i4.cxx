@@ -30,10 +30,35 @@
 #include "constants.h"
 #include "finite_difference.h"
 #include "model.h"
+#include "timeloop.h"
 
 using namespace Finite_difference::O4;
+
 using namespace Finite_difference::O2;
 
+namespace
+{
+    // CFL number per unit time of a single grid cell, fourth order interpolation in all directions.
+    inline double calc_cfl_cell(const double* const restrict u, const double* const restrict v, const double* const restrict w,
+                                const int ijk, const int ii1, const int ii2, const int jj1, const int jj2, const int kk1, const int kk2,
+                                const double dxi, const double dyi, const double dzi)
+    {
+        return std::abs(interp4(u[ijk-ii1], u[ijk], u[ijk+ii1], u[ijk+ii2]))*dxi
+             + std::abs(interp4(v[ijk-jj1], v[ijk], v[ijk+jj1], v[ijk+jj2]))*dyi
+             + std::abs(interp4(w[ijk-kk1], w[ijk], w[ijk+kk1], w[ijk+kk2]))*dzi;
+    }
+
+    // CFL number per unit time of a single grid cell next to a wall, second order interpolation in the vertical.
+    inline double calc_cfl_cell_wall(const double* const restrict u, const double* const restrict v, const double* const restrict w,
+                                     const int ijk, const int ii1, const int ii2, const int jj1, const int jj2, const int kk1,
+                                     const double dxi, const double dyi, const double dzi)
+    {
+        return std::abs(interp4(u[ijk-ii1], u[ijk], u[ijk+ii1], u[ijk+ii2]))*dxi
+             + std::abs(interp4(v[ijk-jj1], v[ijk], v[ijk+jj1], v[ijk+jj2]))*dyi
+             + std::abs(interp2(w[ijk    ], w[ijk+kk1]))*dzi;
+    }
+}
+
 Advec_2i4::Advec_2i4(Model* modelin, Input* inputin) : Advec(modelin, inputin)
 {
     const int igc = 2;
@@ -49,16 +74,6 @@ Advec_2i4::~Advec_2i4()
 {
 }
 
-#ifndef USECUDA
-unsigned long Advec_2i4::get_time_limit(unsigned long idt, double dt)
-{
-    double cfl = calc_cfl(fields->u->data, fields->v->data, fields->w->data, grid->dzi, dt);
-    // Avoid zero divisons.
-    cfl = std::max(cflmin, cfl);
-    return idt * cflmax / cfl;
-}
-#endif
-
 #ifndef USECUDA
 double Advec_2i4::get_cfl(double dt)
 {
@@ -69,15 +84,20 @@ double Advec_2i4::get_cfl(double dt)
 #ifndef USECUDA
 void Advec_2i4::exec()
 {
-    advec_u(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi, 
-            fields->rhoref, fields->rhorefh);
+    // In the first substep, the CFL number per unit time is a by-product of the u-advection.
+    if (model->timeloop->in_substep())
+        advec_u<false>(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi,
+                       fields->rhoref, fields->rhorefh);
+    else
+        cfl_rate = advec_u<true>(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi,
+                                 fields->rhoref, fields->rhorefh);
     advec_v(fields->vt->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi,
             fields->rhoref, fields->rhorefh);
     advec_w(fields->wt->data, fields->u->data, fields->v->data, fields->w->data, grid->dzhi,
             fields->rhoref, fields->rhorefh);
 
-    for (FieldMap::const_iterator it = fields->st.begin(); it!=fields->st.end(); it++)
-        advec_s(it->second->data, fields->sp[it->first]->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi,
+    for (const Field_pair& s : fields->scalar_pairs)
+        advec_s(s.fldt->data, s.fld->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi,
                 fields->rhoref, fields->rhorefh);
 
 }
@@ -106,9 +126,7 @@ double Advec_2i4::calc_cfl(double* restrict u, double* restrict v, double* restr
         for (int i=grid->istart; i<grid->iend; ++i)
         {
             const int ijk = i + j*jj1 + k*kk1;
-            cfl = std::max(cfl, std::abs(interp4(u[ijk-ii1], u[ijk    ], u[ijk+ii1], u[ijk+ii2]))*dxi 
-                              + std::abs(interp4(v[ijk-jj1], v[ijk    ], v[ijk+jj1], v[ijk+jj2]))*dyi 
-                              + std::abs(interp2(w[ijk    ], w[ijk+kk1]))*dzi[k]);
+            cfl = std::max(cfl, calc_cfl_cell_wall(u, v, w, ijk, ii1, ii2, jj1, jj2, kk1, dxi, dyi, dzi[k]));
         }
 
     for (k=grid->kstart+1; k<grid->kend-1; ++k)
@@ -117,9 +135,7 @@ double Advec_2i4::calc_cfl(double* restrict u, double* restrict v, double* restr
             for (int i=grid->istart; i<grid->iend; ++i)
             {
                 const int ijk = i + j*jj1 + k*kk1;
-                cfl = std::max(cfl, std::abs(interp4(u[ijk-ii1], u[ijk], u[ijk+ii1], u[ijk+ii2]))*dxi 
-                                  + std::abs(interp4(v[ijk-jj1], v[ijk], v[ijk+jj1], v[ijk+jj2]))*dyi 
-                                  + std::abs(interp4(w[ijk-kk1], w[ijk], w[ijk+kk1], w[ijk+kk2]))*dzi[k]);
+                cfl = std::max(cfl, calc_cfl_cell(u, v, w, ijk, ii1, ii2, jj1, jj2, kk1, kk2, dxi, dyi, dzi[k]));
             }
 
     k = kend-1;
@@ -128,9 +144,7 @@ double Advec_2i4::calc_cfl(double* restrict u, double* restrict v, double* restr
         for (int i=grid->istart; i<grid->iend; ++i)
         {
             const int ijk  = i + j*jj1 + k*kk1;
-            cfl = std::max(cfl, std::abs(interp4(u[ijk-ii1], u[ijk    ], u[ijk+ii1], u[ijk+ii2]))*dxi 
-                              + std::abs(interp4(v[ijk-jj1], v[ijk    ], v[ijk+jj1], v[ijk+jj2]))*dyi 
-                              + std::abs(interp2(w[ijk    ], w[ijk+kk1]))*dzi[k]);
+            cfl = std::max(cfl, calc_cfl_cell_wall(u, v, w, ijk, ii1, ii2, jj1, jj2, kk1, dxi, dyi, dzi[k]));
         }
 
     grid->get_max(&cfl);
@@ -140,8 +154,9 @@ double Advec_2i4::calc_cfl(double* restrict u, double* restrict v, double* restr
     return cfl;
 }
 
-void Advec_2i4::advec_u(double* restrict ut, double* restrict u, double* restrict v, double* restrict w, 
-                        double* restrict dzi, double* restrict rhoref, double* restrict rhorefh)
+template<bool calc_cfl>
+double Advec_2i4::advec_u(double* restrict ut, double* restrict u, double* restrict v, double* restrict w, 
+                          double* restrict dzi, double* restrict rhoref, double* restrict rhorefh)
 {
     const int ii1 = 1;
     const int ii2 = 2;
@@ -156,6 +171,8 @@ void Advec_2i4::advec_u(double* restrict ut, double* restrict u, double* restric
     const int kstart = grid->kstart;
     const int kend   = grid->kend;
 
+    double cfl = 0;
+
     int k = kstart; 
 
     for (int j=grid->jstart; j<grid->jend; ++j)
@@ -174,6 +191,9 @@ void Advec_2i4::advec_u(double* restrict ut, double* restrict u, double* restric
 
                      // w*du/dz -> second order interpolation for fluxtop, fluxbot = 0. as w=0
                      - ( rhorefh[k+1] * interp2(w[ijk-ii1+kk1], w[ijk+kk1]) * interp2(u[ijk    ], u[ijk+kk1]) ) / rhoref[k] * dzi[k];
+
+            if (calc_cfl)
+                cfl = std::max(cfl, calc_cfl_cell_wall(u, v, w, ijk, ii1, ii2, jj1, jj2, kk1, dxi, dyi, dzi[k]));
         }
 
     k = kstart + 1; 
@@ -194,6 +214,9 @@ void Advec_2i4::advec_u(double* restrict ut, double* restrict u, double* restric
                      // w*du/dz -> second order interpolation for fluxbot
                      - ( rhorefh[k+1] * interp2(w[ijk-ii1+kk1], w[ijk+kk1]) * interp4(u[ijk-kk1], u[ijk    ], u[ijk+kk1], u[ijk+kk2])
                        - rhorefh[k  ] * interp2(w[ijk-ii1    ], w[ijk    ]) * interp2(u[ijk-kk1], u[ijk    ]) ) / rhoref[k] * dzi[k];
+
+            if (calc_cfl)
+                cfl = std::max(cfl, calc_cfl_cell(u, v, w, ijk, ii1, ii2, jj1, jj2, kk1, kk2, dxi, dyi, dzi[k]));
         }
 
     for (k=grid->kstart+2; k<grid->kend-2; ++k)
@@ -214,6 +237,9 @@ void Advec_2i4::advec_u(double* restrict ut, double* restrict u, double* restric
                          // w*du/dz
                          - ( rhorefh[k+1] * interp2(w[ijk-ii1+kk1], w[ijk+kk1]) * interp4(u[ijk-kk1], u[ijk    ], u[ijk+kk1], u[ijk+kk2])
                            - rhorefh[k  ] * interp2(w[ijk-ii1    ], w[ijk    ]) * interp4(u[ijk-kk2], u[ijk-kk1], u[ijk    ], u[ijk+kk1]) ) / rhoref[k] * dzi[k];
+
+                if (calc_cfl)
+                    cfl = std::max(cfl, calc_cfl_cell(u, v, w, ijk, ii1, ii2, jj1, jj2, kk1, kk2, dxi, dyi, dzi[k]));
             }
 
     k = kend - 2; 
@@ -234,6 +260,9 @@ void Advec_2i4::advec_u(double* restrict ut, double* restrict u, double* restric
                      // w*du/dz -> second order interpolation for fluxtop
                      - ( rhorefh[k+1] * interp2(w[ijk-ii1+kk1], w[ijk+kk1]) * interp2(u[ijk    ], u[ijk+kk1])
                        - rhorefh[k  ] * interp2(w[ijk-ii1    ], w[ijk    ]) * interp4(u[ijk-kk2], u[ijk-kk1], u[ijk    ], u[ijk+kk1]) ) / rhoref[k] * dzi[k];
+
+            if (calc_cfl)
+                cfl = std::max(cfl, calc_cfl_cell(u, v, w, ijk, ii1, ii2, jj1, jj2, kk1, kk2, dxi, dyi, dzi[k]));
         }
 
     k = kend - 1; 
@@ -253,7 +282,12 @@ void Advec_2i4::advec_u(double* restrict ut, double* restrict u, double* restric
 
                      // w*du/dz -> second order interpolation for fluxbot, fluxtop=0 as w=0
                      - ( -rhorefh[k] * interp2(w[ijk-ii1    ], w[ijk    ]) * interp2(u[ijk-kk1], u[ijk    ]) ) / rhoref[k] * dzi[k];
+
+            if (calc_cfl)
+                cfl = std::max(cfl, calc_cfl_cell_wall(u, v, w, ijk, ii1, ii2, jj1, jj2, kk1, dxi, dyi, dzi[k]));
         }
+
+    return cfl;
 }
 
 void Advec_2i4::advec_v(double* restrict vt, double* restrict u, double* restrict v, double* restrict w,
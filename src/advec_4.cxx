@@ -30,9 +30,23 @@
 #include "constants.h"
 #include "finite_difference.h"
 #include "model.h"
+#include "timeloop.h"
 
 using namespace Finite_difference::O4;
 
+namespace
+{
+    // CFL number per unit time of a single grid cell.
+    inline double calc_cfl_cell(const double* const restrict u, const double* const restrict v, const double* const restrict w,
+                                const int ijk, const int ii1, const int ii2, const int jj1, const int jj2, const int kk1, const int kk2,
+                                const double dxi, const double dyi, const double dzi)
+    {
+        return std::abs(ci0*u[ijk-ii1] + ci1*u[ijk] + ci2*u[ijk+ii1] + ci3*u[ijk+ii2])*dxi
+             + std::abs(ci0*v[ijk-jj1] + ci1*v[ijk] + ci2*v[ijk+jj1] + ci3*v[ijk+jj2])*dyi
+             + std::abs(ci0*w[ijk-kk1] + ci1*w[ijk] + ci2*w[ijk+kk1] + ci3*w[ijk+kk2])*dzi;
+    }
+}
+
 Advec_4::Advec_4(Model* modelin, Input* inputin) : Advec(modelin, inputin)
 {
     swadvec = "4";
@@ -43,14 +57,6 @@ Advec_4::~Advec_4()
 }
 
 #ifndef USECUDA
-unsigned long Advec_4::get_time_limit(unsigned long idt, double dt)
-{
-    // Calculate cfl and prevent zero divisons.
-    double cfl = calc_cfl(fields->u->data, fields->v->data, fields->w->data, grid->dzi, dt);
-    cfl = std::max(cflmin, cfl);
-    return idt * cflmax / cfl;
-}
-
 double Advec_4::get_cfl(double dt)
 {
     return calc_cfl(fields->u->data, fields->v->data, fields->w->data, grid->dzi, dt);
@@ -60,22 +66,31 @@ void Advec_4::exec()
 {
     // In case of a two-dimensional run, strip v component out of all kernels and do 
     // not calculate v-advection tendency.
+    // In the first substep, the CFL number per unit time is a by-product of the u-advection.
+    const bool calc_cfl = !model->timeloop->in_substep();
+
     if (grid->jtot == 1)
     {
-        advec_u<false>(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi4 );
+        if (calc_cfl)
+            cfl_rate = advec_u<false, true>(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi, grid->dzi4);
+        else
+            advec_u<false, false>(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi, grid->dzi4);
         advec_w<false>(fields->wt->data, fields->u->data, fields->v->data, fields->w->data, grid->dzhi4);
 
-        for (FieldMap::const_iterator it = fields->st.begin(); it!=fields->st.end(); it++)
-            advec_s<false>(it->second->data, fields->sp[it->first]->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi4);
+        for (const Field_pair& s : fields->scalar_pairs)
+            advec_s<false>(s.fldt->data, s.fld->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi4);
     }
     else
     {
-        advec_u<true>(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi4 );
+        if (calc_cfl)
+            cfl_rate = advec_u<true, true>(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi, grid->dzi4);
+        else
+            advec_u<true, false>(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi, grid->dzi4);
         advec_v<true>(fields->vt->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi4 );
         advec_w<true>(fields->wt->data, fields->u->data, fields->v->data, fields->w->data, grid->dzhi4);
 
-        for (FieldMap::const_iterator it = fields->st.begin(); it!=fields->st.end(); it++)
-            advec_s<true>(it->second->data, fields->sp[it->first]->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi4);
+        for (const Field_pair& s : fields->scalar_pairs)
+            advec_s<true>(s.fldt->data, s.fld->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi4);
     }
 }
 #endif
@@ -100,9 +115,7 @@ double Advec_4::calc_cfl(double * restrict u, double * restrict v, double * rest
             for (int i=grid->istart; i<grid->iend; i++)
             {
                 const int ijk = i + j*jj1 + k*kk1;
-                cfl = std::max(cfl, std::abs(ci0*u[ijk-ii1] + ci1*u[ijk] + ci2*u[ijk+ii1] + ci3*u[ijk+ii2])*dxi 
-                                  + std::abs(ci0*v[ijk-jj1] + ci1*v[ijk] + ci2*v[ijk+jj1] + ci3*v[ijk+jj2])*dyi 
-                                  + std::abs(ci0*w[ijk-kk1] + ci1*w[ijk] + ci2*w[ijk+kk1] + ci3*w[ijk+kk2])*dzi[k] );
+                cfl = std::max(cfl, calc_cfl_cell(u, v, w, ijk, ii1, ii2, jj1, jj2, kk1, kk2, dxi, dyi, dzi[k]));
             }
 
     grid->get_max(&cfl);
@@ -112,8 +125,9 @@ double Advec_4::calc_cfl(double * restrict u, double * restrict v, double * rest
     return cfl;
 }
 
-    template<bool dim3>
-void Advec_4::advec_u(double * restrict ut, double * restrict u, double * restrict v, double * restrict w, double * restrict dzi4)
+    template<bool dim3, bool calc_cfl>
+double Advec_4::advec_u(double * restrict ut, double * restrict u, double * restrict v, double * restrict w,
+                        double * restrict dzi, double * restrict dzi4)
 {
     const int ii1 = 1;
     const int ii2 = 2;
@@ -131,6 +145,8 @@ void Advec_4::advec_u(double * restrict ut, double * restrict u, double * restri
     const double dxi = 1./grid->dx;
     const double dyi = 1./grid->dy;
 
+    double cfl = 0;
+
     // bottom boundary
     for (int j=grid->jstart; j<grid->jend; j++)
 #pragma ivdep
@@ -155,6 +171,9 @@ void Advec_4::advec_u(double * restrict ut, double * restrict u, double * restri
                        + cg2*((ci0*w[ijk-ii2+kk1] + ci1*w[ijk-ii1+kk1] + ci2*w[ijk+kk1] + ci3*w[ijk+ii1+kk1]) * (ci0*u[ijk-kk1] + ci1*u[ijk    ] + ci2*u[ijk+kk1] + ci3*u[ijk+kk2]))
                        + cg3*((ci0*w[ijk-ii2+kk2] + ci1*w[ijk-ii1+kk2] + ci2*w[ijk+kk2] + ci3*w[ijk+ii1+kk2]) * (ci0*u[ijk    ] + ci1*u[ijk+kk1] + ci2*u[ijk+kk2] + ci3*u[ijk+kk3])) )
                      * dzi4[kstart];
+
+            if (calc_cfl)
+                cfl = std::max(cfl, calc_cfl_cell(u, v, w, ijk, ii1, ii2, jj1, jj2, kk1, kk2, dxi, dyi, dzi[kstart]));
         }
 
     for (int k=grid->kstart+1; k<grid->kend-1; k++)
@@ -181,6 +200,9 @@ void Advec_4::advec_u(double * restrict ut, double * restrict u, double * restri
                            + cg2*((ci0*w[ijk-ii2+kk1] + ci1*w[ijk-ii1+kk1] + ci2*w[ijk+kk1] + ci3*w[ijk+ii1+kk1]) * (ci0*u[ijk-kk1] + ci1*u[ijk    ] + ci2*u[ijk+kk1] + ci3*u[ijk+kk2]))
                            + cg3*((ci0*w[ijk-ii2+kk2] + ci1*w[ijk-ii1+kk2] + ci2*w[ijk+kk2] + ci3*w[ijk+ii1+kk2]) * (ci0*u[ijk    ] + ci1*u[ijk+kk1] + ci2*u[ijk+kk2] + ci3*u[ijk+kk3])) )
                          * dzi4[k];
+
+                if (calc_cfl)
+                    cfl = std::max(cfl, calc_cfl_cell(u, v, w, ijk, ii1, ii2, jj1, jj2, kk1, kk2, dxi, dyi, dzi[k]));
             }
 
     // top boundary
@@ -207,7 +229,12 @@ void Advec_4::advec_u(double * restrict ut, double * restrict u, double * restri
                        + cg2*((ci0*w[ijk-ii2+kk1] + ci1*w[ijk-ii1+kk1] + ci2*w[ijk+kk1] + ci3*w[ijk+ii1+kk1]) * (ci0*u[ijk-kk1] + ci1*u[ijk    ] + ci2*u[ijk+kk1] + ci3*u[ijk+kk2]))
                        + cg3*((ci0*w[ijk-ii2+kk2] + ci1*w[ijk-ii1+kk2] + ci2*w[ijk+kk2] + ci3*w[ijk+ii1+kk2]) * (ti0*u[ijk-kk1] + ti1*u[ijk    ] + ti2*u[ijk+kk1] + ti3*u[ijk+kk2])) )
                      * dzi4[kend-1];
+
+            if (calc_cfl)
+                cfl = std::max(cfl, calc_cfl_cell(u, v, w, ijk, ii1, ii2, jj1, jj2, kk1, kk2, dxi, dyi, dzi[kend-1]));
         }
+
+    return cfl;
 }
 
     template<bool dim3>
@@ -30,12 +30,26 @@
 #include "constants.h"
 #include "finite_difference.h"
 #include "model.h"
+#include "timeloop.h"
 
 using Finite_difference::O2::interp2;
 using Finite_difference::O4::interp4;
 using Finite_difference::O4::grad4;
 using Finite_difference::O4::grad4x;
 
+namespace
+{
+    // CFL number per unit time of a single grid cell.
+    inline double calc_cfl_cell(const double* const restrict u, const double* const restrict v, const double* const restrict w,
+                                const int ijk, const int ii1, const int ii2, const int jj1, const int jj2, const int kk1, const int kk2,
+                                const double dxi, const double dyi, const double dzi)
+    {
+        return std::abs(interp4(u[ijk-ii1], u[ijk], u[ijk+ii1], u[ijk+ii2]))*dxi
+             + std::abs(interp4(v[ijk-jj1], v[ijk], v[ijk+jj1], v[ijk+jj2]))*dyi
+             + std::abs(interp4(w[ijk-kk1], w[ijk], w[ijk+kk1], w[ijk+kk2]))*dzi;
+    }
+}
+
 Advec_4m::Advec_4m(Model* modelin, Input* inputin) : Advec(modelin, inputin)
 {
     swadvec = "4m";
@@ -46,14 +60,6 @@ Advec_4m::~Advec_4m()
 }
 
 #ifndef USECUDA
-unsigned long Advec_4m::get_time_limit(unsigned long idt, double dt)
-{
-    // Calculate cfl and prevent zero divisons.
-    double cfl = calc_cfl(fields->u->data, fields->v->data, fields->w->data, grid->dzi, dt);
-    cfl = std::max(cflmin, cfl);
-    return idt * cflmax / cfl;
-}
-
 double Advec_4m::get_cfl(double dt)
 {
     return calc_cfl(fields->u->data, fields->v->data, fields->w->data, grid->dzi, dt);
@@ -61,12 +67,16 @@ double Advec_4m::get_cfl(double dt)
 
 void Advec_4m::exec()
 {
-    advec_u(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi4 );
+    // In the first substep, the CFL number per unit time is a by-product of the u-advection.
+    if (model->timeloop->in_substep())
+        advec_u<false>(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi, grid->dzi4);
+    else
+        cfl_rate = advec_u<true>(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi, grid->dzi4);
     advec_v(fields->vt->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi4 );
     advec_w(fields->wt->data, fields->u->data, fields->v->data, fields->w->data, grid->dzhi4);
 
-    for (FieldMap::const_iterator it = fields->st.begin(); it!=fields->st.end(); ++it)
-        advec_s(it->second->data, fields->sp[it->first]->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi4);
+    for (const Field_pair& s : fields->scalar_pairs)
+        advec_s(s.fldt->data, s.fld->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi4);
 }
 #endif
 
@@ -90,9 +100,7 @@ double Advec_4m::calc_cfl(double * restrict u, double * restrict v, double * res
             for (int i=grid->istart; i<grid->iend; ++i)
             {
                 const int ijk = i + j*jj1 + k*kk1;
-                cfl = std::max(cfl, std::abs(interp4(u[ijk-ii1], u[ijk], u[ijk+ii1], u[ijk+ii2]))*dxi 
-                                  + std::abs(interp4(v[ijk-jj1], v[ijk], v[ijk+jj1], v[ijk+jj2]))*dyi 
-                                  + std::abs(interp4(w[ijk-kk1], w[ijk], w[ijk+kk1], w[ijk+kk2]))*dzi[k] );
+                cfl = std::max(cfl, calc_cfl_cell(u, v, w, ijk, ii1, ii2, jj1, jj2, kk1, kk2, dxi, dyi, dzi[k]));
             }
 
     grid->get_max(&cfl);
@@ -102,7 +110,9 @@ double Advec_4m::calc_cfl(double * restrict u, double * restrict v, double * res
     return cfl;
 }
 
-void Advec_4m::advec_u(double * restrict ut, double * restrict u, double * restrict v, double * restrict w, double * restrict dzi4)
+template<bool calc_cfl>
+double Advec_4m::advec_u(double * restrict ut, double * restrict u, double * restrict v, double * restrict w,
+                         double * restrict dzi, double * restrict dzi4)
 {
     const int ii1 = 1;
     const int ii2 = 2;
@@ -120,6 +130,8 @@ void Advec_4m::advec_u(double * restrict ut, double * restrict u, double * restr
     const double dxi = 1./grid->dx;
     const double dyi = 1./grid->dy;
 
+    double cfl = 0;
+
     // bottom boundary
     for (int j=grid->jstart; j<grid->jend; ++j)
 #pragma ivdep
@@ -143,6 +155,9 @@ void Advec_4m::advec_u(double * restrict ut, double * restrict u, double * restr
                                interp4(w[ijk-ii2+kk1], w[ijk-ii1+kk1], w[ijk+kk1], w[ijk+ii1+kk1]) * interp2(u[ijk    ], u[ijk+kk1]),
                                interp4(w[ijk-ii2+kk2], w[ijk-ii1+kk2], w[ijk+kk2], w[ijk+ii1+kk2]) * interp2(u[ijk    ], u[ijk+kk3]))
                        * dzi4[kstart];
+
+            if (calc_cfl)
+                cfl = std::max(cfl, calc_cfl_cell(u, v, w, ijk, ii1, ii2, jj1, jj2, kk1, kk2, dxi, dyi, dzi[kstart]));
         }
 
     for (int k=grid->kstart+1; k<grid->kend-1; ++k)
@@ -167,6 +182,9 @@ void Advec_4m::advec_u(double * restrict ut, double * restrict u, double * restr
                                   interp4(w[ijk-ii2+kk1], w[ijk-ii1+kk1], w[ijk+kk1], w[ijk+ii1+kk1]) * interp2(u[ijk    ], u[ijk+kk1]),
                                   interp4(w[ijk-ii2+kk2], w[ijk-ii1+kk2], w[ijk+kk2], w[ijk+ii1+kk2]) * interp2(u[ijk    ], u[ijk+kk3]))
                            * dzi4[k];
+
+                if (calc_cfl)
+                    cfl = std::max(cfl, calc_cfl_cell(u, v, w, ijk, ii1, ii2, jj1, jj2, kk1, kk2, dxi, dyi, dzi[k]));
             }
 
     // top boundary
@@ -191,7 +209,12 @@ void Advec_4m::advec_u(double * restrict ut, double * restrict u, double * restr
                                interp4(w[ijk-ii2+kk1], w[ijk-ii1+kk1], w[ijk+kk1], w[ijk+ii1+kk1]) * interp2(u[ijk    ], u[ijk+kk1]),
                               -interp4(w[ijk-ii2    ], w[ijk-ii1    ], w[ijk    ], w[ijk+ii1    ]) * interp2(u[ijk-kk2], u[ijk+kk1]))
                        * dzi4[kend-1];
+
+            if (calc_cfl)
+                cfl = std::max(cfl, calc_cfl_cell(u, v, w, ijk, ii1, ii2, jj1, jj2, kk1, kk2, dxi, dyi, dzi[kend-1]));
         }
+
+    return cfl;
 }
 
 void Advec_4m::advec_v(double * restrict vt, double * restrict u, double * restrict v, double * restrict w, double * restrict dzi4)
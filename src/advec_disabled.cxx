@@ -40,7 +40,7 @@ Advec_disabled::~Advec_disabled()
 {
 }
 
-unsigned long Advec_disabled::get_time_limit(unsigned long idt, const double dt)
+unsigned long Advec_disabled::get_time_limit(unsigned long idt, const double dt, const double cflrate)
 {
     return Constants::ulhuge;
 }
@@ -0,0 +1,363 @@
+/*
+ * MicroHH
+ * Copyright (c) 2011-2017 Chiel van Heerwaarden
+ * Copyright (c) 2011-2017 Thijs Heus
+ * Copyright (c) 2014-2017 Bart van Stratum
+ *
+ * This file is part of MicroHH
+ *
+ * MicroHH is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * MicroHH is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with MicroHH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include "master.h"
+#include "grid.h"
+#include "fields.h"
+#include "average.h"
+#include "model.h"
+#include "timeloop.h"
+#include "constants.h"
+#include "defines.h"
+
+namespace
+{
+    // Add a sample to the running mean and the sum of the squared deviations in one sweep over the field.
+    void add_sample(double* const restrict mean, double* const restrict m2, const double* const restrict data,
+                    const double ni, const int ncells)
+    {
+        #pragma ivdep
+        for (int n=0; n<ncells; ++n)
+        {
+            const double delta = data[n] - mean[n];
+            mean[n] += delta*ni;
+            m2[n]   += delta*(data[n] - mean[n]);
+        }
+    }
+
+    // Add a sample to the running mean.
+    void add_sample(double* const restrict mean, const double* const restrict data,
+                    const double ni, const int ncells)
+    {
+        #pragma ivdep
+        for (int n=0; n<ncells; ++n)
+            mean[n] += (data[n] - mean[n])*ni;
+    }
+}
+
+Average::Average(Model* modelin, Input* inputin)
+{
+    model  = modelin;
+    grid   = model->grid;
+    fields = model->fields;
+    master = model->master;
+
+    int nerror = 0;
+    nerror += inputin->get_item(&swaverage, "average", "swaverage", "", "0");
+
+    if (swaverage == "1")
+    {
+        nerror += inputin->get_item(&sampletime, "average", "sampletime", "");
+        nerror += inputin->get_list(&averagelist, "average", "averagelist", "");
+        nerror += inputin->get_item(&swmoments, "average", "swmoments", "", "0");
+
+        if (!(swmoments == "0" || swmoments == "1"))
+        {
+            ++nerror;
+            master->print_error("\"%s\" is an illegal value for swmoments\n", swmoments.c_str());
+        }
+    }
+    else if (swaverage != "0")
+    {
+        ++nerror;
+        master->print_error("\"%s\" is an illegal value for swaverage\n", swaverage.c_str());
+    }
+
+    nsamples   = 0;
+    iotimesave = -1;
+
+    if (nerror)
+        throw 1;
+}
+
+Average::~Average()
+{
+    for (Average_map::const_iterator it=averages.begin(); it!=averages.end(); ++it)
+    {
+        delete[] it->second.mean;
+        delete[] it->second.m2;
+    }
+}
+
+void Average::init(double ifactor)
+{
+    if (swaverage == "0")
+        return;
+
+    isampletime = (unsigned long)(ifactor * sampletime);
+}
+
+void Average::create()
+{
+    // The averages are only kept in run mode, in post mode the samples of the loaded fields would be added again.
+    if (swaverage == "0" || master->mode != "run")
+        return;
+
+    int nerror = 0;
+
+    for (std::vector<std::string>::const_iterator it=averagelist.begin(); it!=averagelist.end(); ++it)
+    {
+        if (fields->a.find(*it) == fields->a.end())
+        {
+            master->print_error("field %s in [average][averagelist] does not exist\n", it->c_str());
+            ++nerror;
+            continue;
+        }
+
+        Average_var& avg = averages[*it];
+        avg.data   = fields->a[*it]->data;
+        avg.offset = (*it == "u") ? grid->utrans : (*it == "v") ? grid->vtrans : 0.;
+
+        avg.mean = new double[grid->ncells];
+        avg.m2   = (swmoments == "1") ? new double[grid->ncells] : 0;
+
+        for (int n=0; n<grid->ncells; ++n)
+            avg.mean[n] = 0.;
+        if (avg.m2)
+            for (int n=0; n<grid->ncells; ++n)
+                avg.m2[n] = 0.;
+    }
+
+    if (nerror)
+        throw 1;
+}
+
+unsigned long Average::get_time_limit(unsigned long itime)
+{
+    if (swaverage == "0")
+        return Constants::ulhuge;
+
+    return isampletime - itime % isampletime;
+}
+
+std::string Average::get_switch()
+{
+    return swaverage;
+}
+
+bool Average::do_average()
+{
+    if (swaverage == "0" || master->mode != "run")
+        return false;
+
+    if (model->timeloop->get_itime() % isampletime == 0)
+        return true;
+    else
+        return false;
+}
+
+void Average::exec()
+{
+    ++nsamples;
+    const double ni = 1./nsamples;
+
+    for (Average_map::iterator it=averages.begin(); it!=averages.end(); ++it)
+    {
+        if (it->second.m2)
+            add_sample(it->second.mean, it->second.m2, it->second.data, ni, grid->ncells);
+        else
+            add_sample(it->second.mean, it->second.data, ni, grid->ncells);
+    }
+}
+
+void Average::save(int iotime)
+{
+    if (swaverage == "0" || master->mode != "run" || iotime == iotimesave)
+        return;
+
+    int nerror = 0;
+
+    // save the number of samples, which is needed to continue the averages
+    if (master->mpiid == 0)
+    {
+        char filename[256];
+        std::sprintf(filename, "average.%07d", iotime);
+
+        master->print_message("Saving \"%s\" ... ", filename);
+
+        FILE *pFile;
+        pFile = fopen(filename, "wbx");
+
+        if (pFile == NULL)
+        {
+            master->print_message("FAILED\n");
+            ++nerror;
+        }
+        else
+        {
+            fwrite(&nsamples, sizeof(int), 1, pFile);
+
+            fclose(pFile);
+            master->print_message("OK\n");
+        }
+    }
+
+    // Broadcast the error code to prevent deadlocks in case of error.
+    master->broadcast(&nerror, 1);
+    if (nerror)
+        throw 1;
+
+    Tmp_field tmp1 = fields->get_tmp();
+    Tmp_field tmp2 = fields->get_tmp();
+    Tmp_field tmp3 = fields->get_tmp();
+
+    const double NoOffset = 0.;
+
+    for (Average_map::const_iterator it=averages.begin(); it!=averages.end(); ++it)
+    {
+        char filename[256];
+        std::sprintf(filename, "%smean.%07d", it->first.c_str(), iotime);
+        master->print_message("Saving \"%s\" ... ", filename);
+
+        if (grid->save_field3d(it->second.mean, tmp1->data, tmp2->data, filename, it->second.offset))
+        {
+            master->print_message("FAILED\n");
+            ++nerror;
+        }
+        else
+            master->print_message("OK\n");
+
+        if (!it->second.m2)
+            continue;
+
+        // the sum of the squared deviations is saved as is, such that a restart continues it bitwise
+        std::sprintf(filename, "%sm2.%07d", it->first.c_str(), iotime);
+        master->print_message("Saving \"%s\" ... ", filename);
+
+        if (grid->save_field3d(it->second.m2, tmp1->data, tmp2->data, filename, NoOffset))
+        {
+            master->print_message("FAILED\n");
+            ++nerror;
+        }
+        else
+            master->print_message("OK\n");
+
+        // the variance is derived output only
+        const double ni = (nsamples > 0) ? 1./nsamples : 0.;
+        for (int n=0; n<grid->ncells; ++n)
+            tmp3->data[n] = it->second.m2[n]*ni;
+
+        std::sprintf(filename, "%svar.%07d", it->first.c_str(), iotime);
+        master->print_message("Saving \"%s\" ... ", filename);
+
+        if (grid->save_field3d(tmp3->data, tmp1->data, tmp2->data, filename, NoOffset))
+        {
+            master->print_message("FAILED\n");
+            ++nerror;
+        }
+        else
+            master->print_message("OK\n");
+    }
+
+    if (nerror)
+        throw 1;
+
+    iotimesave = iotime;
+}
+
+void Average::load(int iotime)
+{
+    if (swaverage == "0" || master->mode != "run")
+        return;
+
+    int nerror = 0;
+    int exists = 0;
+
+    // start new averages in case the previous run did not save them
+    if (master->mpiid == 0)
+    {
+        char filename[256];
+        std::sprintf(filename, "average.%07d", iotime);
+
+        FILE *pFile;
+        pFile = fopen(filename, "rb");
+
+        if (pFile == NULL)
+            master->print_message("No averages found in \"%s\", starting new averages\n", filename);
+        else
+        {
+            master->print_message("Loading \"%s\" ... ", filename);
+            if (fread(&nsamples, sizeof(int), 1, pFile) == 1)
+            {
+                exists = 1;
+                master->print_message("OK\n");
+            }
+            else
+            {
+                master->print_message("FAILED\n");
+                ++nerror;
+            }
+            fclose(pFile);
+        }
+    }
+
+    master->broadcast(&nerror, 1);
+    if (nerror)
+        throw 1;
+
+    master->broadcast(&exists, 1);
+    if (!exists)
+        return;
+
+    master->broadcast(&nsamples, 1);
+
+    Tmp_field tmp1 = fields->get_tmp();
+    Tmp_field tmp2 = fields->get_tmp();
+
+    const double NoOffset = 0.;
+
+    for (Average_map::iterator it=averages.begin(); it!=averages.end(); ++it)
+    {
+        char filename[256];
+        std::sprintf(filename, "%smean.%07d", it->first.c_str(), iotime);
+        master->print_message("Loading \"%s\" ... ", filename);
+
+        if (grid->load_field3d(it->second.mean, tmp1->data, tmp2->data, filename, it->second.offset))
+        {
+            master->print_message("FAILED\n");
+            ++nerror;
+        }
+        else
+            master->print_message("OK\n");
+
+        if (!it->second.m2)
+            continue;
+
+        std::sprintf(filename, "%sm2.%07d", it->first.c_str(), iotime);
+        master->print_message("Loading \"%s\" ... ", filename);
+
+        if (grid->load_field3d(it->second.m2, tmp1->data, tmp2->data, filename, NoOffset))
+        {
+            master->print_message("FAILED\n");
+            ++nerror;
+        }
+        else
+            master->print_message("OK\n");
+    }
+
+    if (nerror)
+        throw 1;
+
+    // the averages at this time are on disk already, they do not contain the sample at this time
+    iotimesave = iotime;
+}
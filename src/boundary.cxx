@@ -31,6 +31,7 @@
 #include "model.h"
 #include "timeloop.h"
 #include "finite_difference.h"
+#include "stats.h"
 
 // Boundary schemes.
 #include "boundary.h"
@@ -737,17 +738,21 @@ void Boundary::calc_ghost_cells_topw_4th(double* restrict w)
         }
 }
 
-void Boundary::get_mask(Field3d* field, Field3d* fieldh, Mask* m)
+void Boundary::get_mask(Mask* m)
 {
+    unsigned char* restrict mask    = model->stats->mask;
+    unsigned char* restrict maskh   = model->stats->maskh;
+    unsigned char* restrict maskbot = model->stats->maskbot;
+
     // Set surface mask
     for (int i=0; i<grid->ijcells; ++i)
-        fieldh->databot[i] = 1;
+        maskbot[i] = 1;
 
     // Set atmospheric mask
     for (int i=0; i<grid->ncells; ++i)
     {
-        field ->data[i] = 1;
-        fieldh->data[i] = 1;
+        mask [i] = 1;
+        maskh[i] = 1;
     }
 }
 
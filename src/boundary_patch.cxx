@@ -67,6 +67,8 @@ void Boundary_patch::init(Input* inputin)
 
 void Boundary_patch::set_values()
 {
+    Tmp_field tmp1 = fields->get_tmp();
+
     const double no_offset = 0.;
 
     set_bc(fields->u->databot, fields->u->datagradbot, fields->u->datafluxbot, mbcbot, ubot, fields->visc, grid->utrans);
@@ -75,7 +77,7 @@ void Boundary_patch::set_values()
     set_bc(fields->u->datatop, fields->u->datagradtop, fields->u->datafluxtop, mbctop, utop, fields->visc, grid->utrans);
     set_bc(fields->v->datatop, fields->v->datagradtop, fields->v->datafluxtop, mbctop, vtop, fields->visc, grid->vtrans);
 
-    calc_patch(fields->atmp["tmp1"]->databot, grid->x, grid->y, patch_dim, 
+    calc_patch(tmp1->databot, grid->x, grid->y, patch_dim, 
                patch_xh, patch_xr, patch_xi, 
                patch_yh, patch_yr, patch_yi, 
                patch_xoffs, patch_yoffs);
@@ -83,56 +85,49 @@ void Boundary_patch::set_values()
     for (FieldMap::const_iterator it=fields->sp.begin(); it!=fields->sp.end(); ++it)
     {
         set_bc_patch(it->second->databot, it->second->datagradbot, it->second->datafluxbot, 
-                     fields->atmp["tmp1"]->databot, patch_facl_map[it->first], patch_facr_map[it->first],
+                     tmp1->databot, patch_facl_map[it->first], patch_facr_map[it->first],
                      sbc[it->first]->bcbot, sbc[it->first]->bot, it->second->visc, no_offset);
         set_bc      (it->second->datatop, it->second->datagradtop, it->second->datafluxtop,
                      sbc[it->first]->bctop, sbc[it->first]->top, it->second->visc, no_offset);
     }
 }
 
-void Boundary_patch::get_mask(Field3d* field, Field3d* fieldh, Mask* m)
+void Boundary_patch::get_mask(Mask* m)
 {
+    Tmp_field tmp1 = fields->get_tmp();
+
     const int jj = grid->icells;
     const int kk = grid->ijcells;
 
+    unsigned char* restrict mask    = model->stats->mask;
+    unsigned char* restrict maskh   = model->stats->maskh;
+    unsigned char* restrict maskbot = model->stats->maskbot;
+
     // Switch between patch - no patch
     int sw;
     m->name == "patch_high" ? sw = 1 : sw = 0;
 
     // Calculate surface pattern
-    calc_patch(fields->atmp["tmp1"]->databot, grid->x, grid->y, patch_dim, 
+    calc_patch(tmp1->databot, grid->x, grid->y, patch_dim, 
                patch_xh, patch_xr, patch_xi, 
                patch_yh, patch_yr, patch_yi, 
                patch_xoffs, patch_yoffs);
 
     // Set the values ranging between 0....1 to 0 or 1
-    model->stats->nmaskh[grid->kstart] = 0;
     for (int j=grid->jstart; j<grid->jend; ++j)
         #pragma ivdep
         for (int i=grid->istart; i<grid->iend; ++i)
         {
             const int ij = i + j*jj;
 
-            if (fields->atmp["tmp1"]->databot[ij] >= 0.5)
-                fieldh->databot[ij] = sw;
+            if (tmp1->databot[ij] >= 0.5)
+                maskbot[ij] = sw;
             else
-                fieldh->databot[ij] = 1-sw;
-
-            if (fieldh->databot[ij] == 1)
-                model->stats->nmaskh[grid->kstart] += 1;
+                maskbot[ij] = 1-sw;
         }
 
-    // Sum the area, and propagate info
-    master->sum(&model->stats->nmaskh[grid->kstart], 1);
-
-    for (int k=grid->kstart+1; k<grid->kend; ++k)
-        model->stats->nmaskh[k] = model->stats->nmaskh[grid->kstart];
-    for (int k=grid->kstart; k<grid->kend; ++k)
-        model->stats->nmask[k]  = model->stats->nmaskh[grid->kstart];
-    model->stats->nmaskbot = model->stats->nmaskh[grid->kstart]; 
-
     // Set the atmospheric values
-    for (int k=grid->kstart; k<grid->kend; ++k)
+    for (int k=grid->kstart; k<grid->kend+1; ++k)
         for (int j=grid->jstart; j<grid->jend; ++j)
             #pragma ivdep
             for (int i=grid->istart; i<grid->iend; ++i)
@@ -140,20 +135,18 @@ void Boundary_patch::get_mask(Field3d* field, Field3d* fieldh, Mask* m)
                 const int ij  = i + j*jj;
                 const int ijk = i + j*jj + k*kk;
 
-                field ->data[ijk] = fieldh->databot[ij];
-                fieldh->data[ijk] = fieldh->databot[ij];
+                mask [ijk] = maskbot[ij];
+                maskh[ijk] = maskbot[ij];
             }
-
-    grid->boundary_cyclic   (field->data    );
-    grid->boundary_cyclic   (fieldh->data   );
-    grid->boundary_cyclic_2d(fieldh->databot);
 }
 
 void Boundary_patch::get_surface_mask(Field3d* field)
 {
+    Tmp_field tmp1 = fields->get_tmp();
+
     const int jj = grid->icells;
 
-    calc_patch(fields->atmp["tmp1"]->databot, grid->x, grid->y, patch_dim, 
+    calc_patch(tmp1->databot, grid->x, grid->y, patch_dim, 
                patch_xh, patch_xr, patch_xi, 
                patch_yh, patch_yr, patch_yi, 
                patch_xoffs, patch_yoffs);
@@ -165,7 +158,7 @@ void Boundary_patch::get_surface_mask(Field3d* field)
         {
             const int ij = i + j*jj;
 
-            if (fields->atmp["tmp1"]->databot[ij] >= 0.5)
+            if (tmp1->databot[ij] >= 0.5)
                 field->databot[ij] = 1;
             else
                 field->databot[ij] = 0;
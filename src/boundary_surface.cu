@@ -37,39 +37,67 @@ namespace
 {
     namespace most = Monin_obukhov;
     const int nzL = 10000; // Size of the lookup table for MO iterations.
+    const int nRi = 10000; // Number of uniform Ri buckets that index the lookup table.
 }
 
 namespace
 {
     __device__ 
     double find_Obuk_g(const float* const __restrict__ zL, const float* const __restrict__ f,
-                       int &n, const double Ri, const double zsl)
+                       const int* const __restrict__ bucket, const float Ri_min, const float Ri_max, const float dRii,
+                       const float Ri, const double zsl)
     {
-        // Determine search direction.
-        if ((f[n]-Ri) > 0)
-            while ( (f[n-1]-Ri) > 0 && n > 0) { --n; }
+        // Beyond the maximum of the evaluation function there is no solution, take the most stable value.
+        if (Ri > Ri_max)
+            return zsl/zL[nzL-1];
+
+        int n;
+
+        // Bisection in the stretched part of the table.
+        if (Ri < Ri_min)
+        {
+            int n0 = 0;
+            n = nzL/10;
+            while (n0 < n)
+            {
+                const int nm = (n0+n)/2;
+                if (f[nm] < Ri)
+                    n0 = nm+1;
+                else
+                    n = nm;
+            }
+        }
+        // Start from the bucket index and correct for the few points inside the bucket.
         else
-            while ( (f[n]-Ri) < 0 && n < (nzL-1) ) { ++n; }
+        {
+            n = bucket[static_cast<int>((Ri-Ri_min)*dRii)];
+            while (n > 0 && f[n-1] >= Ri) { --n; }
+            while (f[n] < Ri) { ++n; }
+        }
 
-        const double zL0 = (n == 0 || n == nzL-1) ? zL[n] : zL[n-1] + (Ri-f[n-1]) / (f[n]-f[n-1]) * (zL[n]-zL[n-1]);
+        const double zL0 = (n == 0) ? zL[n] : zL[n-1] + (Ri-f[n-1]) / (f[n]-f[n-1]) * (zL[n]-zL[n-1]);
 
         return zsl/zL0;
     }
 
     __device__ 
-    double calc_Obuk_noslip_flux_g(float* __restrict__ zL, float* __restrict__ f, int& n, double du, double bfluxbot, double zsl)
+    double calc_Obuk_noslip_flux_g(const float* __restrict__ zL, const float* __restrict__ f,
+                                   const int* __restrict__ bucket, float Ri_min, float Ri_max, float dRii,
+                                   double du, double bfluxbot, double zsl)
     {
-        // Calculate the appropriate Richardson number.
-        const double Ri = -Constants::kappa * bfluxbot * zsl / pow(du, 3);
-        return find_Obuk_g(zL, f, n, Ri, zsl);
+        // Calculate the appropriate Richardson number and reduce precision.
+        const float Ri = -Constants::kappa * bfluxbot * zsl / pow(du, 3);
+        return find_Obuk_g(zL, f, bucket, Ri_min, Ri_max, dRii, Ri, zsl);
     }
 
     __device__ 
-    double calc_Obuk_noslip_dirichlet_g(float* __restrict__ zL, float* __restrict__ f, int& n, double du, double db, double zsl)
+    double calc_Obuk_noslip_dirichlet_g(const float* __restrict__ zL, const float* __restrict__ f,
+                                        const int* __restrict__ bucket, float Ri_min, float Ri_max, float dRii,
+                                        double du, double db, double zsl)
     {
-        // Calculate the appropriate Richardson number.
-        const double Ri = Constants::kappa * db * zsl / pow(du, 2);
-        return find_Obuk_g(zL, f, n, Ri, zsl);
+        // Calculate the appropriate Richardson number and reduce precision.
+        const float Ri = Constants::kappa * db * zsl / pow(du, 2);
+        return find_Obuk_g(zL, f, bucket, Ri_min, Ri_max, dRii, Ri, zsl);
     }
 
     /* Calculate absolute wind speed */
@@ -100,7 +128,7 @@ namespace
     void stability_g(double* __restrict__ ustar, double* __restrict__ obuk,
                      double* __restrict__ b, double* __restrict__ bbot, double* __restrict__ bfluxbot,
                      double* __restrict__ dutot, float* __restrict__ zL_sl_g, float* __restrict__ f_sl_g, 
-                     int* __restrict__ nobuk_g,
+                     int* __restrict__ nzL_bucket_g, float Ri_min, float Ri_max, float dRii,
                      double z0m, double z0h, double zsl,
                      int icells, int jcells, int kstart, int jj, int kk, 
                      Boundary::Boundary_type mbcbot, int thermobc)
@@ -121,14 +149,14 @@ namespace
             // case 2: fixed buoyancy flux and free ustar
             else if (mbcbot == Boundary::Dirichlet_type && thermobc == Boundary::Flux_type)
             {
-                obuk [ij] = calc_Obuk_noslip_flux_g(zL_sl_g, f_sl_g, nobuk_g[ij], dutot[ij], bfluxbot[ij], zsl);
+                obuk [ij] = calc_Obuk_noslip_flux_g(zL_sl_g, f_sl_g, nzL_bucket_g, Ri_min, Ri_max, dRii, dutot[ij], bfluxbot[ij], zsl);
                 ustar[ij] = dutot[ij] * most::fm(zsl, z0m, obuk[ij]);
             }
             // case 3: fixed buoyancy surface value and free ustar
             else if (mbcbot == Boundary::Dirichlet_type && thermobc == Boundary::Dirichlet_type)
             {
                 double db = b[ijk] - bbot[ij];
-                obuk [ij] = calc_Obuk_noslip_dirichlet_g(zL_sl_g, f_sl_g, nobuk_g[ij], dutot[ij], db, zsl);
+                obuk [ij] = calc_Obuk_noslip_dirichlet_g(zL_sl_g, f_sl_g, nzL_bucket_g, Ri_min, Ri_max, dRii, dutot[ij], db, zsl);
                 ustar[ij] = dutot[ij] * most::fm(zsl, z0m, obuk[ij]);
             }
         }
@@ -285,6 +313,13 @@ void Boundary_surface::prepare_device()
 
     cuda_safe_call(cudaMemcpy(zL_sl_g, zL_sl, nzL*sizeof(float), cudaMemcpyHostToDevice));
     cuda_safe_call(cudaMemcpy(f_sl_g,  f_sl,  nzL*sizeof(float), cudaMemcpyHostToDevice));
+
+    // The bucket index only exists for the boundary conditions that use the lookup table.
+    if (nzL_bucket != 0)
+    {
+        cuda_safe_call(cudaMalloc(&nzL_bucket_g, (nRi+1)*sizeof(int)));
+        cuda_safe_call(cudaMemcpy(nzL_bucket_g, nzL_bucket, (nRi+1)*sizeof(int), cudaMemcpyHostToDevice));
+    }
 }
 
 // TMP BVS
@@ -320,6 +355,7 @@ void Boundary_surface::clear_device()
     cuda_safe_call(cudaFree(nobuk_g));
     cuda_safe_call(cudaFree(zL_sl_g));
     cuda_safe_call(cudaFree(f_sl_g ));
+    cuda_safe_call(cudaFree(nzL_bucket_g));
 }
 
 #ifdef USECUDA
@@ -374,7 +410,7 @@ void Boundary_surface::update_bcs()
             &ustar_g[offs], &obuk_g[offs], 
             &fields->atmp["tmp1"]->data_g[offs], &fields->atmp["tmp1"]->databot_g[offs], &fields->atmp["tmp1"]->datafluxbot_g[offs],
             &fields->atmp["tmp2"]->data_g[offs], 
-            zL_sl_g, f_sl_g, &nobuk_g[offs],
+            zL_sl_g, f_sl_g, nzL_bucket_g, Ri_min, Ri_max, dRii,
             z0m, z0h, grid->z[grid->kstart],
             grid->icells, grid->jcells, grid->kstart, grid->icellsp, grid->ijcellsp, mbcbot, thermobc); 
         cuda_check_error();
@@ -43,6 +43,7 @@ namespace
     namespace most = Monin_obukhov;
     // Size of the lookup table.
     const int nzL = 10000; // Size of the lookup table for MO iterations.
+    const int nRi = 10000; // Number of uniform Ri buckets that index the lookup table.
 }
 
 Boundary_surface::Boundary_surface(Model* modelin, Input* inputin) : Boundary(modelin, inputin)
@@ -54,6 +55,7 @@ Boundary_surface::Boundary_surface(Model* modelin, Input* inputin) : Boundary(mo
     nobuk = 0;
     zL_sl = 0;
     f_sl  = 0;
+    nzL_bucket = 0;
 
 #ifdef USECUDA
     ustar_g = 0;
@@ -61,6 +63,7 @@ Boundary_surface::Boundary_surface(Model* modelin, Input* inputin) : Boundary(mo
     nobuk_g = 0;
     zL_sl_g = 0;
     f_sl_g  = 0;
+    nzL_bucket_g = 0;
 #endif
 }
 
@@ -71,6 +74,7 @@ Boundary_surface::~Boundary_surface()
     delete[] nobuk;
     delete[] zL_sl;
     delete[] f_sl;
+    delete[] nzL_bucket;
 
 #ifdef USECUDA
     clear_device();
@@ -207,14 +211,16 @@ void Boundary_surface::init_surface()
 
 void Boundary_surface::exec_cross(int iotime)
 {
+    Tmp_field tmp1 = fields->get_tmp();
+
     int nerror = 0;
 
     for (std::vector<std::string>::const_iterator it=crosslist.begin(); it<crosslist.end(); ++it)
     {
         if (*it == "ustar")
-            nerror += model->cross->cross_plane(ustar, fields->atmp["tmp1"]->data, "ustar",iotime);
+            nerror += model->cross->cross_plane(ustar, tmp1->data, "ustar",iotime);
         else if (*it == "obuk")
-            nerror += model->cross->cross_plane(obuk,  fields->atmp["tmp1"]->data, "obuk",iotime);
+            nerror += model->cross->cross_plane(obuk,  tmp1->data, "obuk",iotime);
     }  
 
     if (nerror)
@@ -223,8 +229,8 @@ void Boundary_surface::exec_cross(int iotime)
 
 void Boundary_surface::exec_stats(Mask *m)
 {
-    stats->calc_mean2d(&m->tseries["obuk"].data , obuk , 0., fields->atmp["tmp4"]->databot, &stats->nmaskbot);
-    stats->calc_mean2d(&m->tseries["ustar"].data, ustar, 0., fields->atmp["tmp4"]->databot, &stats->nmaskbot);
+    stats->calc_mean2d(&m->tseries["obuk"].data , obuk , 0.);
+    stats->calc_mean2d(&m->tseries["ustar"].data, ustar, 0.);
 }
 
 void Boundary_surface::set_values()
@@ -326,27 +332,57 @@ void Boundary_surface::init_solver()
         for (int n=0; n<nzL; ++n)
             f_sl[n] = zL_sl[n] * std::pow(most::fm(zsl, z0m, zsl/zL_sl[n]), 2) / most::fh(zsl, z0h, zsl/zL_sl[n]);
     }
+    else
+        return;
+
+    // Find the end of the monotonically increasing branch of the evaluation function.
+    // For stable conditions f_sl reaches a maximum, Ri beyond that are mapped onto the most stable z/L.
+    nzL_branch = 1;
+    while (nzL_branch < nzL && f_sl[nzL_branch] > f_sl[nzL_branch-1])
+        ++nzL_branch;
+
+    // Divide the Ri range of the non-stretched part of the table into uniform buckets and store
+    // per bucket the first table index at or above its lower bound. This gives an O(1) inverse lookup,
+    // the stretched free convection tail is searched with a bisection.
+    const int nstretch = nzL/10;
+    Ri_min = f_sl[nstretch];
+    Ri_max = f_sl[nzL_branch-1];
+    dRii   = nRi / (Ri_max - Ri_min);
+
+    nzL_bucket = new int[nRi+1];
+
+    int n = nstretch;
+    for (int nb=0; nb<nRi+1; ++nb)
+    {
+        const float Ri_bucket = Ri_min + nb/dRii;
+        while (n < nzL_branch-1 && f_sl[n] < Ri_bucket)
+            ++n;
+        nzL_bucket[nb] = n;
+    }
 }
 
 #ifndef USECUDA
 void Boundary_surface::update_bcs()
 {
+    Tmp_field tmp1 = fields->get_tmp();
+    Tmp_field tmp2 = fields->get_tmp();
+
     // Start with retrieving the stability information.
     if (model->thermo->get_switch() == "0")
     {
         stability_neutral(ustar, obuk,
                           fields->u->data, fields->v->data,
                           fields->u->databot, fields->v->databot,
-                          fields->atmp["tmp1"]->data, grid->z);
+                          tmp1->data, grid->z);
     }
     else
     {
         // Store the buoyancy in tmp1.
-        model->thermo->get_buoyancy_surf(fields->atmp["tmp1"]);
-        stability(ustar, obuk, fields->atmp["tmp1"]->datafluxbot,
-                  fields->u->data,    fields->v->data,    fields->atmp["tmp1"]->data,
-                  fields->u->databot, fields->v->databot, fields->atmp["tmp1"]->databot,
-                  fields->atmp["tmp2"]->data, grid->z);
+        model->thermo->get_buoyancy_surf(tmp1);
+        stability(ustar, obuk, tmp1->datafluxbot,
+                  fields->u->data,    fields->v->data,    tmp1->data,
+                  fields->u->databot, fields->v->databot, tmp1->databot,
+                  tmp2->data, grid->z);
     }
 
     // Calculate the surface value, gradient and flux depending on the chosen boundary condition.
@@ -402,41 +438,66 @@ void Boundary_surface::stability(double* restrict ustar, double* restrict obuk,
     grid->boundary_cyclic_2d(dutot);
 
     // calculate Obukhov length
+    // Only the interior columns are solved, the ghost cells are filled afterwards.
     // case 1: fixed buoyancy flux and fixed ustar
     if (mbcbot == Ustar_type && thermobc == Flux_type)
     {
-        for (int j=0; j<grid->jcells; ++j)
+        for (int j=grid->jstart; j<grid->jend; ++j)
 #pragma ivdep
-            for (int i=0; i<grid->icells; ++i)
+            for (int i=grid->istart; i<grid->iend; ++i)
             {
                 const int ij = i + j*jj;
                 obuk[ij] = -std::pow(ustar[ij], 3) / (Constants::kappa*bfluxbot[ij]);
             }
+
+        grid->boundary_cyclic_2d(obuk);
     }
     // case 2: fixed buoyancy surface value and free ustar
     else if (mbcbot == Dirichlet_type && thermobc == Flux_type)
     {
-        for (int j=0; j<grid->jcells; ++j)
+        for (int j=grid->jstart; j<grid->jend; ++j)
+        {
+            // The table lookup is done first, such that the evaluation of the
+            // stability function in the second loop can be vectorized.
+            for (int i=grid->istart; i<grid->iend; ++i)
+            {
+                const int ij = i + j*jj;
+                obuk[ij] = calc_obuk_noslip_flux(dutot[ij], bfluxbot[ij], z[kstart]);
+            }
+
 #pragma ivdep
-            for (int i=0; i<grid->icells; ++i)
+            for (int i=grid->istart; i<grid->iend; ++i)
             {
                 const int ij = i + j*jj;
-                obuk [ij] = calc_obuk_noslip_flux(zL_sl, f_sl, nobuk[ij], dutot[ij], bfluxbot[ij], z[kstart]);
                 ustar[ij] = dutot[ij] * most::fm(z[kstart], z0m, obuk[ij]);
             }
+        }
+
+        grid->boundary_cyclic_2d(obuk);
+        grid->boundary_cyclic_2d(ustar);
     }
     else if (mbcbot == Dirichlet_type && thermobc == Dirichlet_type)
     {
-        for (int j=0; j<grid->jcells; ++j)
-#pragma ivdep
-            for (int i=0; i<grid->icells; ++i)
+        for (int j=grid->jstart; j<grid->jend; ++j)
+        {
+            for (int i=grid->istart; i<grid->iend; ++i)
             {
                 const int ij  = i + j*jj;
                 const int ijk = i + j*jj + kstart*kk;
                 const double db = b[ijk] - bbot[ij];
-                obuk [ij] = calc_obuk_noslip_dirichlet(zL_sl, f_sl, nobuk[ij], dutot[ij], db, z[kstart]);
+                obuk[ij] = calc_obuk_noslip_dirichlet(dutot[ij], db, z[kstart]);
+            }
+
+#pragma ivdep
+            for (int i=grid->istart; i<grid->iend; ++i)
+            {
+                const int ij = i + j*jj;
                 ustar[ij] = dutot[ij] * most::fm(z[kstart], z0m, obuk[ij]);
             }
+        }
+
+        grid->boundary_cyclic_2d(obuk);
+        grid->boundary_cyclic_2d(ustar);
     }
 }
 
@@ -646,39 +707,46 @@ void Boundary_surface::surfs(double* restrict ustar, double* restrict obuk, doub
     }
 }
 
-namespace
+double Boundary_surface::find_zL(const float Ri)
 {
-    double find_zL(const float* const restrict zL, const float* const restrict f,
-                   int &n, const float Ri)
-    {
-        // Determine search direction.
-        if ( (f[n]-Ri) > 0 )
-            while ( (f[n-1]-Ri) > 0 && n > 0) { --n; }
-        else
-            while ( (f[n]-Ri) < 0 && n < (nzL-1) ) { ++n; }
+    const float* const restrict zL = zL_sl;
+    const float* const restrict f  = f_sl;
 
-        const double zL0 = (n == 0 || n == nzL-1) ? zL[n] : zL[n-1] + (Ri-f[n-1]) / (f[n]-f[n-1]) * (zL[n]-zL[n-1]);
+    // Beyond the maximum of the evaluation function there is no solution, take the most stable value.
+    // Ri_max itself is the last point of the branch and is found in the table.
+    if (Ri > Ri_max)
+        return zL[nzL-1];
 
-        return zL0;
+    int n;
+
+    // Bisection in the stretched part of the table.
+    if (Ri < Ri_min)
+        n = std::lower_bound(f, f + nzL/10 + 1, Ri) - f;
+    // Start from the bucket index and correct for the few points inside the bucket.
+    else
+    {
+        n = nzL_bucket[static_cast<int>((Ri-Ri_min)*dRii)];
+        while (n > 0 && f[n-1] >= Ri) { --n; }
+        while (f[n] < Ri) { ++n; }
     }
+
+    const double zL0 = (n == 0) ? zL[n] : zL[n-1] + (Ri-f[n-1]) / (f[n]-f[n-1]) * (zL[n]-zL[n-1]);
+
+    return zL0;
 }
 
-double Boundary_surface::calc_obuk_noslip_flux(const float* const restrict zL, const float* const restrict f,
-                                               int& n,
-                                               const double du, const double bfluxbot, const double zsl)
+double Boundary_surface::calc_obuk_noslip_flux(const double du, const double bfluxbot, const double zsl)
 {
     // Calculate the appropriate Richardson number and reduce precision.
     const float Ri = -Constants::kappa * bfluxbot * zsl / std::pow(du, 3);
 
-    return zsl/find_zL(zL, f, n, Ri);
+    return zsl/find_zL(Ri);
 }
 
-double Boundary_surface::calc_obuk_noslip_dirichlet(const float* const restrict zL, const float* const restrict f,
-                                                    int& n,
-                                                    const double du, const double db, const double zsl)
+double Boundary_surface::calc_obuk_noslip_dirichlet(const double du, const double db, const double zsl)
 {
     // Calculate the appropriate Richardson number and reduce precision.
     const float Ri = Constants::kappa * db * zsl / std::pow(du, 2);
 
-    return zsl/find_zL(zL, f, n, Ri);
+    return zsl/find_zL(Ri);
 }
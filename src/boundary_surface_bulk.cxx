@@ -248,21 +248,24 @@ void Boundary_surface_bulk::surface_scaling(double* restrict ustar, double* rest
 
 void Boundary_surface_bulk::update_bcs()
 {
+    Tmp_field tmp1 = fields->get_tmp();
+    Tmp_field tmp2 = fields->get_tmp();
+
     const double zsl = grid->z[grid->kstart];
 
     // Calculate total wind speed difference with surface
-    calculate_du(fields->atmp["tmp1"]->data, fields->u->data, fields->v->data, fields->u->databot, fields->v->databot);
+    calculate_du(tmp1->data, fields->u->data, fields->v->data, fields->u->databot, fields->v->databot);
 
     // Calculate surface momentum fluxes and gradients
     momentum_fluxgrad(fields->u->datafluxbot, fields->v->datafluxbot, fields->u->datagradbot, fields->v->datagradbot,
-                      fields->u->data, fields->v->data, fields->u->databot, fields->v->databot, fields->atmp["tmp1"]->data, bulk_cm, zsl);
+                      fields->u->data, fields->v->data, fields->u->databot, fields->v->databot, tmp1->data, bulk_cm, zsl);
 
     // Calculate surface scalar fluxes and gradients
     for (FieldMap::const_iterator it=fields->sp.begin(); it!=fields->sp.end(); ++it)
-        scalar_fluxgrad(it->second->datafluxbot, it->second->datagradbot, it->second->data, it->second->databot, fields->atmp["tmp1"]->data, bulk_cs[it->first], zsl);
+        scalar_fluxgrad(it->second->datafluxbot, it->second->datagradbot, it->second->data, it->second->databot, tmp1->data, bulk_cs[it->first], zsl);
     
     // Calculate Obukhov length and ustar
-    model->thermo->get_buoyancy_fluxbot(fields->atmp["tmp2"]);
-    surface_scaling(ustar, obuk, fields->atmp["tmp1"]->data, fields->atmp["tmp2"]->datafluxbot, bulk_cm); 
+    model->thermo->get_buoyancy_fluxbot(tmp2);
+    surface_scaling(ustar, obuk, tmp1->data, tmp2->datafluxbot, bulk_cm); 
 }
 //#endif
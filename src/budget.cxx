@@ -20,6 +20,7 @@
  * along with MicroHH.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include "input.h"
 #include "master.h"
 #include "grid.h"
@@ -27,6 +28,7 @@
 #include "thermo.h"
 #include "diff.h"
 #include "stats.h"
+#include "defines.h"
 
 #include "budget.h"
 #include "budget_disabled.h"
@@ -49,6 +51,66 @@ Budget::~Budget()
 {
 }
 
+void Budget::add_to_sum(double* prof)
+{
+    sum_list.push_back(prof);
+}
+
+void Budget::sum_profs()
+{
+    const int kcells = grid.kcells;
+    const int nprofs = sum_list.size();
+
+    sum_buffer.resize(nprofs*kcells);
+
+    for (int n=0; n<nprofs; ++n)
+        std::copy(sum_list[n], sum_list[n]+kcells, sum_buffer.begin() + n*kcells);
+
+    master.sum(sum_buffer.data(), nprofs*kcells);
+
+    for (int n=0; n<nprofs; ++n)
+        std::copy(sum_buffer.begin() + n*kcells, sum_buffer.begin() + (n+1)*kcells, sum_list[n]);
+
+    sum_list.clear();
+}
+
+// This function does the same as Grid::calc_mean for several fields, with one sum over all processes.
+void Budget::calc_means(const std::vector<double*>& means, const std::vector<const double*>& data)
+{
+    const int jj = grid.icells;
+    const int kk = grid.ijcells;
+    const int kcells = grid.kcells;
+    const int nfields = means.size();
+
+    sum_buffer.resize(nfields*kcells);
+
+    for (int n=0; n<nfields; ++n)
+    {
+        const double* restrict fld = data[n];
+        double* restrict prof = &sum_buffer[n*kcells];
+
+        for (int k=0; k<kcells; ++k)
+        {
+            prof[k] = 0.;
+            for (int j=grid.jstart; j<grid.jend; ++j)
+#pragma ivdep
+                for (int i=grid.istart; i<grid.iend; ++i)
+                {
+                    const int ijk = i + j*jj + k*kk;
+                    prof[k] += fld[ijk];
+                }
+        }
+    }
+
+    master.sum(sum_buffer.data(), nfields*kcells);
+
+    const double n = grid.itot*grid.jtot;
+
+    for (int nf=0; nf<nfields; ++nf)
+        for (int k=0; k<kcells; ++k)
+            means[nf][k] = sum_buffer[nf*kcells + k] / n;
+}
+
 Budget* Budget::factory(Input* inputin, Master* masterin, Grid* gridin, Fields* fieldsin, Thermo* thermoin, Diff* diffin, Advec* advecin, Force* forcein, Stats* statsin)
 {
     std::string swbudget;
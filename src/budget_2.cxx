@@ -178,10 +178,27 @@ void Budget_2::create()
 
 void Budget_2::exec_stats(Mask* m)
 {
+    Tmp_field tmp1 = fields.get_tmp();
+    Tmp_field tmp2 = fields.get_tmp();
+    Tmp_field tmp3 = fields.get_tmp();
+
     // Calculate the mean of the fields
-    grid.calc_mean(umodel, fields.u->data, grid.kcells);
-    grid.calc_mean(vmodel, fields.v->data, grid.kcells);
+    calc_means({umodel, vmodel}, {fields.u->data, fields.v->data});
+
+    // Interpolate the vertical velocity to {xh,y,zh} (wx, below u) and {x,yh,zh} (wy, below v) once,
+    // as both the advection and the DNS diffusion terms need them
+    double* const wx = tmp1->data;
+    double* const wy = tmp2->data;
 
+    if (advec.get_switch() != "0" || diff.get_switch() == "2" || diff.get_switch() == "4")
+    {
+        const int wloc [3] = {0,0,1};
+        const int wxloc[3] = {1,0,1};
+        const int wyloc[3] = {0,1,1};
+
+        grid.interpolate_2nd(wx, fields.w->data, wloc, wxloc);
+        grid.interpolate_2nd(wy, fields.w->data, wloc, wyloc);
+    }
 
     // Calculate kinetic and turbulent kinetic energy
     calc_kinetic_energy(m->profs["ke"].data, m->profs["tke"].data,
@@ -195,7 +212,7 @@ void Budget_2::exec_stats(Mask* m)
                              m->profs["u2_turb"].data,  m->profs["v2_turb"].data,  m->profs["w2_turb"].data, m->profs["tke_turb"].data,
                              m->profs["uw_turb"].data, m->profs["vw_turb"].data,
                              fields.u->data, fields.v->data, fields.w->data, umodel, vmodel,
-                             fields.atmp["tmp1"]->data, fields.atmp["tmp2"]->data, grid.dzi, grid.dzhi);
+                             wx, wy, grid.dzi, grid.dzhi);
     }
 
     if(diff.get_switch() != "0")
@@ -204,7 +221,7 @@ void Budget_2::exec_stats(Mask* m)
         if(diff.get_switch() == "2" || diff.get_switch() == "4")
             calc_diffusion_terms_DNS(m->profs["u2_visc"].data, m->profs["v2_visc"].data, m->profs["w2_visc"].data, m->profs["tke_visc"].data, m->profs["uw_visc"].data,
                                      m->profs["u2_diss"].data, m->profs["v2_diss"].data, m->profs["w2_diss"].data, m->profs["tke_diss"].data, m->profs["uw_diss"].data,
-                                     fields.atmp["tmp1"]->data, fields.atmp["tmp2"]->data, fields.atmp["tmp3"]->data, fields.u->data, fields.v->data, fields.w->data, umodel, vmodel,
+                                     tmp3->data, wx, wy, fields.u->data, fields.v->data, fields.w->data, umodel, vmodel,
                                      grid.dzi, grid.dzhi, grid.dxi, grid.dyi, fields.visc);
         else if(diff.get_switch() == "smag2")
             calc_diffusion_terms_LES(m->profs["u2_diss"].data,  m->profs["v2_diss"].data, m->profs["w2_diss"].data,
@@ -213,7 +230,7 @@ void Budget_2::exec_stats(Mask* m)
                                      m->profs["tke_visc"].data, m->profs["uw_visc"].data, m->profs["vw_visc"].data,
                                      m->profs["u2_diff"].data,  m->profs["v2_diff"].data, m->profs["w2_diff"].data,
                                      m->profs["tke_diff"].data, m->profs["uw_diff"].data, m->profs["vw_diff"].data,
-                                     fields.atmp["tmp1"]->data, fields.atmp["tmp2"]->data, fields.atmp["tmp3"]->data,
+                                     tmp1->data, tmp2->data, tmp3->data,
                                      fields.u->data, fields.v->data, fields.w->data,
                                      fields.u->datafluxbot, fields.v->datafluxbot,
                                      fields.sd["evisc"]->data, umodel, vmodel,
@@ -226,39 +243,38 @@ void Budget_2::exec_stats(Mask* m)
         const double diff_b = thermo.get_buoyancy_diffusivity();
 
         // Store the buoyancy in the tmp1 field
-        thermo.get_thermo_field(fields.atmp["tmp1"], fields.atmp["tmp2"], "b", true);
+        thermo.get_thermo_field(tmp1, tmp2, "b", true);
 
         // Calculate mean fields
-        grid.calc_mean(fields.atmp["tmp1"]->datamean, fields.atmp["tmp1"]->data, grid.kcells);
-        grid.calc_mean(fields.sd["p"]->datamean, fields.sd["p"]->data, grid.kcells);
+        calc_means({tmp1->datamean, fields.sd["p"]->datamean}, {tmp1->data, fields.sd["p"]->data});
 
         // Calculate buoyancy terms
         calc_buoyancy_terms(m->profs["w2_buoy"].data, m->profs["tke_buoy"].data,
                             m->profs["uw_buoy"].data, m->profs["vw_buoy"].data,
-                            fields.u->data, fields.v->data, fields.w->data, fields.atmp["tmp1"]->data,
-                            umodel, vmodel, fields.atmp["tmp1"]->datamean);
+                            fields.u->data, fields.v->data, fields.w->data, tmp1->data,
+                            umodel, vmodel, tmp1->datamean);
 
         // Buoyancy variance and flux budgets
         calc_buoyancy_terms_scalar(m->profs["bw_buoy"].data,
-                                   fields.atmp["tmp1"]->data, fields.atmp["tmp1"]->data,
-                                   fields.atmp["tmp1"]->datamean, fields.atmp["tmp1"]->datamean);
+                                   tmp1->data, tmp1->data,
+                                   tmp1->datamean, tmp1->datamean);
 
         if (advec.get_switch() != "0")
             calc_advection_terms_scalar(m->profs["b2_shear"].data, m->profs["b2_turb"].data,
                                         m->profs["bw_shear"].data, m->profs["bw_turb"].data,
-                                        fields.atmp["tmp1"]->data, fields.w->data, fields.atmp["tmp1"]->datamean,
+                                        tmp1->data, fields.w->data, tmp1->datamean,
                                         grid.dzi, grid.dzhi);
 
         if (diff.get_switch() == "2" || diff.get_switch() == "4")
             calc_diffusion_terms_scalar_DNS(m->profs["b2_visc"].data, m->profs["b2_diss"].data,
                                             m->profs["bw_visc"].data, m->profs["bw_diss"].data,
-                                            fields.atmp["tmp1"]->data, fields.w->data,
-                                            fields.atmp["tmp1"]->datamean,
+                                            tmp1->data, fields.w->data,
+                                            tmp1->datamean,
                                             grid.dzi, grid.dzhi, grid.dxi, grid.dyi, fields.visc, diff_b);
 
         calc_pressure_terms_scalar(m->profs["bw_pres"].data,  m->profs["bw_rdstr"].data,
-                                   fields.atmp["tmp1"]->data, fields.sd["p"]->data,
-                                   fields.atmp["tmp1"]->datamean, fields.sd["p"]->datamean,
+                                   tmp1->data, fields.sd["p"]->data,
+                                   tmp1->datamean, fields.sd["p"]->datamean,
                                    grid.dzi, grid.dzhi);
     }
 
@@ -278,6 +294,9 @@ void Budget_2::exec_stats(Mask* m)
                         m->profs["uw_rdstr"].data,    m->profs["vw_rdstr"].data,
                         fields.u->data, fields.v->data, fields.w->data, fields.sd["p"]->data, umodel, vmodel,
                         grid.dzi, grid.dzhi, grid.dxi, grid.dyi);
+
+    // Sum all budget terms over all processes in one call
+    sum_profs();
 }
 
 namespace
@@ -340,9 +359,9 @@ void Budget_2::calc_kinetic_energy(double* const restrict ke, double* const rest
             }
     }
 
-    // Calculate sum over all processes, and calc mean profiles
-    master.sum(ke , grid.kcells);
-    master.sum(tke, grid.kcells);
+    // Calc mean profiles, the sum over all processes is done at the end of exec_stats
+    add_to_sum(ke);
+    add_to_sum(tke);
 
     for (int k=grid.kstart; k<grid.kend; ++k)
     {
@@ -364,17 +383,9 @@ void Budget_2::calc_advection_terms(double* const restrict u2_shear, double* con
                                     double* const restrict uw_turb, double* const restrict vw_turb,
                                     const double* const restrict u, const double* const restrict v, const double* const restrict w,
                                     const double* const restrict umean, const double* const restrict vmean,
-                                    double* const restrict wx, double* const restrict wy,
+                                    const double* const restrict wx, const double* const restrict wy,
                                     const double* const restrict dzi, const double* const restrict dzhi)
 {
-    // Interpolate the vertical velocity to {xh,y,zh} (wx, below u) and {x,yh,zh} (wy, below v)
-    const int wloc [3] = {0,0,1};
-    const int wxloc[3] = {1,0,1};
-    const int wyloc[3] = {0,1,1};
-
-    grid.interpolate_2nd(wx, w, wloc, wxloc);
-    grid.interpolate_2nd(wy, w, wloc, wyloc);
-
     const int jj = grid.icells;
     const int kk = grid.ijcells;
     const int ijtot = grid.itot * grid.jtot;
@@ -499,18 +510,18 @@ void Budget_2::calc_advection_terms(double* const restrict u2_shear, double* con
                                 (v[ijk-kk]-vmean[k-1]) * pow(interp2(wy[ijk], wy[ijk-kk]), 2) ) * dzhi[k];
             }
 
-    // Calculate sum over all processes, and calc mean profiles
-    master.sum(u2_shear,  grid.kcells);
-    master.sum(v2_shear,  grid.kcells);
-    master.sum(tke_shear, grid.kcells);
-    master.sum(uw_shear,  grid.kcells);
-    master.sum(vw_shear,  grid.kcells);
-    master.sum(u2_turb,   grid.kcells);
-    master.sum(v2_turb,   grid.kcells);
-    master.sum(w2_turb,   grid.kcells);
-    master.sum(tke_turb,  grid.kcells);
-    master.sum(uw_turb,   grid.kcells);
-    master.sum(vw_turb,   grid.kcells);
+    // Calc mean profiles, the sum over all processes is done at the end of exec_stats
+    add_to_sum(u2_shear);
+    add_to_sum(v2_shear);
+    add_to_sum(tke_shear);
+    add_to_sum(uw_shear);
+    add_to_sum(vw_shear);
+    add_to_sum(u2_turb);
+    add_to_sum(v2_turb);
+    add_to_sum(w2_turb);
+    add_to_sum(tke_turb);
+    add_to_sum(uw_turb);
+    add_to_sum(vw_turb);
 
     for (int k=grid.kstart; k<grid.kend; ++k)
     {
@@ -577,11 +588,11 @@ void Budget_2::calc_advection_terms_scalar(double* const restrict s2_shear, doub
             }
     }
 
-    // Calculate sum over all processes, and calc mean profiles
-    master.sum(s2_shear, grid.kcells);
-    master.sum(s2_turb,  grid.kcells);
-    master.sum(sw_shear, grid.kcells);
-    master.sum(sw_turb,  grid.kcells);
+    // Calc mean profiles, the sum over all processes is done at the end of exec_stats
+    add_to_sum(s2_shear);
+    add_to_sum(s2_turb);
+    add_to_sum(sw_shear);
+    add_to_sum(sw_turb);
 
     for (int k=grid.kstart; k<grid.kend; ++k)
     {
@@ -729,16 +740,16 @@ void Budget_2::calc_pressure_terms(double* const restrict w2_pres,  double* cons
             }
 
 
-    // Calculate sum over all processes, and calc mean profiles
-    master.sum(w2_pres,      grid.kcells);
-    master.sum(tke_pres,     grid.kcells);
-    master.sum(uw_pres,      grid.kcells);
-    master.sum(vw_pres,      grid.kcells);
-    master.sum(u2_rdstr,     grid.kcells);
-    master.sum(v2_rdstr,     grid.kcells);
-    master.sum(w2_rdstr,     grid.kcells);
-    master.sum(uw_rdstr,     grid.kcells);
-    master.sum(vw_rdstr,     grid.kcells);
+    // Calc mean profiles, the sum over all processes is done at the end of exec_stats
+    add_to_sum(w2_pres);
+    add_to_sum(tke_pres);
+    add_to_sum(uw_pres);
+    add_to_sum(vw_pres);
+    add_to_sum(u2_rdstr);
+    add_to_sum(v2_rdstr);
+    add_to_sum(w2_rdstr);
+    add_to_sum(uw_rdstr);
+    add_to_sum(vw_rdstr);
 
     for (int k=grid.kstart; k<grid.kend; ++k)
     {
@@ -789,9 +800,9 @@ void Budget_2::calc_pressure_terms_scalar(double* const restrict sw_pres, double
                 sw_rdstr[k] += interp2(p[ijk]-pmean[k], p[ijk-kk]-pmean[k-1]) * ((s[ijk]-smean[k])-(s[ijk-kk]-smean[k-1])) * dzhi[k];
             }
 
-    // Calculate sum over all processes, and calc mean profiles
-    master.sum(sw_pres,  grid.kcells);
-    master.sum(sw_rdstr, grid.kcells);
+    // Calc mean profiles, the sum over all processes is done at the end of exec_stats
+    add_to_sum(sw_pres);
+    add_to_sum(sw_rdstr);
 
     for (int k=grid.kstart; k<grid.kend+1; ++k)
     {
@@ -1232,25 +1243,25 @@ void Budget_2::calc_diffusion_terms_LES(double* const restrict u2_diss, double*
         tke_diff[k] += 0.5 * (u2_diff[k] + v2_diff[k]);
     }
 
-    // Calculate sum over all processes, and calc mean profiles
-    master.sum(u2_diss,  grid.kcells);
-    master.sum(v2_diss,  grid.kcells);
-    master.sum(w2_diss,  grid.kcells);
-    master.sum(tke_diss, grid.kcells);
-    master.sum(uw_diss,  grid.kcells);
-    master.sum(vw_diss,  grid.kcells);
-    master.sum(u2_visc,  grid.kcells);
-    master.sum(v2_visc,  grid.kcells);
-    master.sum(w2_visc,  grid.kcells);
-    master.sum(tke_visc, grid.kcells);
-    master.sum(uw_visc,  grid.kcells);
-    master.sum(vw_visc,  grid.kcells);
-    master.sum(u2_diff,  grid.kcells);
-    master.sum(v2_diff,  grid.kcells);
-    master.sum(w2_diff,  grid.kcells);
-    master.sum(tke_diff, grid.kcells);
-    master.sum(uw_diff,  grid.kcells);
-    master.sum(vw_diff,  grid.kcells);
+    // Calc mean profiles, the sum over all processes is done at the end of exec_stats
+    add_to_sum(u2_diss);
+    add_to_sum(v2_diss);
+    add_to_sum(w2_diss);
+    add_to_sum(tke_diss);
+    add_to_sum(uw_diss);
+    add_to_sum(vw_diss);
+    add_to_sum(u2_visc);
+    add_to_sum(v2_visc);
+    add_to_sum(w2_visc);
+    add_to_sum(tke_visc);
+    add_to_sum(uw_visc);
+    add_to_sum(vw_visc);
+    add_to_sum(u2_diff);
+    add_to_sum(v2_diff);
+    add_to_sum(w2_diff);
+    add_to_sum(tke_diff);
+    add_to_sum(uw_diff);
+    add_to_sum(vw_diff);
 
     for (int k=grid.kstart; k<grid.kend; ++k)
     {
@@ -1288,20 +1299,12 @@ void Budget_2::calc_diffusion_terms_DNS(double* const restrict u2_visc, double*
                                         double* const restrict w2_visc, double* const restrict tke_visc, double* const restrict uw_visc,
                                         double* const restrict u2_diss, double* const restrict v2_diss,
                                         double* const restrict w2_diss, double* const restrict tke_diss, double* const restrict uw_diss,
-                                        double* const restrict wz, double* const restrict wx, double* const restrict wy,
+                                        double* const restrict wz, const double* const restrict wx, const double* const restrict wy,
                                         const double* const restrict u, const double* const restrict v,
                                         const double* const restrict w, const double* const restrict umean, const double* const restrict vmean,
                                         const double* const restrict dzi, const double* const restrict dzhi,
                                         const double dxi, const double dyi, const double visc)
 {
-    // Interpolate the vertical velocity to {xh,y,zh} (wx, below u) and {x,yh,zh} (wy, below v)
-    const int wloc [3] = {0,0,1};
-    const int wxloc[3] = {1,0,1};
-    const int wyloc[3] = {0,1,1};
-
-    grid.interpolate_2nd(wx, w, wloc, wxloc);
-    grid.interpolate_2nd(wy, w, wloc, wyloc);
-
     const int ii = 1;
     const int jj = grid.icells;
     const int kk = grid.ijcells;
@@ -1534,17 +1537,17 @@ void Budget_2::calc_diffusion_terms_DNS(double* const restrict u2_visc, double*
                                            interp2_4(w[ijk], w[ijk-kk], w[ijk-kk-ii], w[ijk-ii]) ) * dzhi[k];
             }
 
-    // Calculate sum over all processes, and calc mean profiles
-    master.sum(u2_visc,  grid.kcells);
-    master.sum(v2_visc,  grid.kcells);
-    master.sum(w2_visc,  grid.kcells);
-    master.sum(tke_visc, grid.kcells);
-    master.sum(uw_visc,  grid.kcells);
-    master.sum(u2_diss,  grid.kcells);
-    master.sum(v2_diss,  grid.kcells);
-    master.sum(w2_diss,  grid.kcells);
-    master.sum(tke_diss, grid.kcells);
-    master.sum(uw_diss,  grid.kcells);
+    // Calc mean profiles, the sum over all processes is done at the end of exec_stats
+    add_to_sum(u2_visc);
+    add_to_sum(v2_visc);
+    add_to_sum(w2_visc);
+    add_to_sum(tke_visc);
+    add_to_sum(uw_visc);
+    add_to_sum(u2_diss);
+    add_to_sum(v2_diss);
+    add_to_sum(w2_diss);
+    add_to_sum(tke_diss);
+    add_to_sum(uw_diss);
 
     for (int k=grid.kstart; k<grid.kend; ++k)
     {
@@ -1661,11 +1664,11 @@ void Budget_2::calc_diffusion_terms_scalar_DNS(double* const restrict b2_visc, d
     bw_visc[grid.kstart] = bw_visc[grid.kstart+1];
     bw_visc[grid.kend  ] = bw_visc[grid.kend-1  ];
 
-    // Calculate sum over all processes, and calc mean profiles
-    master.sum(b2_visc, grid.kcells);
-    master.sum(b2_diss, grid.kcells);
-    master.sum(bw_visc, grid.kcells);
-    master.sum(bw_diss, grid.kcells);
+    // Calc mean profiles, the sum over all processes is done at the end of exec_stats
+    add_to_sum(b2_visc);
+    add_to_sum(b2_diss);
+    add_to_sum(bw_visc);
+    add_to_sum(bw_diss);
 
     for (int k=grid.kstart; k<grid.kend; ++k)
     {
@@ -1737,11 +1740,11 @@ void Budget_2::calc_buoyancy_terms(double* const restrict w2_buoy, double* const
 
             }
 
-    // Calculate sum over all processes, and calc mean profiles
-    master.sum(w2_buoy,  grid.kcells);
-    master.sum(tke_buoy, grid.kcells);
-    master.sum(uw_buoy,  grid.kcells);
-    master.sum(vw_buoy,  grid.kcells);
+    // Calc mean profiles, the sum over all processes is done at the end of exec_stats
+    add_to_sum(w2_buoy);
+    add_to_sum(tke_buoy);
+    add_to_sum(uw_buoy);
+    add_to_sum(vw_buoy);
 
     for (int k=grid.kstart; k<grid.kend; ++k)
         tke_buoy[k] /= ijtot;
@@ -1779,8 +1782,8 @@ void Budget_2::calc_buoyancy_terms_scalar(double* const restrict sw_buoy,
                 sw_buoy[k] += interp2(s[ijk]-smean[k], s[ijk-kk]-smean[k-1]) * interp2(b[ijk]-bmean[k], b[ijk-kk]-bmean[k-1]);
             }
 
-    // Calculate sum over all processes, and calc mean profiles
-    master.sum(sw_buoy, grid.kcells);
+    // Calc mean profiles, the sum over all processes is done at the end of exec_stats
+    add_to_sum(sw_buoy);
 
     for (int k=grid.kstart; k<grid.kend+1; ++k)
         sw_buoy[k] /= ijtot;
@@ -1840,11 +1843,11 @@ void Budget_2::calc_coriolis_terms(double* const restrict u2_cor, double* const
                                         interp2_4(u[ijk+ii]-umean[k], u[ijk+ii-jj]-umean[k], u[ijk+ii-jj-kk]-umean[k-1], u[ijk+ii-kk]-umean[k-1])) * fc;
             }
 
-    // Calculate sum over all processes, and calc mean profiles
-    master.sum(u2_cor, grid.kcells);
-    master.sum(v2_cor, grid.kcells);
-    master.sum(uw_cor, grid.kcells);
-    master.sum(vw_cor, grid.kcells);
+    // Calc mean profiles, the sum over all processes is done at the end of exec_stats
+    add_to_sum(u2_cor);
+    add_to_sum(v2_cor);
+    add_to_sum(uw_cor);
+    add_to_sum(vw_cor);
 
     for (int k=grid.kstart; k<grid.kend; ++k)
     {
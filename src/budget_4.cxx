@@ -22,6 +22,7 @@
 
 #include <cstdio>
 #include <cmath>
+#include <algorithm>
 #include "master.h"
 #include "grid.h"
 #include "fields.h"
@@ -41,6 +42,8 @@ Budget_4::Budget_4(Input* inputin, Master* masterin, Grid* gridin, Fields* field
 {
     umodel = 0;
     vmodel = 0;
+
+    bsort_sorted = false;
 }
 
 Budget_4::~Budget_4()
@@ -143,9 +146,11 @@ void Budget_4::create()
 
 void Budget_4::exec_stats(Mask* m)
 {
+    Tmp_field tmp1 = fields.get_tmp();
+    Tmp_field tmp2 = fields.get_tmp();
+
     // calculate the mean of the fields
-    grid.calc_mean(umodel, fields.u->data, grid.kcells);
-    grid.calc_mean(vmodel, fields.v->data, grid.kcells);
+    calc_means({umodel, vmodel}, {fields.u->data, fields.v->data});
 
     if (grid.swspatialorder == "4")
     {
@@ -156,14 +161,14 @@ void Budget_4::exec_stats(Mask* m)
                 m->profs["ke"].data, m->profs["tke"].data);
 
         calc_tke_budget_shear_turb(fields.u->data, fields.v->data, fields.w->data,
-                                   fields.atmp["tmp1"]->data, fields.atmp["tmp2"]->data,
+                                   tmp1->data, tmp2->data,
                                    umodel, vmodel,
                                    m->profs["u2_shear"].data, m->profs["v2_shear"].data, m->profs["tke_shear"].data, m->profs["uw_shear"].data,
                                    m->profs["u2_turb"].data, m->profs["v2_turb"].data, m->profs["w2_turb"].data, m->profs["tke_turb"].data, m->profs["uw_turb"].data,
                                    grid.dzi4, grid.dzhi4);
 
         calc_tke_budget(fields.u->data, fields.v->data, fields.w->data, fields.sd["p"]->data,
-                        fields.atmp["tmp1"]->data, fields.atmp["tmp2"]->data,
+                        tmp1->data, tmp2->data,
                         umodel, vmodel,
                         m->profs["u2_visc"].data, m->profs["v2_visc"].data, m->profs["w2_visc"].data, m->profs["tke_visc"].data, m->profs["uw_visc"].data,
                         m->profs["u2_diss"].data, m->profs["v2_diss"].data, m->profs["w2_diss"].data, m->profs["tke_diss"].data, m->profs["uw_diss"].data,
@@ -175,23 +180,22 @@ void Budget_4::exec_stats(Mask* m)
         if (thermo.get_switch() != "0")
         {
             // store the buoyancy in the tmp1 field
-            thermo.get_thermo_field(fields.atmp["tmp1"], fields.atmp["tmp2"], "b", true);
+            thermo.get_thermo_field(tmp1, tmp2, "b", true);
 
-            grid.calc_mean(fields.atmp["tmp1"]->datamean, fields.atmp["tmp1"]->data, grid.kcells);
-            grid.calc_mean(fields.sd["p"]->datamean, fields.sd["p"]->data, grid.kcells);
+            calc_means({tmp1->datamean, fields.sd["p"]->datamean}, {tmp1->data, fields.sd["p"]->data});
 
-            calc_tke_budget_buoy(fields.u->data, fields.w->data, fields.atmp["tmp1"]->data,
-                                 umodel, fields.atmp["tmp1"]->datamean,
+            calc_tke_budget_buoy(fields.u->data, fields.w->data, tmp1->data,
+                                 umodel, tmp1->datamean,
                                  m->profs["w2_buoy"].data, m->profs["tke_buoy"].data, m->profs["uw_buoy"].data);
 
-            calc_b2_budget(fields.w->data, fields.atmp["tmp1"]->data,
-                           fields.atmp["tmp1"]->datamean,
+            calc_b2_budget(fields.w->data, tmp1->data,
+                           tmp1->datamean,
                            m->profs["b2_shear"].data, m->profs["b2_turb"].data, m->profs["b2_visc"].data, m->profs["b2_diss"].data,
                            grid.dzi4, grid.dzhi4,
                            fields.visc);
 
-            calc_bw_budget(fields.w->data, fields.sd["p"]->data, fields.atmp["tmp1"]->data, fields.atmp["tmp2"]->data,
-                           fields.sd["p"]->datamean, fields.atmp["tmp1"]->datamean,
+            calc_bw_budget(fields.w->data, fields.sd["p"]->data, tmp1->data, tmp2->data,
+                           fields.sd["p"]->datamean, tmp1->datamean,
                            m->profs["bw_shear"].data, m->profs["bw_turb"].data, m->profs["bw_visc"].data,
                            m->profs["bw_buoy"].data, m->profs["bw_rdstr"].data, m->profs["bw_diss"].data, m->profs["bw_pres"].data,
                            grid.dzi4, grid.dzhi4,
@@ -202,11 +206,11 @@ void Budget_4::exec_stats(Mask* m)
         if (thermo.get_switch() != "0")
         {
             // calculate the sorted buoyancy profile, tmp1 still contains the buoyancy
-            stats.calc_sorted_prof(fields.atmp["tmp1"]->data, fields.atmp["tmp2"]->data, m->profs["bsort"].data);
+            stats.calc_sorted_prof(tmp1->data, tmp2->data, m->profs["bsort"].data);
 
             // calculate the potential energy back, tmp1 contains the buoyancy, tmp2 will contain height that the local buoyancy
             // will reach in the sorted profile
-            calc_pe(fields.atmp["tmp1"]->data, fields.atmp["tmp2"]->data, fields.atmp["tmp2"]->databot, fields.atmp["tmp2"]->datatop,
+            calc_pe(tmp1->data, tmp2->data, tmp2->databot, tmp2->datatop,
                     grid.z,
                     m->profs["bsort"].data,
                     m->profs["pe"].data, m->profs["ape"].data, m->profs["bpe"].data,
@@ -215,7 +219,7 @@ void Budget_4::exec_stats(Mask* m)
 
             // calculate the budget of background potential energy, start with this one, because tmp2 contains the needed height
             // which will be overwritten inside of the routine
-            // calcBpeBudget(fields.w->data, fields.atmp["tmp1"]->data, fields.atmp["tmp2"]->data, fields.atmp["tmp2"]->databot, fields.atmp["tmp2"]->datatop,
+            // calcBpeBudget(fields.w->data, tmp1->data, tmp2->data, tmp2->databot, tmp2->datatop,
             //               m->profs["bpe_turb"].data, m->profs["bpe_visc"].data, m->profs["bpe_diss"].data,
             //               // TODO put the correct value for visc here!!!!!
             //               m->profs["bsort"].data,
@@ -223,13 +227,16 @@ void Budget_4::exec_stats(Mask* m)
             //               fields.visc);
 
             // calculate the budget of potential energy
-            calc_pe_budget(fields.w->data, fields.atmp["tmp1"]->data, fields.atmp["tmp2"]->data, fields.atmp["tmp2"]->datatop,
+            calc_pe_budget(fields.w->data, tmp1->data, tmp2->data, tmp2->datatop,
                            m->profs["pe_turb"].data, m->profs["pe_visc"].data, m->profs["pe_bous"].data,
                            // TODO put the correct value for visc here!!!!!
                            grid.z, grid.zh, grid.dzi4, grid.dzhi4,
                            fields.visc);
         }
     }
+
+    // sum all budget terms over all processes in one call
+    sum_profs();
 }
 
 void Budget_4::calc_ke(double* restrict u, double* restrict v, double* restrict w,
@@ -277,8 +284,8 @@ void Budget_4::calc_ke(double* restrict u, double* restrict v, double* restrict
             }
     }
 
-    master.sum(ke , grid.kcells);
-    master.sum(tke, grid.kcells);
+    add_to_sum(ke);
+    add_to_sum(tke);
 
     int n = grid.itot*grid.jtot;
     for (int k=grid.kstart; k<grid.kend; ++k)
@@ -388,9 +395,9 @@ void Budget_4::calc_tke_budget_shear_turb(double* restrict u, double* restrict v
     tke_shear[k] += 0.5*(u2_shear[k] + v2_shear[k]);
 
     // create the profiles
-    master.sum(u2_shear, grid.kcells);
-    master.sum(v2_shear, grid.kcells);
-    master.sum(tke_shear, grid.kcells);
+    add_to_sum(u2_shear);
+    add_to_sum(v2_shear);
+    add_to_sum(tke_shear);
 
     for (int k=grid.kstart; k<grid.kend; ++k)
     {
@@ -414,7 +421,7 @@ void Budget_4::calc_tke_budget_shear_turb(double* restrict u, double* restrict v
             }
     }
 
-    master.sum(uw_shear, grid.kcells);
+    add_to_sum(uw_shear);
 
     for (int k=grid.kstart; k<grid.kend+1; ++k)
     {
@@ -564,11 +571,11 @@ void Budget_4::calc_tke_budget_shear_turb(double* restrict u, double* restrict v
         }
 
     // calculate the profiles
-    master.sum(u2_turb , grid.kcells);
-    master.sum(v2_turb , grid.kcells);
-    master.sum(w2_turb , grid.kcells);
-    master.sum(tke_turb, grid.kcells);
-    master.sum(uw_turb , grid.kcells);
+    add_to_sum(u2_turb);
+    add_to_sum(v2_turb);
+    add_to_sum(w2_turb);
+    add_to_sum(tke_turb);
+    add_to_sum(uw_turb);
 
     for (k=grid.kstart; k<grid.kend; ++k)
     {
@@ -734,9 +741,9 @@ void Budget_4::calc_tke_budget(double* restrict u, double* restrict v, double* r
             }
     }
 
-    master.sum(w2_pres , grid.kcells);
-    master.sum(tke_pres, grid.kcells);
-    master.sum(uw_pres , grid.kcells);
+    add_to_sum(w2_pres);
+    add_to_sum(tke_pres);
+    add_to_sum(uw_pres);
 
     for (int k=grid.kstart; k<grid.kend; ++k)
         tke_pres[k] /= n;
@@ -1150,11 +1157,11 @@ void Budget_4::calc_tke_budget(double* restrict u, double* restrict v, double* r
 
         }
 
-    master.sum(u2_visc , grid.kcells);
-    master.sum(v2_visc , grid.kcells);
-    master.sum(w2_visc , grid.kcells);
-    master.sum(tke_visc, grid.kcells);
-    master.sum(uw_visc , grid.kcells);
+    add_to_sum(u2_visc);
+    add_to_sum(v2_visc);
+    add_to_sum(w2_visc);
+    add_to_sum(tke_visc);
+    add_to_sum(uw_visc);
 
     for (int k=grid.kstart; k<grid.kend; ++k)
     {
@@ -1953,11 +1960,11 @@ void Budget_4::calc_tke_budget(double* restrict u, double* restrict v, double* r
                             * dzhi4top ) ); 
         }
 
-    master.sum(u2_diss , grid.kcells);
-    master.sum(v2_diss , grid.kcells);
-    master.sum(w2_diss , grid.kcells);
-    master.sum(tke_diss, grid.kcells);
-    master.sum(uw_diss , grid.kcells);
+    add_to_sum(u2_diss);
+    add_to_sum(v2_diss);
+    add_to_sum(w2_diss);
+    add_to_sum(tke_diss);
+    add_to_sum(uw_diss);
 
     for (int k=grid.kstart; k<grid.kend; ++k)
     {
@@ -2029,10 +2036,10 @@ void Budget_4::calc_tke_budget(double* restrict u, double* restrict v, double* r
             }
     }
 
-    master.sum(u2_rdstr, grid.kcells);
-    master.sum(v2_rdstr, grid.kcells);
-    master.sum(w2_rdstr, grid.kcells);
-    master.sum(uw_rdstr, grid.kcells);
+    add_to_sum(u2_rdstr);
+    add_to_sum(v2_rdstr);
+    add_to_sum(w2_rdstr);
+    add_to_sum(uw_rdstr);
 
     for (int k=grid.kstart; k<grid.kend; ++k)
     {
@@ -2092,9 +2099,9 @@ void Budget_4::calc_tke_budget_buoy(double* restrict u, double* restrict w, doub
             }
     }
 
-    master.sum(tke_buoy, grid.kcells);
-    master.sum(w2_buoy , grid.kcells);
-    master.sum(uw_buoy , grid.kcells);
+    add_to_sum(tke_buoy);
+    add_to_sum(w2_buoy);
+    add_to_sum(uw_buoy);
 
     for (int k=grid.kstart; k<grid.kend; ++k)
         tke_buoy[k] /= n;
@@ -2400,10 +2407,10 @@ void Budget_4::calc_b2_budget(double* restrict w, double* restrict b,
                               , 2 ) ) );
         }
 
-    master.sum(b2_shear, grid.kcells);
-    master.sum(b2_turb , grid.kcells);
-    master.sum(b2_visc , grid.kcells);
-    master.sum(b2_diss , grid.kcells);
+    add_to_sum(b2_shear);
+    add_to_sum(b2_turb);
+    add_to_sum(b2_visc);
+    add_to_sum(b2_diss);
 
     for (int k=grid.kstart; k<grid.kend; ++k)
     {
@@ -2943,13 +2950,13 @@ void Budget_4::calc_bw_budget(double* restrict w, double* restrict p, double* re
     }
 
 
-    master.sum(bw_shear, grid.kcells);
-    master.sum(bw_turb , grid.kcells);
-    master.sum(bw_visc , grid.kcells);
-    master.sum(bw_rdstr, grid.kcells);
-    master.sum(bw_buoy , grid.kcells);
-    master.sum(bw_diss , grid.kcells);
-    master.sum(bw_pres , grid.kcells);
+    add_to_sum(bw_shear);
+    add_to_sum(bw_turb);
+    add_to_sum(bw_visc);
+    add_to_sum(bw_rdstr);
+    add_to_sum(bw_buoy);
+    add_to_sum(bw_diss);
+    add_to_sum(bw_pres);
 
     for (int k=grid.kstart; k<grid.kend+1; ++k)
     {
@@ -2975,6 +2982,13 @@ void Budget_4::calc_pe(double* restrict b, double* restrict zsort, double* restr
     const int kstart = grid.kstart;
     const int kend = grid.kend;
 
+    // calc_zsort searches the sorted profile by bisection, which only gives the same
+    // result as walking the profile from level k if the profile is nondecreasing
+    bsort_sorted = true;
+    for (int k=grid.kstart; k<grid.kend-1; ++k)
+        if (!(bsort[k] <= bsort[k+1]))
+            bsort_sorted = false;
+
     for (int k=grid.kstart; k<grid.kend; ++k)
     {
         pe_total[k] = 0;
@@ -2987,7 +3001,7 @@ void Budget_4::calc_pe(double* restrict b, double* restrict zsort, double* restr
             }
     }
 
-    master.sum(pe_total, grid.kcells);
+    add_to_sum(pe_total);
 
     int n = grid.itot*grid.jtot;
     for (int k=grid.kstart; k<grid.kend; ++k)
@@ -3037,9 +3051,9 @@ void Budget_4::calc_pe(double* restrict b, double* restrict zsort, double* restr
             }
     }
 
-    master.sum(zsortprof, grid.kcells);
-    master.sum(pe_bg    , grid.kcells);
-    master.sum(pe_avail , grid.kcells);
+    add_to_sum(zsortprof);
+    add_to_sum(pe_bg);
+    add_to_sum(pe_avail);
 
     for (int k=grid.kstart; k<grid.kend; ++k)
     {
@@ -3099,8 +3113,14 @@ double Budget_4::calc_zsort(double b, double* restrict bsort, double* restrict z
 
     if (b > bsort[k])
     {
-        while (b > bsort[ks] && ks < grid.kend-1)
-            ++ks;
+        // find the first level above k where bsort >= b, by bisection if bsort is sorted
+        if (bsort_sorted)
+            ks = std::lower_bound(bsort+std::min(k+1, grid.kend-1), bsort+grid.kend-1, b) - bsort;
+        else
+        {
+            while (b > bsort[ks] && ks < grid.kend-1)
+                ++ks;
+        }
 
         // linearly interpolate the height
         zsortval = z[ks-1] + (b-bsort[ks-1])/(bsort[ks]-bsort[ks-1]) * (z[ks]-z[ks-1]);
@@ -3108,8 +3128,14 @@ double Budget_4::calc_zsort(double b, double* restrict bsort, double* restrict z
     }
     else if (b < bsort[k])
     {
-        while (b < bsort[ks] && ks > grid.kstart)
-            --ks;
+        // find the last level below k where bsort <= b, by bisection if bsort is sorted
+        if (bsort_sorted && k > grid.kstart)
+            ks = std::upper_bound(bsort+grid.kstart+1, bsort+k, b) - bsort - 1;
+        else
+        {
+            while (b < bsort[ks] && ks > grid.kstart)
+                --ks;
+        }
 
         // linearly interpolate the height
         zsortval = z[ks] + (b-bsort[ks])/(bsort[ks+1]-bsort[ks]) * (z[ks+1]-z[ks]);
@@ -3346,9 +3372,9 @@ void Budget_4::calc_pe_budget(double* restrict w, double* restrict b, double* re
                                     * dzi4[kend-1];
         }
 
-    master.sum(pe_turb, grid.kcells);
-    master.sum(pe_visc, grid.kcells);
-    master.sum(pe_bous, grid.kcells);
+    add_to_sum(pe_turb);
+    add_to_sum(pe_visc);
+    add_to_sum(pe_bous);
 
     int n = grid.itot*grid.jtot;
     for (int k=grid.kstart; k<grid.kend; ++k)
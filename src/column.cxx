@@ -25,6 +25,9 @@
 #include <sstream>
 #include <iostream>
 #include <iomanip>
+#include <memory>
+#include <vector>
+#include <algorithm>
 #include "master.h"
 #include "grid.h"
 #include "fields.h"
@@ -54,7 +57,24 @@ Column::Column(Model* modelin, Input* inputin)
     nerror += inputin->get_item(&swcolumn, "column", "swcolumn", "", "0");
 
     if (swcolumn == "1")
+    {
         nerror += inputin->get_item(&sampletime, "column", "sampletime", "");
+        nerror += inputin->get_list(&xcolumn, "column", "xcolumn", "");
+        nerror += inputin->get_list(&ycolumn, "column", "ycolumn", "");
+        nerror += inputin->get_item(&buffersize, "column", "buffersize", "", 1);
+
+        if (xcolumn.size() != ycolumn.size())
+        {
+            ++nerror;
+            master->print_error("xcolumn and ycolumn need to have the same number of elements\n");
+        }
+
+        if (buffersize < 1)
+        {
+            ++nerror;
+            master->print_error("buffersize should be at least 1\n");
+        }
+    }
 
     if (!(swcolumn == "0" || swcolumn == "1"))
     {
@@ -91,6 +111,61 @@ void Column::init(double ifactor)
 
     // set the number of column to zero
     ncolumn = 0;
+    nwrite  = 0;
+
+    // Without coordinates a single column in the first grid cell is sampled.
+    if (xcolumn.empty())
+    {
+        xcolumn.push_back(0.);
+        ycolumn.push_back(0.);
+    }
+
+    const int ncol = xcolumn.size();
+
+    icolumn.resize(ncol);
+    jcolumn.resize(ncol);
+    owner  .resize(ncol);
+    ilocal .resize(ncol);
+
+    int nerror = 0;
+    for (int n=0; n<ncol; ++n)
+    {
+        if (xcolumn[n] < 0. || xcolumn[n] >= grid->xsize || ycolumn[n] < 0. || ycolumn[n] >= grid->ysize)
+        {
+            ++nerror;
+            master->print_error("column (%g, %g) is outside of the domain\n", xcolumn[n], ycolumn[n]);
+            continue;
+        }
+
+        // Sample the grid cell that contains the coordinate.
+        icolumn[n] = std::min((int)std::floor(xcolumn[n]*grid->dxi), grid->itot-1);
+        jcolumn[n] = std::min((int)std::floor(ycolumn[n]*grid->dyi), grid->jtot-1);
+    }
+
+    if (nerror)
+        throw 1;
+
+    // Each column is sampled by the process that owns it, store its ij-index in the local grid.
+    ijlocal.clear();
+    for (int n=0; n<ncol; ++n)
+    {
+        const int i = icolumn[n] - master->mpicoordx*grid->imax;
+        const int j = jcolumn[n] - master->mpicoordy*grid->jmax;
+
+        owner [n] = 0;
+        ilocal[n] = 0;
+
+        if (i >= 0 && i < grid->imax && j >= 0 && j < grid->jmax)
+        {
+            owner [n] = master->mpiid;
+            ilocal[n] = ijlocal.size();
+            ijlocal.push_back(i+grid->istart + (j+grid->jstart)*grid->icells);
+        }
+    }
+
+    // Tell all processes which process owns which column, such that the root knows the gather layout.
+    master->sum(owner .data(), ncol);
+    master->sum(ilocal.data(), ncol);
 }
 
 void Column::create(int n)
@@ -129,9 +204,12 @@ void Column::create(int n)
             z_dim  = dataFile->addDim("z" , grid->kmax);
             zh_dim = dataFile->addDim("zh", grid->kmax+1);
             t_dim  = dataFile->addDim("t");
+            station_dim = dataFile->addDim("station", xcolumn.size());
 
             NcVar z_var;
             NcVar zh_var;
+            NcVar x_var;
+            NcVar y_var;
 
             // create variables belonging to dimensions
             iter_var = dataFile->addVar("iter", ncInt, t_dim);
@@ -150,10 +228,29 @@ void Column::create(int n)
             zh_var.putAtt("units", "m");
             zh_var.putAtt("long_name", "Half level height");
 
+            x_var = dataFile->addVar("x", ncDouble, station_dim);
+            x_var.putAtt("units", "m");
+            x_var.putAtt("long_name", "x-coordinate of the column");
+
+            y_var = dataFile->addVar("y", ncDouble, station_dim);
+            y_var.putAtt("units", "m");
+            y_var.putAtt("long_name", "y-coordinate of the column");
+
             // save the grid variables
             z_var .putVar(&grid->z [grid->kstart]);
             zh_var.putVar(&grid->zh[grid->kstart]);
 
+            // save the cell centers of the sampled columns
+            std::vector<double> xc(xcolumn.size());
+            std::vector<double> yc(xcolumn.size());
+            for (size_t n=0; n<xcolumn.size(); ++n)
+            {
+                xc[n] = (icolumn[n]+0.5)*grid->dx;
+                yc[n] = (jcolumn[n]+0.5)*grid->dy;
+            }
+            x_var.putVar(xc.data());
+            y_var.putVar(yc.data());
+
             // Synchronize the NetCDF file
             // BvS: only the last netCDF4-c++ includes the NcFile->sync()
             //      for now use sync() from the netCDF-C library to support older NetCDF4-c++ versions
@@ -200,31 +297,117 @@ void Column::exec(int iteration, double time, unsigned long itime)
     // write message in case column is triggered
     master->print_message("Saving column for time %f\n", time);
 
-    // put the data into the NetCDF file
-    if (master->mpiid == 0)
+    const int ncol   = xcolumn.size();
+    const int nlocal = ijlocal.size();
+    const int nprofs = profs.size();
+    const int kcells = grid->kcells;
+
+    // Set the gather layout: the block of each process holds its columns per profile.
+    if (recvcounts.empty())
     {
-        const std::vector<size_t> time_index = {static_cast<size_t>(ncolumn)};
+        recvcounts.assign(master->nprocs, 0);
+        displs    .assign(master->nprocs, 0);
+
+        for (int n=0; n<ncol; ++n)
+            recvcounts[owner[n]] += nprofs*kcells;
+        for (int p=1; p<master->nprocs; ++p)
+            displs[p] = displs[p-1] + recvcounts[p-1];
+
+        sendbuf.resize(nprofs*nlocal*kcells);
+        if (master->mpiid == 0)
+            recvbuf.resize(nprofs*ncol*kcells);
+    }
 
-        t_var   .putVar(time_index, &time     );
-        iter_var.putVar(time_index, &iteration);
+    // Pack the local columns of all profiles and collect them on the root in one gather.
+    int v = 0;
+    for (Column_map::const_iterator it=profs.begin(); it!=profs.end(); ++it, ++v)
+        std::copy(it->second.data, it->second.data + nlocal*kcells, sendbuf.begin() + v*nlocal*kcells);
 
-        const std::vector<size_t> time_height_index = {static_cast<size_t>(ncolumn), 0};
-        std::vector<size_t> time_height_size  = {1, 0};
+    master->gather(sendbuf.data(), sendbuf.size(), recvbuf.data(), recvcounts.data(), displs.data());
 
-        for (Column_map::const_iterator it=profs.begin(); it!=profs.end(); ++it)
+    // Add the sample to the buffers on the root.
+    if (master->mpiid == 0)
+    {
+        v = 0;
+        for (Column_map::iterator it=profs.begin(); it!=profs.end(); ++it, ++v)
         {
-            time_height_size[1] = profs[it->first].ncvar.getDim(1).getSize();
-            profs[it->first].ncvar.putVar(time_height_index, time_height_size, &profs[it->first].data[grid->kstart]);
+            // The size is stored at creation, as the output thread can be writing the file.
+            const int size = it->second.nlev;
+            for (int n=0; n<ncol; ++n)
+            {
+                const int nowner = recvcounts[owner[n]] / (nprofs*kcells);
+                const double* column = &recvbuf[displs[owner[n]] + (v*nowner + ilocal[n])*kcells + grid->kstart];
+                it->second.buffer.insert(it->second.buffer.end(), column, column + size);
+            }
         }
 
-        // Synchronize the NetCDF file
-        // BvS: only the last netCDF4-c++ includes the NcFile->sync()
-        //      for now use sync() from the netCDF-C library to support older NetCDF4-c++ versions
-        //dataFile->sync();
-        nc_sync(dataFile->getId());
+        time_buffer.push_back(time);
+        iter_buffer.push_back(iteration);
     }
-    
+
     ++ncolumn;
+
+    if (master->mpiid == 0 && time_buffer.size() >= (size_t)buffersize)
+        flush();
+}
+
+void Column::flush()
+{
+    if (swcolumn == "0" || master->mpiid != 0 || time_buffer.empty())
+        return;
+
+    // hand the buffered samples to the output thread, such that the model continues with empty buffers
+    std::shared_ptr<std::vector<std::vector<double>>> data = std::make_shared<std::vector<std::vector<double>>>();
+    for (Column_map::iterator it=profs.begin(); it!=profs.end(); ++it)
+    {
+        data->push_back(std::move(it->second.buffer));
+        it->second.buffer.clear();
+    }
+
+    std::shared_ptr<std::vector<double>> times = std::make_shared<std::vector<double>>(std::move(time_buffer));
+    std::shared_ptr<std::vector<int>>    iters = std::make_shared<std::vector<int>>   (std::move(iter_buffer));
+    time_buffer.clear();
+    iter_buffer.clear();
+
+    const size_t iwrite   = nwrite;
+    const size_t nsamples = times->size();
+    const size_t ncol     = xcolumn.size();
+
+    grid->exec_output([this, iwrite, nsamples, ncol, times, iters, data]()
+    {
+        try
+        {
+            const std::vector<size_t> time_index = {iwrite};
+            const std::vector<size_t> time_size  = {nsamples};
+
+            t_var   .putVar(time_index, time_size, times->data());
+            iter_var.putVar(time_index, time_size, iters->data());
+
+            const std::vector<size_t> time_height_index = {iwrite, 0, 0};
+            std::vector<size_t> time_height_size  = {nsamples, ncol, 0};
+
+            std::vector<std::vector<double>>::const_iterator prof = data->begin();
+            for (Column_map::iterator it=profs.begin(); it!=profs.end(); ++it, ++prof)
+            {
+                time_height_size[2] = prof->size() / (nsamples*ncol);
+                it->second.ncvar.putVar(time_height_index, time_height_size, prof->data());
+            }
+
+            // Synchronize the NetCDF file
+            // BvS: only the last netCDF4-c++ includes the NcFile->sync()
+            //      for now use sync() from the netCDF-C library to support older NetCDF4-c++ versions
+            //dataFile->sync();
+            nc_sync(dataFile->getId());
+        }
+        catch (NcException& e)
+        {
+            return 1;
+        }
+
+        return 0;
+    }, master->simname + ".column");
+
+    nwrite += nsamples;
 }
 
 std::string Column::get_switch()
@@ -238,7 +421,7 @@ void Column::add_prof(std::string name, std::string longname, std::string unit,
     // create the NetCDF variable
     if (master->mpiid == 0)
     {
-        std::vector<NcDim> dim_vector = {t_dim};
+        std::vector<NcDim> dim_vector = {t_dim, station_dim};
 
         if (zloc == "z")
         {
@@ -257,25 +440,26 @@ void Column::add_prof(std::string name, std::string longname, std::string unit,
         profs[name].ncvar.putAtt("_FillValue", ncDouble, NC_FILL_DOUBLE);
     }
 
-    // and allocate the memory and initialize at zero
-    profs[name].data = new double[grid->kcells];
-    for (int k=0; k<grid->kcells; ++k)
-        profs[name].data[k] = 0.;
-
-
-
+    // and allocate the memory for the local columns and initialize at zero
+    profs[name].nlev = (zloc == "zh") ? grid->kmax+1 : grid->kmax;
+    const int size = ijlocal.size()*grid->kcells;
+    profs[name].data = new double[size];
+    for (int n=0; n<size; ++n)
+        profs[name].data[n] = 0.;
 }
+
 void Column::calc_column(double* const restrict prof, const double* const restrict data,
                       const double offset)
 {
-    const int jj = grid->icells;
     const int kk = grid->ijcells;
-   
+    const int kcells = grid->kcells;
 
-    for (int k=1; k<grid->kcells; k++)
-    {
-        const int ijk  = grid->istart + grid->jstart*jj + k*kk;
-        prof[k] = (data[ijk] + offset);
-    }
+    // only the columns that are owned by this process are sampled
+    for (size_t n=0; n<ijlocal.size(); ++n)
+        for (int k=0; k<kcells; k++)
+        {
+            const int ijk = ijlocal[n] + k*kk;
+            prof[n*kcells+k] = (data[ijk] + offset);
+        }
 }
 
@@ -49,6 +49,14 @@ Cross::Cross(Model* modelin, Input* inputin)
 
     if (swcross == "1")
     {
+        // Write one file per slice and output time, or append the output times to one container per slice.
+        nerror += inputin->get_item(&swcontainer, "cross", "swcontainer", "", "0");
+        if (!(swcontainer == "0" || swcontainer == "1"))
+        {
+            master->print_error("\"%s\" is an illegal value for swcontainer\n", swcontainer.c_str());
+            ++nerror;
+        }
+
         // Get the time at which the cross sections are triggered.
         nerror += inputin->get_item(&sampletime, "cross", "sampletime", "");
 
@@ -66,6 +74,10 @@ Cross::Cross(Model* modelin, Input* inputin)
         nerror += inputin->get_list(&xz, "cross", "xz", "");
         nerror += inputin->get_list(&yz, "cross", "yz", "");
         nerror += inputin->get_list(&xy, "cross", "xy", "");
+
+        // get the output encoding, which can be set per variable
+        for (std::vector<std::string>::const_iterator it=crosslist.begin(); it!=crosslist.end(); ++it)
+            nerror += Encoding::get_format(&encodings[*it], inputin, master, "cross", *it);
     }
 
     if (nerror)
@@ -92,6 +104,41 @@ int Cross::check_save(int error, char* filename)
     }
 }
 
+// return the output encoding of a cross variable
+const Encoding::Format& Cross::get_encoding(const std::string& name)
+{
+    std::map<std::string, Encoding::Format>::const_iterator it = encodings.find(name);
+    if (it == encodings.end())
+        return Encoding::raw;
+    else
+        return it->second;
+}
+
+// set the file name of a slice, where index -1 denotes a plane without index
+void Cross::set_filename(char* filename, const std::string& name, const char* plane, const int index, const int iotime)
+{
+    if (swcontainer == "1")
+    {
+        if (index == -1)
+            std::sprintf(filename, "%s.%s", name.c_str(), plane);
+        else
+            std::sprintf(filename, "%s.%s.%05d", name.c_str(), plane, index);
+    }
+    else
+    {
+        if (index == -1)
+            std::sprintf(filename, "%s.%s.%07d", name.c_str(), plane, iotime);
+        else
+            std::sprintf(filename, "%s.%s.%05d.%07d", name.c_str(), plane, index, iotime);
+    }
+}
+
+// return the output time for the grid, which only appends the slice to a container if it is non-negative
+int Cross::get_container_time(const int iotime)
+{
+    return (swcontainer == "1") ? iotime : -1;
+}
+
 void Cross::init(double ifactor)
 {
     if (swcross == "0")
@@ -297,16 +344,16 @@ int Cross::cross_simple(double* restrict data, double* restrict tmp, std::string
     {
         for (std::vector<int>::iterator it=jxzh.begin(); it<jxzh.end(); ++it)
         {
-            std::sprintf(filename, "%s.%s.%05d.%07d", name.c_str(), "xz", *it, iotime);
-            nerror += check_save(grid->save_xz_slice(data, tmp, filename, *it), filename);    
+            set_filename(filename, name, "xz", *it, iotime);
+            nerror += check_save(grid->save_xz_slice(data, tmp, filename, *it, get_encoding(name), get_container_time(iotime)), filename);    
         }
     }
     else
     {
         for (std::vector<int>::iterator it=jxz.begin(); it<jxz.end(); ++it)
         {
-            std::sprintf(filename, "%s.%s.%05d.%07d", name.c_str(), "xz", *it, iotime);
-            nerror += check_save(grid->save_xz_slice(data, tmp, filename, *it), filename);    
+            set_filename(filename, name, "xz", *it, iotime);
+            nerror += check_save(grid->save_xz_slice(data, tmp, filename, *it, get_encoding(name), get_container_time(iotime)), filename);    
         }
     }
     
@@ -315,16 +362,16 @@ int Cross::cross_simple(double* restrict data, double* restrict tmp, std::string
     {
         for (std::vector<int>::iterator it=ixzh.begin(); it<ixzh.end(); ++it)
         {
-            std::sprintf(filename, "%s.%s.%05d.%07d", name.c_str(), "yz", *it, iotime);
-            nerror += check_save(grid->save_yz_slice(data, tmp, filename, *it), filename);    
+            set_filename(filename, name, "yz", *it, iotime);
+            nerror += check_save(grid->save_yz_slice(data, tmp, filename, *it, get_encoding(name), get_container_time(iotime)), filename);    
         }
     }
     else
     {
         for (std::vector<int>::iterator it=ixz.begin(); it<ixz.end(); ++it)
         {
-            std::sprintf(filename, "%s.%s.%05d.%07d", name.c_str(), "yz", *it, iotime);
-            nerror += check_save(grid->save_yz_slice(data, tmp, filename, *it), filename);    
+            set_filename(filename, name, "yz", *it, iotime);
+            nerror += check_save(grid->save_yz_slice(data, tmp, filename, *it, get_encoding(name), get_container_time(iotime)), filename);    
         }
     }
 
@@ -333,16 +380,16 @@ int Cross::cross_simple(double* restrict data, double* restrict tmp, std::string
         // loop over the index arrays to save all xy cross sections
         for (std::vector<int>::iterator it=kxyh.begin(); it<kxyh.end(); ++it)
         {
-            std::sprintf(filename, "%s.%s.%05d.%07d", name.c_str(), "xy", *it, iotime);
-            nerror += check_save(grid->save_xy_slice(data, tmp, filename, *it), filename);
+            set_filename(filename, name, "xy", *it, iotime);
+            nerror += check_save(grid->save_xy_slice(data, tmp, filename, *it, get_encoding(name), get_container_time(iotime)), filename);
         }
     }
     else
     {
         for (std::vector<int>::iterator it=kxy.begin(); it<kxy.end(); ++it)
         {
-            std::sprintf(filename, "%s.%s.%05d.%07d", name.c_str(), "xy", *it, iotime);
-            nerror += check_save(grid->save_xy_slice(data, tmp, filename, *it), filename);
+            set_filename(filename, name, "xy", *it, iotime);
+            nerror += check_save(grid->save_xy_slice(data, tmp, filename, *it, get_encoding(name), get_container_time(iotime)), filename);
         }
     }
 
@@ -354,8 +401,8 @@ int Cross::cross_plane(double* restrict data, double* restrict tmp, std::string
     int nerror = 0;
     char filename[256];
 
-    std::sprintf(filename, "%s.%s.%07d", name.c_str(), "xy", iotime);
-    nerror += check_save(grid->save_xy_slice(data, tmp, filename), filename);
+    set_filename(filename, name, "xy", -1, iotime);
+    nerror += check_save(grid->save_xy_slice(data, tmp, filename, -1, get_encoding(name), get_container_time(iotime)), filename);
 
     return nerror;
 } 
@@ -458,22 +505,22 @@ int Cross::cross_lngrad(double* restrict a, double* restrict lngrad, double* res
     // loop over the index arrays to save all xz cross sections
     for (std::vector<int>::iterator it=jxz.begin(); it<jxz.end(); ++it)
     {
-        std::sprintf(filename, "%s.%s.%05d.%07d", name.c_str(), "xz", *it, iotime);
-        nerror += check_save(grid->save_xz_slice(lngrad, tmp, filename, *it),filename);
+        set_filename(filename, name, "xz", *it, iotime);
+        nerror += check_save(grid->save_xz_slice(lngrad, tmp, filename, *it, get_encoding(name), get_container_time(iotime)),filename);
     }
     
     // loop over the index arrays to save all yz cross sections
     for (std::vector<int>::iterator it=ixz.begin(); it<ixz.end(); ++it)
     {
-        std::sprintf(filename, "%s.%s.%05d.%07d", name.c_str(), "yz", *it, iotime);
-        nerror += check_save(grid->save_yz_slice(lngrad, tmp, filename, *it),filename);
+        set_filename(filename, name, "yz", *it, iotime);
+        nerror += check_save(grid->save_yz_slice(lngrad, tmp, filename, *it, get_encoding(name), get_container_time(iotime)),filename);
     }
 
     // loop over the index arrays to save all xy cross sections
     for (std::vector<int>::iterator it=kxy.begin(); it<kxy.end(); ++it)
     {
-        std::sprintf(filename, "%s.%s.%05d.%07d", name.c_str(), "xy", *it, iotime);
-        nerror += check_save(grid->save_xy_slice(lngrad, tmp, filename, *it),filename);
+        set_filename(filename, name, "xy", *it, iotime);
+        nerror += check_save(grid->save_xy_slice(lngrad, tmp, filename, *it, get_encoding(name), get_container_time(iotime)),filename);
     }
 
     return nerror;
@@ -45,6 +45,7 @@ Diff::Diff(Model* modelin, Input* inputin)
     master = model->master;
 
     swdiff = "0";
+    dn_rate = 0.;
 
     int nerror = 0;
     nerror += inputin->get_item(&dnmax, "diff", "dnmax", "", 0.4);
@@ -97,3 +98,21 @@ std::string Diff::get_switch()
 {
     return swdiff;
 }
+
+unsigned long Diff::get_time_limit(unsigned long idt, double dt, double dnrate)
+{
+    // Avoid zero division.
+    const double dn = std::max(Constants::dsmall, dnrate*dt);
+    return idt * dnmax / dn;
+}
+
+void Diff::calc_dn_rate()
+{
+    // The diffusion number is linear in the time step.
+    dn_rate = get_dn(1.);
+}
+
+double Diff::get_dn_rate()
+{
+    return dn_rate;
+}
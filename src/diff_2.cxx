@@ -51,11 +51,6 @@ void Diff_2::set_values()
         dnmul = std::max(dnmul, std::abs(viscmax * (1./(grid->dx*grid->dx) + 1./(grid->dy*grid->dy) + 1./(grid->dz[k]*grid->dz[k]))));
 }
 
-unsigned long Diff_2::get_time_limit(unsigned long idt, double dt)
-{
-    return idt * dnmax / (dt * dnmul);
-}
-
 double Diff_2::get_dn(const double dt)
 {
     return dnmul*dt;
@@ -68,8 +63,8 @@ void Diff_2::exec()
     diff_c(fields->vt->data, fields->v->data, grid->dzi, grid->dzhi, fields->visc);
     diff_w(fields->wt->data, fields->w->data, grid->dzi, grid->dzhi, fields->visc);
 
-    for (FieldMap::const_iterator it = fields->st.begin(); it!=fields->st.end(); it++)
-        diff_c(it->second->data, fields->sp[it->first]->data, grid->dzi, grid->dzhi, fields->sp[it->first]->visc);
+    for (const Field_pair& s : fields->scalar_pairs)
+        diff_c(s.fldt->data, s.fld->data, grid->dzi, grid->dzhi, s.fld->visc);
 }
 #endif
 
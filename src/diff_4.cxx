@@ -54,11 +54,6 @@ void Diff_4::set_values()
         dnmul = std::max(dnmul, std::abs(viscmax * (1./(grid->dx*grid->dx) + 1./(grid->dy*grid->dy) + 1./(grid->dz[k]*grid->dz[k]))));
 }
 
-unsigned long Diff_4::get_time_limit(unsigned long idt, double dt)
-{
-    return idt * dnmax / (dt * dnmul);
-}
-
 double Diff_4::get_dn(double dt)
 {
     return dnmul*dt;
@@ -74,8 +69,8 @@ void Diff_4::exec()
         diff_c<false>(fields->ut->data, fields->u->data, grid->dzi4, grid->dzhi4, fields->visc);
         diff_w<false>(fields->wt->data, fields->w->data, grid->dzi4, grid->dzhi4, fields->visc);
 
-        for (FieldMap::const_iterator it = fields->st.begin(); it!=fields->st.end(); it++)
-            diff_c<false>(it->second->data, fields->sp[it->first]->data, grid->dzi4, grid->dzhi4, fields->sp[it->first]->visc);
+        for (const Field_pair& s : fields->scalar_pairs)
+            diff_c<false>(s.fldt->data, s.fld->data, grid->dzi4, grid->dzhi4, s.fld->visc);
     }
     else
     {
@@ -83,8 +78,8 @@ void Diff_4::exec()
         diff_c<true>(fields->vt->data, fields->v->data, grid->dzi4, grid->dzhi4, fields->visc);
         diff_w<true>(fields->wt->data, fields->w->data, grid->dzi4, grid->dzhi4, fields->visc);
 
-        for (FieldMap::const_iterator it = fields->st.begin(); it!=fields->st.end(); it++)
-            diff_c<true>(it->second->data, fields->sp[it->first]->data, grid->dzi4, grid->dzhi4, fields->sp[it->first]->visc);
+        for (const Field_pair& s : fields->scalar_pairs)
+            diff_c<true>(s.fldt->data, s.fld->data, grid->dzi4, grid->dzhi4, s.fld->visc);
     }
 }
 #endif
@@ -57,7 +57,7 @@ Diff_disabled::~Diff_disabled()
 {
 }
 
-unsigned long Diff_disabled::get_time_limit(const unsigned long idtlim, const double dt)
+unsigned long Diff_disabled::get_time_limit(const unsigned long idtlim, const double dt, const double dnrate)
 {
     return Constants::ulhuge;
 }
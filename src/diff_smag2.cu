@@ -32,6 +32,7 @@
 #include "constants.h"
 #include "thermo.h"
 #include "model.h"
+#include "timeloop.h"
 #include "tools.h"
 #include "monin_obukhov.h"
 
@@ -474,6 +475,10 @@ void Diff_smag_2::exec_viscosity()
 #ifdef USECUDA
 void Diff_smag_2::exec()
 {
+    // On the GPU, the diffusion number per unit time of the first substep is computed in a separate kernel.
+    if (!model->timeloop->in_substep())
+        dn_rate = get_dn(1.);
+
     const int blocki = grid->ithread_block;
     const int blockj = grid->jthread_block;
     const int gridi  = grid->imax/blocki + (grid->imax%blocki > 0);
@@ -511,41 +516,6 @@ void Diff_smag_2::exec()
 }
 #endif
 
-#ifdef USECUDA
-unsigned long Diff_smag_2::get_time_limit(unsigned long idt, double dt)
-{
-    const int blocki = grid->ithread_block;
-    const int blockj = grid->jthread_block;
-    const int gridi  = grid->imax/blocki + (grid->imax%blocki > 0);
-    const int gridj  = grid->jmax/blockj + (grid->jmax%blockj > 0);
-
-    dim3 gridGPU (gridi, gridj, grid->kmax);
-    dim3 blockGPU(blocki, blockj, 1);
-
-    const int offs = grid->memoffset;
-
-    const double dxidxi = 1./(grid->dx * grid->dx);
-    const double dyidyi = 1./(grid->dy * grid->dy);
-    const double tPrfac = std::min(1., tPr);
-
-    // Calculate dnmul in tmp1 field
-    calc_dnmul_g<<<gridGPU, blockGPU>>>(
-        &fields->atmp["tmp1"]->data_g[offs], &fields->sd["evisc"]->data_g[offs],
-        grid->dzi_g, tPrfac, dxidxi, dyidyi,  
-        grid->istart,  grid->jstart, grid->kstart, 
-        grid->iend,    grid->jend,   grid->kend,
-        grid->icellsp, grid->ijcellsp);  
-    cuda_check_error();
-
-    // Get maximum from tmp1 field
-    double dnmul = grid->get_max_g(&fields->atmp["tmp1"]->data_g[offs], fields->atmp["tmp2"]->data_g); 
-    dnmul = std::max(Constants::dsmall, dnmul);
-    const unsigned long idtlim = idt * dnmax/(dnmul*dt);
-
-    return idtlim;
-}
-#endif
-
 #ifdef USECUDA
 double Diff_smag_2::get_dn(double dt)
 {
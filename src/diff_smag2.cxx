@@ -23,6 +23,7 @@
 #include <cstdio>
 #include <cmath>
 #include <algorithm>
+#include <vector>
 #include "grid.h"
 #include "fields.h"
 #include "master.h"
@@ -32,11 +33,94 @@
 #include "constants.h"
 #include "thermo.h"
 #include "model.h"
+#include "timeloop.h"
 #include "monin_obukhov.h"
 
 namespace
 {
     namespace most = Monin_obukhov;
+
+    // Squared strain rate at the cell center.
+    inline double strain2_interior(const double* const restrict u, const double* const restrict v, const double* const restrict w,
+                                   const int ijk, const int ii, const int jj, const int kk,
+                                   const double dxi, const double dyi, const double dzi, const double dzhi, const double dzhitop)
+    {
+        return 2.*(
+               // du/dx + du/dx
+               + std::pow((u[ijk+ii]-u[ijk])*dxi, 2)
+
+               // dv/dy + dv/dy
+               + std::pow((v[ijk+jj]-v[ijk])*dyi, 2)
+
+               // dw/dz + dw/dz
+               + std::pow((w[ijk+kk]-w[ijk])*dzi, 2)
+
+               // du/dy + dv/dx
+               + 0.125*std::pow((u[ijk      ]-u[ijk   -jj])*dyi  + (v[ijk      ]-v[ijk-ii   ])*dxi, 2)
+               + 0.125*std::pow((u[ijk+ii   ]-u[ijk+ii-jj])*dyi  + (v[ijk+ii   ]-v[ijk      ])*dxi, 2)
+               + 0.125*std::pow((u[ijk   +jj]-u[ijk      ])*dyi  + (v[ijk   +jj]-v[ijk-ii+jj])*dxi, 2)
+               + 0.125*std::pow((u[ijk+ii+jj]-u[ijk+ii   ])*dyi  + (v[ijk+ii+jj]-v[ijk   +jj])*dxi, 2)
+
+               // du/dz + dw/dx
+               + 0.125*std::pow((u[ijk      ]-u[ijk   -kk])*dzhi    + (w[ijk      ]-w[ijk-ii   ])*dxi, 2)
+               + 0.125*std::pow((u[ijk+ii   ]-u[ijk+ii-kk])*dzhi    + (w[ijk+ii   ]-w[ijk      ])*dxi, 2)
+               + 0.125*std::pow((u[ijk   +kk]-u[ijk      ])*dzhitop + (w[ijk   +kk]-w[ijk-ii+kk])*dxi, 2)
+               + 0.125*std::pow((u[ijk+ii+kk]-u[ijk+ii   ])*dzhitop + (w[ijk+ii+kk]-w[ijk   +kk])*dxi, 2)
+
+               // dv/dz + dw/dy
+               + 0.125*std::pow((v[ijk      ]-v[ijk   -kk])*dzhi    + (w[ijk      ]-w[ijk-jj   ])*dyi, 2)
+               + 0.125*std::pow((v[ijk+jj   ]-v[ijk+jj-kk])*dzhi    + (w[ijk+jj   ]-w[ijk      ])*dyi, 2)
+               + 0.125*std::pow((v[ijk   +kk]-v[ijk      ])*dzhitop + (w[ijk   +kk]-w[ijk-jj+kk])*dyi, 2)
+               + 0.125*std::pow((v[ijk+jj+kk]-v[ijk+jj   ])*dzhitop + (w[ijk+jj+kk]-w[ijk   +kk])*dyi, 2) )
+
+               // Add a small number to avoid zero divisions.
+               + Constants::dsmall;
+    }
+
+    // Squared strain rate at the lowest model level, where du/dz and dv/dz follow from Monin-Obukhov similarity.
+    inline double strain2_most(const double* const restrict u, const double* const restrict v, const double* const restrict w,
+                               const double* const restrict ufluxbot, const double* const restrict vfluxbot,
+                               const double* const restrict ustar, const double* const restrict obuk,
+                               const int ij, const int ijk, const int ii, const int jj, const int kk,
+                               const double dxi, const double dyi, const double dzi, const double zsl)
+    {
+        return 2.*(
+               // du/dx + du/dx
+               + std::pow((u[ijk+ii]-u[ijk])*dxi, 2)
+
+               // dv/dy + dv/dy
+               + std::pow((v[ijk+jj]-v[ijk])*dyi, 2)
+
+               // dw/dz + dw/dz
+               + std::pow((w[ijk+kk]-w[ijk])*dzi, 2)
+
+               // du/dy + dv/dx
+               + 0.125*std::pow((u[ijk      ]-u[ijk   -jj])*dyi  + (v[ijk      ]-v[ijk-ii   ])*dxi, 2)
+               + 0.125*std::pow((u[ijk+ii   ]-u[ijk+ii-jj])*dyi  + (v[ijk+ii   ]-v[ijk      ])*dxi, 2)
+               + 0.125*std::pow((u[ijk   +jj]-u[ijk      ])*dyi  + (v[ijk   +jj]-v[ijk-ii+jj])*dxi, 2)
+               + 0.125*std::pow((u[ijk+ii+jj]-u[ijk+ii   ])*dyi  + (v[ijk+ii+jj]-v[ijk   +jj])*dxi, 2)
+
+               // du/dz
+               + 0.5*std::pow(-0.5*(ufluxbot[ij]+ufluxbot[ij+ii])/(Constants::kappa*zsl*ustar[ij])*most::phim(zsl/obuk[ij]), 2)
+
+               // dw/dx
+               + 0.125*std::pow((w[ijk      ]-w[ijk-ii   ])*dxi, 2)
+               + 0.125*std::pow((w[ijk+ii   ]-w[ijk      ])*dxi, 2)
+               + 0.125*std::pow((w[ijk   +kk]-w[ijk-ii+kk])*dxi, 2)
+               + 0.125*std::pow((w[ijk+ii+kk]-w[ijk   +kk])*dxi, 2)
+
+               // dv/dz
+               + 0.5*std::pow(-0.5*(vfluxbot[ij]+vfluxbot[ij+jj])/(Constants::kappa*zsl*ustar[ij])*most::phim(zsl/obuk[ij]), 2)
+
+               // dw/dy
+               + 0.125*std::pow((w[ijk      ]-w[ijk-jj   ])*dyi, 2)
+               + 0.125*std::pow((w[ijk+jj   ]-w[ijk      ])*dyi, 2)
+               + 0.125*std::pow((w[ijk   +kk]-w[ijk-jj+kk])*dyi, 2)
+               + 0.125*std::pow((w[ijk+jj+kk]-w[ijk   +kk])*dyi, 2) )
+
+               // Add a small number to avoid zero divisions.
+               + Constants::dsmall;
+    }
 }
 
 Diff_smag_2::Diff_smag_2(Model* modelin, Input* inputin) : Diff(modelin, inputin)
@@ -65,17 +149,6 @@ Diff_smag_2::~Diff_smag_2()
 #endif
 }
 
-#ifndef USECUDA
-unsigned long Diff_smag_2::get_time_limit(const unsigned long idt, const double dt)
-{
-    double dnmul = calc_dnmul(fields->sd["evisc"]->data, grid->dzi, this->tPr);
-    // Avoid zero division.
-    dnmul = std::max(Constants::dsmall, dnmul);
-
-    return idt * dnmax/(dnmul*dt);
-}
-#endif
-
 #ifndef USECUDA
 double Diff_smag_2::get_dn(const double dt)
 {
@@ -90,27 +163,29 @@ double Diff_smag_2::get_dn(const double dt)
 
 void Diff_smag_2::exec_viscosity()
 {
+    Tmp_field tmp1 = fields->get_tmp();
+
     // Do a cast because the base boundary class does not have the MOST related variables.
     Boundary_surface* boundaryptr = static_cast<Boundary_surface*>(model->boundary);
 
-    // Calculate strain rate using MO for velocity gradients lowest level
-    if (model->boundary->get_switch() == "surface")
-        calc_strain2<false>(fields->sd["evisc"]->data,
-                            fields->u->data, fields->v->data, fields->w->data,
-                            fields->u->datafluxbot, fields->v->datafluxbot,
-                            boundaryptr->ustar, boundaryptr->obuk,
-                            grid->z, grid->dzi, grid->dzhi);
-    // Calculate strain rate using resolved boundaries
-    else
-        calc_strain2<true>(fields->sd["evisc"]->data,
-                           fields->u->data, fields->v->data, fields->w->data,
-                           fields->u->datafluxbot, fields->v->datafluxbot,
-                           NULL, NULL, // BvS, for now....
-                           grid->z, grid->dzi, grid->dzhi);
-
     // start with retrieving the stability information
     if (model->thermo->get_switch() == "0")
     {
+        // Calculate strain rate using MO for velocity gradients lowest level
+        if (model->boundary->get_switch() == "surface")
+            calc_strain2<false>(fields->sd["evisc"]->data,
+                                fields->u->data, fields->v->data, fields->w->data,
+                                fields->u->datafluxbot, fields->v->datafluxbot,
+                                boundaryptr->ustar, boundaryptr->obuk,
+                                grid->z, grid->dzi, grid->dzhi);
+        // Calculate strain rate using resolved boundaries
+        else
+            calc_strain2<true>(fields->sd["evisc"]->data,
+                               fields->u->data, fields->v->data, fields->w->data,
+                               fields->u->datafluxbot, fields->v->datafluxbot,
+                               NULL, NULL, // BvS, for now....
+                               grid->z, grid->dzi, grid->dzhi);
+
         // Calculate eddy viscosity using MO at lowest model level
         if (model->boundary->get_switch() == "surface")
             calc_evisc_neutral<false>(fields->sd["evisc"]->data,
@@ -127,18 +202,30 @@ void Diff_smag_2::exec_viscosity()
     // assume buoyancy calculation is needed
     else
     {
-        // store the buoyancyflux in tmp1
-        model->thermo->get_buoyancy_fluxbot(fields->atmp["tmp1"]);
-        // retrieve the full field in tmp1 and use tmp2 for temporary calculations
-        model->thermo->get_thermo_field(fields->atmp["tmp1"], fields->atmp["tmp2"], "N2", false);
-        // model->thermo->getThermoField(fields->sd["tmp1"], fields->sd["tmp2"], "b");
-
-        calc_evisc(fields->sd["evisc"]->data,
-                   fields->u->data, fields->v->data, fields->w->data, fields->atmp["tmp1"]->data,
-                   fields->u->datafluxbot, fields->v->datafluxbot, fields->atmp["tmp1"]->datafluxbot,
-                   boundaryptr->ustar, boundaryptr->obuk,
-                   grid->z, grid->dz, grid->dzi,
-                   boundaryptr->z0m);
+        // Get the functor that evaluates N2 inline, such that strain, stability correction
+        // and wall damping are computed in a single sweep without a 3d N2 field.
+        std::vector<double> N2fac(grid->kcells);
+        const N2_functor N2 = model->thermo->get_N2_functor(N2fac.data());
+
+        if (model->boundary->get_switch() == "surface")
+        {
+            // store the buoyancyflux in the bottom flux of tmp1
+            model->thermo->get_buoyancy_fluxbot(tmp1);
+
+            calc_evisc<false>(fields->sd["evisc"]->data,
+                              fields->u->data, fields->v->data, fields->w->data,
+                              fields->u->datafluxbot, fields->v->datafluxbot, tmp1->datafluxbot,
+                              boundaryptr->ustar, boundaryptr->obuk, N2,
+                              grid->z, grid->dz, grid->dzi, grid->dzhi,
+                              boundaryptr->z0m, fields->visc);
+        }
+        else
+            calc_evisc<true>(fields->sd["evisc"]->data,
+                             fields->u->data, fields->v->data, fields->w->data,
+                             fields->u->datafluxbot, fields->v->datafluxbot, NULL,
+                             NULL, NULL, N2,
+                             grid->z, grid->dz, grid->dzi, grid->dzhi,
+                             0, fields->visc);
     }
 }
 #endif
@@ -146,31 +233,42 @@ void Diff_smag_2::exec_viscosity()
 #ifndef USECUDA
 void Diff_smag_2::exec()
 {
+    // In the first substep, the diffusion number per unit time is a by-product of the u-diffusion.
+    const bool calc_dn = !model->timeloop->in_substep();
+
     if(model->boundary->get_switch() == "surface")
     {
-        diff_u<false>(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi, grid->dzhi, fields->sd["evisc"]->data,
-               fields->u->datafluxbot, fields->u->datafluxtop, fields->rhoref, fields->rhorefh);
+        if (calc_dn)
+            dn_rate = diff_u<false, true>(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi, grid->dzhi, fields->sd["evisc"]->data,
+                                          fields->u->datafluxbot, fields->u->datafluxtop, fields->rhoref, fields->rhorefh);
+        else
+            diff_u<false, false>(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi, grid->dzhi, fields->sd["evisc"]->data,
+                                 fields->u->datafluxbot, fields->u->datafluxtop, fields->rhoref, fields->rhorefh);
         diff_v<false>(fields->vt->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi, grid->dzhi, fields->sd["evisc"]->data,
                fields->v->datafluxbot, fields->v->datafluxtop, fields->rhoref, fields->rhorefh);
         diff_w(fields->wt->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi, grid->dzhi, fields->sd["evisc"]->data,
                fields->rhoref, fields->rhorefh);
 
-        for (FieldMap::const_iterator it = fields->st.begin(); it!=fields->st.end(); ++it)
-            diff_c(it->second->data, fields->sp[it->first]->data, grid->dzi, grid->dzhi, fields->sd["evisc"]->data,
-                   fields->sp[it->first]->datafluxbot, fields->sp[it->first]->datafluxtop, fields->rhoref, fields->rhorefh, this->tPr);
+        for (const Field_pair& s : fields->scalar_pairs)
+            diff_c(s.fldt->data, s.fld->data, grid->dzi, grid->dzhi, fields->sd["evisc"]->data,
+                   s.fld->datafluxbot, s.fld->datafluxtop, fields->rhoref, fields->rhorefh, this->tPr);
     }
     else
     {
-        diff_u<true>(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi, grid->dzhi, fields->sd["evisc"]->data,
-               fields->u->datafluxbot, fields->u->datafluxtop, fields->rhoref, fields->rhorefh);
+        if (calc_dn)
+            dn_rate = diff_u<true, true>(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi, grid->dzhi, fields->sd["evisc"]->data,
+                                         fields->u->datafluxbot, fields->u->datafluxtop, fields->rhoref, fields->rhorefh);
+        else
+            diff_u<true, false>(fields->ut->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi, grid->dzhi, fields->sd["evisc"]->data,
+                                fields->u->datafluxbot, fields->u->datafluxtop, fields->rhoref, fields->rhorefh);
         diff_v<true>(fields->vt->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi, grid->dzhi, fields->sd["evisc"]->data,
                fields->v->datafluxbot, fields->v->datafluxtop, fields->rhoref, fields->rhorefh);
         diff_w(fields->wt->data, fields->u->data, fields->v->data, fields->w->data, grid->dzi, grid->dzhi, fields->sd["evisc"]->data,
                fields->rhoref, fields->rhorefh);
 
-        for (FieldMap::const_iterator it = fields->st.begin(); it!=fields->st.end(); ++it)
-            diff_c(it->second->data, fields->sp[it->first]->data, grid->dzi, grid->dzhi, fields->sd["evisc"]->data,
-                   fields->sp[it->first]->datafluxbot, fields->sp[it->first]->datafluxtop, fields->rhoref, fields->rhorefh, this->tPr);
+        for (const Field_pair& s : fields->scalar_pairs)
+            diff_c(s.fldt->data, s.fld->data, grid->dzi, grid->dzhi, fields->sd["evisc"]->data,
+                   s.fld->datafluxbot, s.fld->datafluxtop, fields->rhoref, fields->rhorefh, this->tPr);
 
     }
 }
@@ -202,43 +300,8 @@ void Diff_smag_2::calc_strain2(double* restrict strain2,
             {
                 const int ij  = i + j*jj;
                 const int ijk = i + j*jj + kstart*kk;
-
-                strain2[ijk] = 2.*(
-                               // du/dx + du/dx
-                               + std::pow((u[ijk+ii]-u[ijk])*dxi, 2)
-
-                               // dv/dy + dv/dy
-                               + std::pow((v[ijk+jj]-v[ijk])*dyi, 2)
-
-                               // dw/dz + dw/dz
-                               + std::pow((w[ijk+kk]-w[ijk])*dzi[kstart], 2)
-
-                               // du/dy + dv/dx
-                               + 0.125*std::pow((u[ijk      ]-u[ijk   -jj])*dyi  + (v[ijk      ]-v[ijk-ii   ])*dxi, 2)
-                               + 0.125*std::pow((u[ijk+ii   ]-u[ijk+ii-jj])*dyi  + (v[ijk+ii   ]-v[ijk      ])*dxi, 2)
-                               + 0.125*std::pow((u[ijk   +jj]-u[ijk      ])*dyi  + (v[ijk   +jj]-v[ijk-ii+jj])*dxi, 2)
-                               + 0.125*std::pow((u[ijk+ii+jj]-u[ijk+ii   ])*dyi  + (v[ijk+ii+jj]-v[ijk   +jj])*dxi, 2)
-
-                               // du/dz
-                               + 0.5*std::pow(-0.5*(ufluxbot[ij]+ufluxbot[ij+ii])/(Constants::kappa*z[kstart]*ustar[ij])*most::phim(z[kstart]/obuk[ij]), 2)
-
-                               // dw/dx
-                               + 0.125*std::pow((w[ijk      ]-w[ijk-ii   ])*dxi, 2)
-                               + 0.125*std::pow((w[ijk+ii   ]-w[ijk      ])*dxi, 2)
-                               + 0.125*std::pow((w[ijk   +kk]-w[ijk-ii+kk])*dxi, 2)
-                               + 0.125*std::pow((w[ijk+ii+kk]-w[ijk   +kk])*dxi, 2)
-
-                               // dv/dz
-                               + 0.5*std::pow(-0.5*(vfluxbot[ij]+vfluxbot[ij+jj])/(Constants::kappa*z[kstart]*ustar[ij])*most::phim(z[kstart]/obuk[ij]), 2)
-
-                               // dw/dy
-                               + 0.125*std::pow((w[ijk      ]-w[ijk-jj   ])*dyi, 2)
-                               + 0.125*std::pow((w[ijk+jj   ]-w[ijk      ])*dyi, 2)
-                               + 0.125*std::pow((w[ijk   +kk]-w[ijk-jj+kk])*dyi, 2)
-                               + 0.125*std::pow((w[ijk+jj+kk]-w[ijk   +kk])*dyi, 2) );
-
-                // add a small number to avoid zero divisions
-                strain2[ijk] += Constants::dsmall;
+                strain2[ijk] = strain2_most(u, v, w, ufluxbot, vfluxbot, ustar, obuk,
+                                            ij, ijk, ii, jj, kk, dxi, dyi, dzi[kstart], z[kstart]);
             }
     }
 
@@ -248,102 +311,115 @@ void Diff_smag_2::calc_strain2(double* restrict strain2,
             for (int i=grid->istart; i<grid->iend; ++i)
             {
                 const int ijk = i + j*jj + k*kk;
-                strain2[ijk] = 2.*(
-                               // du/dx + du/dx
-                               + std::pow((u[ijk+ii]-u[ijk])*dxi, 2)
-
-                               // dv/dy + dv/dy
-                               + std::pow((v[ijk+jj]-v[ijk])*dyi, 2)
-
-                               // dw/dz + dw/dz
-                               + std::pow((w[ijk+kk]-w[ijk])*dzi[k], 2)
-
-                               // du/dy + dv/dx
-                               + 0.125*std::pow((u[ijk      ]-u[ijk   -jj])*dyi  + (v[ijk      ]-v[ijk-ii   ])*dxi, 2)
-                               + 0.125*std::pow((u[ijk+ii   ]-u[ijk+ii-jj])*dyi  + (v[ijk+ii   ]-v[ijk      ])*dxi, 2)
-                               + 0.125*std::pow((u[ijk   +jj]-u[ijk      ])*dyi  + (v[ijk   +jj]-v[ijk-ii+jj])*dxi, 2)
-                               + 0.125*std::pow((u[ijk+ii+jj]-u[ijk+ii   ])*dyi  + (v[ijk+ii+jj]-v[ijk   +jj])*dxi, 2)
-
-                               // du/dz + dw/dx
-                               + 0.125*std::pow((u[ijk      ]-u[ijk   -kk])*dzhi[k  ] + (w[ijk      ]-w[ijk-ii   ])*dxi, 2)
-                               + 0.125*std::pow((u[ijk+ii   ]-u[ijk+ii-kk])*dzhi[k  ] + (w[ijk+ii   ]-w[ijk      ])*dxi, 2)
-                               + 0.125*std::pow((u[ijk   +kk]-u[ijk      ])*dzhi[k+1] + (w[ijk   +kk]-w[ijk-ii+kk])*dxi, 2)
-                               + 0.125*std::pow((u[ijk+ii+kk]-u[ijk+ii   ])*dzhi[k+1] + (w[ijk+ii+kk]-w[ijk   +kk])*dxi, 2)
-
-                               // dv/dz + dw/dy
-                               + 0.125*std::pow((v[ijk      ]-v[ijk   -kk])*dzhi[k  ] + (w[ijk      ]-w[ijk-jj   ])*dyi, 2)
-                               + 0.125*std::pow((v[ijk+jj   ]-v[ijk+jj-kk])*dzhi[k  ] + (w[ijk+jj   ]-w[ijk      ])*dyi, 2)
-                               + 0.125*std::pow((v[ijk   +kk]-v[ijk      ])*dzhi[k+1] + (w[ijk   +kk]-w[ijk-jj+kk])*dyi, 2)
-                               + 0.125*std::pow((v[ijk+jj+kk]-v[ijk+jj   ])*dzhi[k+1] + (w[ijk+jj+kk]-w[ijk   +kk])*dyi, 2) );
-
-                       // Add a small number to avoid zero divisions.
-                       strain2[ijk] += Constants::dsmall;
+                strain2[ijk] = strain2_interior(u, v, w, ijk, ii, jj, kk, dxi, dyi, dzi[k], dzhi[k], dzhi[k+1]);
             }
 }
 
+template <bool resolved_wall>
 void Diff_smag_2::calc_evisc(double* restrict evisc,
-                             double* restrict u, double* restrict v, double* restrict w,  double* restrict N2,
+                             double* restrict u, double* restrict v, double* restrict w,
                              double* restrict ufluxbot, double* restrict vfluxbot, double* restrict bfluxbot,
-                             double* restrict ustar, double* restrict obuk,
-                             double* restrict z, double* restrict dz, double* restrict dzi,
-                             const double z0m)
+                             double* restrict ustar, double* restrict obuk, const N2_functor N2,
+                             double* restrict z, double* restrict dz, double* restrict dzi, double* restrict dzhi,
+                             const double z0m, const double mvisc)
 {
-    // Variables for the wall damping.
-    double mlen,mlen0,fac;
-    const double n = 2.;
-
-    double RitPrratio;
-
+    const int ii = 1;
     const int jj = grid->icells;
     const int kk = grid->ijcells;
     const int kstart = grid->kstart;
 
-    const double dx = grid->dx;
-    const double dy = grid->dy;
-
-    // bottom boundary, here strain is fully parametrized using MO
-    // calculate smagorinsky constant times filter width squared, use wall damping according to Mason
-    mlen0 = this->cs*std::pow(dx*dy*dz[kstart], 1./3.);
-    mlen  = std::pow(1./(1./std::pow(mlen0, n) + 1./(std::pow(Constants::kappa*(z[kstart]+z0m), n))), 1./n);
-    fac   = std::pow(mlen, 2);
+    // Make local copies to aid vectorization.
+    const double dx  = grid->dx;
+    const double dy  = grid->dy;
+    const double dxi = 1./grid->dx;
+    const double dyi = 1./grid->dy;
+    const double cs  = this->cs;
+    const double tPr = this->tPr;
 
-    // local copies to aid vectorization
-    double tPr = this->tPr;
-    double cs  = this->cs;
+    // Wall damping constant.
+    const double n = 2.;
 
-    for (int j=grid->jstart; j<grid->jend; ++j)
-        #pragma ivdep
-        for (int i=grid->istart; i<grid->iend; ++i)
+    if (resolved_wall)
+    {
+        for (int k=grid->kstart; k<grid->kend; ++k)
         {
-            const int ij  = i + j*jj;
-            const int ijk = i + j*jj + kstart*kk;
-            // TODO use the thermal expansion coefficient from the input later, what to do if there is no buoyancy?
-            // Add the buoyancy production to the TKE
-            RitPrratio = -bfluxbot[ij]/(Constants::kappa*z[kstart]*ustar[ij])*most::phih(z[kstart]/obuk[ij]) / evisc[ijk] / tPr;
-            RitPrratio = std::min(RitPrratio, 1.-Constants::dsmall);
-            evisc[ijk] = fac * std::sqrt(evisc[ijk]) * std::sqrt(1.-RitPrratio);
+            const double fac = std::pow(cs*std::pow(dx*dy*dz[k], 1./3.), 2);
+
+            for (int j=grid->jstart; j<grid->jend; ++j)
+                #pragma ivdep
+                for (int i=grid->istart; i<grid->iend; ++i)
+                {
+                    const int ijk = i + j*jj + k*kk;
+                    const double strain2 = strain2_interior(u, v, w, ijk, ii, jj, kk, dxi, dyi, dzi[k], dzhi[k], dzhi[k+1]);
+
+                    // Add the buoyancy production to the TKE
+                    const double RitPrratio = std::min(N2(ijk, k) / strain2 / tPr, 1.-Constants::dsmall);
+                    evisc[ijk] = fac * std::sqrt(strain2) * std::sqrt(1.-RitPrratio) + mvisc;
+                }
         }
 
-    for (int k=grid->kstart+1; k<grid->kend; ++k)
+        grid->boundary_cyclic(evisc);
+
+        // For a resolved wall the viscosity at the wall is needed. For now, assume that the eddy viscosity
+        // is zero, so set ghost cell such that the viscosity interpolated to the surface equals the molecular viscosity.
+        const int kb = grid->kstart;
+        const int kt = grid->kend-1;
+        for (int j=0; j<grid->jcells; ++j)
+            #pragma ivdep
+            for (int i=0; i<grid->icells; ++i)
+            {
+                const int ijkb = i + j*jj + kb*kk;
+                const int ijkt = i + j*jj + kt*kk;
+                evisc[ijkb-kk] = 2 * mvisc - evisc[ijkb];
+                evisc[ijkt+kk] = 2 * mvisc - evisc[ijkt];
+            }
+    }
+    else
     {
+        // bottom boundary, here strain is fully parametrized using MO
         // calculate smagorinsky constant times filter width squared, use wall damping according to Mason
-        mlen0 = cs*std::pow(dx*dy*dz[k], 1./3.);
-        mlen  = std::pow(1./(1./std::pow(mlen0, n) + 1./(std::pow(Constants::kappa*(z[k]+z0m), n))), 1./n);
-        fac   = std::pow(mlen, 2);
+        const double mlen0 = cs*std::pow(dx*dy*dz[kstart], 1./3.);
+        const double mlen  = std::pow(1./(1./std::pow(mlen0, n) + 1./(std::pow(Constants::kappa*(z[kstart]+z0m), n))), 1./n);
+        const double fac   = std::pow(mlen, 2);
 
         for (int j=grid->jstart; j<grid->jend; ++j)
             #pragma ivdep
             for (int i=grid->istart; i<grid->iend; ++i)
             {
-                const int ijk = i + j*jj + k*kk;
+                const int ij  = i + j*jj;
+                const int ijk = i + j*jj + kstart*kk;
+                const double strain2 = strain2_most(u, v, w, ufluxbot, vfluxbot, ustar, obuk,
+                                                    ij, ijk, ii, jj, kk, dxi, dyi, dzi[kstart], z[kstart]);
+
+                // TODO use the thermal expansion coefficient from the input later, what to do if there is no buoyancy?
                 // Add the buoyancy production to the TKE
-                RitPrratio = N2[ijk] / evisc[ijk] / tPr;
+                double RitPrratio = -bfluxbot[ij]/(Constants::kappa*z[kstart]*ustar[ij])*most::phih(z[kstart]/obuk[ij]) / strain2 / tPr;
                 RitPrratio = std::min(RitPrratio, 1.-Constants::dsmall);
-                evisc[ijk] = fac * std::sqrt(evisc[ijk]) * std::sqrt(1.-RitPrratio);
+                evisc[ijk] = fac * std::sqrt(strain2) * std::sqrt(1.-RitPrratio);
             }
-    }
 
-    grid->boundary_cyclic(evisc);
+        for (int k=grid->kstart+1; k<grid->kend; ++k)
+        {
+            // calculate smagorinsky constant times filter width squared, use wall damping according to Mason
+            const double mlen0 = cs*std::pow(dx*dy*dz[k], 1./3.);
+            const double mlen  = std::pow(1./(1./std::pow(mlen0, n) + 1./(std::pow(Constants::kappa*(z[k]+z0m), n))), 1./n);
+            const double fac   = std::pow(mlen, 2);
+
+            for (int j=grid->jstart; j<grid->jend; ++j)
+                #pragma ivdep
+                for (int i=grid->istart; i<grid->iend; ++i)
+                {
+                    const int ijk = i + j*jj + k*kk;
+                    const double strain2 = strain2_interior(u, v, w, ijk, ii, jj, kk, dxi, dyi, dzi[k], dzhi[k], dzhi[k+1]);
+
+                    // Add the buoyancy production to the TKE
+                    const double RitPrratio = std::min(N2(ijk, k) / strain2 / tPr, 1.-Constants::dsmall);
+                    evisc[ijk] = fac * std::sqrt(strain2) * std::sqrt(1.-RitPrratio);
+                }
+        }
+
+        grid->boundary_cyclic(evisc);
+    }
 }
 
 template <bool resolved_wall>
@@ -416,11 +492,11 @@ void Diff_smag_2::calc_evisc_neutral(double* restrict evisc,
 
 }
 
-template <bool resolved_wall>
-void Diff_smag_2::diff_u(double* restrict ut, double* restrict u, double* restrict v, double* restrict w,
-                         double* restrict dzi, double* restrict dzhi, double* restrict evisc,
-                         double* restrict fluxbot, double* restrict fluxtop,
-                         double* restrict rhoref, double* restrict rhorefh)
+template <bool resolved_wall, bool calc_dn>
+double Diff_smag_2::diff_u(double* restrict ut, double* restrict u, double* restrict v, double* restrict w,
+                           double* restrict dzi, double* restrict dzhi, double* restrict evisc,
+                           double* restrict fluxbot, double* restrict fluxtop,
+                           double* restrict rhoref, double* restrict rhorefh)
 {
     const int ii = 1;
     const int jj = grid->icells;
@@ -431,6 +507,12 @@ void Diff_smag_2::diff_u(double* restrict ut, double* restrict u, double* restri
     const double dxi = 1./grid->dx;
     const double dyi = 1./grid->dy;
 
+    const double dxidxi = 1./(grid->dx * grid->dx);
+    const double dyidyi = 1./(grid->dy * grid->dy);
+
+    const double tPrfac = std::min(1., tPr);
+    double dnmul = 0;
+
     double eviscn, eviscs, eviscb, evisct;
 
     const int k_offset = resolved_wall ? 0 : 1;
@@ -459,6 +541,9 @@ void Diff_smag_2::diff_u(double* restrict ut, double* restrict u, double* restri
                          // du/dz + dw/dx
                          + ( rhorefh[kstart+1] * evisct*((u[ijk+kk]-u[ijk   ])* dzhi[kstart+1] + (w[ijk+kk]-w[ijk-ii+kk])*dxi)
                            + rhorefh[kstart  ] * fluxbot[ij] ) / rhoref[kstart] * dzi[kstart];
+
+                if (calc_dn)
+                    dnmul = std::max(dnmul, std::abs(tPrfac*evisc[ijk]*(dxidxi + dyidyi + dzi[kstart]*dzi[kstart])));
             }
 
         // top boundary
@@ -482,6 +567,9 @@ void Diff_smag_2::diff_u(double* restrict ut, double* restrict u, double* restri
                          // du/dz + dw/dx
                          + (- rhorefh[kend  ] * fluxtop[ij]
                             - rhorefh[kend-1] * eviscb*((u[ijk   ]-u[ijk-kk])* dzhi[kend-1] + (w[ijk   ]-w[ijk-ii   ])*dxi) ) / rhoref[kend-1] * dzi[kend-1];
+
+                if (calc_dn)
+                    dnmul = std::max(dnmul, std::abs(tPrfac*evisc[ijk]*(dxidxi + dyidyi + dzi[kend-1]*dzi[kend-1])));
             }
     }
 
@@ -505,7 +593,12 @@ void Diff_smag_2::diff_u(double* restrict ut, double* restrict u, double* restri
                          // du/dz + dw/dx
                          + ( rhorefh[k+1] * evisct*((u[ijk+kk]-u[ijk   ])* dzhi[k+1] + (w[ijk+kk]-w[ijk-ii+kk])*dxi)
                            - rhorefh[k  ] * eviscb*((u[ijk   ]-u[ijk-kk])* dzhi[k  ] + (w[ijk   ]-w[ijk-ii   ])*dxi) ) / rhoref[k] * dzi[k];
+
+                if (calc_dn)
+                    dnmul = std::max(dnmul, std::abs(tPrfac*evisc[ijk]*(dxidxi + dyidyi + dzi[k]*dzi[k])));
             }
+
+    return dnmul;
 }
 
 template <bool resolved_wall>
@@ -45,6 +45,26 @@ Dump::Dump(Model *modelin, Input *inputin)
     {  
         nerror += inputin->get_item(&sampletime, "dump", "sampletime", "");
         nerror += inputin->get_list(&dumplist ,  "dump", "dumplist" ,  "");
+
+        // get the output encoding, which can be set per variable
+        for (std::vector<std::string>::const_iterator it=dumplist.begin(); it!=dumplist.end(); ++it)
+            nerror += Encoding::get_format(&encodings[*it], inputin, master, "dump", *it);
+
+        // get the region and the strides, which can be set per variable
+        for (std::vector<std::string>::const_iterator it=dumplist.begin(); it!=dumplist.end(); ++it)
+        {
+            Field3d_region region;
+            nerror += get_region(&region, inputin, *it);
+
+            // only store the region if it is not the full field, which is saved with the transposed write
+            const int tot[3] = {grid->itot, grid->jtot, grid->ktot};
+            for (int n=0; n<3; ++n)
+                if (region.begin[n] != 0 || region.end[n] != tot[n] || region.stride[n] != 1)
+                {
+                    regions[*it] = region;
+                    break;
+                }
+        }
     }  
 
     if (nerror)
@@ -103,15 +123,54 @@ bool Dump::do_dump()
         return false;
 }
 
+int Dump::get_region(Field3d_region* region, Input* inputin, const std::string& el)
+{
+    const std::string dirs[3] = {"i", "j", "k"};
+    const int tot[3] = {grid->itot, grid->jtot, grid->ktot};
+
+    int nerror = 0;
+    for (int n=0; n<3; ++n)
+    {
+        nerror += inputin->get_item(&region->begin [n], "dump", dirs[n] + "start" , el, 0);
+        nerror += inputin->get_item(&region->end   [n], "dump", dirs[n] + "end"   , el, tot[n]);
+        nerror += inputin->get_item(&region->stride[n], "dump", dirs[n] + "stride", el, 1);
+    }
+
+    if (nerror)
+        return nerror;
+
+    for (int n=0; n<3; ++n)
+    {
+        if (region->begin[n] < 0 || region->end[n] > tot[n] || region->begin[n] >= region->end[n] || region->stride[n] < 1)
+        {
+            master->print_error("illegal region %sstart=%d, %send=%d, %sstride=%d in [dump] for \"%s\"\n",
+                    dirs[n].c_str(), region->begin[n], dirs[n].c_str(), region->end[n], dirs[n].c_str(), region->stride[n], el.c_str());
+            ++nerror;
+        }
+    }
+
+    return nerror;
+}
+
 void Dump::save_dump(double * restrict data, double * restrict tmp, std::string varname,int iotime)
 {
+    Tmp_field tmp2 = fields->get_tmp();
+
     const double NoOffset = 0.;
     char filename[256];
 
     std::sprintf(filename, "%s.%07d", varname.c_str(), iotime);
     master->print_message("Saving \"%s\" ... ", filename);
 
-    if (grid->save_field3d(data, tmp, fields->atmp["tmp2"]->data, filename, NoOffset))
+    std::map<std::string, Encoding::Format>::const_iterator it = encodings.find(varname);
+    const Encoding::Format& format = (it == encodings.end()) ? Encoding::raw : it->second;
+
+    // a region is written directly by the processes that own it, the full field through a transpose
+    std::map<std::string, Field3d_region>::const_iterator itr = regions.find(varname);
+    const int nerror = (itr == regions.end()) ? grid->save_field3d(data, tmp, tmp2->data, filename, NoOffset, format)
+                                              : grid->save_field3d(data, filename, NoOffset, itr->second, format);
+
+    if (nerror)
     {
         master->print_message("FAILED\n");
         throw 1;
@@ -0,0 +1,320 @@
+/*
+ * MicroHH
+ * Copyright (c) 2011-2017 Chiel van Heerwaarden
+ * Copyright (c) 2011-2017 Thijs Heus
+ * Copyright (c) 2014-2017 Bart van Stratum
+ *
+ * This file is part of MicroHH
+ *
+ * MicroHH is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * MicroHH is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with MicroHH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <zlib.h>
+#include <netcdf.h>
+#include "master.h"
+#include "input.h"
+#include "encoding.h"
+#include "defines.h"
+
+namespace
+{
+    using namespace Encoding;
+
+    // Number of blocks of which the lossy tolerance required more mantissa bits than the precision has.
+    std::atomic<int> nclamped(0);
+
+    int element_size(const Precision precision)
+    {
+        if (precision == Float64)
+            return 8;
+        else if (precision == Float32)
+            return 4;
+        else
+            return 2;
+    }
+
+    // Convert a single precision value to half precision, rounding to the nearest even value.
+    uint16_t float_to_half(const float value)
+    {
+        uint32_t x;
+        std::memcpy(&x, &value, sizeof(float));
+
+        const uint32_t sign     = (x >> 16) & 0x8000;
+        const int      exponent = static_cast<int>((x >> 23) & 0xff) - 127 + 15;
+        uint32_t       mantissa = x & 0x7fffff;
+
+        // infinity or nan
+        if (((x >> 23) & 0xff) == 0xff)
+            return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+
+        // overflow to infinity
+        if (exponent >= 31)
+            return sign | 0x7c00;
+
+        // subnormal values or underflow to zero
+        if (exponent <= 0)
+        {
+            if (exponent < -10)
+                return sign;
+
+            mantissa |= 0x800000;
+            const int shift = 14 - exponent;
+            uint32_t half = mantissa >> shift;
+            const uint32_t rest    = mantissa & ((1u << shift) - 1);
+            const uint32_t halfway = 1u << (shift - 1);
+            if (rest > halfway || (rest == halfway && (half & 1)))
+                ++half;
+            return sign | half;
+        }
+
+        // a carry of the rounding into the exponent gives the correct result
+        uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+        const uint32_t rest = mantissa & 0x1fff;
+        if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+            ++half;
+        return half;
+    }
+
+    // Round the values to the number of mantissa bits that keeps the absolute error below the tolerance.
+    // The number of bits follows from the largest value, which has the largest rounding error.
+    void round_bits(double* restrict values, const int n, const double tolerance, const int nbitsmax)
+    {
+        double maxabs = 0.;
+        for (int i=0; i<n; ++i)
+            if (values[i] != NC_FILL_DOUBLE)
+                maxabs = std::max(maxabs, std::abs(values[i]));
+
+        if (maxabs == 0.)
+            return;
+
+        // rounding to nbits mantissa bits gives an error of at most 2^(e-nbits-1) for values below 2^(e+1)
+        const int nbitsneeded = static_cast<int>(std::ceil(std::ilogb(maxabs) - 1 - std::log2(tolerance)));
+        if (nbitsneeded > nbitsmax)
+            ++nclamped;
+
+        const int nbits = std::max(0, std::min(nbitsmax, nbitsneeded));
+        const int ndrop = 52 - nbits;
+
+        if (ndrop <= 0)
+            return;
+
+        const uint64_t half = uint64_t(1) << (ndrop-1);
+        const uint64_t mask = ~((uint64_t(1) << ndrop) - 1);
+
+        for (int i=0; i<n; ++i)
+        {
+            if (values[i] == NC_FILL_DOUBLE || !std::isfinite(values[i]))
+                continue;
+
+            uint64_t x;
+            std::memcpy(&x, &values[i], sizeof(double));
+            x = (x + half) & mask;
+            std::memcpy(&values[i], &x, sizeof(double));
+        }
+    }
+
+    // Store the values at the requested precision.
+    void convert(std::vector<unsigned char>& bytes, Block& block, const double* restrict data, const int n,
+                 const Format& format)
+    {
+        bytes.resize(n*element_size(format.precision));
+
+        block.scale  = 1.;
+        block.offset = 0.;
+
+        if (format.precision == Float64 || format.precision == Float32)
+        {
+            std::vector<double> values(data, data+n);
+            if (format.compression == Lossy)
+                round_bits(values.data(), n, format.tolerance, (format.precision == Float64) ? 52 : 23);
+
+            if (format.precision == Float64)
+                std::memcpy(bytes.data(), values.data(), n*sizeof(double));
+            else
+            {
+                float* restrict out = reinterpret_cast<float*>(bytes.data());
+                for (int i=0; i<n; ++i)
+                    out[i] = static_cast<float>(values[i]);
+            }
+        }
+        else if (format.precision == Float16)
+        {
+            uint16_t* restrict out = reinterpret_cast<uint16_t*>(bytes.data());
+            for (int i=0; i<n; ++i)
+                out[i] = float_to_half(static_cast<float>(data[i]));
+        }
+        else if (format.precision == Int16)
+        {
+            // quantize the range of the block excluding the fill values into [-32767, 32767]
+            double vmin =  NC_FILL_DOUBLE;
+            double vmax = -NC_FILL_DOUBLE;
+            for (int i=0; i<n; ++i)
+                if (data[i] != NC_FILL_DOUBLE)
+                {
+                    vmin = std::min(vmin, data[i]);
+                    vmax = std::max(vmax, data[i]);
+                }
+
+            if (vmax >= vmin)
+            {
+                block.scale  = (vmax - vmin) / 65534.;
+                block.offset = 0.5*(vmax + vmin);
+                if (block.scale == 0.)
+                    block.scale = 1.;
+            }
+
+            const double scalei = 1./block.scale;
+            int16_t* restrict out = reinterpret_cast<int16_t*>(bytes.data());
+            for (int i=0; i<n; ++i)
+            {
+                if (data[i] == NC_FILL_DOUBLE)
+                    out[i] = int16_fill;
+                else
+                    out[i] = static_cast<int16_t>(std::max(-32767., std::min(32767., std::round((data[i] - block.offset)*scalei))));
+            }
+        }
+    }
+
+    // Group the bytes of equal significance of all values, which makes the data better compressible.
+    void shuffle(unsigned char* restrict out, const unsigned char* restrict in, const int n, const int size)
+    {
+        for (int b=0; b<size; ++b)
+            for (int i=0; i<n; ++i)
+                out[b*n + i] = in[i*size + b];
+    }
+
+    int parse_format(Format* format, const std::string& precision, const std::string& compression, double tolerance)
+    {
+        int nerror = 0;
+
+        if (precision == "float64")
+            format->precision = Float64;
+        else if (precision == "float32")
+            format->precision = Float32;
+        else if (precision == "float16")
+            format->precision = Float16;
+        else if (precision == "int16")
+            format->precision = Int16;
+        else
+            ++nerror;
+
+        if (compression == "none")
+            format->compression = None;
+        else if (compression == "deflate")
+            format->compression = Deflate;
+        else if (compression == "lossy")
+            format->compression = Lossy;
+        else
+            ++nerror;
+
+        // the lossy compression rounds the mantissa of floating point values
+        if (format->compression == Lossy)
+        {
+            if (!(format->precision == Float64 || format->precision == Float32) || tolerance <= 0.)
+                ++nerror;
+        }
+
+        format->tolerance = tolerance;
+
+        return nerror;
+    }
+}
+
+bool Encoding::is_raw(const Format& format)
+{
+    return format.precision == Float64 && format.compression == None;
+}
+
+int Encoding::get_format(Format* format, Input* input, Master* master, const std::string& cat, const std::string& el)
+{
+    std::string precision;
+    std::string compression;
+    double tolerance;
+
+    int nerror = 0;
+    nerror += input->get_item(&precision  , cat, "precision"  , el, "float64");
+    nerror += input->get_item(&compression, cat, "compression", el, "none");
+    nerror += input->get_item(&tolerance  , cat, "tolerance"  , el, 0.);
+
+    if (nerror)
+        return nerror;
+
+    if (parse_format(format, precision, compression, tolerance))
+    {
+        master->print_error("illegal output encoding precision=%s, compression=%s, tolerance=%g in [%s] for \"%s\"\n",
+                precision.c_str(), compression.c_str(), tolerance, cat.c_str(), el.c_str());
+        return 1;
+    }
+
+    return 0;
+}
+
+int Encoding::encode_block(Block& block, const double* restrict data, const Format& format)
+{
+    const int n = block.count[0]*block.count[1]*block.count[2];
+
+    std::vector<unsigned char> bytes;
+    convert(bytes, block, data, n, format);
+
+    if (format.compression == None)
+    {
+        block.data.swap(bytes);
+        return 0;
+    }
+
+    std::vector<unsigned char> shuffled(bytes.size());
+    shuffle(shuffled.data(), bytes.data(), n, element_size(format.precision));
+
+    uLongf nbytes = compressBound(shuffled.size());
+    block.data.resize(nbytes);
+    if (compress2(block.data.data(), &nbytes, shuffled.data(), shuffled.size(), Z_DEFAULT_COMPRESSION) != Z_OK)
+    {
+        block.data.clear();
+        return 1;
+    }
+    block.data.resize(nbytes);
+
+    return 0;
+}
+
+int Encoding::get_nclamped()
+{
+    return nclamped.exchange(0);
+}
+
+void Encoding::pack_header(unsigned char* header, const Format& format, int itot, int jtot, int ktot, int nblocks)
+{
+    const int32_t values[6] = {format.precision, format.compression, itot, jtot, ktot, nblocks};
+
+    std::memcpy(header, "MHHENC01", 8);
+    std::memcpy(header+8, values, sizeof(values));
+    std::memcpy(header+32, &format.tolerance, sizeof(double));
+}
+
+void Encoding::pack_record(unsigned char* record, const Block& block)
+{
+    const int32_t values[6] = {block.start[0], block.start[1], block.start[2],
+                               block.count[0], block.count[1], block.count[2]};
+    const int64_t nbytes = block.data.size();
+
+    std::memcpy(record, values, sizeof(values));
+    std::memcpy(record+24, &nbytes, sizeof(int64_t));
+    std::memcpy(record+32, &block.scale, sizeof(double));
+    std::memcpy(record+40, &block.offset, sizeof(double));
+}
@@ -25,6 +25,7 @@
 #include <cmath>
 #include <algorithm>
 #include <sstream>
+#include <limits>
 #include "master.h"
 #include "grid.h"
 #include "fields.h"
@@ -81,9 +82,14 @@ Fields::Fields(Model *modelin, Input *inputin)
     init_momentum_field(w, wt, "w", "Vertical velocity", "m s-1");
     init_diagnostic_field("p", "Pressure", "Pa");
 
-    // Set a default of 4 temporary fields. Other classes can increase this number
-    // before the init phase, where they are initialized in Fields::init()
-    n_tmp_fields = 4;
+    // Allocate tmp1 and tmp2 at init, because the GPU code accesses them by name. Other classes can
+    // increase this number before the init phase. The other tmp fields are created by the pool on demand.
+    n_tmp_fields = 2;
+    n_tmp_in_use = 0;
+    n_tmp_peak   = 0;
+
+    load_read_time = 0.;
+    load_wait_time = 0.;
 
     // Remove the data from the input that is not used in run mode, to avoid warnings.
     if (master->mode == "run")
@@ -122,9 +128,11 @@ Fields::~Fields()
     for (FieldMap::iterator it=sd.begin(); it!=sd.end(); ++it)
         delete it->second;
 
-    // deallocate the tmp fields
+    // deallocate the tmp fields, including the ones the pool has created after init
     for (FieldMap::iterator it=atmp.begin(); it!=atmp.end(); ++it)
         delete it->second;
+    for (size_t n=atmp.size(); n<tmp_pool.size(); ++n)
+        delete tmp_pool[n];
 
     // delete the arrays
     delete[] rhoref;
@@ -271,55 +279,38 @@ void Fields::exec()
 }
 #endif
 
-void Fields::get_mask(Field3d *mfield, Field3d *mfieldh, Mask *m)
+void Fields::get_mask(Mask *m)
 {
     if (m->name == "wplus")
-        calc_mask_wplus(mfield->data, mfieldh->data, mfieldh->databot, 
-                        stats->nmask, stats->nmaskh, &stats->nmaskbot, w->data);
+        calc_mask_wplus(stats->mask, stats->maskh, stats->maskbot, w->data);
     else if (m->name == "wmin")                                                  
-        calc_mask_wmin(mfield->data, mfieldh->data, mfieldh->databot,
-                       stats->nmask, stats->nmaskh, &stats->nmaskbot, w->data);
+        calc_mask_wmin(stats->mask, stats->maskh, stats->maskbot, w->data);
 }
 
-void Fields::calc_mask_wplus(double* restrict mask, double* restrict maskh, double* restrict maskbot,
-        int* restrict nmask, int* restrict nmaskh, int* restrict nmaskbot,
-        double* restrict w)
+void Fields::calc_mask_wplus(unsigned char* restrict mask, unsigned char* restrict maskh, unsigned char* restrict maskbot,
+                             double* restrict w)
 {
-    int ijk,ij,jj,kk,kstart;
-
-    jj = grid->icells;
-    kk = grid->ijcells;
-    kstart = grid->kstart;
-
-    int ntmp;
+    const int jj = grid->icells;
+    const int kk = grid->ijcells;
+    const int kstart = grid->kstart;
 
     for (int k=grid->kstart; k<grid->kend; k++)
-    {
-        nmask[k] = 0;
         for (int j=grid->jstart; j<grid->jend; j++)
 #pragma ivdep
             for (int i=grid->istart; i<grid->iend; i++)
             {
-                ijk = i + j*jj + k*kk;
-                ntmp = (w[ijk] + w[ijk+kk]) > 0.;
-                nmask[k] += ntmp;
-                mask[ijk] = (double)ntmp;
+                const int ijk = i + j*jj + k*kk;
+                mask[ijk] = (w[ijk] + w[ijk+kk]) > 0.;
             }
-    }
 
     for (int k=grid->kstart; k<grid->kend+1; k++)
-    {
-        nmaskh[k] = 0;
         for (int j=grid->jstart; j<grid->jend; j++)
 #pragma ivdep
             for (int i=grid->istart; i<grid->iend; i++)
             {
-                ijk = i + j*jj + k*kk;
-                ntmp = w[ijk] > 0.;
-                nmaskh[k] += ntmp;
-                maskh[ijk] = (double)ntmp;
+                const int ijk = i + j*jj + k*kk;
+                maskh[ijk] = w[ijk] > 0.;
             }
-    }
 
     // Set the mask for surface projected quantities
     // In this case: velocity at surface, so zero
@@ -327,55 +318,36 @@ void Fields::calc_mask_wplus(double* restrict mask, double* restrict maskh, doub
 #pragma ivdep
         for (int i=grid->istart; i<grid->iend; i++)
         {
-            ij  = i + j*jj;
-            ijk = i + j*jj + kstart*kk;
+            const int ij  = i + j*jj;
+            const int ijk = i + j*jj + kstart*kk;
             maskbot[ij] = maskh[ijk];
         }
-
-    grid->boundary_cyclic(mask);
-    grid->boundary_cyclic(maskh);
-    grid->boundary_cyclic_2d(maskbot);
-
-    master->sum(nmask , grid->kcells);
-    master->sum(nmaskh, grid->kcells);
-    *nmaskbot = nmaskh[grid->kstart];
 }
 
-void Fields::calc_mask_wmin(double* restrict mask, double* restrict maskh, double* restrict maskbot,
-        int* restrict nmask, int* restrict nmaskh, int* restrict nmaskbot,
-        double* restrict w)
+void Fields::calc_mask_wmin(unsigned char* restrict mask, unsigned char* restrict maskh, unsigned char* restrict maskbot,
+                            double* restrict w)
 {
     const int jj = grid->icells;
     const int kk = grid->ijcells;
     const int kstart = grid->kstart;
 
     for (int k=grid->kstart; k<grid->kend; k++)
-    {
-        nmask[k] = 0;
         for (int j=grid->jstart; j<grid->jend; j++)
 #pragma ivdep
             for (int i=grid->istart; i<grid->iend; i++)
             {
                 const int ijk = i + j*jj + k*kk;
-                const int ntmp = (w[ijk] + w[ijk+kk]) <= 0.;
-                nmask[k] += ntmp;
-                mask[ijk] = (double)ntmp;
+                mask[ijk] = (w[ijk] + w[ijk+kk]) <= 0.;
             }
-    }
 
     for (int k=grid->kstart; k<grid->kend+1; k++)
-    {
-        nmaskh[k] = 0;
         for (int j=grid->jstart; j<grid->jend; j++)
 #pragma ivdep
             for (int i=grid->istart; i<grid->iend; i++)
             {
                 const int ijk = i + j*jj + k*kk;
-                const int ntmp = w[ijk] <= 0.;
-                nmaskh[k] += ntmp;
-                maskh[ijk] = (double)ntmp;
+                maskh[ijk] = w[ijk] <= 0.;
             }
-    }
 
     // Set the mask for surface projected quantities
     // In this case: velocity at surface, so zero
@@ -387,14 +359,6 @@ void Fields::calc_mask_wmin(double* restrict mask, double* restrict maskh, doubl
             const int ijk = i + j*jj + kstart*kk;
             maskbot[ij] = maskh[ijk];
         }
-
-    grid->boundary_cyclic(mask);
-    grid->boundary_cyclic(maskh);
-    grid->boundary_cyclic_2d(maskbot);
-
-    master->sum(nmask , grid->kcells);
-    master->sum(nmaskh, grid->kcells);
-    *nmaskbot = nmaskh[grid->kstart];
 }
 
 void Fields::exec_stats(Mask *m)
@@ -405,170 +369,43 @@ void Fields::exec_stats(Mask *m)
     const int wloc[] = {0,0,1};
     const int sloc[] = {0,0,0};
 
-    const int uwloc[] = {1,0,1};
-    const int vwloc[] = {0,1,1};
-
     const double NoOffset = 0.;
 
     // save the area coverage of the mask
-    stats->calc_area(m->profs["area" ].data, sloc, stats->nmask );
-    stats->calc_area(m->profs["areah"].data, wloc, stats->nmaskh);
+    stats->calc_area(m->profs["area" ].data, sloc);
+    stats->calc_area(m->profs["areah"].data, wloc);
 
     // start with the stats on the w location, to make the wmean known for the flux calculations
-    stats->calc_mean(m->profs["w"].data, w->data, NoOffset, wloc, atmp["tmp4"]->data, stats->nmaskh);
-    for (int n=2; n<5; ++n)
-    {
-        std::stringstream ss;
-        ss << n;
-        std::string sn = ss.str();
-        stats->calc_moment(w->data, m->profs["w"].data, m->profs["w"+sn].data, n, wloc,
-                          atmp["tmp4"]->data, stats->nmaskh);
-    }
+    stats->calc_stats(m, "w", w->data, NoOffset, wloc, 0, 0, 0, 0, 0, 0.);
 
-    // calculate the stats on the u location
-    // interpolate the mask horizontally onto the u coordinate
-    grid->interpolate_2nd(atmp["tmp1"]->data, atmp["tmp3"]->data, sloc, uloc);
-    stats->calc_mean(m->profs["u"].data, u->data, grid->utrans, uloc, atmp["tmp1"]->data, stats->nmask);
-    stats->calc_mean(umodel            , u->data, NoOffset   , uloc, atmp["tmp1"]->data, stats->nmask);
-    for (int n=2; n<5; ++n)
-    {
-        std::stringstream ss;
-        ss << n;
-        std::string sn = ss.str();
-        stats->calc_moment(u->data, umodel, m->profs["u"+sn].data, n, uloc,
-                          atmp["tmp1"]->data, stats->nmask);
-    }
+    // the diffusive fluxes are computed from the eddy viscosity in case of the Smagorinsky model
+    const bool smag = (model->diff->get_switch() == "smag2") && (grid->swspatialorder == "2");
+    double* evisc = smag ? sd["evisc"]->data : 0;
 
-    // interpolate the mask on half level horizontally onto the u coordinate
-    grid->interpolate_2nd(atmp["tmp1"]->data, atmp["tmp4"]->data, wloc, uwloc);
-    if (grid->swspatialorder == "2")
-    {
-        stats->calc_grad_2nd(u->data, m->profs["ugrad"].data, grid->dzhi, uloc,
-                            atmp["tmp1"]->data, stats->nmaskh);
-        stats->calc_flux_2nd(u->data, umodel, w->data, m->profs["w"].data,
-                            m->profs["uw"].data, atmp["tmp2"]->data, uloc,
-                            atmp["tmp1"]->data, stats->nmaskh);
-        if (model->diff->get_switch() == "smag2")
-            stats->calc_diff_2nd(u->data, w->data, sd["evisc"]->data,
-                                m->profs["udiff"].data, grid->dzhi,
-                                u->datafluxbot, u->datafluxtop, 1., uloc,
-                                atmp["tmp1"]->data, stats->nmaskh);
-        else
-            stats->calc_diff_2nd(u->data, m->profs["udiff"].data, grid->dzhi, visc, uloc,
-                                atmp["tmp1"]->data, stats->nmaskh);
-
-    }
-    else if (grid->swspatialorder == "4")
-    {
-        stats->calc_grad_4th(u->data, m->profs["ugrad"].data, grid->dzhi4, uloc,
-                            atmp["tmp1"]->data, stats->nmaskh);
-        stats->calc_flux_4th(u->data, w->data, m->profs["uw"].data, atmp["tmp2"]->data, uloc,
-                            atmp["tmp1"]->data, stats->nmaskh);
-        stats->calc_diff_4th(u->data, m->profs["udiff"].data, grid->dzhi4, visc, uloc,
-                            atmp["tmp1"]->data, stats->nmaskh);
-    }
+    // calculate the stats on the u location
+    stats->calc_stats(m, "u", u->data, grid->utrans, uloc, umodel, w->data,
+                      evisc, u->datafluxbot, u->datafluxtop, smag ? 1. : visc);
 
     // calculate the stats on the v location
-    grid->interpolate_2nd(atmp["tmp1"]->data, atmp["tmp3"]->data, sloc, vloc);
-    stats->calc_mean(m->profs["v"].data, v->data, grid->vtrans, vloc, atmp["tmp1"]->data, stats->nmask);
-    stats->calc_mean(vmodel            , v->data, NoOffset   , vloc, atmp["tmp1"]->data, stats->nmask);
-    for (int n=2; n<5; ++n)
-    {
-        std::stringstream ss;
-        ss << n;
-        std::string sn = ss.str();
-        stats->calc_moment(v->data, vmodel, m->profs["v"+sn].data, n, vloc,
-                          atmp["tmp1"]->data, stats->nmask);
-    }
-
-    // interpolate the mask on half level horizontally onto the u coordinate
-    grid->interpolate_2nd(atmp["tmp1"]->data, atmp["tmp4"]->data, wloc, vwloc);
-    if (grid->swspatialorder == "2")
-    {
-        stats->calc_grad_2nd(v->data, m->profs["vgrad"].data, grid->dzhi, vloc,
-                            atmp["tmp1"]->data, stats->nmaskh);
-        stats->calc_flux_2nd(v->data, vmodel, w->data, m->profs["w"].data,
-                            m->profs["vw"].data, atmp["tmp2"]->data, vloc,
-                            atmp["tmp1"]->data, stats->nmaskh);
-        if (model->diff->get_switch() == "smag2")
-            stats->calc_diff_2nd(v->data, w->data, sd["evisc"]->data,
-                                m->profs["vdiff"].data, grid->dzhi,
-                                v->datafluxbot, v->datafluxtop, 1., vloc,
-                                atmp["tmp1"]->data, stats->nmaskh);
-        else
-            stats->calc_diff_2nd(v->data, m->profs["vdiff"].data, grid->dzhi, visc, vloc,
-                                atmp["tmp1"]->data, stats->nmaskh);
-
-    }
-    else if (grid->swspatialorder == "4")
-    {
-        stats->calc_grad_4th(v->data, m->profs["vgrad"].data, grid->dzhi4, vloc,
-                            atmp["tmp1"]->data, stats->nmaskh);
-        stats->calc_flux_4th(v->data, w->data, m->profs["vw"].data, atmp["tmp2"]->data, vloc,
-                            atmp["tmp1"]->data, stats->nmaskh);
-        stats->calc_diff_4th(v->data, m->profs["vdiff"].data, grid->dzhi4, visc, vloc,
-                            atmp["tmp1"]->data, stats->nmaskh);
-    }
+    stats->calc_stats(m, "v", v->data, grid->vtrans, vloc, vmodel, w->data,
+                      evisc, v->datafluxbot, v->datafluxtop, smag ? 1. : visc);
 
     // calculate stats for the prognostic scalars
     Diff_smag_2 *diffptr = static_cast<Diff_smag_2 *>(model->diff);
     for (FieldMap::const_iterator it=sp.begin(); it!=sp.end(); ++it)
-    {
-        stats->calc_mean(m->profs[it->first].data, it->second->data, NoOffset, sloc, atmp["tmp3"]->data, stats->nmask);
-        for (int n=2; n<5; ++n)
-        {
-            std::stringstream ss;
-            ss << n;
-            std::string sn = ss.str();
-            stats->calc_moment(it->second->data, m->profs[it->first].data, m->profs[it->first+sn].data, n, sloc,
-                    atmp["tmp3"]->data, stats->nmask);
-        }
-        if (grid->swspatialorder == "2")
-        {
-            stats->calc_grad_2nd(it->second->data, m->profs[it->first+"grad"].data, grid->dzhi, sloc,
-                                atmp["tmp4"]->data, stats->nmaskh);
-            stats->calc_flux_2nd(it->second->data, m->profs[it->first].data, w->data, m->profs["w"].data,
-                                m->profs[it->first+"w"].data, atmp["tmp1"]->data, sloc,
-                                atmp["tmp4"]->data, stats->nmaskh);
-            if (model->diff->get_switch() == "smag2")
-                stats->calc_diff_2nd(it->second->data, w->data, sd["evisc"]->data,
-                                    m->profs[it->first+"diff"].data, grid->dzhi,
-                                    it->second->datafluxbot, it->second->datafluxtop, diffptr->tPr, sloc,
-                                    atmp["tmp4"]->data, stats->nmaskh);
-            else
-                stats->calc_diff_2nd(it->second->data, m->profs[it->first+"diff"].data, grid->dzhi, it->second->visc, sloc,
-                                    atmp["tmp4"]->data, stats->nmaskh);
-        }
-        else if (grid->swspatialorder == "4")
-        {
-            stats->calc_grad_4th(it->second->data, m->profs[it->first+"grad"].data, grid->dzhi4, sloc,
-                                atmp["tmp4"]->data, stats->nmaskh);
-            stats->calc_flux_4th(it->second->data, w->data, m->profs[it->first+"w"].data, atmp["tmp1"]->data, sloc,
-                                atmp["tmp4"]->data, stats->nmaskh);
-            stats->calc_diff_4th(it->second->data, m->profs[it->first+"diff"].data, grid->dzhi4, it->second->visc, sloc,
-                                atmp["tmp4"]->data, stats->nmaskh);
-        }
-    }
+        stats->calc_stats(m, it->first, it->second->data, NoOffset, sloc, 0, w->data,
+                          evisc, it->second->datafluxbot, it->second->datafluxtop,
+                          smag ? diffptr->tPr : it->second->visc);
 
     // Calculate pressure statistics
-    stats->calc_mean(m->profs["p"].data, sd["p"]->data, NoOffset, sloc, atmp["tmp3"]->data, stats->nmask);
-    stats->calc_moment(sd["p"]->data, m->profs["p"].data, m->profs["p2"].data, 2, sloc,
-                      atmp["tmp1"]->data, stats->nmask);
-    if (grid->swspatialorder == "2")
-    {
-        stats->calc_grad_2nd(sd["p"]->data, m->profs["pgrad"].data, grid->dzhi, sloc,
-                             atmp["tmp4"]->data, stats->nmaskh);
-        stats->calc_flux_2nd(sd["p"]->data, m->profs["p"].data, w->data, m->profs["w"].data,
-                            m->profs["pw"].data, atmp["tmp1"]->data, sloc,
-                            atmp["tmp4"]->data, stats->nmaskh);
-    }
-    else if (grid->swspatialorder == "4")
-    {
-        stats->calc_grad_4th(sd["p"]->data, m->profs["pgrad"].data, grid->dzhi4, sloc,
-                             atmp["tmp4"]->data, stats->nmaskh);
-        stats->calc_flux_4th(sd["p"]->data, w->data, m->profs["pw"].data, atmp["tmp1"]->data, sloc,
-                             atmp["tmp4"]->data, stats->nmaskh);
-    }
+    stats->calc_stats(m, "p", sd["p"]->data, NoOffset, sloc, 0, w->data, 0, 0, 0, 0.);
+
+    // calculate the spectra, which are only registered for the full field
+    stats->calc_spectra(m, "u", u->data, grid->utrans, uloc);
+    stats->calc_spectra(m, "v", v->data, grid->vtrans, vloc);
+    stats->calc_spectra(m, "w", w->data, NoOffset, wloc);
+    for (FieldMap::const_iterator it=sp.begin(); it!=sp.end(); ++it)
+        stats->calc_spectra(m, it->first, it->second->data, NoOffset, sloc);
 
     // calculate the total fluxes
     stats->add_fluxes(m->profs["uflux"].data, m->profs["uw"].data, m->profs["udiff"].data);
@@ -577,7 +414,7 @@ void Fields::exec_stats(Mask *m)
         stats->add_fluxes(m->profs[it->first+"flux"].data, m->profs[it->first+"w"].data, m->profs[it->first+"diff"].data);
 
     if (model->diff->get_switch() == "smag2")
-        stats->calc_mean(m->profs["evisc"].data, sd["evisc"]->data, NoOffset, sloc, atmp["tmp3"]->data, stats->nmask);
+        stats->calc_mean(m->profs["evisc"].data, sd["evisc"]->data, NoOffset, sloc);
 }
 
 void Fields::set_calc_mean_profs(bool sw)
@@ -616,6 +453,10 @@ void Fields::init_momentum_field(Field3d*& fld, Field3d*& fldt, std::string fldn
     a [fldname] = mp[fldname];
     ap[fldname] = mp[fldname];
     at[fldname] = mt[fldname];
+
+    handles [fldname] = add_to_registry(mp[fldname]);
+    thandles[fldname] = add_to_registry(mt[fldname]);
+    prognostic_pairs.push_back({mp[fldname], mt[fldname]});
 }
 
 void Fields::init_prognostic_field(std::string fldname, std::string longname, std::string unit)
@@ -640,6 +481,11 @@ void Fields::init_prognostic_field(std::string fldname, std::string longname, st
     a [fldname] = sp[fldname];
     ap[fldname] = sp[fldname];
     at[fldname] = st[fldname];
+
+    handles [fldname] = add_to_registry(sp[fldname]);
+    thandles[fldname] = add_to_registry(st[fldname]);
+    prognostic_pairs.push_back({sp[fldname], st[fldname]});
+    scalar_pairs    .push_back({sp[fldname], st[fldname]});
 }
 
 void Fields::init_diagnostic_field(std::string fldname,std::string longname, std::string unit)
@@ -652,6 +498,8 @@ void Fields::init_diagnostic_field(std::string fldname,std::string longname, std
 
     sd[fldname] = new Field3d(grid, master, fldname, longname, unit);
     a [fldname] = sd[fldname];
+
+    handles[fldname] = add_to_registry(sd[fldname]);
 }
 
 void Fields::init_tmp_field(std::string fldname,std::string longname, std::string unit)
@@ -663,6 +511,160 @@ void Fields::init_tmp_field(std::string fldname,std::string longname, std::strin
     }
 
     atmp[fldname] = new Field3d(grid, master, fldname, longname, unit);
+
+    handles[fldname] = add_to_registry(atmp[fldname]);
+
+    tmp_pool.push_back(atmp[fldname]);
+    tmp_in_use.push_back(false);
+}
+
+namespace
+{
+#ifdef TMPCHECKS
+    // Fill a tmp field with NaNs, such that code that uses data it did not write itself is detected.
+    void poison_tmp_field(Field3d* fld, Grid* grid)
+    {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+
+        std::fill(fld->data, fld->data + grid->ncells, nan);
+        std::fill(fld->datamean, fld->datamean + grid->kcells, nan);
+
+        double* data2d[] = {fld->databot, fld->datatop, fld->datagradbot, fld->datagradtop, fld->datafluxbot, fld->datafluxtop};
+        for (double* data : data2d)
+            std::fill(data, data + grid->ijcells, nan);
+    }
+#endif
+}
+
+/**
+ * This function checks out a tmp field from the pool. A new tmp field is created if all existing ones are in use,
+ * such that the number of tmp fields matches the maximum number that is used at once.
+ * @return The checked out field, which returns to the pool when it goes out of scope.
+ */
+Tmp_field Fields::get_tmp()
+{
+    std::lock_guard<std::mutex> lock(tmp_mutex);
+
+    size_t n = std::find(tmp_in_use.begin(), tmp_in_use.end(), false) - tmp_in_use.begin();
+
+    if (n == tmp_pool.size())
+    {
+        // BvS: the cast to long long is unfortunately necessary for Intel compilers
+        // which don't seem to have the full c++11 implementation
+        std::string name = "tmp" + std::to_string(static_cast<long long>(n+1));
+        Field3d* fld = new Field3d(grid, master, name, "", "");
+        if (fld->init())
+        {
+            delete fld;
+            throw 1;
+        }
+        tmp_pool.push_back(fld);
+        tmp_in_use.push_back(false);
+    }
+
+    tmp_in_use[n] = true;
+    ++n_tmp_in_use;
+    n_tmp_peak = std::max(n_tmp_peak, n_tmp_in_use);
+
+#ifdef TMPCHECKS
+    poison_tmp_field(tmp_pool[n], grid);
+#endif
+
+    return Tmp_field(this, tmp_pool[n]);
+}
+
+void Fields::release_tmp(Field3d* fld)
+{
+    std::lock_guard<std::mutex> lock(tmp_mutex);
+
+    const size_t n = std::find(tmp_pool.begin(), tmp_pool.end(), fld) - tmp_pool.begin();
+
+#ifdef TMPCHECKS
+    if (n == tmp_pool.size() || !tmp_in_use[n])
+    {
+        master->print_error("\"%s\" is returned to the tmp pool, but it is not checked out\n", fld->name.c_str());
+        std::abort();
+    }
+
+    // poison the data, such that aliases that are still used after the release are detected
+    poison_tmp_field(fld, grid);
+#endif
+
+    tmp_in_use[n] = false;
+    --n_tmp_in_use;
+}
+
+/**
+ * This function checks at the end of a stage that no tmp fields are checked out anymore.
+ * Only active with TMPCHECKS, which is set in debug builds.
+ */
+void Fields::check_tmp_fields()
+{
+#ifdef TMPCHECKS
+    std::lock_guard<std::mutex> lock(tmp_mutex);
+
+    if (n_tmp_in_use != 0)
+    {
+        for (size_t n=0; n<tmp_pool.size(); ++n)
+            if (tmp_in_use[n])
+                master->print_error("\"%s\" is still checked out at the end of the time step\n", tmp_pool[n]->name.c_str());
+        throw 1;
+    }
+#endif
+}
+
+Tmp_field::Tmp_field(Fields* fieldsin, Field3d* fldin) : fields(fieldsin), fld(fldin)
+{
+}
+
+Tmp_field::Tmp_field(Tmp_field&& other) : fields(other.fields), fld(other.fld)
+{
+    other.fld = 0;
+}
+
+Tmp_field::~Tmp_field()
+{
+    release();
+}
+
+void Tmp_field::release()
+{
+    if (fld)
+        fields->release_tmp(fld);
+    fld = 0;
+}
+
+int Fields::add_to_registry(Field3d* fld)
+{
+    registry.push_back(fld);
+    return registry.size()-1;
+}
+
+int Fields::get_handle(const std::string& fldname)
+{
+    std::map<std::string, int>::const_iterator it = handles.find(fldname);
+    if (it == handles.end())
+    {
+        master->print_error("field \"%s\" does not exist\n", fldname.c_str());
+        throw 1;
+    }
+    return it->second;
+}
+
+int Fields::get_tendency_handle(const std::string& fldname)
+{
+    std::map<std::string, int>::const_iterator it = thandles.find(fldname);
+    if (it == thandles.end())
+    {
+        master->print_error("prognostic field \"%s\" does not exist\n", fldname.c_str());
+        throw 1;
+    }
+    return it->second;
+}
+
+Field_pair Fields::get_pair(const std::string& fldname)
+{
+    return {registry[get_handle(fldname)], registry[get_tendency_handle(fldname)]};
 }
 
 void Fields::create(Input *inputin)
@@ -817,17 +819,36 @@ int Fields::add_mean_prof(Input* inputin, std::string fld, double* restrict data
 
 void Fields::load(int n)
 {
+    Tmp_field tmp1 = get_tmp();
+    Tmp_field tmp2 = get_tmp();
+
     const double NoOffset = 0.;
 
     int nerror = 0;
 
-    for (FieldMap::const_iterator it=ap.begin(); it!=ap.end(); ++it)
+    // use the buffers that are read ahead, if this output time has been prefetched
+    const bool use_prefetch = !prefetched.empty() && prefetched.front().first == n;
+    const double start = master->get_wall_clock_time();
+
+    int nf = 0;
+    for (FieldMap::const_iterator it=ap.begin(); it!=ap.end(); ++it, ++nf)
     {
         // the offset is kept at zero, otherwise bitwise identical restarts is not possible
         char filename[256];
         std::sprintf(filename, "%s.%07d", it->second->name.c_str(), n);
         master->print_message("Loading \"%s\" ... ", filename);
-        if (grid->load_field3d(it->second->data, atmp["tmp1"]->data, atmp["tmp2"]->data, filename, NoOffset))
+
+        int error;
+        if (use_prefetch)
+        {
+            Prefetch_buffer& buffer = *prefetched.front().second[nf];
+            error = grid->load_field3d(it->second->data, tmp1->data, buffer, NoOffset);
+            load_read_time += buffer.readtime;
+        }
+        else
+            error = grid->load_field3d(it->second->data, tmp1->data, tmp2->data, filename, NoOffset);
+
+        if (error)
         {
             master->print_message("FAILED\n");
             ++nerror;
@@ -838,10 +859,53 @@ void Fields::load(int n)
         }  
     }
 
+    const double elapsed = master->get_wall_clock_time() - start;
+    load_wait_time += elapsed;
+
+    if (use_prefetch)
+    {
+        prefetch_pool.push_back(prefetched.front().second);
+        prefetched.pop_front();
+    }
+    else
+        load_read_time += elapsed;
+
     if (nerror)
         throw 1;
 }
 
+void Fields::prefetch(int n)
+{
+    // reuse the buffers of an output time that has been loaded already
+    Prefetch_set buffers;
+    if (!prefetch_pool.empty())
+    {
+        buffers = prefetch_pool.back();
+        prefetch_pool.pop_back();
+    }
+    else
+    {
+        for (FieldMap::const_iterator it=ap.begin(); it!=ap.end(); ++it)
+            buffers.push_back(std::make_shared<Prefetch_buffer>());
+    }
+
+    int nf = 0;
+    for (FieldMap::const_iterator it=ap.begin(); it!=ap.end(); ++it, ++nf)
+    {
+        char filename[256];
+        std::sprintf(filename, "%s.%07d", it->second->name.c_str(), n);
+        grid->prefetch_field3d(buffers[nf], filename);
+    }
+
+    prefetched.push_back(std::make_pair(n, buffers));
+}
+
+void Fields::get_load_times(double* read_time, double* wait_time)
+{
+    *read_time = load_read_time;
+    *wait_time = load_wait_time;
+}
+
 void Fields::create_stats()
 {
     int nerror = 0;
@@ -903,6 +967,13 @@ void Fields::create_stats()
         stats->add_prof("vflux", "Total flux of the " + v->longname, "m2 s-2", "zh");
         for (FieldMap::const_iterator it=sp.begin(); it!=sp.end(); ++it)
             stats->add_prof(it->first+"flux", "Total flux of the " + it->second->longname, it->second->unit + " m s-1", "zh");
+
+        // spectra at the selected heights
+        stats->add_spectra(u->name, u->longname, u->unit, "z" );
+        stats->add_spectra(v->name, v->longname, v->unit, "z" );
+        stats->add_spectra(w->name, w->longname, w->unit, "zh");
+        for (FieldMap::const_iterator it=sp.begin(); it!=sp.end(); ++it)
+            stats->add_spectra(it->first, it->second->longname, it->second->unit, "z");
     }
 
     if (nerror)
@@ -934,6 +1005,9 @@ void Fields::create_column()
 
 void Fields::save(int n)
 {
+    Tmp_field tmp1 = get_tmp();
+    Tmp_field tmp2 = get_tmp();
+
     const double NoOffset = 0.;
 
     int nerror = 0;
@@ -944,7 +1018,7 @@ void Fields::save(int n)
         master->print_message("Saving \"%s\" ... ", filename);
 
         // the offset is kept at zero, because otherwise bitwise identical restarts is not possible
-        if (grid->save_field3d(it->second->data, atmp["tmp1"]->data, atmp["tmp2"]->data, filename, NoOffset))
+        if (grid->save_field3d(it->second->data, tmp1->data, tmp2->data, filename, NoOffset))
         {
             master->print_message("FAILED\n");
             ++nerror;
@@ -1065,27 +1139,30 @@ double Fields::calc_tke_2nd(double* restrict u, double* restrict v, double* rest
 
 void Fields::exec_cross(int iotime)
 {
+    Tmp_field tmp1 = get_tmp();
+    Tmp_field tmp2 = get_tmp();
+
     int nerror = 0;
 
     Cross* cross = model->cross;
 
     for (std::vector<std::string>::const_iterator it=crosssimple.begin(); it<crosssimple.end(); ++it)
-        nerror += cross->cross_simple(a[*it]->data, atmp["tmp1"]->data, a[*it]->name, iotime);
+        nerror += cross->cross_simple(a[*it]->data, tmp1->data, a[*it]->name, iotime);
 
     for (std::vector<std::string>::const_iterator it=crosslngrad.begin(); it<crosslngrad.end(); ++it)
-        nerror += cross->cross_lngrad(a[*it]->data, atmp["tmp1"]->data, atmp["tmp2"]->data, grid->dzi4, a[*it]->name + "lngrad", iotime);
+        nerror += cross->cross_lngrad(a[*it]->data, tmp1->data, tmp2->data, grid->dzi4, a[*it]->name + "lngrad", iotime);
 
     for (std::vector<std::string>::const_iterator it=crossfluxbot.begin(); it<crossfluxbot.end(); ++it)
-        nerror += cross->cross_plane(a[*it]->datafluxbot, atmp["tmp1"]->data, a[*it]->name + "fluxbot", iotime);
+        nerror += cross->cross_plane(a[*it]->datafluxbot, tmp1->data, a[*it]->name + "fluxbot", iotime);
 
     for (std::vector<std::string>::const_iterator it=crossfluxtop.begin(); it<crossfluxtop.end(); ++it)
-        nerror += cross->cross_plane(a[*it]->datafluxtop, atmp["tmp1"]->data, a[*it]->name + "fluxtop", iotime);
+        nerror += cross->cross_plane(a[*it]->datafluxtop, tmp1->data, a[*it]->name + "fluxtop", iotime);
 
     for (std::vector<std::string>::const_iterator it=crossbot.begin(); it<crossbot.end(); ++it)
-        nerror += cross->cross_plane(a[*it]->databot, atmp["tmp1"]->data, a[*it]->name + "bot", iotime);
+        nerror += cross->cross_plane(a[*it]->databot, tmp1->data, a[*it]->name + "bot", iotime);
 
     for (std::vector<std::string>::const_iterator it=crosstop.begin(); it<crosstop.end(); ++it)
-        nerror += cross->cross_plane(a[*it]->datatop, atmp["tmp1"]->data, a[*it]->name + "top", iotime);
+        nerror += cross->cross_plane(a[*it]->datatop, tmp1->data, a[*it]->name + "top", iotime);
 
     if (nerror)
         throw 1;
@@ -1093,8 +1170,10 @@ void Fields::exec_cross(int iotime)
 
 void Fields::exec_dump(int iotime)
 {
+    Tmp_field tmp1 = get_tmp();
+
     for (std::vector<std::string>::const_iterator it=dumplist.begin(); it<dumplist.end(); ++it)
-        model->dump->save_dump(sd[*it]->data, atmp["tmp1"]->data, *it, iotime);
+        model->dump->save_dump(sd[*it]->data, tmp1->data, *it, iotime);
 }
 
 
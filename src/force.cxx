@@ -210,6 +210,14 @@ void Force::create(Input *inputin)
         for (std::vector<std::string>::const_iterator it=lslist.begin(); it!=lslist.end(); ++it)
             nerror += inputin->get_prof(&lsprofs[*it][grid->kstart], *it+"ls", grid->kmax);
 
+        // store the fields and profiles, such that the forcings can be applied without lookups
+        if (!nerror)
+            for (std::vector<std::string>::const_iterator it=lslist.begin(); it!=lslist.end(); ++it)
+            {
+                const Field_pair p = fields->get_pair(*it);
+                lsterms.push_back({p.fld, p.fldt, lsprofs[*it]});
+            }
+
         // Process the time dependent data
         if (swtimedep_ls == "1")
             nerror += create_timedep(timedepdata_ls, timedeptime_ls, timedeplist_ls, lslist, "ls");
@@ -232,6 +240,13 @@ void Force::create(Input *inputin)
         for (std::vector<std::string>::const_iterator it=nudgelist.begin(); it!=nudgelist.end(); ++it)
             nerror += inputin->get_prof(&nudgeprofs[*it][grid->kstart], *it+"nudge", grid->kmax);
 
+        if (!nerror)
+            for (std::vector<std::string>::const_iterator it=nudgelist.begin(); it!=nudgelist.end(); ++it)
+            {
+                const Field_pair p = fields->get_pair(*it);
+                nudgeterms.push_back({p.fld, p.fldt, nudgeprofs[*it]});
+            }
+
         // Process the time dependent data
         if (swtimedep_nudge == "1")
         {
@@ -303,20 +318,20 @@ void Force::exec(double dt)
 
     if (swls == "1")
     {
-        for (std::vector<std::string>::const_iterator it=lslist.begin(); it!=lslist.end(); ++it)
-            calc_large_scale_source(fields->at[*it]->data, lsprofs[*it]);
+        for (std::vector<Force_term>::const_iterator it=lsterms.begin(); it!=lsterms.end(); ++it)
+            calc_large_scale_source(it->fldt->data, it->prof);
     }
 
     if (swwls == "1")
     {
-        for (FieldMap::const_iterator it = fields->st.begin(); it!=fields->st.end(); ++it)
-            advec_wls_2nd(it->second->data, fields->sp[it->first]->datamean, wls, grid->dzhi);
+        for (const Field_pair& s : fields->scalar_pairs)
+            advec_wls_2nd(s.fldt->data, s.fld->datamean, wls, grid->dzhi);
     }
 
     if (swnudge == "1")
     {
-        for (std::vector<std::string>::const_iterator it=nudgelist.begin(); it!=nudgelist.end(); ++it)
-            calc_nudging_tendency(fields->at[*it]->data, fields->ap[*it]->datamean, nudgeprofs[*it], nudge_factor);
+        for (std::vector<Force_term>::const_iterator it=nudgeterms.begin(); it!=nudgeterms.end(); ++it)
+            calc_nudging_tendency(it->fldt->data, it->fld->datamean, it->prof, nudge_factor);
     }
 }
 #endif
@@ -23,6 +23,8 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cmath>
+#include <cstring>
+#include <algorithm>
 #include "master.h"
 #include "grid.h"
 #include "input.h"
@@ -74,6 +76,17 @@ Grid::Grid(Model *modelin, Input *inputin)
     fftinj  = 0;
     fftoutj = 0;
 
+    queue_output  = false;
+    output_busy   = false;
+    output_exit   = false;
+    output_nerror = 0;
+    output_nqueued = 0;
+    output_ndone   = 0;
+
+    profile        = false;
+    time_transpose = 0.;
+    time_halo      = 0.;
+
     int nerror = 0;
     nerror += inputin->get_item(&xsize, "grid", "xsize", "");
     nerror += inputin->get_item(&ysize, "grid", "ysize", "");
@@ -88,9 +101,24 @@ Grid::Grid(Model *modelin, Input *inputin)
 
     nerror += inputin->get_item(&swspatialorder, "grid", "swspatialorder", "");
 
+    nerror += inputin->get_item(&swasyncio, "grid", "swasyncio", "", "0");
+    nerror += inputin->get_item(&swtranspose, "grid", "swtranspose", "", "isend");
+
     if (nerror)
         throw 1;
 
+    if (!(swasyncio == "0" || swasyncio == "1"))
+    {
+        master->print_error("\"%s\" is an illegal value for swasyncio\n", swasyncio.c_str());
+        throw 1;
+    }
+
+    if (!(swtranspose == "isend" || swtranspose == "alltoall" || swtranspose == "neighbor" || swtranspose == "shared" || swtranspose == "auto"))
+    {
+        master->print_error("\"%s\" is an illegal value for swtranspose\n", swtranspose.c_str());
+        throw 1;
+    }
+
     if (!(swspatialorder == "2" || swspatialorder == "4"))
     {
         master->print_error("\"%s\" is an illegal value for swspatialorder\n", swspatialorder.c_str());
@@ -117,6 +145,19 @@ Grid::Grid(Model *modelin, Input *inputin)
  */
 Grid::~Grid()
 {
+    // Let the output thread finish the queued output before the data types are freed.
+    if (output_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(output_mutex);
+            output_exit = true;
+        }
+        output_cond.notify_all();
+        output_thread.join();
+    }
+
+    close_containers();
+
     if (fftwplan)
     {
         fftw_destroy_plan(iplanf);
@@ -240,6 +281,18 @@ void Grid::init()
 
     // initialize the communication functions
     init_mpi();
+
+    // start the thread that writes the output in the background
+    if (swasyncio == "1")
+    {
+        if (master->thread_multiple)
+            output_thread = std::thread(&Grid::run_output, this);
+        else
+        {
+            master->print_warning("MPI does not support MPI_THREAD_MULTIPLE, swasyncio is disabled\n");
+            swasyncio = "0";
+        }
+    }
 }
 
 /**
@@ -422,6 +475,140 @@ void Grid::check_ghost_cells()
     }
 }
 
+/**
+ * This function creates the FFTW3 plans of the transforms in the x- and y-direction for the
+ * current decomposition. The plans depend on itot, jmax, jtot and iblock only.
+ * @param flags The FFTW3 planner flags, with FFTW_WISDOM_ONLY only the plans in the imported wisdom are created.
+ * @return Returns 1 if not all plans could be created, in which case none is kept.
+ */
+int Grid::create_fftw_plans(const unsigned int flags)
+{
+    // use the FFTW3 many interface in order to reduce function call overhead
+    int rank = 1;
+    int ni[] = {itot};
+    int nj[] = {jtot};
+    int istride = 1;
+    int jstride = iblock;
+    int idist = itot;
+    int jdist = 1;
+
+    fftw_r2r_kind kindf[] = {FFTW_R2HC};
+    fftw_r2r_kind kindb[] = {FFTW_HC2R};
+
+    iplanf = fftw_plan_many_r2r(rank, ni, jmax, fftini, ni, istride, idist,
+                                fftouti, ni, istride, idist, kindf, flags);
+    iplanb = fftw_plan_many_r2r(rank, ni, jmax, fftini, ni, istride, idist,
+                                fftouti, ni, istride, idist, kindb, flags);
+    jplanf = fftw_plan_many_r2r(rank, nj, iblock, fftinj, nj, jstride, jdist,
+                                fftoutj, nj, jstride, jdist, kindf, flags);
+    jplanb = fftw_plan_many_r2r(rank, nj, iblock, fftinj, nj, jstride, jdist,
+                                fftoutj, nj, jstride, jdist, kindb, flags);
+
+    if (iplanf == NULL || iplanb == NULL || jplanf == NULL || jplanb == NULL)
+    {
+        fftw_plan plans[] = {iplanf, iplanb, jplanf, jplanb};
+        for (fftw_plan plan : plans)
+            if (plan != NULL)
+                fftw_destroy_plan(plan);
+        return 1;
+    }
+
+    fftwplan = true;
+    return 0;
+}
+
+/**
+ * This function creates the FFTW3 plans and saves the wisdom, such that restarts are bitwise identical.
+ * In ensemble mode, only the first member measures the plans. Its wisdom is shared with the other
+ * members, which then create identical plans without measuring if they have the same grid.
+ */
+void Grid::save_fftw_plans()
+{
+    int nerror = 0;
+
+    if (master->member == 0)
+        nerror += create_fftw_plans(FFTW_EXHAUSTIVE);
+
+    share_fftw_wisdom();
+
+    if (master->member != 0)
+        nerror += create_fftw_plans(FFTW_EXHAUSTIVE);
+
+    if (nerror)
+    {
+        master->print_error("FFTW3 plans cannot be created\n");
+        throw 1;
+    }
+
+    export_fftw_wisdom();
+}
+
+/**
+ * This function loads the FFTW3 wisdom and creates the plans from it. If the wisdom file is missing or
+ * does not contain the plans of the current decomposition, for instance after a restart on another
+ * npx or npy, the missing plans are created and added to the wisdom file. The file then serves
+ * restarts on both the old and the new decomposition.
+ */
+void Grid::load_fftw_plans()
+{
+    char filename[256];
+    std::sprintf(filename, "%s.%07d", "fftwplan", 0);
+
+    master->print_message("Loading \"%s\" ... ", filename);
+
+    const int n = fftw_import_wisdom_from_filename(filename);
+    if (n == 0)
+        master->print_message("FAILED\n");
+    else
+        master->print_message("OK\n");
+
+    if (n == 0 || create_fftw_plans(FFTW_EXHAUSTIVE | FFTW_WISDOM_ONLY))
+    {
+        master->print_warning("\"%s\" has no FFTW3 plans for npx = %d and npy = %d, the plans are regenerated\n",
+                              filename, master->npx, master->npy);
+        // only this member is missing plans, so the wisdom cannot be shared with the others
+        if (create_fftw_plans(FFTW_EXHAUSTIVE))
+        {
+            master->print_error("FFTW3 plans cannot be created\n");
+            throw 1;
+        }
+        export_fftw_wisdom();
+    }
+
+    fftw_forget_wisdom();
+}
+
+/**
+ * This function writes the accumulated FFTW3 wisdom to file. The file is written under a temporary name
+ * and then renamed, such that processes that are still reading the old file are not affected.
+ */
+void Grid::export_fftw_wisdom()
+{
+    int nerror = 0;
+
+    if (master->mpiid == 0)
+    {
+        char filename[256], tmpname[256];
+        std::sprintf(filename, "%s.%07d", "fftwplan", 0);
+        std::snprintf(tmpname, sizeof(tmpname), "%s.tmp", filename);
+
+        master->print_message("Saving \"%s\" ... ", filename);
+
+        if (fftw_export_wisdom_to_filename(tmpname) == 0 || std::rename(tmpname, filename))
+        {
+            master->print_message("FAILED\n");
+            master->print_error("\"%s\" cannot be saved\n", filename);
+            ++nerror;
+        }
+        else
+            master->print_message("OK\n");
+    }
+
+    master->broadcast(&nerror, 1);
+    if (nerror)
+        throw 1;
+}
+
 /**
  * This function increases the number of ghost cells in case necessary.
  * @param igc Ghost cells in the x-direction.
@@ -530,3 +717,243 @@ void Grid::calc_mean(double* restrict prof, const double* restrict data, const i
     for (int k=0; k<krange; ++k)
         prof[k] /= n;
 }
+
+/**
+ * This function executes an output job. If output is queued, the job is handed to the output thread
+ * that executes the jobs in the order they are queued, otherwise the job is executed directly.
+ * All processes have to queue the same jobs in the same order, as the jobs can contain collectives.
+ * @param job Function that writes the data from its own copy and returns the number of errors.
+ * @param name Name of the file that is written, used in the error message.
+ * @return Number of errors of the job, or 0 if the job is queued.
+ */
+int Grid::exec_output(std::function<int()> job, const std::string& name)
+{
+    // Output that is written directly has to wait for the queued output to keep the order.
+    if (!queue_output)
+    {
+        {
+            std::unique_lock<std::mutex> lock(output_mutex);
+            output_cond.wait(lock, [&]{ return output_jobs.empty() && !output_busy; });
+        }
+        return job();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(output_mutex);
+        output_jobs.push_back(std::make_pair(job, name));
+        ++output_nqueued;
+    }
+    output_cond.notify_all();
+
+    return 0;
+}
+
+/**
+ * This function executes an input job. If the output thread is running, the job is queued behind
+ * the pending output, such that it is executed in the background, otherwise it is executed directly.
+ * As for output jobs, all processes have to queue the same jobs in the same order.
+ * @param job Function that reads the data into its own buffer and stores its errors there.
+ * @return Number of the job to wait for with wait_input, 0 if the job has been executed directly.
+ */
+unsigned long Grid::exec_input(std::function<int()> job)
+{
+    if (!output_thread.joinable())
+    {
+        job();
+        return 0;
+    }
+
+    unsigned long n;
+    {
+        std::lock_guard<std::mutex> lock(output_mutex);
+        output_jobs.push_back(std::make_pair(job, std::string()));
+        n = ++output_nqueued;
+    }
+    output_cond.notify_all();
+
+    return n;
+}
+
+/**
+ * This function blocks until the queued job with the given number has been executed.
+ * @param n Number of the job as returned by exec_input.
+ */
+void Grid::wait_input(const unsigned long n)
+{
+    std::unique_lock<std::mutex> lock(output_mutex);
+    output_cond.wait(lock, [&]{ return output_ndone >= n; });
+}
+
+/**
+ * This function loads a 3d field from a buffer that is filled by prefetch_field3d. It waits until the
+ * buffer has been read and unpacks it into the field.
+ * @return Returns 1 if the file could not be read.
+ */
+int Grid::load_field3d(double* restrict data, double* restrict tmp, Prefetch_buffer& buffer, const double offset)
+{
+    wait_input(buffer.job);
+
+    if (buffer.nerror)
+        return 1;
+
+    unpack_field3d(data, buffer.data.data(), tmp, offset);
+
+    return 0;
+}
+
+namespace
+{
+    // Division of a by b > 0 that rounds towards plus infinity, also for negative a.
+    inline int ceil_div(const int a, const int b)
+    {
+        return (a >= 0) ? (a + b - 1) / b : -((-a) / b);
+    }
+}
+
+/**
+ * This function copies the points of a region of a 3d field that are owned by this process into a buffer,
+ * with x as the fastest index. The part of the region of this process is a box within the saved field.
+ * @param buffer Buffer that is resized to the number of local points.
+ * @param start Index of the first local point in the saved field, per direction.
+ * @param count Number of local points, per direction.
+ * @param total Size of the saved field, per direction.
+ */
+void Grid::pack_region(std::vector<double>& buffer, const double* restrict data, const double offset,
+                       const Field3d_region& region, int start[3], int count[3], int total[3])
+{
+    const int first[3] = {master->mpicoordx*imax, master->mpicoordy*jmax, 0};
+    const int nlocal[3] = {imax, jmax, kmax};
+
+    int ilocal[3];
+    for (int n=0; n<3; ++n)
+    {
+        total[n] = ceil_div(region.end[n] - region.begin[n], region.stride[n]);
+
+        // the saved points with a global index in [first, first+nlocal) belong to this process
+        const int m0 = std::max(0, ceil_div(first[n] - region.begin[n], region.stride[n]));
+        const int m1 = std::min(total[n], ceil_div(first[n] + nlocal[n] - region.begin[n], region.stride[n]));
+
+        start [n] = m0;
+        count [n] = std::max(0, m1 - m0);
+        ilocal[n] = region.begin[n] + m0*region.stride[n] - first[n];
+    }
+
+    buffer.resize(count[0]*count[1]*count[2]);
+
+    const int ii = region.stride[0];
+    const int jj = region.stride[1]*icells;
+    const int kk = region.stride[2]*ijcells;
+
+    const int ijk0 = ilocal[0]+igc + (ilocal[1]+jgc)*icells + (ilocal[2]+kgc)*ijcells;
+
+    int n = 0;
+    for (int k=0; k<count[2]; k++)
+        for (int j=0; j<count[1]; j++)
+            for (int i=0; i<count[0]; i++)
+            {
+                const int ijk = ijk0 + i*ii + j*jj + k*kk;
+                buffer[n++] = data[ijk] + offset;
+            }
+}
+
+/**
+ * This function switches the queueing of output jobs on or off. Queueing is only enabled when
+ * the output thread is running.
+ * @param queue Boolean to switch the queueing on.
+ */
+void Grid::set_output_queue(bool queue)
+{
+    queue_output = queue && output_thread.joinable();
+}
+
+/**
+ * This function blocks until all queued output jobs are written.
+ * @return Number of errors of the output jobs since the last wait.
+ */
+int Grid::wait_output()
+{
+    std::unique_lock<std::mutex> lock(output_mutex);
+    output_cond.wait(lock, [&]{ return output_jobs.empty() && !output_busy; });
+
+    const int nerror = output_nerror;
+    output_nerror = 0;
+
+    return nerror;
+}
+
+/**
+ * This function contains the loop of the output thread, that executes the queued jobs one by one.
+ */
+void Grid::run_output()
+{
+    std::unique_lock<std::mutex> lock(output_mutex);
+
+    while (true)
+    {
+        output_cond.wait(lock, [&]{ return !output_jobs.empty() || output_exit; });
+
+        // The thread only stops if all queued output is written.
+        if (output_jobs.empty())
+            return;
+
+        std::pair<std::function<int()>, std::string> job = output_jobs.front();
+        output_jobs.pop_front();
+        output_busy = true;
+
+        lock.unlock();
+        const int nerror = job.first();
+        if (nerror)
+            master->print_error("\"%s\" cannot be written\n", job.second.c_str());
+        lock.lock();
+
+        output_nerror += nerror;
+        output_busy = false;
+        ++output_ndone;
+        output_cond.notify_all();
+    }
+}
+
+void Container::pack_header(unsigned char* header, const int capacity)
+{
+    const int pad = 0;
+    std::memcpy(header, "MHHCNT01", 8);
+    std::memcpy(header+8 , &capacity, sizeof(int));
+    std::memcpy(header+12, &pad, sizeof(int));
+}
+
+int Container::unpack_header(const unsigned char* header, int* capacity)
+{
+    if (std::memcmp(header, "MHHCNT01", 8))
+        return 1;
+
+    std::memcpy(capacity, header+8, sizeof(int));
+    return 0;
+}
+
+void Container::pack_entry(unsigned char* entry, const int iotime, const long long offset, const long long nbytes)
+{
+    const int pad = 0;
+    std::memcpy(entry   , &iotime, sizeof(int));
+    std::memcpy(entry+4 , &pad   , sizeof(int));
+    std::memcpy(entry+8 , &offset, sizeof(long long));
+    std::memcpy(entry+16, &nbytes, sizeof(long long));
+}
+
+long long Container::unpack_table(const unsigned char* table, const int capacity, int* nentries)
+{
+    long long next;
+    std::memcpy(&next, table, sizeof(long long));
+
+    // the entries are filled in order, the first entry without data ends the table
+    *nentries = 0;
+    for (int n=0; n<capacity; ++n)
+    {
+        long long nbytes;
+        std::memcpy(&nbytes, table + sizeof(long long) + n*entry_size + 16, sizeof(long long));
+        if (nbytes == 0)
+            break;
+        ++(*nentries);
+    }
+
+    return next;
+}
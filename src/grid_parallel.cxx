@@ -23,10 +23,383 @@
 #ifdef USEMPI
 #include <fftw3.h>
 #include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
 #include "master.h"
 #include "grid.h"
 #include "defines.h"
 
+namespace
+{
+    // Check whether an opened file holds exactly n doubles, the position is reset to the start.
+    long long get_file_size(FILE* file)
+    {
+        std::fseek(file, 0, SEEK_END);
+        const long long size = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+        return size;
+    }
+
+    // Copy block n of a transpose into a contiguous buffer.
+    void pack_block(double* restrict buffer, const double* restrict data, const Transpose_block& b)
+    {
+        // Contiguous blocks are copied at once.
+        if (b.jj == b.ni && b.kk == b.ni*b.nj)
+        {
+            std::copy(data, data + b.ni*b.nj*b.nk, buffer);
+            return;
+        }
+
+        const int jjb = b.ni;
+        const int kkb = b.ni*b.nj;
+
+        for (int k=0; k<b.nk; ++k)
+            for (int j=0; j<b.nj; ++j)
+#pragma ivdep
+                for (int i=0; i<b.ni; ++i)
+                    buffer[i + j*jjb + k*kkb] = data[i + j*b.jj + k*b.kk];
+    }
+
+    // Copy a contiguous buffer into block n of a transpose.
+    void unpack_block(double* restrict data, const double* restrict buffer, const Transpose_block& b)
+    {
+        // Contiguous blocks are copied at once.
+        if (b.jj == b.ni && b.kk == b.ni*b.nj)
+        {
+            std::copy(buffer, buffer + b.ni*b.nj*b.nk, data);
+            return;
+        }
+
+        const int jjb = b.ni;
+        const int kkb = b.ni*b.nj;
+
+        for (int k=0; k<b.nk; ++k)
+            for (int j=0; j<b.nj; ++j)
+#pragma ivdep
+                for (int i=0; i<b.ni; ++i)
+                    data[i + j*b.jj + k*b.kk] = buffer[i + j*jjb + k*kkb];
+    }
+
+    // Create a graph communicator in which all processes of comm are neighbors, in the order of their rank.
+    MPI_Comm create_all_neighbor_comm(MPI_Comm comm)
+    {
+        int nprocs;
+        MPI_Comm_size(comm, &nprocs);
+
+        std::vector<int> ranks(nprocs);
+        for (int n=0; n<nprocs; ++n)
+            ranks[n] = n;
+
+        MPI_Comm commgraph;
+        MPI_Dist_graph_create_adjacent(comm, nprocs, ranks.data(), MPI_UNWEIGHTED,
+                                       nprocs, ranks.data(), MPI_UNWEIGHTED,
+                                       MPI_INFO_NULL, false, &commgraph);
+
+        return commgraph;
+    }
+
+    // Determine the node layout of comm and create the shared memory window for the node-aware transposes.
+    // The window contains per process a send and a receive buffer of nsegment values.
+    void create_transpose_node(Transpose_node& t, MPI_Comm comm, const int nsegment)
+    {
+        int nprocs;
+        MPI_Comm_size(comm, &nprocs);
+        MPI_Comm_rank(comm, &t.rank);
+
+        MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, t.rank, MPI_INFO_NULL, &t.commnode);
+
+        int nlocal;
+        int localrank;
+        MPI_Comm_size(t.commnode, &nlocal);
+        MPI_Comm_rank(t.commnode, &localrank);
+
+        // the first process on each node is the leader, the nodes are numbered by the rank of their leader
+        MPI_Comm_split(comm, (localrank == 0) ? 0 : MPI_UNDEFINED, t.rank, &t.commleader);
+
+        int nodeid = 0;
+        if (t.commleader != MPI_COMM_NULL)
+            MPI_Comm_rank(t.commleader, &nodeid);
+        MPI_Bcast(&nodeid, 1, MPI_INT, 0, t.commnode);
+
+        int layout[2] = {nodeid, localrank};
+        std::vector<int> layouts(2*nprocs);
+        MPI_Allgather(layout, 2, MPI_INT, layouts.data(), 2, MPI_INT, comm);
+
+        t.node .resize(nprocs);
+        t.local.resize(nprocs);
+        t.members.clear();
+        for (int n=0; n<nprocs; ++n)
+        {
+            t.node [n] = layouts[2*n  ];
+            t.local[n] = layouts[2*n+1];
+
+            if (t.node[n] >= static_cast<int>(t.members.size()))
+                t.members.resize(t.node[n]+1);
+            t.members[t.node[n]].push_back(n);
+        }
+
+        double* base;
+        MPI_Win_allocate_shared(2*nsegment*sizeof(double), sizeof(double), MPI_INFO_NULL, t.commnode, &base, &t.win);
+
+        t.segments.resize(nlocal);
+        for (int l=0; l<nlocal; ++l)
+        {
+            MPI_Aint size;
+            int dispunit;
+            MPI_Win_shared_query(t.win, l, &size, &dispunit, &t.segments[l]);
+        }
+
+        // the window is accessed by direct loads and stores, synchronized by barriers
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, t.win);
+
+        const int nblock = nsegment / nprocs;
+        if (t.commleader != MPI_COMM_NULL)
+        {
+            t.aggsend.resize(nblock*nlocal*(nprocs-nlocal));
+            t.aggrecv.resize(nblock*nlocal*(nprocs-nlocal));
+        }
+    }
+
+    void free_transpose_node(Transpose_node& t)
+    {
+        MPI_Win_unlock_all(t.win);
+        MPI_Win_free(&t.win);
+
+        if (t.commleader != MPI_COMM_NULL)
+            MPI_Comm_free(&t.commleader);
+        MPI_Comm_free(&t.commnode);
+    }
+
+    // Exchange the packed blocks of all processes of the communicator. The blocks of the processes on the
+    // same node are copied directly from the shared memory, the blocks of the other nodes are aggregated,
+    // such that only the node leaders exchange one message per pair of nodes.
+    void exchange_shared(Transpose_node& t, const int nblock, const int nsegment)
+    {
+        const int mynode = t.node[t.rank];
+        const std::vector<int>& mymembers = t.members[mynode];
+
+        // make the packed blocks of all processes on the node visible
+        MPI_Win_sync(t.win);
+        MPI_Barrier(t.commnode);
+        MPI_Win_sync(t.win);
+
+        // copy the blocks of the processes on this node
+        double* restrict recv = t.segments[t.local[t.rank]] + nsegment;
+        for (std::vector<int>::const_iterator s=mymembers.begin(); s!=mymembers.end(); ++s)
+        {
+            const double* send = t.segments[t.local[*s]] + t.rank*nblock;
+            std::copy(send, send + nblock, &recv[*s*nblock]);
+        }
+
+        // the leader exchanges the blocks of the node with the other leaders
+        if (t.commleader != MPI_COMM_NULL)
+        {
+            const int nnodes = t.members.size();
+
+            std::vector<int> sendcounts(nnodes), senddispls(nnodes);
+            std::vector<int> recvcounts(nnodes), recvdispls(nnodes);
+
+            int nsend = 0;
+            int nrecv = 0;
+            for (int b=0; b<nnodes; ++b)
+            {
+                const int ncount = (b == mynode) ? 0 : nblock*mymembers.size()*t.members[b].size();
+
+                senddispls[b] = nsend;
+                recvdispls[b] = nrecv;
+                sendcounts[b] = ncount;
+                recvcounts[b] = ncount;
+                nsend += ncount;
+                nrecv += ncount;
+
+                if (b == mynode)
+                    continue;
+
+                // order the blocks by destination and then by source
+                double* restrict agg = &t.aggsend[senddispls[b]];
+                for (std::vector<int>::const_iterator d=t.members[b].begin(); d!=t.members[b].end(); ++d)
+                    for (std::vector<int>::const_iterator s=mymembers.begin(); s!=mymembers.end(); ++s)
+                    {
+                        const double* send = t.segments[t.local[*s]] + (*d)*nblock;
+                        agg = std::copy(send, send + nblock, agg);
+                    }
+            }
+
+            MPI_Alltoallv(t.aggsend.data(), sendcounts.data(), senddispls.data(), MPI_DOUBLE,
+                          t.aggrecv.data(), recvcounts.data(), recvdispls.data(), MPI_DOUBLE, t.commleader);
+
+            // store the received blocks in the receive buffers of their destinations
+            for (int b=0; b<nnodes; ++b)
+            {
+                if (b == mynode)
+                    continue;
+
+                const double* agg = &t.aggrecv[recvdispls[b]];
+                for (std::vector<int>::const_iterator d=mymembers.begin(); d!=mymembers.end(); ++d)
+                    for (std::vector<int>::const_iterator s=t.members[b].begin(); s!=t.members[b].end(); ++s)
+                    {
+                        double* dest = t.segments[t.local[*d]] + nsegment + (*s)*nblock;
+                        std::copy(agg, agg + nblock, dest);
+                        agg += nblock;
+                    }
+            }
+        }
+
+        // wait until all blocks of the node have arrived
+        MPI_Win_sync(t.win);
+        MPI_Barrier(t.commnode);
+        MPI_Win_sync(t.win);
+    }
+
+    // Encode the block of this process and write the blocks of all processes of comm at offset base.
+    // The blocks are stored in rank order after the header and the block records.
+    int write_encoded_at(MPI_File fh, MPI_Comm comm, const MPI_Offset base, const double* data, Encoding::Block& block,
+                         const Encoding::Format& format, const int itot, const int jtot, const int ktot, long long* size)
+    {
+        int nerror = 0;
+        if (Encoding::encode_block(block, data, format))
+            ++nerror;
+
+        int rank;
+        int nblocks;
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &nblocks);
+
+        // collect the block records at the first process
+        std::vector<unsigned char> header(Encoding::header_size + nblocks*Encoding::record_size);
+        unsigned char record[Encoding::record_size];
+        Encoding::pack_record(record, block);
+        MPI_Gather(record, Encoding::record_size, MPI_BYTE,
+                   &header[Encoding::header_size], Encoding::record_size, MPI_BYTE, 0, comm);
+
+        // the position of the block follows from the sizes of the blocks of the lower ranks
+        long long nbytes = block.data.size();
+        long long offset = 0;
+        MPI_Exscan(&nbytes, &offset, 1, MPI_LONG_LONG, MPI_SUM, comm);
+        if (rank == 0)
+            offset = 0;
+
+        MPI_Allreduce(&nbytes, size, 1, MPI_LONG_LONG, MPI_SUM, comm);
+        *size += header.size();
+
+        if (rank == 0)
+        {
+            Encoding::pack_header(header.data(), format, itot, jtot, ktot, nblocks);
+            if (MPI_File_write_at(fh, base, header.data(), header.size(), MPI_BYTE, MPI_STATUS_IGNORE))
+                ++nerror;
+        }
+
+        const MPI_Offset fileoff = base + header.size() + offset;
+        if (MPI_File_write_at_all(fh, fileoff, block.data.data(), nbytes, MPI_BYTE, MPI_STATUS_IGNORE))
+            ++nerror;
+
+        return nerror;
+    }
+
+    // Encode the block of this process and write the blocks of all processes of comm to a new file.
+    int write_encoded(MPI_Comm comm, const std::string& filename, const double* data, Encoding::Block& block,
+                      const Encoding::Format& format, const int itot, const int jtot, const int ktot)
+    {
+        MPI_File fh;
+        if (MPI_File_open(comm, const_cast<char*>(filename.c_str()), MPI_MODE_CREATE | MPI_MODE_WRONLY | MPI_MODE_EXCL, MPI_INFO_NULL, &fh))
+            return 1;
+
+        long long size;
+        int nerror = write_encoded_at(fh, comm, 0, data, block, format, itot, jtot, ktot, &size);
+
+        if (MPI_File_close(&fh))
+            ++nerror;
+
+        return nerror;
+    }
+
+    // Write the part of a slice of this process at offset, using the subarray type of the slice.
+    int write_slice_at(MPI_File fh, const MPI_Offset offset, MPI_Datatype subarray, const std::vector<double>& slice)
+    {
+        char name[] = "native";
+
+        if (MPI_File_set_view(fh, offset, MPI_DOUBLE, subarray, name, MPI_INFO_NULL))
+            return 1;
+
+        if (MPI_File_write_all(fh, slice.data(), slice.size(), MPI_DOUBLE, MPI_STATUS_IGNORE))
+            return 1;
+
+        return 0;
+    }
+
+    // Open a container file. A new container gets a header and an empty index table, an existing
+    // container is continued after the last entry of its last index table.
+    int open_container(Output_container& c, MPI_Comm comm, const std::string& filename)
+    {
+        int rank;
+        MPI_Comm_rank(comm, &rank);
+
+        if (MPI_File_open(comm, const_cast<char*>(filename.c_str()), MPI_MODE_CREATE | MPI_MODE_RDWR, MPI_INFO_NULL, &c.fh))
+            return 1;
+
+        // the file is closed on errors, as a failed container is not stored
+        MPI_Offset size;
+        if (MPI_File_get_size(c.fh, &size))
+        {
+            MPI_File_close(&c.fh);
+            return 1;
+        }
+
+        if (size == 0)
+        {
+            c.capacity = Container::capacity;
+            c.nentries = 0;
+            c.table    = Container::header_size;
+            c.end      = c.table + Container::table_size(c.capacity);
+
+            int nerror = 0;
+            if (rank == 0)
+            {
+                std::vector<unsigned char> header(c.end, 0);
+                Container::pack_header(header.data(), c.capacity);
+                if (MPI_File_write_at(c.fh, 0, header.data(), header.size(), MPI_BYTE, MPI_STATUS_IGNORE))
+                    ++nerror;
+            }
+
+            // all processes close the file if the header could not be written
+            MPI_Bcast(&nerror, 1, MPI_INT, 0, comm);
+            if (nerror)
+                MPI_File_close(&c.fh);
+            return nerror;
+        }
+
+        unsigned char header[Container::header_size];
+        if (MPI_File_read_at_all(c.fh, 0, header, Container::header_size, MPI_BYTE, MPI_STATUS_IGNORE)
+                || Container::unpack_header(header, &c.capacity))
+        {
+            MPI_File_close(&c.fh);
+            return 1;
+        }
+
+        // follow the chain of index tables to the last one
+        std::vector<unsigned char> table(Container::table_size(c.capacity));
+        c.table = Container::header_size;
+        while (true)
+        {
+            if (MPI_File_read_at_all(c.fh, c.table, table.data(), table.size(), MPI_BYTE, MPI_STATUS_IGNORE))
+            {
+                MPI_File_close(&c.fh);
+                return 1;
+            }
+            const long long next = Container::unpack_table(table.data(), c.capacity, &c.nentries);
+            if (next == 0)
+                break;
+            c.table = next;
+        }
+        c.end = size;
+
+        return 0;
+    }
+}
+
 // MPI functions
 void Grid::init_mpi()
 {
@@ -61,6 +434,20 @@ void Grid::init_mpi()
     MPI_Type_vector(datacount, datablock, datastride, MPI_DOUBLE, &northsouthedge2d);
     MPI_Type_commit(&northsouthedge2d);
 
+    // east west for a field of flags
+    datacount  = jcells*kcells;
+    datablock  = igc;
+    datastride = icells;
+    MPI_Type_vector(datacount, datablock, datastride, MPI_UNSIGNED_CHAR, &eastwestedgeflag);
+    MPI_Type_commit(&eastwestedgeflag);
+
+    // north south for a field of flags
+    datacount  = kcells;
+    datablock  = icells*jgc;
+    datastride = icells*jcells;
+    MPI_Type_vector(datacount, datablock, datastride, MPI_UNSIGNED_CHAR, &northsouthedgeflag);
+    MPI_Type_commit(&northsouthedgeflag);
+
     // transposez
     datacount = imax*jmax*kblock;
     MPI_Type_contiguous(datacount, MPI_DOUBLE, &transposez);
@@ -146,7 +533,54 @@ void Grid::init_mpi()
     // allocate the array for the profiles
     profl = new double[kcells];
 
+    // create the communicators and buffers for the collective transposes
+    transpose_sendbuf = 0;
+    transpose_recvbuf = 0;
+    transpose_shared  = false;
+
+    if (swtranspose != "isend")
+    {
+        commxgraph = create_all_neighbor_comm(master->commx);
+        commygraph = create_all_neighbor_comm(master->commy);
+
+        // all transposes exchange the data of one process, which is nmax values
+        transpose_sendbuf = new double[nmax];
+        transpose_recvbuf = new double[nmax];
+    }
+
+    if (swtranspose == "shared" || swtranspose == "auto")
+    {
+        create_transpose_node(nodex, master->commx, nmax);
+        create_transpose_node(nodey, master->commy, nmax);
+        transpose_shared = true;
+    }
+
     mpitypes = true;
+
+    // select the fastest backend for the current decomposition
+    if (swtranspose == "auto")
+    {
+        benchmark_transposes();
+
+        // free the shared memory windows and buffers of the backends that are not selected
+        if (swtranspose != "shared")
+        {
+            free_transpose_node(nodex);
+            free_transpose_node(nodey);
+            transpose_shared = false;
+        }
+
+        if (swtranspose == "isend" || swtranspose == "shared")
+        {
+            MPI_Comm_free(&commxgraph);
+            MPI_Comm_free(&commygraph);
+
+            delete[] transpose_sendbuf;
+            delete[] transpose_recvbuf;
+            transpose_sendbuf = 0;
+            transpose_recvbuf = 0;
+        }
+    }
 } 
 
 void Grid::exit_mpi()
@@ -157,6 +591,8 @@ void Grid::exit_mpi()
         MPI_Type_free(&northsouthedge);
         MPI_Type_free(&eastwestedge2d);
         MPI_Type_free(&northsouthedge2d);
+        MPI_Type_free(&eastwestedgeflag);
+        MPI_Type_free(&northsouthedgeflag);
         MPI_Type_free(&transposez);
         MPI_Type_free(&transposez2);
         MPI_Type_free(&transposex);
@@ -171,13 +607,35 @@ void Grid::exit_mpi()
         MPI_Type_free(&subxyslice);
 
         delete[] profl;
+
+        if (transpose_sendbuf)
+        {
+            MPI_Comm_free(&commxgraph);
+            MPI_Comm_free(&commygraph);
+
+            delete[] transpose_sendbuf;
+            delete[] transpose_recvbuf;
+        }
+
+        if (transpose_shared)
+        {
+            free_transpose_node(nodex);
+            free_transpose_node(nodey);
+        }
     }
 }
 
 void Grid::boundary_cyclic(double* restrict data, Edge edge)
 {
+    // The exchange is only timed for the profile and the communication statistics.
+    const bool timed = profile || master->get_comm_stats();
+    const double time_start = timed ? master->get_wall_clock_time() : 0.;
     const int ncount = 1;
 
+    int typesize;
+    double nmessages = 0.;
+    double nbytes = 0.;
+
     if (edge == East_west_edge || edge == Both_edges)
     {
         // Communicate east-west edges.
@@ -197,6 +655,10 @@ void Grid::boundary_cyclic(double* restrict data, Edge edge)
         master->reqsn++;
         // Wait here for the MPI to have correct values in the corners of the cells.
         master->wait_all();
+
+        MPI_Type_size(eastwestedge, &typesize);
+        nmessages += 2;
+        nbytes += 2*typesize;
     }
 
     if (edge == North_south_edge || edge == Both_edges)
@@ -220,6 +682,10 @@ void Grid::boundary_cyclic(double* restrict data, Edge edge)
             MPI_Irecv(&data[northin], ncount, northsouthedge, master->nnorth, 2, master->commxy, &master->reqs[master->reqsn]);
             master->reqsn++;
             master->wait_all();
+
+            MPI_Type_size(northsouthedge, &typesize);
+            nmessages += 2;
+            nbytes += 2*typesize;
         }
         // In case of 2D, fill all the ghost cells in the y-direction with the same value.
         else
@@ -240,10 +706,99 @@ void Grid::boundary_cyclic(double* restrict data, Edge edge)
                     }
         }
     }
+
+    if (timed)
+    {
+        const double time = master->get_wall_clock_time() - time_start;
+        time_halo += time;
+        master->add_comm(Comm_kind::halo, nmessages, nbytes, time);
+    }
+}
+
+void Grid::boundary_cyclic(unsigned char* restrict data)
+{
+    const bool timed = profile || master->get_comm_stats();
+    const double time_start = timed ? master->get_wall_clock_time() : 0.;
+    const int ncount = 1;
+
+    int typesize;
+    MPI_Type_size(eastwestedgeflag, &typesize);
+    double nmessages = 2.;
+    double nbytes = 2*typesize;
+
+    // Communicate east-west edges.
+    const int eastout = iend-igc;
+    const int westin  = 0;
+    const int westout = istart;
+    const int eastin  = iend;
+
+    // Send and receive the ghost cells in east-west direction.
+    MPI_Isend(&data[eastout], ncount, eastwestedgeflag, master->neast, 1, master->commxy, &master->reqs[master->reqsn]);
+    master->reqsn++;
+    MPI_Irecv(&data[westin], ncount, eastwestedgeflag, master->nwest, 1, master->commxy, &master->reqs[master->reqsn]);
+    master->reqsn++;
+    MPI_Isend(&data[westout], ncount, eastwestedgeflag, master->nwest, 2, master->commxy, &master->reqs[master->reqsn]);
+    master->reqsn++;
+    MPI_Irecv(&data[eastin], ncount, eastwestedgeflag, master->neast, 2, master->commxy, &master->reqs[master->reqsn]);
+    master->reqsn++;
+    // Wait here for the MPI to have correct values in the corners of the cells.
+    master->wait_all();
+
+    // If the run is 3D, perform the cyclic boundary routine for the north-south direction.
+    if (jtot > 1)
+    {
+        // Communicate north-south edges.
+        const int northout = (jend-jgc)*icells;
+        const int southin  = 0;
+        const int southout = jstart*icells;
+        const int northin  = jend  *icells;
+
+        // Send and receive the ghost cells in the north-south direction.
+        MPI_Isend(&data[northout], ncount, northsouthedgeflag, master->nnorth, 1, master->commxy, &master->reqs[master->reqsn]);
+        master->reqsn++;
+        MPI_Irecv(&data[southin], ncount, northsouthedgeflag, master->nsouth, 1, master->commxy, &master->reqs[master->reqsn]);
+        master->reqsn++;
+        MPI_Isend(&data[southout], ncount, northsouthedgeflag, master->nsouth, 2, master->commxy, &master->reqs[master->reqsn]);
+        master->reqsn++;
+        MPI_Irecv(&data[northin], ncount, northsouthedgeflag, master->nnorth, 2, master->commxy, &master->reqs[master->reqsn]);
+        master->reqsn++;
+        master->wait_all();
+
+        MPI_Type_size(northsouthedgeflag, &typesize);
+        nmessages += 2;
+        nbytes += 2*typesize;
+    }
+    // In case of 2D, fill all the ghost cells in the y-direction with the same value.
+    else
+    {
+        const int jj = icells;
+        const int kk = icells*jcells;
+
+        for (int k=0; k<kcells; k++)
+            for (int j=0; j<jgc; j++)
+#pragma ivdep
+                for (int i=0; i<icells; i++)
+                {
+                    const int ijkref   = i + jstart*jj   + k*kk;
+                    const int ijknorth = i + j*jj        + k*kk;
+                    const int ijksouth = i + (jend+j)*jj + k*kk;
+                    data[ijknorth] = data[ijkref];
+                    data[ijksouth] = data[ijkref];
+                }
+    }
+
+    if (timed)
+    {
+        const double time = master->get_wall_clock_time() - time_start;
+        time_halo += time;
+        master->add_comm(Comm_kind::halo, nmessages, nbytes, time);
+    }
 }
 
 void Grid::boundary_cyclic_2d(double* restrict data)
 {
+    const bool timed = profile || master->get_comm_stats();
+    const double time_start = timed ? master->get_wall_clock_time() : 0.;
     int ncount = 1;
 
     // communicate east-west edges
@@ -258,6 +813,11 @@ void Grid::boundary_cyclic_2d(double* restrict data)
     int southout = jstart*icells;
     int northin  = jend  *icells;
 
+    int typesize;
+    MPI_Type_size(eastwestedge2d, &typesize);
+    double nmessages = 2.;
+    double nbytes = 2*typesize;
+
     // first, send and receive the ghost cells in east-west direction
     MPI_Isend(&data[eastout], ncount, eastwestedge2d, master->neast, 1, master->commxy, &master->reqs[master->reqsn]);
     master->reqsn++;
@@ -283,6 +843,10 @@ void Grid::boundary_cyclic_2d(double* restrict data)
         MPI_Irecv(&data[northin], ncount, northsouthedge2d, master->nnorth, 2, master->commxy, &master->reqs[master->reqsn]);
         master->reqsn++;
         master->wait_all();
+
+        MPI_Type_size(northsouthedge2d, &typesize);
+        nmessages += 2;
+        nbytes += 2*typesize;
     }
     // in case of 2D, fill all the ghost cells with the current value
     else
@@ -301,162 +865,230 @@ void Grid::boundary_cyclic_2d(double* restrict data)
                 data[ijsouth] = data[ijref];
             }
     }
+
+    if (timed)
+    {
+        const double time = master->get_wall_clock_time() - time_start;
+        time_halo += time;
+        master->add_comm(Comm_kind::halo_2d, nmessages, nbytes, time);
+    }
 }
 
-void Grid::transpose_zx(double* restrict ar, double* restrict as)
+void Grid::transpose(double* restrict ar, double* restrict as,
+                     const Transpose_block& bsend, const Transpose_block& brecv,
+                     MPI_Datatype typesend, MPI_Datatype typerecv,
+                     MPI_Comm comm, MPI_Comm commgraph, Transpose_node& node, const int nprocs, const int kind)
 {
-    const int ncount = 1;
-    const int tag = 1;
+    // The transpose is only timed for the profile and the communication statistics.
+    const bool timed = profile || master->get_comm_stats();
+    const double time_start = timed ? master->get_wall_clock_time() : 0.;
 
-    const int jj = imax;
-    const int kk = imax*jmax;
-
-    for (int n=0; n<master->npx; n++)
+    // send and receive the blocks as derived data types
+    if (swtranspose == "isend")
     {
-        // determine where to fetch the data and where to store it
-        const int ijks = n*kblock*kk;
-        const int ijkr = n*jj;
+        const int ncount = 1;
+        const int tag = 1;
 
-        // send and receive the data
-        MPI_Isend(&as[ijks], ncount, transposez, n, tag, master->commx, &master->reqs[master->reqsn]);
-        master->reqsn++;
-        MPI_Irecv(&ar[ijkr], ncount, transposex, n, tag, master->commx, &master->reqs[master->reqsn]);
-        master->reqsn++;
-    }
-    master->wait_all();
-}
+        for (int n=0; n<nprocs; n++)
+        {
+            MPI_Isend(&as[n*bsend.nstride], ncount, typesend, n, tag, comm, &master->reqs[master->reqsn]);
+            master->reqsn++;
+            MPI_Irecv(&ar[n*brecv.nstride], ncount, typerecv, n, tag, comm, &master->reqs[master->reqsn]);
+            master->reqsn++;
+        }
+        master->wait_all();
 
-void Grid::transpose_xz(double* restrict ar, double* restrict as)
-{
-    const int ncount = 1;
-    const int tag = 1;
+        if (timed)
+        {
+            int typesize;
+            MPI_Type_size(typesend, &typesize);
 
-    const int jj = imax;
-    const int kk = imax*jmax;
+            const double time = master->get_wall_clock_time() - time_start;
+            time_transpose += time;
+            master->add_comm(kind, nprocs, (double)nprocs*typesize, time);
+        }
+        return;
+    }
 
-    for (int n=0; n<master->npx; n++)
-    {
-        // determine where to fetch the data and where to store it
-        const int ijks = n*jj;
-        const int ijkr = n*kblock*kk;
+    // pack the blocks into a contiguous buffer and exchange them in a single collective
+    const int nblock = bsend.ni*bsend.nj*bsend.nk;
 
-        // send and receive the data
-        MPI_Isend(&as[ijks], ncount, transposex, n, tag, master->commx, &master->reqs[master->reqsn]);
-        master->reqsn++;
-        MPI_Irecv(&ar[ijkr], ncount, transposez, n, tag, master->commx, &master->reqs[master->reqsn]);
-        master->reqsn++;
+    // the node-aware transposes pack into the shared memory window
+    double* sendbuf = transpose_sendbuf;
+    double* recvbuf = transpose_recvbuf;
+    if (swtranspose == "shared")
+    {
+        sendbuf = node.segments[node.local[node.rank]];
+        recvbuf = sendbuf + nmax;
     }
-    master->wait_all();
+
+    for (int n=0; n<nprocs; n++)
+        pack_block(&sendbuf[n*nblock], &as[n*bsend.nstride], bsend);
+
+    // only the exchange is accounted as communication, the packing is not
+    const double time_exchange = timed ? master->get_wall_clock_time() : 0.;
+
+    if (swtranspose == "alltoall")
+        MPI_Alltoall(sendbuf, nblock, MPI_DOUBLE, recvbuf, nblock, MPI_DOUBLE, comm);
+    else if (swtranspose == "neighbor")
+        MPI_Neighbor_alltoall(sendbuf, nblock, MPI_DOUBLE, recvbuf, nblock, MPI_DOUBLE, commgraph);
+    else
+        exchange_shared(node, nblock, nmax);
+
+    if (timed)
+        master->add_comm(kind, nprocs, (double)nprocs*nblock*sizeof(double), master->get_wall_clock_time() - time_exchange);
+
+    for (int n=0; n<nprocs; n++)
+        unpack_block(&ar[n*brecv.nstride], &recvbuf[n*nblock], brecv);
+
+    if (timed)
+        time_transpose += master->get_wall_clock_time() - time_start;
 }
 
-void Grid::transpose_xy(double* restrict ar, double* restrict as)
+void Grid::transpose_zx(double* restrict ar, double* restrict as)
 {
-    const int ncount = 1;
-    const int tag = 1;
+    // z-oriented blocks of kblock levels go to x-oriented blocks of imax columns
+    const Transpose_block bz = {kblock*imax*jmax, imax, jmax, kblock, imax, imax*jmax};
+    const Transpose_block bx = {imax            , imax, jmax, kblock, itot, itot*jmax};
 
-    const int jj = iblock;
-    const int kk = iblock*jmax;
+    transpose(ar, as, bz, bx, transposez, transposex, master->commx, commxgraph, nodex, master->npx, Comm_kind::transpose_zx);
+}
 
-    for (int n=0; n<master->npy; n++)
-    {
-        // determine where to fetch the data and where to store it
-        const int ijks = n*jj;
-        const int ijkr = n*kk;
+void Grid::transpose_xz(double* restrict ar, double* restrict as)
+{
+    const Transpose_block bx = {imax            , imax, jmax, kblock, itot, itot*jmax};
+    const Transpose_block bz = {kblock*imax*jmax, imax, jmax, kblock, imax, imax*jmax};
 
-        // send and receive the data
-        MPI_Isend(&as[ijks], ncount, transposex2, n, tag, master->commy, &master->reqs[master->reqsn]);
-        master->reqsn++;
-        MPI_Irecv(&ar[ijkr], ncount, transposey , n, tag, master->commy, &master->reqs[master->reqsn]);
-        master->reqsn++;
-    }
-    master->wait_all();
+    transpose(ar, as, bx, bz, transposex, transposez, master->commx, commxgraph, nodex, master->npx, Comm_kind::transpose_xz);
 }
 
-void Grid::transpose_yx(double* restrict ar, double* restrict as)
+void Grid::transpose_xy(double* restrict ar, double* restrict as)
 {
-    const int ncount = 1;
-    const int tag = 1;
+    // x-oriented blocks of iblock columns go to y-oriented blocks of jmax rows
+    const Transpose_block bx = {iblock     , iblock, jmax, kblock, itot  , itot*jmax  };
+    const Transpose_block by = {iblock*jmax, iblock, jmax, kblock, iblock, iblock*jtot};
 
-    const int jj = iblock;
-    const int kk = iblock*jmax;
+    transpose(ar, as, bx, by, transposex2, transposey, master->commy, commygraph, nodey, master->npy, Comm_kind::transpose_xy);
+}
 
-    for (int n=0; n<master->npy; n++)
-    {
-        // determine where to fetch the data and where to store it
-        const int ijks = n*kk;
-        const int ijkr = n*jj;
+void Grid::transpose_yx(double* restrict ar, double* restrict as)
+{
+    const Transpose_block by = {iblock*jmax, iblock, jmax, kblock, iblock, iblock*jtot};
+    const Transpose_block bx = {iblock     , iblock, jmax, kblock, itot  , itot*jmax  };
 
-        // send and receive the data
-        MPI_Isend(&as[ijks], ncount, transposey , n, tag, master->commy, &master->reqs[master->reqsn]);
-        master->reqsn++;
-        MPI_Irecv(&ar[ijkr], ncount, transposex2, n, tag, master->commy, &master->reqs[master->reqsn]);
-        master->reqsn++;
-    }
-    master->wait_all();
+    transpose(ar, as, by, bx, transposey, transposex2, master->commy, commygraph, nodey, master->npy, Comm_kind::transpose_yx);
 }
 
 void Grid::transpose_yz(double* restrict ar, double* restrict as)
 {
-    const int ncount = 1;
-    const int tag = 1;
+    // y-oriented blocks of jblock rows go to z-oriented blocks of kblock levels
+    const Transpose_block by = {jblock*iblock       , iblock, jblock, kblock, iblock, iblock*jtot  };
+    const Transpose_block bz = {kblock*iblock*jblock, iblock, jblock, kblock, iblock, iblock*jblock};
 
-    const int jj = iblock;
-    const int kk = iblock*jblock;
+    transpose(ar, as, by, bz, transposey2, transposez2, master->commx, commxgraph, nodex, master->npx, Comm_kind::transpose_yz);
+}
 
-    for (int n=0; n<master->npx; n++)
-    {
-        // determine where to fetch the data and where to store it
-        const int ijks = n*jblock*jj;
-        const int ijkr = n*kblock*kk;
+void Grid::transpose_zy(double* restrict ar, double* restrict as)
+{
+    const Transpose_block bz = {kblock*iblock*jblock, iblock, jblock, kblock, iblock, iblock*jblock};
+    const Transpose_block by = {jblock*iblock       , iblock, jblock, kblock, iblock, iblock*jtot  };
 
-        // send and receive the data
-        MPI_Isend(&as[ijks], ncount, transposey2, n, tag, master->commx, &master->reqs[master->reqsn]);
-        master->reqsn++;
-        MPI_Irecv(&ar[ijkr], ncount, transposez2, n, tag, master->commx, &master->reqs[master->reqsn]);
-        master->reqsn++;
-    }
-    master->wait_all();
+    transpose(ar, as, bz, by, transposez2, transposey2, master->commx, commxgraph, nodex, master->npx, Comm_kind::transpose_zy);
 }
 
-void Grid::transpose_zy(double* restrict ar, double* restrict as)
+/**
+ * This function times the cycle of transposes of the pressure solver for each backend
+ * and selects the fastest one.
+ */
+void Grid::benchmark_transposes()
 {
-    const int ncount = 1;
-    const int tag = 1;
+    const int nrepeat = 10;
+    const std::vector<std::string> backends = {"isend", "alltoall", "neighbor", "shared"};
+
+    std::vector<double> a(nmax, 0.);
+    std::vector<double> b(nmax, 0.);
 
-    const int jj = iblock;
-    const int kk = iblock*jblock;
+    std::string backend_best;
+    double time_best = 0.;
 
-    for (int n=0; n<master->npx; n++)
+    master->print_message("Benchmarking the transposes for npx = %d, npy = %d\n", master->npx, master->npy);
+
+    for (std::vector<std::string>::const_iterator it=backends.begin(); it!=backends.end(); ++it)
     {
-        // determine where to fetch the data and where to store it
-        const int ijks = n*kblock*kk;
-        const int ijkr = n*jblock*jj;
+        swtranspose = *it;
 
-        // send and receive the data
-        MPI_Isend(&as[ijks], ncount, transposez2, n, tag, master->commx, &master->reqs[master->reqsn]);
-        master->reqsn++;
-        MPI_Irecv(&ar[ijkr], ncount, transposey2, n, tag, master->commx, &master->reqs[master->reqsn]);
-        master->reqsn++;
+        // the first cycle is not timed, to exclude the setup costs in the MPI library
+        double time_start = 0.;
+        for (int n=0; n<nrepeat+1; ++n)
+        {
+            if (n == 1)
+            {
+                MPI_Barrier(master->commxy);
+                time_start = master->get_wall_clock_time();
+            }
+
+            transpose_zx(b.data(), a.data());
+            transpose_xy(a.data(), b.data());
+            transpose_yz(b.data(), a.data());
+            transpose_zy(a.data(), b.data());
+            transpose_yx(b.data(), a.data());
+            transpose_xz(a.data(), b.data());
+        }
+
+        // the slowest process determines the time
+        double time = (master->get_wall_clock_time() - time_start) / nrepeat;
+        master->max(&time, 1);
+
+        master->print_message("Transpose backend %-8s: %E s per cycle\n", it->c_str(), time);
+
+        if (backend_best.empty() || time < time_best)
+        {
+            backend_best = *it;
+            time_best = time;
+        }
     }
-    master->wait_all();
+
+    swtranspose = backend_best;
+    master->print_message("Selected transpose backend %s\n", swtranspose.c_str());
 }
 
 void Grid::get_max(double *var)
 {
+    const bool timed = master->get_comm_stats();
+    const double time_start = timed ? master->get_wall_clock_time() : 0.;
     double varl = *var;
     MPI_Allreduce(&varl, var, 1, MPI_DOUBLE, MPI_MAX, master->commxy);
+    if (timed)
+        master->add_comm(Comm_kind::grid_reduce, 1, sizeof(double), master->get_wall_clock_time() - time_start);
 }
 
 void Grid::get_max(int *var)
 {
+    const bool timed = master->get_comm_stats();
+    const double time_start = timed ? master->get_wall_clock_time() : 0.;
     int varl = *var;
     MPI_Allreduce(&varl, var, 1, MPI_INT, MPI_MAX, master->commxy);
+    if (timed)
+        master->add_comm(Comm_kind::grid_reduce, 1, sizeof(int), master->get_wall_clock_time() - time_start);
+}
+
+void Grid::get_max(double *var, int n)
+{
+    const bool timed = master->get_comm_stats();
+    const double time_start = timed ? master->get_wall_clock_time() : 0.;
+    MPI_Allreduce(MPI_IN_PLACE, var, n, MPI_DOUBLE, MPI_MAX, master->commxy);
+    if (timed)
+        master->add_comm(Comm_kind::grid_reduce, 1, n*sizeof(double), master->get_wall_clock_time() - time_start);
 }
 
 void Grid::get_sum(double *var)
 {
+    const bool timed = master->get_comm_stats();
+    const double time_start = timed ? master->get_wall_clock_time() : 0.;
     double varl = *var;
     MPI_Allreduce(&varl, var, 1, MPI_DOUBLE, MPI_SUM, master->commxy);
+    if (timed)
+        master->add_comm(Comm_kind::grid_reduce, 1, sizeof(double), master->get_wall_clock_time() - time_start);
 }
 
 void Grid::get_prof(double *prof, int kcellsin)
@@ -464,7 +1096,40 @@ void Grid::get_prof(double *prof, int kcellsin)
     for (int k=0; k<kcellsin; k++)
         profl[k] = prof[k] / master->nprocs;
 
+    const bool timed = master->get_comm_stats();
+    const double time_start = timed ? master->get_wall_clock_time() : 0.;
     MPI_Allreduce(profl, prof, kcellsin, MPI_DOUBLE, MPI_SUM, master->commxy);
+    if (timed)
+        master->add_comm(Comm_kind::prof, 1, kcellsin*sizeof(double), master->get_wall_clock_time() - time_start);
+}
+
+void Grid::share_fftw_wisdom()
+{
+    if (master->nmembers == 1)
+        return;
+
+    // each process receives the wisdom of the process with the same rank in the first member
+    char* wisdom = 0;
+    int length = 0;
+    if (master->member == 0)
+    {
+        wisdom = fftw_export_wisdom_to_string();
+        length = std::strlen(wisdom) + 1;
+    }
+
+    MPI_Bcast(&length, 1, MPI_INT, 0, master->commens);
+
+    std::vector<char> buffer(length);
+    if (master->member == 0)
+    {
+        std::memcpy(buffer.data(), wisdom, length);
+        std::free(wisdom);
+    }
+
+    MPI_Bcast(buffer.data(), length, MPI_CHAR, 0, master->commens);
+
+    if (master->member != 0)
+        fftw_import_wisdom_from_string(buffer.data());
 }
 
 // IO functions
@@ -525,45 +1190,7 @@ void Grid::save()
     master->print_message("OK\n");
 
     // SAVE THE FFTW PLAN IN ORDER TO ENSURE BITWISE IDENTICAL RESTARTS
-    // use the FFTW3 many interface in order to reduce function call overhead
-    int rank = 1;
-    int ni[] = {itot};
-    int nj[] = {jtot};
-    int istride = 1;
-    int jstride = iblock;
-    int idist = itot;
-    int jdist = 1;
-
-    fftw_r2r_kind kindf[] = {FFTW_R2HC};
-    fftw_r2r_kind kindb[] = {FFTW_HC2R};
-
-    iplanf = fftw_plan_many_r2r(rank, ni, jmax, fftini, ni, istride, idist,
-                                fftouti, ni, istride, idist, kindf, FFTW_EXHAUSTIVE);
-    iplanb = fftw_plan_many_r2r(rank, ni, jmax, fftini, ni, istride, idist,
-                                fftouti, ni, istride, idist, kindb, FFTW_EXHAUSTIVE);
-    jplanf = fftw_plan_many_r2r(rank, nj, iblock, fftinj, nj, jstride, jdist,
-                                fftoutj, nj, jstride, jdist, kindf, FFTW_EXHAUSTIVE);
-    jplanb = fftw_plan_many_r2r(rank, nj, iblock, fftinj, nj, jstride, jdist,
-                                fftoutj, nj, jstride, jdist, kindb, FFTW_EXHAUSTIVE);
-
-    fftwplan = true;
-
-    if (master->mpiid == 0)
-    {
-        char filename[256];
-        std::sprintf(filename, "%s.%07d", "fftwplan", 0);
-
-        master->print_message("Saving \"%s\" ... ", filename);
-
-        int n = fftw_export_wisdom_to_filename(filename);
-        if (n == 0)
-        {
-            master->print_error("\"%s\" cannot be saved\n", filename);
-            throw 1;
-        }
-        else
-            master->print_message("OK\n");
-    }
+    save_fftw_plans();
 }
 
 void Grid::load()
@@ -575,6 +1202,10 @@ void Grid::load()
     std::sprintf(filename, "%s.%07d", "grid", 0);
     if (master->mpiid == 0) std::printf("Loading \"%s\" ... ", filename);
 
+    // the grid file contains x, xh, y, yh, z and zh
+    const long long expected = 2*(itot+jtot+ktot)*static_cast<long long>(sizeof(double));
+    long long size = expected;
+
     FILE *pFile;
     if (master->mpiid == 0)
     {
@@ -583,6 +1214,11 @@ void Grid::load()
         {
             ++nerror;
         }
+        else if ((size = get_file_size(pFile)) != expected)
+        {
+            fclose(pFile);
+            ++nerror;
+        }
         else
         {
             int n = (2*itot+2*jtot)*sizeof(double);
@@ -598,6 +1234,10 @@ void Grid::load()
     if (nerror)
     {
         master->print_message("FAILED\n");
+        // only the main process knows the size, which is the one that prints the error
+        if (size != expected)
+            master->print_error("\"%s\" has %lld bytes, %lld are expected for itot = %d, jtot = %d and ktot = %d\n",
+                                filename, size, expected, itot, jtot, ktot);
         throw 1;
     }
     else
@@ -610,44 +1250,11 @@ void Grid::load()
     calculate();
 
     // LOAD THE FFTW PLAN
-    std::sprintf(filename, "%s.%07d", "fftwplan", 0);
-
-    master->print_message("Loading \"%s\" ... ", filename);
-
-    int n = fftw_import_wisdom_from_filename(filename);
-    if (n == 0)
-    {
-        master->print_message("FAILED\n");
-        throw 1;
-    }
-    else
-        master->print_message("OK\n");
-
-    // use the FFTW3 many interface in order to reduce function call overhead
-    int rank = 1;
-    int ni[] = {itot};
-    int nj[] = {jtot};
-    int istride = 1;
-    int jstride = iblock;
-    int idist = itot;
-    int jdist = 1;
-    fftw_r2r_kind kindf[] = {FFTW_R2HC};
-    fftw_r2r_kind kindb[] = {FFTW_HC2R};
-    iplanf = fftw_plan_many_r2r(rank, ni, jmax, fftini, ni, istride, idist,
-                                fftouti, ni, istride, idist, kindf, FFTW_EXHAUSTIVE);
-    iplanb = fftw_plan_many_r2r(rank, ni, jmax, fftini, ni, istride, idist,
-                                fftouti, ni, istride, idist, kindb, FFTW_EXHAUSTIVE);
-    jplanf = fftw_plan_many_r2r(rank, nj, iblock, fftinj, nj, jstride, jdist,
-                                fftoutj, nj, jstride, jdist, kindf, FFTW_EXHAUSTIVE);
-    jplanb = fftw_plan_many_r2r(rank, nj, iblock, fftinj, nj, jstride, jdist,
-                                fftoutj, nj, jstride, jdist, kindb, FFTW_EXHAUSTIVE);
-
-    fftwplan = true;
-
-    fftw_forget_wisdom();
+    load_fftw_plans();
 }
 
-int Grid::save_field3d(double* restrict data, double* restrict tmp1, double* restrict tmp2, char* filename, double offset)
+int Grid::save_field3d(double* restrict data, double* restrict tmp1, double* restrict tmp2, char* filename, double offset,
+                       const Encoding::Format& format)
 {
     // save the data in transposed order to have large chunks of contiguous disk space
     // MPI-IO is not stable on Juqueen and supermuc otherwise
@@ -670,38 +1277,172 @@ int Grid::save_field3d(double* restrict data, double* restrict tmp1, double* res
                 tmp1[ijkb] = data[ijk] + offset;
             }
 
+    // encoded fields are written per process in contiguous blocks, which does not require the transpose
+    if (!Encoding::is_raw(format))
+    {
+        std::shared_ptr<std::vector<double>> field = std::make_shared<std::vector<double>>(tmp1, tmp1+count);
+        const std::string file(filename);
+
+        return exec_output([this, field, file, format]()
+        {
+            Encoding::Block block = {{master->mpicoordx*imax, master->mpicoordy*jmax, 0}, {imax, jmax, kmax}};
+            return write_encoded(master->commxyio, file, field->data(), block, format, itot, jtot, ktot);
+        }, file);
+    }
+
     transpose_zx(tmp2, tmp1);
 
-    MPI_File fh;
-    if (MPI_File_open(master->commxy, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY | MPI_MODE_EXCL, MPI_INFO_NULL, &fh))
-        return 1;
+    // copy the transposed data, such that it can be written while the model continues
+    std::shared_ptr<std::vector<double>> field = std::make_shared<std::vector<double>>(tmp2, tmp2+count);
+    const std::string file(filename);
 
-    // select noncontiguous part of 3d array to store the selected data
-    MPI_Offset fileoff = 0; // the offset within the file (header size)
-    char name[] = "native";
+    return exec_output([this, field, file]()
+    {
+        MPI_File fh;
+        if (MPI_File_open(master->commxyio, const_cast<char*>(file.c_str()), MPI_MODE_CREATE | MPI_MODE_WRONLY | MPI_MODE_EXCL, MPI_INFO_NULL, &fh))
+            return 1;
 
-    if (MPI_File_set_view(fh, fileoff, MPI_DOUBLE, subarray, name, MPI_INFO_NULL))
-        return 1;
+        // select noncontiguous part of 3d array to store the selected data
+        MPI_Offset fileoff = 0; // the offset within the file (header size)
+        char name[] = "native";
 
-    if (MPI_File_write_all(fh, tmp2, count, MPI_DOUBLE, MPI_STATUS_IGNORE))
-        return 1;
+        if (MPI_File_set_view(fh, fileoff, MPI_DOUBLE, subarray, name, MPI_INFO_NULL))
+            return 1;
 
-    if (MPI_File_close(&fh))
+        if (MPI_File_write_all(fh, field->data(), field->size(), MPI_DOUBLE, MPI_STATUS_IGNORE))
+            return 1;
+
+        if (MPI_File_close(&fh))
+            return 1;
+
+        return 0;
+    }, file);
+}
+
+/**
+ * This function saves a region of a 3d field, taking every stride-th point of the region in each direction.
+ * Every process writes its own part of the region through a subarray view of the file, which does not
+ * require a transpose. Processes that own no part of the region take part in the collective write without data.
+ */
+int Grid::save_field3d(double* restrict data, char* filename, double offset, const Field3d_region& region,
+                       const Encoding::Format& format)
+{
+    std::shared_ptr<std::vector<double>> field = std::make_shared<std::vector<double>>();
+
+    int start[3], count[3], total[3];
+    pack_region(*field, data, offset, region, start, count, total);
+
+    const std::string file(filename);
+
+    if (!Encoding::is_raw(format))
+    {
+        Encoding::Block block = {{start[0], start[1], start[2]}, {count[0], count[1], count[2]}};
+        const int ni = total[0], nj = total[1], nk = total[2];
+
+        return exec_output([this, field, file, block, format, ni, nj, nk]() mutable
+        {
+            return write_encoded(master->commxyio, file, field->data(), block, format, ni, nj, nk);
+        }, file);
+    }
+
+    // the subarray is in C order, with z as the slowest index
+    const int sizes   [3] = {total[2], total[1], total[0]};
+    const int subsizes[3] = {count[2], count[1], count[0]};
+    const int starts  [3] = {start[2], start[1], start[0]};
+
+    return exec_output([this, field, file, sizes, subsizes, starts]()
+    {
+        MPI_File fh;
+        if (MPI_File_open(master->commxyio, const_cast<char*>(file.c_str()), MPI_MODE_CREATE | MPI_MODE_WRONLY | MPI_MODE_EXCL, MPI_INFO_NULL, &fh))
+            return 1;
+
+        int nerror = 0;
+        char name[] = "native";
+
+        if (field->empty())
+        {
+            if (MPI_File_set_view(fh, 0, MPI_DOUBLE, MPI_DOUBLE, name, MPI_INFO_NULL))
+                ++nerror;
+        }
+        else
+        {
+            MPI_Datatype subregion;
+            MPI_Type_create_subarray(3, sizes, subsizes, starts, MPI_ORDER_C, MPI_DOUBLE, &subregion);
+            MPI_Type_commit(&subregion);
+
+            if (MPI_File_set_view(fh, 0, MPI_DOUBLE, subregion, name, MPI_INFO_NULL))
+                ++nerror;
+
+            MPI_Type_free(&subregion);
+        }
+
+        if (MPI_File_write_all(fh, field->data(), field->size(), MPI_DOUBLE, MPI_STATUS_IGNORE))
+            ++nerror;
+
+        if (MPI_File_close(&fh))
+            ++nerror;
+
+        return nerror;
+    }, file);
+}
+
+int Grid::load_field3d(double* restrict data, double* restrict tmp1, double* restrict tmp2, char* filename, double offset)
+{
+    if (read_field3d(tmp1, filename, master->commxy))
         return 1;
 
+    unpack_field3d(data, tmp1, tmp2, offset);
+
     return 0;
 }
 
-int Grid::load_field3d(double* restrict data, double* restrict tmp1, double* restrict tmp2, char* filename, double offset)
+/**
+ * This function starts reading a 3d field into a buffer, which is done by the output thread if it runs.
+ * The buffer is unpacked into the field with load_field3d.
+ */
+void Grid::prefetch_field3d(std::shared_ptr<Prefetch_buffer> buffer, const std::string& filename)
+{
+    buffer->data.resize(imax*jmax*kmax);
+    buffer->filename = filename;
+    buffer->nerror   = 0;
+    buffer->readtime = 0.;
+
+    buffer->job = exec_input([this, buffer]()
+    {
+        const double start = master->get_wall_clock_time();
+        buffer->nerror = read_field3d(buffer->data.data(), buffer->filename.c_str(), master->commxyio);
+        buffer->readtime = master->get_wall_clock_time() - start;
+        return 0;
+    });
+}
+
+int Grid::read_field3d(double* restrict buffer, const char* filename, MPI_Comm comm)
 {
     // save the data in transposed order to have large chunks of contiguous disk space
     // MPI-IO is not stable on Juqueen and supermuc otherwise
 
     // read the file
     MPI_File fh;
-    if (MPI_File_open(master->commxy, filename, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh))
+    if (MPI_File_open(comm, const_cast<char*>(filename), MPI_MODE_RDONLY, MPI_INFO_NULL, &fh))
         return 1;
 
+    // the file layout does not depend on the decomposition, but its size has to match the grid
+    MPI_Offset size;
+    if (MPI_File_get_size(fh, &size))
+    {
+        MPI_File_close(&fh);
+        return 1;
+    }
+
+    const MPI_Offset expected = static_cast<MPI_Offset>(itot)*jtot*ktot*sizeof(double);
+    if (size != expected)
+    {
+        master->print_error("\"%s\" has %lld bytes, %lld are expected for itot = %d, jtot = %d and ktot = %d\n",
+                            filename, static_cast<long long>(size), static_cast<long long>(expected), itot, jtot, ktot);
+        MPI_File_close(&fh);
+        return 1;
+    }
+
     // select noncontiguous part of 3d array to store the selected data
     MPI_Offset fileoff = 0; // the offset within the file (header size)
     char name[] = "native";
@@ -710,14 +1451,19 @@ int Grid::load_field3d(double* restrict data, double* restrict tmp1, double* res
     // extract the data from the 3d field without the ghost cells
     int count = imax*jmax*kmax;
 
-    if (MPI_File_read_all(fh, tmp1, count, MPI_DOUBLE, MPI_STATUS_IGNORE))
+    if (MPI_File_read_all(fh, buffer, count, MPI_DOUBLE, MPI_STATUS_IGNORE))
         return 1;
 
     if (MPI_File_close(&fh))
         return 1;
 
+    return 0;
+}
+
+void Grid::unpack_field3d(double* restrict data, double* restrict buffer, double* restrict tmp, double offset)
+{
     // transpose the data back
-    transpose_xz(tmp2, tmp1);
+    transpose_xz(tmp, buffer);
 
     const int jj  = icells;
     const int kk  = icells*jcells;
@@ -731,10 +1477,8 @@ int Grid::load_field3d(double* restrict data, double* restrict tmp1, double* res
             {
                 const int ijk  = i+igc + (j+jgc)*jj + (k+kgc)*kk;
                 const int ijkb = i + j*jjb + k*kkb;
-                data[ijk] = tmp2[ijkb] - offset;
+                data[ijk] = tmp[ijkb] - offset;
             }
-
-    return 0;
 }
 
 void Grid::fft_forward(double* restrict data,   double* restrict tmp1,
@@ -863,11 +1607,92 @@ void Grid::fft_backward(double* restrict data,   double* restrict tmp1,
     transpose_xz(tmp1, data);
 }
 
-int Grid::save_xz_slice(double* restrict data, double* restrict tmp, char* filename, int jslice)
+/**
+ * This function appends a slice to a container file and adds it to the time index. The container is
+ * opened at the first write and kept open, such that later writes only write data at computed offsets.
+ * It is only called from output jobs, which are executed in the same order by all processes of comm.
+ * @param filename Name of the container file.
+ * @param comm Communicator of the processes that write the slice.
+ * @param iotime Output time of the slice.
+ * @param write Function that writes the slice at the given offset and returns its size in bytes.
+ * @return Number of errors.
+ */
+int Grid::append_container(const std::string& filename, MPI_Comm comm, const int iotime,
+                           std::function<int(MPI_File, MPI_Offset, long long*)> write)
 {
-    // extract the data from the 3d field without the ghost cells
-    int nerror=0;
+    std::map<std::string, Output_container>::iterator it = containers.find(filename);
+    if (it == containers.end())
+    {
+        Output_container container;
+        if (open_container(container, comm, filename))
+            return 1;
+        it = containers.insert(std::make_pair(filename, container)).first;
+    }
+
+    Output_container& c = it->second;
+
+    int rank;
+    MPI_Comm_rank(comm, &rank);
 
+    int nerror = 0;
+
+    // start a new index table at the end of the file if the current one is full
+    if (c.nentries == c.capacity)
+    {
+        const long long table = c.end;
+        if (rank == 0)
+        {
+            std::vector<unsigned char> empty(Container::table_size(c.capacity), 0);
+            if (MPI_File_write_at(c.fh, table, empty.data(), empty.size(), MPI_BYTE, MPI_STATUS_IGNORE))
+                ++nerror;
+
+            unsigned char next[sizeof(long long)];
+            std::memcpy(next, &table, sizeof(long long));
+            if (MPI_File_write_at(c.fh, c.table, next, sizeof(long long), MPI_BYTE, MPI_STATUS_IGNORE))
+                ++nerror;
+        }
+
+        c.table     = table;
+        c.nentries  = 0;
+        c.end      += Container::table_size(c.capacity);
+    }
+
+    // write the slice at the end of the file and restore the byte view for the index
+    long long nbytes = 0;
+    nerror += write(c.fh, c.end, &nbytes);
+
+    char name[] = "native";
+    MPI_File_set_view(c.fh, 0, MPI_BYTE, MPI_BYTE, name, MPI_INFO_NULL);
+
+    // the slice becomes visible for readers once it is added to the index
+    if (rank == 0)
+    {
+        unsigned char entry[Container::entry_size];
+        Container::pack_entry(entry, iotime, c.end, nbytes);
+
+        const MPI_Offset entryoff = c.table + sizeof(long long) + c.nentries*Container::entry_size;
+        if (MPI_File_write_at(c.fh, entryoff, entry, Container::entry_size, MPI_BYTE, MPI_STATUS_IGNORE))
+            ++nerror;
+    }
+
+    ++c.nentries;
+    c.end += nbytes;
+
+    return nerror;
+}
+
+void Grid::close_containers()
+{
+    for (std::map<std::string, Output_container>::iterator it=containers.begin(); it!=containers.end(); ++it)
+        MPI_File_close(&it->second.fh);
+
+    containers.clear();
+}
+
+int Grid::save_xz_slice(double* restrict data, double* restrict tmp, char* filename, int jslice,
+                        const Encoding::Format& format, int iotime)
+{
+    // extract the data from the 3d field without the ghost cells
     const int jj  = icells;
     const int kk  = icells*jcells;
     const int kkb = imax;
@@ -884,46 +1709,68 @@ int Grid::save_xz_slice(double* restrict data, double* restrict tmp, char* filen
             tmp[ijkb] = data[ijk];
         }
 
-    if (master->mpicoordy == jslice/jmax)
+    // copy the slice, such that it can be written while the model continues
+    std::shared_ptr<std::vector<double>> slice = std::make_shared<std::vector<double>>(tmp, tmp+count);
+    const std::string file(filename);
+    const bool has_slice = master->mpicoordy == jslice/jmax;
+
+    return exec_output([this, slice, file, has_slice, format, iotime]()
     {
-        MPI_File fh;
-        if (MPI_File_open(master->commx, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY | MPI_MODE_EXCL, MPI_INFO_NULL, &fh))
-            ++nerror;
+        int nerror = 0;
 
-        // select noncontiguous part of 3d array to store the selected data
-        MPI_Offset fileoff = 0; // the offset within the file (header size)
-        char name[] = "native";
+        Encoding::Block block = {{master->mpicoordx*imax, 0, 0}, {imax, 1, kmax}};
 
-        if (!nerror)
-            if (MPI_File_set_view(fh, fileoff, MPI_DOUBLE, subxzslice, name, MPI_INFO_NULL))
-                ++nerror;
+        if (has_slice && iotime >= 0)
+        {
+            nerror += append_container(file, master->commxio, iotime, [&](MPI_File fh, MPI_Offset offset, long long* size)
+            {
+                if (!Encoding::is_raw(format))
+                    return write_encoded_at(fh, master->commxio, offset, slice->data(), block, format, itot, 1, ktot, size);
 
-        // only write at the procs that contain the slice
-        if (!nerror)
-            if (MPI_File_write_all(fh, tmp, count, MPI_DOUBLE, MPI_STATUS_IGNORE))
+                *size = static_cast<long long>(itot)*ktot*sizeof(double);
+                return write_slice_at(fh, offset, subxzslice, *slice);
+            });
+        }
+        else if (has_slice && !Encoding::is_raw(format))
+            nerror += write_encoded(master->commxio, file, slice->data(), block, format, itot, 1, ktot);
+        else if (has_slice)
+        {
+            MPI_File fh;
+            if (MPI_File_open(master->commxio, const_cast<char*>(file.c_str()), MPI_MODE_CREATE | MPI_MODE_WRONLY | MPI_MODE_EXCL, MPI_INFO_NULL, &fh))
                 ++nerror;
 
-        if (!nerror)
-            MPI_File_sync(fh);
+            // select noncontiguous part of 3d array to store the selected data
+            MPI_Offset fileoff = 0; // the offset within the file (header size)
+            char name[] = "native";
 
-        if (!nerror)
-            if (MPI_File_close(&fh))
-                ++nerror;
-    }
+            if (!nerror)
+                if (MPI_File_set_view(fh, fileoff, MPI_DOUBLE, subxzslice, name, MPI_INFO_NULL))
+                    ++nerror;
 
-    // Gather errors from other processes
-    master->sum(&nerror,1);
+            // only write at the procs that contain the slice
+            if (!nerror)
+                if (MPI_File_write_all(fh, slice->data(), slice->size(), MPI_DOUBLE, MPI_STATUS_IGNORE))
+                    ++nerror;
 
-    MPI_Barrier(master->commxy);
+            if (!nerror)
+                MPI_File_sync(fh);
 
-    return nerror;
+            if (!nerror)
+                if (MPI_File_close(&fh))
+                    ++nerror;
+        }
+
+        // Gather errors from other processes
+        MPI_Allreduce(MPI_IN_PLACE, &nerror, 1, MPI_INT, MPI_SUM, master->commxyio);
+
+        return nerror;
+    }, file);
 }
 
-int Grid::save_yz_slice(double* restrict data, double* restrict tmp, char* filename, int islice)
+int Grid::save_yz_slice(double* restrict data, double* restrict tmp, char* filename, int islice,
+                        const Encoding::Format& format, int iotime)
 {
     // extract the data from the 3d field without the ghost cells
-    int nerror=0;
-
     const int jj = icells;
     const int kk = ijcells;
 
@@ -942,42 +1789,66 @@ int Grid::save_yz_slice(double* restrict data, double* restrict tmp, char* filen
             tmp[ijkb] = data[ijk];
         }
 
-    if (master->mpicoordx == islice/imax)
+    // copy the slice, such that it can be written while the model continues
+    std::shared_ptr<std::vector<double>> slice = std::make_shared<std::vector<double>>(tmp, tmp+count);
+    const std::string file(filename);
+    const bool has_slice = master->mpicoordx == islice/imax;
+
+    return exec_output([this, slice, file, has_slice, format, iotime]()
     {
-        MPI_File fh;
-        if (MPI_File_open(master->commy, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY | MPI_MODE_EXCL, MPI_INFO_NULL, &fh))
-            ++nerror;
+        int nerror = 0;
 
-        // select noncontiguous part of 3d array to store the selected data
-        MPI_Offset fileoff = 0; // the offset within the file (header size)
-        char name[] = "native";
+        Encoding::Block block = {{0, master->mpicoordy*jmax, 0}, {1, jmax, kmax}};
 
-        if (!nerror)
-            if (MPI_File_set_view(fh, fileoff, MPI_DOUBLE, subyzslice, name, MPI_INFO_NULL))
-                ++nerror;
+        if (has_slice && iotime >= 0)
+        {
+            nerror += append_container(file, master->commyio, iotime, [&](MPI_File fh, MPI_Offset offset, long long* size)
+            {
+                if (!Encoding::is_raw(format))
+                    return write_encoded_at(fh, master->commyio, offset, slice->data(), block, format, 1, jtot, ktot, size);
 
-        // only write at the procs that contain the slice
-        if (!nerror)
-            if (MPI_File_write_all(fh, tmp, count, MPI_DOUBLE, MPI_STATUS_IGNORE))
+                *size = static_cast<long long>(jtot)*ktot*sizeof(double);
+                return write_slice_at(fh, offset, subyzslice, *slice);
+            });
+        }
+        else if (has_slice && !Encoding::is_raw(format))
+            nerror += write_encoded(master->commyio, file, slice->data(), block, format, 1, jtot, ktot);
+        else if (has_slice)
+        {
+            MPI_File fh;
+            if (MPI_File_open(master->commyio, const_cast<char*>(file.c_str()), MPI_MODE_CREATE | MPI_MODE_WRONLY | MPI_MODE_EXCL, MPI_INFO_NULL, &fh))
                 ++nerror;
 
-        if (!nerror)
-            MPI_File_sync(fh);
+            // select noncontiguous part of 3d array to store the selected data
+            MPI_Offset fileoff = 0; // the offset within the file (header size)
+            char name[] = "native";
 
-        if (!nerror)
-            if (MPI_File_close(&fh))
-                ++nerror;
-    }
+            if (!nerror)
+                if (MPI_File_set_view(fh, fileoff, MPI_DOUBLE, subyzslice, name, MPI_INFO_NULL))
+                    ++nerror;
 
-    // Gather errors from other processes
-    master->sum(&nerror,1);
+            // only write at the procs that contain the slice
+            if (!nerror)
+                if (MPI_File_write_all(fh, slice->data(), slice->size(), MPI_DOUBLE, MPI_STATUS_IGNORE))
+                    ++nerror;
 
-    MPI_Barrier(master->commxy);
+            if (!nerror)
+                MPI_File_sync(fh);
 
-    return nerror;
+            if (!nerror)
+                if (MPI_File_close(&fh))
+                    ++nerror;
+        }
+
+        // Gather errors from other processes
+        MPI_Allreduce(MPI_IN_PLACE, &nerror, 1, MPI_INT, MPI_SUM, master->commxyio);
+
+        return nerror;
+    }, file);
 }
 
-int Grid::save_xy_slice(double* restrict data, double* restrict tmp, char* filename, int kslice)
+int Grid::save_xy_slice(double* restrict data, double* restrict tmp, char* filename, int kslice,
+                        const Encoding::Format& format, int iotime)
 {
     // extract the data from the 3d field without the ghost cells
     const int jj  = icells;
@@ -1000,29 +1871,53 @@ int Grid::save_xy_slice(double* restrict data, double* restrict tmp, char* filen
             tmp[ijkb] = data[ijk];
         }
 
-    MPI_File fh;
-    if (MPI_File_open(master->commxy, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY | MPI_MODE_EXCL, MPI_INFO_NULL, &fh))
-        return 1;
+    // copy the slice, such that it can be written while the model continues
+    std::shared_ptr<std::vector<double>> slice = std::make_shared<std::vector<double>>(tmp, tmp+count);
+    const std::string file(filename);
 
-    // select noncontiguous part of 3d array to store the selected data
-    MPI_Offset fileoff = 0; // the offset within the file (header size)
-    char name[] = "native";
+    return exec_output([this, slice, file, format, iotime]()
+    {
+        Encoding::Block block = {{master->mpicoordx*imax, master->mpicoordy*jmax, 0}, {imax, jmax, 1}};
 
-    if (MPI_File_set_view(fh, fileoff, MPI_DOUBLE, subxyslice, name, MPI_INFO_NULL))
-        return 1;
+        if (iotime >= 0)
+        {
+            return append_container(file, master->commxyio, iotime, [&](MPI_File fh, MPI_Offset offset, long long* size)
+            {
+                if (!Encoding::is_raw(format))
+                    return write_encoded_at(fh, master->commxyio, offset, slice->data(), block, format, itot, jtot, 1, size);
 
-    // only write at the procs that contain the slice
-    if (MPI_File_write_all(fh, tmp, count, MPI_DOUBLE, MPI_STATUS_IGNORE))
-        return 1;
+                *size = static_cast<long long>(itot)*jtot*sizeof(double);
+                return write_slice_at(fh, offset, subxyslice, *slice);
+            });
+        }
 
-    MPI_File_sync(fh);
+        if (!Encoding::is_raw(format))
+            return write_encoded(master->commxyio, file, slice->data(), block, format, itot, jtot, 1);
 
-    if (MPI_File_close(&fh))
-        return 1;
+        MPI_File fh;
+        if (MPI_File_open(master->commxyio, const_cast<char*>(file.c_str()), MPI_MODE_CREATE | MPI_MODE_WRONLY | MPI_MODE_EXCL, MPI_INFO_NULL, &fh))
+            return 1;
 
-    MPI_Barrier(master->commxy);
+        // select noncontiguous part of 3d array to store the selected data
+        MPI_Offset fileoff = 0; // the offset within the file (header size)
+        char name[] = "native";
 
-    return 0;
+        if (MPI_File_set_view(fh, fileoff, MPI_DOUBLE, subxyslice, name, MPI_INFO_NULL))
+            return 1;
+
+        // only write at the procs that contain the slice
+        if (MPI_File_write_all(fh, slice->data(), slice->size(), MPI_DOUBLE, MPI_STATUS_IGNORE))
+            return 1;
+
+        MPI_File_sync(fh);
+
+        if (MPI_File_close(&fh))
+            return 1;
+
+        MPI_Barrier(master->commxyio);
+
+        return 0;
+    }, file);
 }
 
 int Grid::load_xy_slice(double* restrict data, double* restrict tmp, char* filename, int kslice)
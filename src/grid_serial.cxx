@@ -23,10 +23,136 @@
 #ifndef USEMPI
 #include <fftw3.h>
 #include <cstdio>
+#include <cstring>
+#include <memory>
 #include "master.h"
 #include "grid.h"
 #include "defines.h"
 
+namespace
+{
+    // Check whether an opened file holds exactly n doubles, the position is reset to the start.
+    long long get_file_size(FILE* file)
+    {
+        std::fseek(file, 0, SEEK_END);
+        const long long size = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+        return size;
+    }
+
+    // Write a buffer to a new file.
+    int write_buffer(const std::string& filename, const std::vector<double>& buffer)
+    {
+        FILE *pFile;
+        pFile = fopen(filename.c_str(), "wbx");
+        if (pFile == NULL)
+            return 1;
+
+        fwrite(buffer.data(), sizeof(double), buffer.size(), pFile);
+        fclose(pFile);
+
+        return 0;
+    }
+
+    // Store a buffer as it is written to disk, which is a single encoded block or plain doubles.
+    int encode_buffer(std::vector<unsigned char>& bytes, const std::vector<double>& buffer,
+                      const Encoding::Format& format, const int itot, const int jtot, const int ktot)
+    {
+        if (Encoding::is_raw(format))
+        {
+            const unsigned char* raw = reinterpret_cast<const unsigned char*>(buffer.data());
+            bytes.assign(raw, raw + buffer.size()*sizeof(double));
+            return 0;
+        }
+
+        Encoding::Block block = {{0, 0, 0}, {itot, jtot, ktot}};
+        if (Encoding::encode_block(block, buffer.data(), format))
+            return 1;
+
+        bytes.resize(Encoding::header_size + Encoding::record_size);
+        Encoding::pack_header(bytes.data(), format, itot, jtot, ktot, 1);
+        Encoding::pack_record(&bytes[Encoding::header_size], block);
+        bytes.insert(bytes.end(), block.data.begin(), block.data.end());
+
+        return 0;
+    }
+
+    // Encode a buffer as a single block and write it to a new file.
+    int write_encoded(const std::string& filename, const std::vector<double>& buffer,
+                      const Encoding::Format& format, const int itot, const int jtot, const int ktot)
+    {
+        std::vector<unsigned char> bytes;
+        if (encode_buffer(bytes, buffer, format, itot, jtot, ktot))
+            return 1;
+
+        FILE *pFile;
+        pFile = fopen(filename.c_str(), "wbx");
+        if (pFile == NULL)
+            return 1;
+
+        fwrite(bytes.data(), 1, bytes.size(), pFile);
+        fclose(pFile);
+
+        return 0;
+    }
+
+    // Open a container file. A new container gets a header and an empty index table, an existing
+    // container is continued after the last entry of its last index table.
+    int open_container(Output_container& c, const std::string& filename)
+    {
+        c.fh = fopen(filename.c_str(), "r+b");
+
+        if (c.fh == NULL)
+        {
+            c.fh = fopen(filename.c_str(), "w+b");
+            if (c.fh == NULL)
+                return 1;
+
+            c.capacity = Container::capacity;
+            c.nentries = 0;
+            c.table    = Container::header_size;
+            c.end      = c.table + Container::table_size(c.capacity);
+
+            std::vector<unsigned char> header(c.end, 0);
+            Container::pack_header(header.data(), c.capacity);
+            fwrite(header.data(), 1, header.size(), c.fh);
+
+            return 0;
+        }
+
+        unsigned char header[Container::header_size];
+        if (fread(header, 1, Container::header_size, c.fh) != Container::header_size
+                || Container::unpack_header(header, &c.capacity))
+        {
+            fclose(c.fh);
+            return 1;
+        }
+
+        // follow the chain of index tables to the last one
+        std::vector<unsigned char> table(Container::table_size(c.capacity));
+        c.table = Container::header_size;
+        while (true)
+        {
+            fseek(c.fh, c.table, SEEK_SET);
+            if (fread(table.data(), 1, table.size(), c.fh) != table.size())
+            {
+                fclose(c.fh);
+                return 1;
+            }
+
+            const long long next = Container::unpack_table(table.data(), c.capacity, &c.nentries);
+            if (next == 0)
+                break;
+            c.table = next;
+        }
+
+        fseek(c.fh, 0, SEEK_END);
+        c.end = ftell(c.fh);
+
+        return 0;
+    }
+}
+
 // MPI functions
 void Grid::init_mpi()
 {
@@ -110,6 +236,44 @@ void Grid::boundary_cyclic(double* restrict data, Edge edge)
     }
 }
 
+void Grid::boundary_cyclic(unsigned char* restrict data)
+{
+    const int jj = icells;
+    const int kk = icells*jcells;
+
+    // first, east west boundaries
+    for (int k=0; k<kcells; k++)
+        for (int j=0; j<jcells; j++)
+#pragma ivdep
+            for (int i=0; i<igc; i++)
+            {
+                const int ijk0 = i          + j*jj + k*kk;
+                const int ijk1 = iend-igc+i + j*jj + k*kk;
+                data[ijk0] = data[ijk1];
+                data[ijk0+iend] = data[ijk0+istart];
+            }
+
+    // second, north south boundaries, in case of 2D fill the ghost cells with the current value
+    for (int k=0; k<kcells; k++)
+        for (int j=0; j<jgc; j++)
+#pragma ivdep
+            for (int i=0; i<icells; i++)
+            {
+                const int ijksouth = i + j*jj        + k*kk;
+                const int ijknorth = i + (jend+j)*jj + k*kk;
+                if (jtot > 1)
+                {
+                    data[ijksouth] = data[i + (jend-jgc+j)*jj + k*kk];
+                    data[ijknorth] = data[i + (jstart+j  )*jj + k*kk];
+                }
+                else
+                {
+                    data[ijksouth] = data[i + jstart*jj + k*kk];
+                    data[ijknorth] = data[i + jstart*jj + k*kk];
+                }
+            }
+}
+
 void Grid::boundary_cyclic_2d(double* restrict data)
 {
     const int jj = icells;
@@ -261,6 +425,10 @@ void Grid::transpose_zy(double* restrict ar, double* restrict as)
             }
 }
 
+void Grid::benchmark_transposes()
+{
+}
+
 void Grid::get_max(double *var)
 {
 }
@@ -269,6 +437,10 @@ void Grid::get_max(int *var)
 {
 }
 
+void Grid::get_max(double *var, int n)
+{
+}
+
 void Grid::get_sum(double *var)
 {
 }
@@ -277,6 +449,10 @@ void Grid::get_prof(double *prof, int kcellsin)
 {
 }
 
+void Grid::share_fftw_wisdom()
+{
+}
+
 // IO functions
 void Grid::save()
 {
@@ -304,43 +480,7 @@ void Grid::save()
     fclose(pFile);
 
     // SAVE THE FFTW PLAN IN ORDER TO ENSURE BITWISE IDENTICAL RESTARTS
-    // use the FFTW3 many interface in order to reduce function call overhead
-    int rank = 1;
-    int ni[] = {itot};
-    int nj[] = {jtot};
-    int istride = 1;
-    int jstride = iblock;
-    int idist = itot;
-    int jdist = 1;
-    fftw_r2r_kind kindf[] = {FFTW_R2HC};
-    fftw_r2r_kind kindb[] = {FFTW_HC2R};
-    iplanf = fftw_plan_many_r2r(rank, ni, jmax, fftini, ni, istride, idist,
-                                fftouti, ni, istride, idist, kindf, FFTW_EXHAUSTIVE);
-    iplanb = fftw_plan_many_r2r(rank, ni, jmax, fftini, ni, istride, idist,
-                                fftouti, ni, istride, idist, kindb, FFTW_EXHAUSTIVE);
-    jplanf = fftw_plan_many_r2r(rank, nj, iblock, fftinj, nj, jstride, jdist,
-                                fftoutj, nj, jstride, jdist, kindf, FFTW_EXHAUSTIVE);
-    jplanb = fftw_plan_many_r2r(rank, nj, iblock, fftinj, nj, jstride, jdist,
-                                fftoutj, nj, jstride, jdist, kindb, FFTW_EXHAUSTIVE);
-
-    fftwplan = true;
-
-    if (master->mpiid == 0)
-    {
-        char filename[256];
-        std::sprintf(filename, "%s.%07d", "fftwplan", 0);
-
-        master->print_message("Saving \"%s\" ... ", filename);
-
-        int n = fftw_export_wisdom_to_filename(filename);
-        if (n == 0)
-        {
-            master->print_message("FAILED\n");
-            throw 1;
-        }
-        else
-            master->print_message("OK\n");
-    }
+    save_fftw_plans();
 }
 
 void Grid::load()
@@ -357,6 +497,18 @@ void Grid::load()
         master->print_message("FAILED\n");
         throw 1;
     }
+
+    // the grid file contains x, xh, y, yh, z and zh
+    const long long size = get_file_size(pFile);
+    const long long expected = 2*(itot+jtot+ktot)*static_cast<long long>(sizeof(double));
+    if (size != expected)
+    {
+        fclose(pFile);
+        master->print_message("FAILED\n");
+        master->print_error("\"%s\" has %lld bytes, %lld are expected for itot = %d, jtot = %d and ktot = %d\n",
+                            filename, size, expected, itot, jtot, ktot);
+        throw 1;
+    }
     else
         master->print_message("OK\n");
 
@@ -372,77 +524,87 @@ void Grid::load()
     calculate();
 
     // LOAD THE FFTW PLAN
-    std::sprintf(filename, "%s.%07d", "fftwplan", 0);
+    load_fftw_plans();
+}
 
-    master->print_message("Loading \"%s\" ... ", filename);
+int Grid::save_field3d(double* restrict data, double* restrict tmp1, double* restrict tmp2, char* filename, double offset,
+                       const Encoding::Format& format)
+{
+    const int jj  = icells;
+    const int kk  = icells*jcells;
+    const int jjb = imax;
+    const int kkb = imax*jmax;
 
-    int n = fftw_import_wisdom_from_filename(filename);
-    if (n == 0)
-    {
-        master->print_message("FAILED\n");
-        throw 1;
-    }
-    else
-        master->print_message("OK\n");
+    // first, copy the data without the ghost cells and add the offset
+    std::shared_ptr<std::vector<double>> field = std::make_shared<std::vector<double>>(imax*jmax*kmax);
+    double* restrict fieldb = field->data();
 
-    // use the FFTW3 many interface in order to reduce function call overhead
-    int rank = 1;
-    int ni[] = {itot};
-    int nj[] = {jtot};
-    int istride = 1;
-    int jstride = iblock;
-    int idist = itot;
-    int jdist = 1;
-    fftw_r2r_kind kindf[] = {FFTW_R2HC};
-    fftw_r2r_kind kindb[] = {FFTW_HC2R};
-    iplanf = fftw_plan_many_r2r(rank, ni, jmax, fftini, ni, istride, idist,
-            fftouti, ni, istride, idist, kindf, FFTW_EXHAUSTIVE);
-    iplanb = fftw_plan_many_r2r(rank, ni, jmax, fftini, ni, istride, idist,
-            fftouti, ni, istride, idist, kindb, FFTW_EXHAUSTIVE);
-    jplanf = fftw_plan_many_r2r(rank, nj, iblock, fftinj, nj, jstride, jdist,
-            fftoutj, nj, jstride, jdist, kindf, FFTW_EXHAUSTIVE);
-    jplanb = fftw_plan_many_r2r(rank, nj, iblock, fftinj, nj, jstride, jdist,
-            fftoutj, nj, jstride, jdist, kindb, FFTW_EXHAUSTIVE);
+    for (int k=0; k<kmax; k++)
+        for (int j=0; j<jmax; j++)
+#pragma ivdep
+            for (int i=0; i<imax; i++)
+            {
+                const int ijk  = i+igc + (j+jgc)*jj + (k+kgc)*kk;
+                const int ijkb = i + j*jjb + k*kkb;
+                fieldb[ijkb] = data[ijk] + offset;
+            }
 
-    fftwplan = true;
+    // second, save the data to disk
+    const std::string name(filename);
+    if (!Encoding::is_raw(format))
+        return exec_output([this, field, name, format]() { return write_encoded(name, *field, format, imax, jmax, kmax); }, name);
 
-    fftw_forget_wisdom();
+    return exec_output([field, name]() { return write_buffer(name, *field); }, name);
 }
 
-int Grid::save_field3d(double* restrict data, double* restrict tmp1, double* restrict tmp2, char* filename, double offset)
+/**
+ * This function saves a region of a 3d field, taking every stride-th point of the region in each direction.
+ */
+int Grid::save_field3d(double* restrict data, char* filename, double offset, const Field3d_region& region,
+                       const Encoding::Format& format)
 {
-    FILE *pFile;
-    pFile = fopen(filename, "wbx");
+    int start[3], count[3], total[3];
 
-    if (pFile == NULL)
-        return 1;
+    std::shared_ptr<std::vector<double>> field = std::make_shared<std::vector<double>>();
+    pack_region(*field, data, offset, region, start, count, total);
 
-    const int jj = icells;
-    const int kk = icells*jcells;
+    const std::string name(filename);
+    if (!Encoding::is_raw(format))
+    {
+        const int ni = total[0], nj = total[1], nk = total[2];
+        return exec_output([this, field, name, format, ni, nj, nk]() { return write_encoded(name, *field, format, ni, nj, nk); }, name);
+    }
 
-    // first, add the offset to the data
-    for (int k=kstart; k<kend; k++)
-        for (int j=jstart; j<jend; j++)
-            for (int i=istart; i<iend; i++)
-            {
-                const int ijk = i + j*jj + k*kk;
-                tmp1[ijk] = data[ijk] + offset;
-            }
+    return exec_output([field, name]() { return write_buffer(name, *field); }, name);
+}
 
-    // second, save the data to disk
-    for (int k=kstart; k<kend; k++)
-        for (int j=jstart; j<jend; j++)
-        {
-            const int ijk = istart + j*jj + k*kk;
-            fwrite(&tmp1[ijk], sizeof(double), imax, pFile);
-        }
+int Grid::load_field3d(double* restrict data, double* restrict tmp1, double* restrict tmp2, char* filename, double offset)
+{
+    if (read_field3d(tmp1, filename))
+        return 1;
 
-    fclose(pFile);
+    unpack_field3d(data, tmp1, tmp2, offset);
 
     return 0;
 }
 
-int Grid::load_field3d(double* restrict data, double* restrict tmp1, double* restrict tmp2, char* filename, double offset)
+void Grid::prefetch_field3d(std::shared_ptr<Prefetch_buffer> buffer, const std::string& filename)
+{
+    buffer->data.resize(imax*jmax*kmax);
+    buffer->filename = filename;
+    buffer->nerror   = 0;
+    buffer->readtime = 0.;
+
+    buffer->job = exec_input([this, buffer]()
+    {
+        const double start = master->get_wall_clock_time();
+        buffer->nerror = read_field3d(buffer->data.data(), buffer->filename.c_str());
+        buffer->readtime = master->get_wall_clock_time() - start;
+        return 0;
+    });
+}
+
+int Grid::read_field3d(double* restrict buffer, const char* filename)
 {
     FILE *pFile;
     pFile = fopen(filename, "rb");
@@ -450,29 +612,41 @@ int Grid::load_field3d(double* restrict data, double* restrict tmp1, double* res
     if (pFile == NULL)
         return 1;
 
-    const int jj = icells;
-    const int kk = icells*jcells;
+    const long long size = get_file_size(pFile);
+    const long long expected = static_cast<long long>(itot)*jtot*ktot*sizeof(double);
+    if (size != expected)
+    {
+        master->print_error("\"%s\" has %lld bytes, %lld are expected for itot = %d, jtot = %d and ktot = %d\n",
+                            filename, size, expected, itot, jtot, ktot);
+        fclose(pFile);
+        return 1;
+    }
 
-    // first, load the data from disk
-    for (int k=kstart; k<kend; k++)
-        for (int j=jstart; j<jend; j++)
-        {
-            const int ijk = istart + j*jj + k*kk;
-            fread(&tmp1[ijk], sizeof(double), imax, pFile);
-        }
+    const size_t count = static_cast<size_t>(imax)*jmax*kmax;
+    const size_t nread = fread(buffer, sizeof(double), count, pFile);
 
     fclose(pFile);
 
-    // second, remove the offset
-    for (int k=kstart; k<kend; k++)
-        for (int j=jstart; j<jend; j++)
-            for (int i=istart; i<iend; i++)
+    return nread != count;
+}
+
+void Grid::unpack_field3d(double* restrict data, double* restrict buffer, double* restrict tmp, double offset)
+{
+    const int jj  = icells;
+    const int kk  = icells*jcells;
+    const int jjb = imax;
+    const int kkb = imax*jmax;
+
+    // remove the offset while copying the data into the field
+    for (int k=0; k<kmax; k++)
+        for (int j=0; j<jmax; j++)
+#pragma ivdep
+            for (int i=0; i<imax; i++)
             {
-                const int ijk = i + j*jj + k*kk;
-                data[ijk] = tmp1[ijk] - offset;
+                const int ijk  = i+igc + (j+jgc)*jj + (k+kgc)*kk;
+                const int ijkb = i + j*jjb + k*kkb;
+                data[ijk] = buffer[ijkb] - offset;
             }
-
-    return 0;
 }
 
 void Grid::fft_forward(double* restrict data,   double* restrict tmp1,
@@ -583,7 +757,71 @@ void Grid::fft_backward(double* restrict data,   double* restrict tmp1,
     }
 }
 
-int Grid::save_xz_slice(double* restrict data, double* restrict tmp, char* filename, int jslice)
+/**
+ * This function appends a slice to a container file and adds it to the time index. The container is
+ * opened at the first write and kept open. It is only called from output jobs.
+ * @param filename Name of the container file.
+ * @param iotime Output time of the slice.
+ * @param bytes Slice as it is stored on disk.
+ * @return Number of errors.
+ */
+int Grid::append_container(const std::string& filename, const int iotime, const std::vector<unsigned char>& bytes)
+{
+    std::map<std::string, Output_container>::iterator it = containers.find(filename);
+    if (it == containers.end())
+    {
+        Output_container container;
+        if (open_container(container, filename))
+            return 1;
+        it = containers.insert(std::make_pair(filename, container)).first;
+    }
+
+    Output_container& c = it->second;
+
+    // start a new index table at the end of the file if the current one is full
+    if (c.nentries == c.capacity)
+    {
+        const long long table = c.end;
+
+        std::vector<unsigned char> empty(Container::table_size(c.capacity), 0);
+        fseek(c.fh, table, SEEK_SET);
+        fwrite(empty.data(), 1, empty.size(), c.fh);
+
+        fseek(c.fh, c.table, SEEK_SET);
+        fwrite(&table, sizeof(long long), 1, c.fh);
+
+        c.table     = table;
+        c.nentries  = 0;
+        c.end      += Container::table_size(c.capacity);
+    }
+
+    // write the slice at the end of the file, it becomes visible for readers once it is in the index
+    fseek(c.fh, c.end, SEEK_SET);
+    if (fwrite(bytes.data(), 1, bytes.size(), c.fh) != bytes.size())
+        return 1;
+
+    unsigned char entry[Container::entry_size];
+    Container::pack_entry(entry, iotime, c.end, bytes.size());
+    fseek(c.fh, c.table + sizeof(long long) + c.nentries*Container::entry_size, SEEK_SET);
+    fwrite(entry, 1, Container::entry_size, c.fh);
+    fflush(c.fh);
+
+    ++c.nentries;
+    c.end += bytes.size();
+
+    return 0;
+}
+
+void Grid::close_containers()
+{
+    for (std::map<std::string, Output_container>::iterator it=containers.begin(); it!=containers.end(); ++it)
+        fclose(it->second.fh);
+
+    containers.clear();
+}
+
+int Grid::save_xz_slice(double* restrict data, double* restrict tmp, char* filename, int jslice,
+                        const Encoding::Format& format, int iotime)
 {
     // extract the data from the 3d field without the ghost cells
     const int jj  = icells;
@@ -602,18 +840,27 @@ int Grid::save_xz_slice(double* restrict data, double* restrict tmp, char* filen
             tmp[ijkb] = data[ijk];
         }
 
-    FILE *pFile;
-    pFile = fopen(filename, "wbx");
-    if (pFile == NULL)
-        return 1;
+    // copy the slice, such that it can be written while the model continues
+    std::shared_ptr<std::vector<double>> slice = std::make_shared<std::vector<double>>(tmp, tmp+count);
+    const std::string name(filename);
 
-    fwrite(tmp, sizeof(double), count, pFile);
-    fclose(pFile);
+    if (iotime >= 0)
+        return exec_output([this, slice, name, format, iotime]()
+        {
+            std::vector<unsigned char> bytes;
+            if (encode_buffer(bytes, *slice, format, imax, 1, kmax))
+                return 1;
+            return append_container(name, iotime, bytes);
+        }, name);
 
-    return 0;
+    if (!Encoding::is_raw(format))
+        return exec_output([this, slice, name, format]() { return write_encoded(name, *slice, format, imax, 1, kmax); }, name);
+
+    return exec_output([slice, name]() { return write_buffer(name, *slice); }, name);
 }
 
-int Grid::save_yz_slice(double* restrict data, double* restrict tmp, char* filename, int islice)
+int Grid::save_yz_slice(double* restrict data, double* restrict tmp, char* filename, int islice,
+                        const Encoding::Format& format, int iotime)
 {
     // Extract the data from the 3d field without the ghost cells
     const int jj = icells;
@@ -634,18 +881,27 @@ int Grid::save_yz_slice(double* restrict data, double* restrict tmp, char* filen
             tmp[ijkb] = data[ijk];
         }
 
-    FILE *pFile;
-    pFile = fopen(filename, "wbx");
-    if (pFile == NULL)
-        return 1;
+    // copy the slice, such that it can be written while the model continues
+    std::shared_ptr<std::vector<double>> slice = std::make_shared<std::vector<double>>(tmp, tmp+count);
+    const std::string name(filename);
 
-    fwrite(tmp, sizeof(double), count, pFile);
-    fclose(pFile);
+    if (iotime >= 0)
+        return exec_output([this, slice, name, format, iotime]()
+        {
+            std::vector<unsigned char> bytes;
+            if (encode_buffer(bytes, *slice, format, 1, jmax, kmax))
+                return 1;
+            return append_container(name, iotime, bytes);
+        }, name);
 
-    return 0;
+    if (!Encoding::is_raw(format))
+        return exec_output([this, slice, name, format]() { return write_encoded(name, *slice, format, 1, jmax, kmax); }, name);
+
+    return exec_output([slice, name]() { return write_buffer(name, *slice); }, name);
 }
 
-int Grid::save_xy_slice(double* restrict data, double* restrict tmp, char* filename, int kslice)
+int Grid::save_xy_slice(double* restrict data, double* restrict tmp, char* filename, int kslice,
+                        const Encoding::Format& format, int iotime)
 {
     // extract the data from the 3d field without the ghost cells
     const int jj  = icells;
@@ -668,15 +924,23 @@ int Grid::save_xy_slice(double* restrict data, double* restrict tmp, char* filen
             tmp[ijkb] = data[ijk];
         }
 
-    FILE *pFile;
-    pFile = fopen(filename, "wbx");
-    if (pFile == NULL)
-        return 1;
+    // copy the slice, such that it can be written while the model continues
+    std::shared_ptr<std::vector<double>> slice = std::make_shared<std::vector<double>>(tmp, tmp+count);
+    const std::string name(filename);
 
-    fwrite(tmp, sizeof(double), count, pFile);
-    fclose(pFile);
+    if (iotime >= 0)
+        return exec_output([this, slice, name, format, iotime]()
+        {
+            std::vector<unsigned char> bytes;
+            if (encode_buffer(bytes, *slice, format, imax, jmax, 1))
+                return 1;
+            return append_container(name, iotime, bytes);
+        }, name);
 
-    return 0;
+    if (!Encoding::is_raw(format))
+        return exec_output([this, slice, name, format]() { return write_encoded(name, *slice, format, imax, jmax, 1); }, name);
+
+    return exec_output([slice, name]() { return write_buffer(name, *slice); }, name);
 }
 
 int Grid::load_xy_slice(double* restrict data, double* restrict tmp, char* filename, int kslice)
@@ -1040,3 +1040,31 @@ void Input::flag_as_used(std::string cat, std::string item)
         }
     }
 }
+
+// Set or replace an item from a string "block.item=value" or "block.item[element]=value".
+int Input::add_override(std::string override)
+{
+    char block[256], lhs[256], element[256], rhs[256];
+
+    const size_t eq = override.find('=');
+    if (eq == std::string::npos || eq >= 256 || override.size()-eq > 256)
+    {
+        master->print_error("Override \"%s\" is illegal input\n", override.c_str());
+        return 1;
+    }
+    std::strcpy(rhs, override.substr(eq+1).c_str());
+
+    int n = std::sscanf(override.substr(0, eq).c_str(), "%[a-zA-Z0-9_].%[a-zA-Z0-9_()][%[^]]]", block, lhs, element);
+    if (n < 2)
+    {
+        master->print_error("Override \"%s\" is illegal input\n", override.c_str());
+        return 1;
+    }
+    if (n == 2)
+        std::strcpy(element, "default");
+
+    inputlist[block][lhs][element].data   = rhs;
+    inputlist[block][lhs][element].isused = false;
+
+    return 0;
+}
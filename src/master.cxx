@@ -24,9 +24,17 @@
 #include <cstdio>
 #include "master.h"
 
+namespace
+{
+    const char* comm_names[Comm_kind::size] = {"halo", "halo2d", "transzx", "transxz", "transxy", "transyx",
+                                               "transyz", "transzy", "prof", "gridreduce", "reduce", "bcast", "gather"};
+}
+
+// In ensemble mode, only the first member prints messages, while warnings and
+// errors are printed by all members and labeled with the member number.
 void Master::print_message(const char *format, ...)
 {
-    if (mpiid == 0)
+    if (mpiid == 0 && member == 0)
     {
         va_list args;
         va_start(args, format);
@@ -37,7 +45,7 @@ void Master::print_message(const char *format, ...)
 
 void Master::print_warning(const char *format, ...)
 {
-    std::string warningstr("WARNING: ");
+    std::string warningstr(member_label() + "WARNING: ");
     warningstr += std::string(format);
 
     const char *warningformat = warningstr.c_str();
@@ -53,7 +61,7 @@ void Master::print_warning(const char *format, ...)
 
 void Master::print_error(const char *format, ...)
 {
-    std::string errorstr("ERROR: ");
+    std::string errorstr(member_label() + "ERROR: ");
     errorstr += std::string(format);
 
     const char *errorformat = errorstr.c_str();
@@ -67,6 +75,16 @@ void Master::print_error(const char *format, ...)
     }
 }
 
+std::string Master::member_label()
+{
+    if (nmembers == 1)
+        return "";
+
+    char label[32];
+    std::snprintf(label, 32, "[member %d] ", member);
+    return std::string(label);
+}
+
 bool Master::at_wall_clock_limit()
 {
     const double wall_clock_time_left = wall_clock_end - get_wall_clock_time();
@@ -77,3 +95,110 @@ bool Master::at_wall_clock_limit()
     else
         return false;
 }
+
+void Master::add_comm(const int kind, const double messages, const double bytes, const double time)
+{
+    if (!comm_stats || std::this_thread::get_id() != comm_thread)
+        return;
+
+    Comm_counter* counters[2] = {&comm_total[kind], &comm_interval[kind]};
+    for (int n=0; n<2; ++n)
+    {
+        counters[n]->calls    += 1.;
+        counters[n]->messages += messages;
+        counters[n]->bytes    += bytes;
+        counters[n]->time     += time;
+    }
+}
+
+bool Master::get_comm_stats()
+{
+    return comm_stats;
+}
+
+void Master::start_comm_stats()
+{
+    const Comm_counter zero = {0., 0., 0., 0.};
+    comm_total   .assign(Comm_kind::size, zero);
+    comm_interval.assign(Comm_kind::size, zero);
+    comm_thread = std::this_thread::get_id();
+    comm_stats  = true;
+}
+
+// The messages and bytes are summed over all processes, the time is the maximum and the mean over the processes.
+// All values are per iteration. The reductions of this function are not accounted themselves.
+void Master::print_comm_stats(const int iteration, const int niter, const bool interval)
+{
+    if (!comm_stats)
+        return;
+
+    std::vector<Comm_counter>& counters = interval ? comm_interval : comm_total;
+
+    const int n = Comm_kind::size;
+    std::vector<double> sums(4*n);
+    std::vector<double> tmax(n);
+    for (int i=0; i<n; ++i)
+    {
+        sums[      i] = counters[i].calls;
+        sums[  n + i] = counters[i].messages;
+        sums[2*n + i] = counters[i].bytes;
+        sums[3*n + i] = counters[i].time;
+        tmax[i]       = counters[i].time;
+    }
+
+    comm_stats = false;
+    sum(sums.data(), 4*n);
+    max(tmax.data(), n);
+    comm_stats = true;
+
+    if (interval)
+    {
+        const Comm_counter zero = {0., 0., 0., 0.};
+        comm_interval.assign(Comm_kind::size, zero);
+    }
+
+    if (mpiid != 0 || niter == 0)
+        return;
+
+    const double iters = niter;
+
+    if (interval)
+    {
+        // Only the writing is skipped if the file cannot be opened, the accounting continues
+        // on all processes, such that their reductions in this function stay matched.
+        if (commout_failed)
+            return;
+
+        if (commout == NULL)
+        {
+            std::string outputname = simname + ".comm";
+            commout = std::fopen(outputname.c_str(), "a");
+            if (commout == NULL)
+            {
+                print_warning("\"%s\" cannot be written\n", outputname.c_str());
+                commout_failed = true;
+                return;
+            }
+            std::fprintf(commout, "%8s %-10s %12s %12s %14s %12s %12s\n",
+                         "ITER", "KIND", "CALLS", "MESSAGES", "BYTES", "TMAX", "TMEAN");
+        }
+
+        for (int i=0; i<n; ++i)
+            if (sums[i] > 0.)
+                std::fprintf(commout, "%8d %-10s %12.4E %12.4E %14.6E %12.4E %12.4E\n", iteration, comm_names[i],
+                             sums[i]/(nprocs*iters), sums[n+i]/iters, sums[2*n+i]/iters, tmax[i]/iters, sums[3*n+i]/(nprocs*iters));
+        std::fflush(commout);
+    }
+    else
+    {
+        print_message("Communication per iteration over %d iterations, summed over all processes\n", niter);
+        print_message("  %-10s %10s %12s %12s %12s %12s %12s\n",
+                      "kind", "calls", "messages", "bytes", "bytes/msg", "tmax [s]", "tmean/call");
+        for (int i=0; i<n; ++i)
+            if (sums[i] > 0.)
+                print_message("  %-10s %10.2f %12.4E %12.4E %12.4E %12.4E %12.4E\n", comm_names[i],
+                              sums[i]/(nprocs*iters), sums[n+i]/iters, sums[2*n+i]/iters,
+                              (sums[n+i] > 0.) ? sums[2*n+i]/sums[n+i] : 0.,
+                              tmax[i]/iters, sums[3*n+i]/sums[i]);
+    }
+}
@@ -23,6 +23,12 @@
 #ifdef USEMPI
 #include <mpi.h>
 #include <stdexcept>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "grid.h"
 #include "defines.h"
 #include "master.h"
@@ -32,30 +38,54 @@ Master::Master()
     initialized = false;
     allocated   = false;
 
+    comm_stats = false;
+    commout    = NULL;
+    commout_failed = false;
+
     // set the mpiid, to ensure that errors can be written if MPI init fails
     mpiid = 0;
+
+    // without an ensemble file, the only member spans all processes
+    nmembers   = 1;
+    member     = 0;
+    commmember = MPI_COMM_WORLD;
+    commens    = MPI_COMM_NULL;
 }
 
 Master::~Master()
 {
+    if (commout != NULL)
+        std::fclose(commout);
+
     if (allocated)
     {
         delete[] reqs;
         MPI_Comm_free(&commxy);
         MPI_Comm_free(&commx);
         MPI_Comm_free(&commy);
+        MPI_Comm_free(&commxyio);
+        MPI_Comm_free(&commxio);
+        MPI_Comm_free(&commyio);
     }
 
     print_message("Finished run on %d processes\n", nprocs);
 
+    if (commens != MPI_COMM_NULL)
+    {
+        MPI_Comm_free(&commmember);
+        MPI_Comm_free(&commens);
+    }
+
     if (initialized)
         MPI_Finalize();
 }
 
 void Master::start(int argc, char *argv[])
 {
-    // initialize the MPI
-    int n = MPI_Init(NULL, NULL);
+    // initialize the MPI with support for concurrent calls, the provided level decides whether the output thread is allowed
+    int thread_support;
+    int n = MPI_Init_thread(NULL, NULL, MPI_THREAD_MULTIPLE, &thread_support);
+    thread_multiple = (thread_support == MPI_THREAD_MULTIPLE);
     if (check_error(n))
         throw 1;
 
@@ -100,9 +130,129 @@ void Master::start(int argc, char *argv[])
             simname = argv[2];
         else
             simname = "microhh";
+        // an optional ensemble file splits the processes over independent members
+        if (argc > 3)
+            ensemblefile = argv[3];
     }
 }
 
+// Split the processes into ensemble members. Each non-comment line of the ensemble file
+// describes one member as "directory block.item=value block.item[element]=value ...".
+// The input files have been read already and are shared by all members. Each member
+// gets its own communicator, applies its overrides and runs in its own directory.
+void Master::start_ensemble(Input *inputin)
+{
+    if (ensemblefile.empty())
+        return;
+
+    int nerror = 0;
+    std::vector<std::string> lines;
+
+    if (mpiid == 0)
+    {
+        std::ifstream file(ensemblefile.c_str());
+        if (!file)
+        {
+            print_error("Ensemble file \"%s\" does not exist\n", ensemblefile.c_str());
+            ++nerror;
+        }
+
+        std::string line;
+        while (std::getline(file, line))
+        {
+            // skip empty lines and comments
+            const size_t pos = line.find_first_not_of(" \t");
+            if (pos == std::string::npos || line[pos] == '#')
+                continue;
+            lines.push_back(line.substr(pos));
+        }
+        nmembers = lines.size();
+    }
+
+    broadcast(&nerror, 1);
+    broadcast(&nmembers, 1);
+    if (nerror)
+        throw 1;
+
+    if (nmembers == 0 || nprocs % nmembers != 0)
+    {
+        print_error("nprocs = %d is not divisible by the number of ensemble members %d\n", nprocs, nmembers);
+        throw 1;
+    }
+
+    const int procs_per_member = nprocs / nmembers;
+    member = mpiid / procs_per_member;
+
+    // send each member its line, the other processes receive and discard it
+    std::string memberline;
+    for (int m=0; m<nmembers; ++m)
+    {
+        int length = (mpiid == 0) ? lines[m].size() : 0;
+        broadcast(&length, 1);
+
+        std::vector<char> buffer(length+1, '\0');
+        if (mpiid == 0)
+            lines[m].copy(&buffer[0], length);
+        broadcast(&buffer[0], length+1);
+
+        if (m == member)
+            memberline = &buffer[0];
+    }
+
+    // processes are grouped per member in rank order, which keeps members on as few nodes as possible
+    int n = MPI_Comm_split(MPI_COMM_WORLD, member, mpiid, &commmember);
+    if (check_error(n))
+        throw 1;
+
+    n = MPI_Comm_split(MPI_COMM_WORLD, mpiid % procs_per_member, member, &commens);
+    if (check_error(n))
+        throw 1;
+
+    // from here on, the member behaves as a standalone run on its own processes
+    n = MPI_Comm_free(&commxy);
+    if (check_error(n))
+        throw 1;
+
+    n = MPI_Comm_dup(commmember, &commxy);
+    if (check_error(n))
+        throw 1;
+
+    MPI_Comm_rank(commxy, &mpiid);
+    MPI_Comm_size(commxy, &nprocs);
+
+    std::istringstream memberstream(memberline);
+    std::string directory;
+    memberstream >> directory;
+
+    std::string override;
+    while (memberstream >> override)
+        nerror += inputin->add_override(override);
+
+    // all output and restart files of the member are written in its own directory
+    if (mpiid == 0)
+    {
+        if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+        {
+            print_error("Cannot create directory \"%s\"\n", directory.c_str());
+            ++nerror;
+        }
+    }
+    broadcast(&nerror, 1);
+
+    if (!nerror && chdir(directory.c_str()) != 0)
+    {
+        print_error("Cannot enter directory \"%s\"\n", directory.c_str());
+        ++nerror;
+    }
+
+    // abort all members if one of them fails
+    MPI_Allreduce(MPI_IN_PLACE, &nerror, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    if (nerror)
+        throw 1;
+
+    print_message("Running %d ensemble members on %d processes each\n", nmembers, nprocs);
+}
+
 void Master::init(Input *inputin)
 {
     int nerror = 0;
@@ -140,7 +290,7 @@ void Master::init(Input *inputin)
         throw 1;
 
     // for now, do not reorder processes, blizzard gives large performance loss
-    n = MPI_Cart_create(MPI_COMM_WORLD, 2, dims, periodic, false, &commxy);
+    n = MPI_Cart_create(commmember, 2, dims, periodic, false, &commxy);
     if (check_error(n))
         throw 1;
 
@@ -168,6 +318,19 @@ void Master::init(Input *inputin)
     if (check_error(n))
         throw 1;
 
+    // the output thread communicates over its own communicators, to keep its collectives apart from the solver
+    n = MPI_Comm_dup(commxy, &commxyio);
+    if (check_error(n))
+        throw 1;
+
+    n = MPI_Comm_dup(commx, &commxio);
+    if (check_error(n))
+        throw 1;
+
+    n = MPI_Comm_dup(commy, &commyio);
+    if (check_error(n))
+        throw 1;
+
     // find out who are the neighbors of this process to facilitate the communication routines
     n = MPI_Cart_shift(commxy, 1, 1, &nwest , &neast );
     if (check_error(n))
@@ -216,46 +379,129 @@ void Master::wait_all()
     reqsn = 0;
 }
 
-// do all broadcasts over the MPI_COMM_WORLD, to avoid complications in the input file reading
+// The collectives are accounted as one message per process that contains the local data.
+// The wall clock is only read if the communication is accounted.
+
+// do all broadcasts over commxy, which holds all processes of the run until they are split
+// into ensemble members, and the processes of the own member after that
 void Master::broadcast(char *data, int datasize)
 {
+    const bool timed = comm_stats;
+    const double time_start = timed ? get_wall_clock_time() : 0.;
     MPI_Bcast(data, datasize, MPI_CHAR, 0, commxy);
+    if (timed)
+        add_comm(Comm_kind::broadcast, 1, datasize*sizeof(char), get_wall_clock_time() - time_start);
 }
 
 // overloaded broadcast functions
 void Master::broadcast(int *data, int datasize)
 {
+    const bool timed = comm_stats;
+    const double time_start = timed ? get_wall_clock_time() : 0.;
     MPI_Bcast(data, datasize, MPI_INT, 0, commxy);
+    if (timed)
+        add_comm(Comm_kind::broadcast, 1, datasize*sizeof(int), get_wall_clock_time() - time_start);
 }
 
 void Master::broadcast(unsigned long *data, int datasize)
 {
+    const bool timed = comm_stats;
+    const double time_start = timed ? get_wall_clock_time() : 0.;
     MPI_Bcast(data, datasize, MPI_UNSIGNED_LONG, 0, commxy);
+    if (timed)
+        add_comm(Comm_kind::broadcast, 1, datasize*sizeof(unsigned long), get_wall_clock_time() - time_start);
 }
 
 void Master::broadcast(double *data, int datasize)
 {
+    const bool timed = comm_stats;
+    const double time_start = timed ? get_wall_clock_time() : 0.;
     MPI_Bcast(data, datasize, MPI_DOUBLE, 0, commxy);
+    if (timed)
+        add_comm(Comm_kind::broadcast, 1, datasize*sizeof(double), get_wall_clock_time() - time_start);
 }
 
 void Master::sum(int *var, int datasize)
 {
+    const bool timed = comm_stats;
+    const double time_start = timed ? get_wall_clock_time() : 0.;
     MPI_Allreduce(MPI_IN_PLACE, var, datasize, MPI_INT, MPI_SUM, commxy);
+    if (timed)
+        add_comm(Comm_kind::reduce, 1, datasize*sizeof(int), get_wall_clock_time() - time_start);
 }
 
 void Master::sum(double *var, int datasize)
 {
+    const bool timed = comm_stats;
+    const double time_start = timed ? get_wall_clock_time() : 0.;
     MPI_Allreduce(MPI_IN_PLACE, var, datasize, MPI_DOUBLE, MPI_SUM, commxy);
+    if (timed)
+        add_comm(Comm_kind::reduce, 1, datasize*sizeof(double), get_wall_clock_time() - time_start);
 }
 
 void Master::max(double *var, int datasize)
 {
+    const bool timed = comm_stats;
+    const double time_start = timed ? get_wall_clock_time() : 0.;
     MPI_Allreduce(MPI_IN_PLACE, var, datasize, MPI_DOUBLE, MPI_MAX, commxy);
+    if (timed)
+        add_comm(Comm_kind::reduce, 1, datasize*sizeof(double), get_wall_clock_time() - time_start);
 }
 
 void Master::min(double *var, int datasize)
 {
+    const bool timed = comm_stats;
+    const double time_start = timed ? get_wall_clock_time() : 0.;
     MPI_Allreduce(MPI_IN_PLACE, var, datasize, MPI_DOUBLE, MPI_MIN, commxy);
+    if (timed)
+        add_comm(Comm_kind::reduce, 1, datasize*sizeof(double), get_wall_clock_time() - time_start);
+}
+
+void Master::gather(double *sendbuf, int sendcount, double *recvbuf, const int *recvcounts, const int *displs)
+{
+    const bool timed = comm_stats;
+    const double time_start = timed ? get_wall_clock_time() : 0.;
+    MPI_Gatherv(sendbuf, sendcount, MPI_DOUBLE, recvbuf, recvcounts, displs, MPI_DOUBLE, 0, commxy);
+    if (timed)
+        add_comm(Comm_kind::gather, 1, sendcount*sizeof(double), get_wall_clock_time() - time_start);
+}
+
+namespace
+{
+    // MPI reduction operators cannot carry state, so the merge function and record size are stored here.
+    void (*active_merge_function)(double*, const double*) = 0;
+    int active_record_size = 0;
+
+    void merge_records(void* invec, void* inoutvec, int* len, MPI_Datatype* datatype)
+    {
+        const double* in = static_cast<const double*>(invec);
+        double* inout = static_cast<double*>(inoutvec);
+
+        for (int n=0; n<*len; ++n)
+            active_merge_function(&inout[n*active_record_size], &in[n*active_record_size]);
+    }
+}
+
+void Master::merge(double *var, int nrecords, int recordsize, void (*merge_function)(double*, const double*))
+{
+    active_merge_function = merge_function;
+    active_record_size = recordsize;
+
+    MPI_Datatype record;
+    MPI_Type_contiguous(recordsize, MPI_DOUBLE, &record);
+    MPI_Type_commit(&record);
+
+    MPI_Op op;
+    MPI_Op_create(merge_records, 1, &op);
+
+    const bool timed = comm_stats;
+    const double time_start = timed ? get_wall_clock_time() : 0.;
+    MPI_Allreduce(MPI_IN_PLACE, var, nrecords, record, op, commxy);
+    if (timed)
+        add_comm(Comm_kind::reduce, 1, nrecords*recordsize*sizeof(double), get_wall_clock_time() - time_start);
+
+    MPI_Op_free(&op);
+    MPI_Type_free(&record);
 }
 
 // Only use this function for situations where only one (or more, but not all)
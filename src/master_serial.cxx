@@ -30,10 +30,20 @@ Master::Master()
 {
     initialized = false;
     allocated   = false;
+
+    comm_stats = false;
+    commout    = NULL;
+    commout_failed = false;
+
+    nmembers = 1;
+    member   = 0;
 }
 
 Master::~Master()
 {
+    if (commout != NULL)
+        std::fclose(commout);
+
     print_message("Finished run on %d processes\n", nprocs);
 }
 
@@ -45,6 +55,8 @@ void Master::start(int argc, char *argv[])
     mpiid = 0;
     // Set the number of processes to 1.
     nprocs = 1;
+    // Without MPI, the output thread can always run.
+    thread_multiple = true;
 
     // Set the wall clock time at start.
     wall_clock_start = get_wall_clock_time();
@@ -71,6 +83,18 @@ void Master::start(int argc, char *argv[])
             simname = argv[2];
         else
             simname = "microhh";
+        // Store the ensemble file, which requires MPI.
+        if (argc > 3)
+            ensemblefile = argv[3];
+    }
+}
+
+void Master::start_ensemble(Input *inputin)
+{
+    if (!ensemblefile.empty())
+    {
+        print_error("Ensemble mode requires MPI\n");
+        throw 1;
     }
 }
 
@@ -143,6 +167,17 @@ void Master::max(double *var, int datasize)
 {
 }
 
+// the only process is the root, so its block is copied to its place in the receive buffer
+void Master::gather(double *sendbuf, int sendcount, double *recvbuf, const int *recvcounts, const int *displs)
+{
+    for (int n=0; n<sendcount; ++n)
+        recvbuf[displs[0]+n] = sendbuf[n];
+}
+
+void Master::merge(double *var, int nrecords, int recordsize, void (*merge_function)(double*, const double*))
+{
+}
+
 void Master::min(double *var, int datasize)
 {
 }
@@ -42,12 +42,27 @@
 #include "cross.h"
 #include "dump.h"
 #include "column.h"
+#include "average.h"
 #include "budget.h"
+#include "perf_counters.h"
+#include "encoding.h"
 
 #ifdef USECUDA
 #include <cuda_runtime_api.h>
 #endif
 
+namespace
+{
+    // Stages of the time loop that are timed with swprofile.
+    namespace Stage
+    {
+        enum {advec, diff, thermo, buffer, force, pres, boundary, output, timeloop, other, size};
+    }
+
+    const char* stage_names[] = {"advec", "diff", "thermo", "buffer", "force", "pres",
+                                 "boundary", "output", "timeloop", "other"};
+}
+
 // In the constructor all classes are initialized and their input is read.
 Model::Model(Master *masterin, Input *inputin)
 {
@@ -68,8 +83,19 @@ Model::Model(Master *masterin, Input *inputin)
     column = 0;
     cross  = 0;
     dump   = 0;
+    average = 0;
     budget = 0;
 
+    #ifdef USEPERFCOUNTERS
+    counters = 0;
+    #endif
+
+    cfl_rate = 0.;
+    dn_rate  = 0.;
+    comm_iteration = 0;
+
+    dnsout = NULL;
+
     try
     {
         // Create an instance of the Grid class.
@@ -94,6 +120,7 @@ Model::Model(Master *masterin, Input *inputin)
         column = new Column(this, input);
         cross  = new Cross (this, input);
         dump   = new Dump  (this, input);
+        average = new Average(this, input);
 
         budget = Budget::factory(input, master, grid, fields, thermo, diff, advec, force, stats);
 
@@ -118,6 +145,27 @@ Model::Model(Master *masterin, Input *inputin)
                 stats->add_mask(*it);
         }
 
+        // Get the switch for the profiling of the time loop.
+        nerror += input->get_item(&swprofile, "master", "swprofile", "", "0");
+        if (!(swprofile == "0" || swprofile == "1"))
+        {
+            master->print_error("\"%s\" is an illegal value for swprofile\n", swprofile.c_str());
+            ++nerror;
+        }
+
+        // Get the switch for the accounting of the communication.
+        nerror += input->get_item(&swcommstats, "master", "swcommstats", "", "0");
+        if (!(swcommstats == "0" || swcommstats == "1"))
+        {
+            master->print_error("\"%s\" is an illegal value for swcommstats\n", swcommstats.c_str());
+            ++nerror;
+        }
+
+        #ifdef USEPERFCOUNTERS
+        if (swprofile == "1")
+            counters = new Perf_counters(master, Stage::size);
+        #endif
+
         // if one or more arguments fails, then crash
         if (nerror > 0)
             throw 1;
@@ -133,8 +181,16 @@ Model::Model(Master *masterin, Input *inputin)
 // In this function all instances of objects are deleted and the memory is freed.
 void Model::delete_objects()
 {
+    // Write the queued output before the components that hold its data are deleted.
+    if (grid)
+        grid->wait_output();
+
     // Delete the components in reversed order.
+    #ifdef USEPERFCOUNTERS
+    delete counters;
+    #endif
     delete budget;
+    delete average;
     delete dump;
     delete cross;
     delete column;
@@ -155,6 +211,9 @@ void Model::delete_objects()
 // In the destructor the deletion of all class instances is triggered.
 Model::~Model()
 {
+    if (dnsout != NULL)
+        std::fclose(dnsout);
+
     delete_objects();
     #ifdef USECUDA
     cudaDeviceReset();
@@ -179,6 +238,7 @@ void Model::init()
     column->init(timeloop->get_ifactor());
     cross ->init(timeloop->get_ifactor());
     dump  ->init(timeloop->get_ifactor());
+    average->init(timeloop->get_ifactor());
     budget->init();
 }
 
@@ -198,6 +258,10 @@ void Model::load()
     fields->load(timeloop->get_iotime());
     fields->create_stats();
     fields->create_column();
+
+    // Continue the time averages of the previous run, if they were saved.
+    average->create();
+    average->load(timeloop->get_iotime());
     
     // Initialize data or load data from disk.
     boundary->create(input);
@@ -260,44 +324,91 @@ void Model::exec()
     // Get the viscosity to be used in diffusion.
     diff->exec_viscosity();
 
+    // Calculate the CFL and diffusion numbers in a separate pass, as no tendencies have been computed yet.
+    advec->calc_cfl_rate();
+    diff ->calc_dn_rate();
+
     // Set the time step.
     set_time_step();
 
     // Print the initial status information.
     print_status();
 
+    // In post process mode, start reading the fields of the next output times in the background.
+    if (master->mode == "post")
+    {
+        for (int n=1; n<=timeloop->get_post_proc_prefetch(); ++n)
+            prefetch_post_proc(n);
+    }
+
+    // Start the timers of the stages of the time loop.
+    const int iterstart = timeloop->get_iteration();
+    const double loopstart = master->get_wall_clock_time();
+    stage_times.assign(Stage::size, 0.);
+    stage_start = loopstart;
+    grid->profile = (swprofile == "1");
+    grid->time_transpose = 0.;
+    grid->time_halo = 0.;
+
+    // Start the accounting of the communication of the time loop.
+    if (swcommstats == "1")
+    {
+        master->start_comm_stats();
+        comm_iteration = iterstart;
+    }
+    #ifdef USEPERFCOUNTERS
+    if (counters)
+        counters->start();
+    #endif
+
     // start the time loop
     while (true)
     {
-        // Determine the time step.
-        set_time_step();
-
         // Calculate the advection tendency.
         boundary->set_ghost_cells_w(Boundary::Conservation_type);
         advec->exec();
         boundary->set_ghost_cells_w(Boundary::Normal_type);
+        end_stage(Stage::advec);
 
         // Calculate the diffusion tendency.
         diff->exec();
+        end_stage(Stage::diff);
+
+        // Determine the time step. This is done after advection and diffusion, because these store the
+        // CFL and diffusion numbers in the first substep and do not depend on the time step themselves.
+        set_time_step();
+        end_stage(Stage::other);
 
         // Calculate the thermodynamics and the buoyancy tendency.
         thermo->exec();
+        end_stage(Stage::thermo);
+
         // Calculate the tendency due to damping in the buffer layer.
         buffer->exec();
+        end_stage(Stage::buffer);
 
         // Apply the large scale forcings. Keep this one always right before the pressure.
         force->exec(timeloop->get_sub_time_step());
+        end_stage(Stage::force);
 
         // Solve the poisson equation for pressure.
         boundary->set_ghost_cells_w(Boundary::Conservation_type);
         pres->exec(timeloop->get_sub_time_step());
         boundary->set_ghost_cells_w(Boundary::Normal_type);
+        end_stage(Stage::pres);
 
-        // Allow only for statistics when not in substep and not directly after restart.
-        if (timeloop->is_stats_step())
+        // Allow only for statistics when not in substep and not directly after restart. The saved time averages
+        // do not contain the sample at the restart time, so they are also sampled directly after restart.
+        const bool do_average = !timeloop->in_substep() && average->do_average();
+        if (timeloop->is_stats_step() || do_average)
         {
+            const bool do_stats  = timeloop->is_stats_step() && stats->doStats();
+            const bool do_cross  = timeloop->is_stats_step() && cross->do_cross();
+            const bool do_dump   = timeloop->is_stats_step() && dump->do_dump();
+            const bool do_column = timeloop->is_stats_step() && column->doColumn();
+
             // Copy fields from device to host
-            if (stats->doStats() || cross->do_cross() || dump->do_dump() || column->doColumn())
+            if (do_stats || do_cross || do_dump || do_column || do_average)
             {
                 #ifdef USECUDA
                 if(t_stat.joinable())
@@ -305,13 +416,21 @@ void Model::exec()
                 fields  ->backward_device();
                 boundary->backward_device();
                 thermo  ->backward_device();                
-                t_stat=std::thread(&Model::do_stat,this, stats->doStats(), cross->do_cross(), dump->do_dump(), column->doColumn(),
+                t_stat=std::thread(&Model::do_stat,this, do_stats, do_cross, do_dump, do_column, do_average,
                                     timeloop->get_iteration(), timeloop->get_time(), timeloop->get_itime(), timeloop->get_iotime());
                 #else
-                do_stat(stats->doStats(), cross->do_cross(), dump->do_dump(),column->doColumn(),timeloop->get_iteration(), timeloop->get_time(), timeloop->get_itime(), timeloop->get_iotime());
+                // Queue the output, such that it is written by the output thread while the model continues.
+                // The statistics are computed here, only the writing of the files is queued.
+                // \TODO Compute the statistics, cross sections and dumps from a snapshot of the fields on a helper
+                // thread, as t_stat does with CUDA. This needs own communicators for the reductions of that thread,
+                // tmp fields that can be taken by two threads, and a copy of the diagnostic and surface fields.
+                grid->set_output_queue(true);
+                do_stat(do_stats, do_cross, do_dump, do_column, do_average, timeloop->get_iteration(), timeloop->get_time(), timeloop->get_itime(), timeloop->get_iotime());
+                grid->set_output_queue(false);
                 #endif             
             }
         }
+        end_stage(Stage::output);
 
         // Exit the simulation when the runtime has been hit.
         if (timeloop->is_finished())
@@ -337,9 +456,14 @@ void Model::exec()
                 thermo  ->backward_device();
                 #endif
 
+                // Finish the queued output, such that all output up to the restart time is on disk.
+                column->flush();
+                finish_output();
+
                 // Save data to disk.
                 timeloop->save(timeloop->get_iotime());
                 fields  ->save(timeloop->get_iotime());
+                average ->save(timeloop->get_iotime());
             }
         }
 
@@ -353,10 +477,15 @@ void Model::exec()
             if (timeloop->is_finished())
                 break;
 
-            // Load the data from disk.
+            // Load the data from disk, the fields are taken from the prefetched buffers if available.
             timeloop->load(timeloop->get_iotime());
             fields  ->load(timeloop->get_iotime());
+
+            // Keep the reads of the next output times going while this one is processed.
+            if (timeloop->get_post_proc_prefetch() > 0)
+                prefetch_post_proc(timeloop->get_post_proc_prefetch());
         }
+        end_stage(Stage::timeloop);
 
         // Update the time dependent parameters.
         boundary->update_time_dependent();
@@ -365,18 +494,49 @@ void Model::exec()
 
         // Set the boundary conditions.
         boundary->exec();
+        end_stage(Stage::boundary);
 
         // Calculate the field means, in case needed.
         fields->exec();
 
         // Get the viscosity to be used in diffusion.
         diff->exec_viscosity();
+        end_stage(Stage::diff);
 
         // Write status information to disk.
         print_status();
 
+        #ifndef USECUDA
+        // Check that no tmp field outlived the step (only active with TMPCHECKS).
+        // With CUDA the statistics thread can still hold tmp fields here.
+        fields->check_tmp_fields();
+        #endif
+        end_stage(Stage::other);
+
     } // End time loop.
 
+    if (swprofile == "1")
+        print_profile(timeloop->get_iteration() - iterstart, master->get_wall_clock_time() - loopstart);
+
+    if (swcommstats == "1")
+        master->print_comm_stats(timeloop->get_iteration(), timeloop->get_iteration() - iterstart, false);
+
+    #ifdef USECUDA
+    // The statistics thread can still be sampling the columns.
+    if(t_stat.joinable())
+        t_stat.join();
+    #endif
+
+    // Write the column samples that are still buffered and the time averages, and finish the queued output.
+    column->flush();
+    average->save(timeloop->get_iotime());
+    finish_output();
+
+    master->print_message("Maximum number of tmp fields in use: %d\n", fields->get_tmp_peak());
+
+    if (master->mode == "post")
+        print_load_times();
+
     #ifdef USECUDA
     // At the end of the run, copy the data back from the GPU.
     if(t_stat.joinable())
@@ -387,30 +547,34 @@ void Model::exec()
     #endif
 }
 
-void Model::do_stat(bool doStats, bool doCross, bool doDump, bool doColumn, int iteration, double time, unsigned long itime, int iotime)
+void Model::do_stat(bool doStats, bool doCross, bool doDump, bool doColumn, bool doAverage, int iteration, double time, unsigned long itime, int iotime)
 {
     // Do the statistics.
     if(doStats)
     {
         // Always process the default mask (the full field)
-        stats->get_mask(fields->atmp["tmp3"], fields->atmp["tmp4"], &stats->masks["default"]);
+        stats->get_mask(&stats->masks["default"]);
+        stats->calc_mask_index();
         calc_stats("default");
         // Work through the potential masks for the statistics.
         for (std::vector<std::string>::const_iterator it=masklist.begin(); it!=masklist.end(); ++it)
         {
             if (*it == "wplus" || *it == "wmin")
             {
-                fields->get_mask(fields->atmp["tmp3"], fields->atmp["tmp4"], &stats->masks[*it]);
+                fields->get_mask(&stats->masks[*it]);
+                stats->calc_mask_index();
                 calc_stats(*it);
             }
             else if (*it == "ql" || *it == "qlcore")
             {
-                thermo->get_mask(fields->atmp["tmp3"], fields->atmp["tmp4"], &stats->masks[*it]);
+                thermo->get_mask(&stats->masks[*it]);
+                stats->calc_mask_index();
                 calc_stats(*it);
             }
             else if (*it == "patch_high" || *it == "patch_low")
             {
-                boundary->get_mask(fields->atmp["tmp3"], fields->atmp["tmp4"], &stats->masks[*it]);
+                boundary->get_mask(&stats->masks[*it]);
+                stats->calc_mask_index();
                 calc_stats(*it);
             }
         }
@@ -437,6 +601,9 @@ void Model::do_stat(bool doStats, bool doCross, bool doDump, bool doColumn, int
         thermo->exec_column();
         column->exec(iteration, time, itime);
     }
+    // Update the time averages.
+    if(doAverage)
+        average->exec();
 }
 void Model::set_time_step()
 {
@@ -444,14 +611,22 @@ void Model::set_time_step()
     if (timeloop->in_substep())
         return;
 
+    // Reduce the CFL, diffusion and sedimentation CFL numbers per unit time of all processes in one call.
+    double rates[3] = {advec->get_cfl_rate(), diff->get_dn_rate(), thermo->get_cfl_rate()};
+    grid->get_max(rates, 3);
+
+    cfl_rate = rates[0];
+    dn_rate  = rates[1];
+
     // Retrieve the maximum allowed time step per class.
     timeloop->set_time_step_limit();
-    timeloop->set_time_step_limit(advec ->get_time_limit(timeloop->get_idt(), timeloop->get_dt()));
-    timeloop->set_time_step_limit(diff  ->get_time_limit(timeloop->get_idt(), timeloop->get_dt()));
-    timeloop->set_time_step_limit(thermo->get_time_limit(timeloop->get_idt(), timeloop->get_dt()));
+    timeloop->set_time_step_limit(advec ->get_time_limit(timeloop->get_idt(), timeloop->get_dt(), rates[0]));
+    timeloop->set_time_step_limit(diff  ->get_time_limit(timeloop->get_idt(), timeloop->get_dt(), rates[1]));
+    timeloop->set_time_step_limit(thermo->get_time_limit(timeloop->get_idt(), timeloop->get_dt(), rates[2]));
     timeloop->set_time_step_limit(stats ->get_time_limit(timeloop->get_itime()));
     timeloop->set_time_step_limit(column->get_time_limit(timeloop->get_itime()));
     timeloop->set_time_step_limit(cross ->get_time_limit(timeloop->get_itime()));
+    timeloop->set_time_step_limit(average->get_time_limit(timeloop->get_itime()));
     timeloop->set_time_step_limit(dump  ->get_time_limit(timeloop->get_itime()));
 
     // Set the time step.
@@ -478,7 +653,6 @@ void Model::print_status()
     double cfl, dn;
     double cputime, end;
     static double start;
-    static FILE *dnsout = NULL;
 
     // Write output file header on the main process and set the time of writing.
     if (master->mpiid == 0 && dnsout == NULL)
@@ -506,8 +680,8 @@ void Model::print_status()
         mom  = fields->check_momentum();
         tke  = fields->check_tke();
         mass = fields->check_mass();
-        cfl  = advec->get_cfl(timeloop->get_dt());
-        dn   = diff->get_dn(timeloop->get_dt());
+        cfl  = cfl_rate*dt;
+        dn   = dn_rate*dt;
 
         // Store time interval in betwteen two writes.
         end     = master->get_wall_clock_time();
@@ -525,12 +699,135 @@ void Model::print_status()
             throw 1;
         }
 
+        // Write the communication since the previous check.
+        if (swcommstats == "1")
+        {
+            master->print_comm_stats(iter, iter - comm_iteration, true);
+            comm_iteration = iter;
+        }
+
     }
 
     if (timeloop->is_finished())
     {
         // Close the output file when the run is done.
         if (master->mpiid == 0)
+        {
             std::fclose(dnsout);
+            dnsout = NULL;
+        }
+    }
+}
+
+// Start reading the fields of the output time that is processed n post processing steps from now.
+void Model::prefetch_post_proc(const int n)
+{
+    const int iotime = timeloop->get_post_proc_iotime(n);
+    if (iotime >= 0)
+        fields->prefetch(iotime);
+}
+
+// Wait until the queued output is written. Some output jobs only run on the main process,
+// so all processes have to agree on the errors and warnings of the output.
+void Model::finish_output()
+{
+    int nerror = grid->wait_output();
+    grid->get_max(&nerror);
+    if (nerror)
+        throw 1;
+
+    int nclamped = Encoding::get_nclamped();
+    grid->get_max(&nclamped);
+    if (nclamped)
+        master->print_warning("the lossy tolerance of the output is below the resolution of its precision, values are rounded to the precision\n");
+}
+
+// Report how much of the time spent reading the fields in post process mode overlapped with the processing.
+void Model::print_load_times()
+{
+    double read_time, wait_time;
+    fields->get_load_times(&read_time, &wait_time);
+
+    const double hidden_time = std::max(0., read_time - wait_time);
+    const int prefetch = timeloop->get_post_proc_prefetch();
+
+    master->print_message("Reading the fields took %.3f s, of which %.3f s overlapped with the processing (postprefetch = %d)\n",
+                          read_time, hidden_time, prefetch);
+
+    if (master->mpiid == 0 && dnsout != NULL)
+        std::fprintf(dnsout, "# Reading the fields took %.3f s, of which %.3f s overlapped with the processing (postprefetch = %d)\n",
+                     read_time, hidden_time, prefetch);
+}
+
+// Add the wall clock time since the end of the previous stage to the given stage.
+// With CUDA the kernels run asynchronously, such that the time of a kernel can end up in a later stage.
+void Model::end_stage(const int stage)
+{
+    if (swprofile == "0")
+        return;
+
+    const double now = master->get_wall_clock_time();
+    stage_times[stage] += now - stage_start;
+    stage_start = now;
+
+    #ifdef USEPERFCOUNTERS
+    if (counters)
+        counters->end_stage(stage);
+    #endif
+}
+
+// Print the time spent per stage of the time loop, taking the slowest process, and write it to <simname>.timing.
+void Model::print_profile(const int niter, const double looptime)
+{
+    master->max(stage_times.data(), Stage::size);
+
+    double total = looptime;
+    master->max(&total, 1);
+
+    const double ncells = (double)grid->itot*grid->jtot*grid->ktot;
+    const double throughput = (total > 0.) ? ncells*niter / total : 0.;
+
+    master->print_message("Time loop profile, %d iterations in %.4f s, %.4E cells per second\n", niter, total, throughput);
+    for (int n=0; n<Stage::size; ++n)
+        master->print_message("  %-10s %12.4f s %7.2f %%\n", stage_names[n], stage_times[n],
+                              (total > 0.) ? 100.*stage_times[n]/total : 0.);
+
+    // The communication is part of the stages above, the transposes mostly of the pressure solver.
+    double comm_times[2] = {grid->time_transpose, grid->time_halo};
+    master->max(comm_times, 2);
+    const char* comm_names[2] = {"transpose", "halo"};
+
+    for (int n=0; n<2; ++n)
+        master->print_message("  %-10s %12.4f s %7.2f %% (included in the stages)\n", comm_names[n], comm_times[n],
+                              (total > 0.) ? 100.*comm_times[n]/total : 0.);
+
+    #ifdef USEPERFCOUNTERS
+    if (counters)
+        counters->print(stage_names, stage_times);
+    #endif
+
+    if (master->mpiid == 0)
+    {
+        std::string filename = master->simname + ".timing";
+        FILE* pFile = std::fopen(filename.c_str(), "w");
+        if (pFile == NULL)
+        {
+            master->print_warning("\"%s\" cannot be written\n", filename.c_str());
+            return;
+        }
+
+        std::fprintf(pFile, "%-16s %16s %10s\n", "#STAGE", "TIME", "FRACTION");
+        for (int n=0; n<Stage::size; ++n)
+            std::fprintf(pFile, "%-16s %16.8E %10.6f\n", stage_names[n], stage_times[n],
+                         (total > 0.) ? stage_times[n]/total : 0.);
+        for (int n=0; n<2; ++n)
+            std::fprintf(pFile, "%-16s %16.8E %10.6f\n", comm_names[n], comm_times[n],
+                         (total > 0.) ? comm_times[n]/total : 0.);
+        std::fprintf(pFile, "%-16s %16.8E %10.6f\n", "total", total, 1.);
+        std::fprintf(pFile, "%-16s %16d\n", "iterations", niter);
+        std::fprintf(pFile, "%-16s %16.8E\n", "cells", ncells);
+        std::fprintf(pFile, "%-16s %16.8E\n", "cellspersecond", throughput);
+        std::fprintf(pFile, "%-16s %16d\n", "nprocs", master->nprocs);
+        std::fclose(pFile);
     }
 }
@@ -0,0 +1,229 @@
+/*
+ * MicroHH
+ * Copyright (c) 2011-2017 Chiel van Heerwaarden
+ * Copyright (c) 2011-2017 Thijs Heus
+ * Copyright (c) 2014-2017 Bart van Stratum
+ *
+ * This file is part of MicroHH
+ *
+ * MicroHH is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * MicroHH is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with MicroHH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef USEPERFCOUNTERS
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "master.h"
+#include "perf_counters.h"
+
+namespace
+{
+    struct Counter_event
+    {
+        uint32_t type;
+        uint64_t config;
+        const char* name;
+    };
+
+    // Events of the counter group, the last level cache events are used to estimate the memory traffic.
+    const Counter_event events[] =
+    {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES  , "cycles"      },
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions"},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16), "llcloads" },
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS   << 16), "llcmisses"},
+    };
+
+    const int nevents = sizeof(events) / sizeof(events[0]);
+
+    enum {cycles, instructions, llcloads, llcmisses};
+
+    long perf_event_open(perf_event_attr* attr, pid_t pid, int cpu, int group_fd, unsigned long flags)
+    {
+        return syscall(__NR_perf_event_open, attr, pid, cpu, group_fd, flags);
+    }
+}
+
+Perf_counters::Perf_counters(Master* masterin, const int nstagesin)
+{
+    master  = masterin;
+    nstages = nstagesin;
+    nopen   = 0;
+
+    index.assign(nevents, -1);
+    last.assign(nevents, 0.);
+    counts.assign(nstages*nevents, 0.);
+}
+
+Perf_counters::~Perf_counters()
+{
+    for (std::vector<int>::const_iterator it=fds.begin(); it!=fds.end(); ++it)
+        close(*it);
+}
+
+void Perf_counters::open()
+{
+    for (int n=0; n<nevents; ++n)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[n].type;
+        attr.config = events[n].config;
+        attr.disabled = fds.empty();
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // Count the calling thread on any cpu, the output thread is excluded.
+        const int group = fds.empty() ? -1 : fds[0];
+        const int fd = perf_event_open(&attr, 0, -1, group, 0);
+
+        if (fd == -1)
+        {
+            // Without the cycles as group leader no counter is available.
+            if (n == 0)
+            {
+                master->print_warning("hardware performance counters are not available, check perf_event_paranoid\n");
+                return;
+            }
+            master->print_warning("hardware performance counter %s is not available\n", events[n].name);
+            continue;
+        }
+
+        index[n] = nopen++;
+        fds.push_back(fd);
+    }
+
+    ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void Perf_counters::read_counts(std::vector<double>& values)
+{
+    if (nopen == 0)
+        return;
+
+    // The group is read as the number of events, the enabled and running time and the values.
+    std::vector<uint64_t> buffer(3+nopen);
+    if (read(fds[0], buffer.data(), buffer.size()*sizeof(uint64_t)) == -1)
+        return;
+
+    // Scale the counts if the group has been multiplexed with other events.
+    const double scale = (buffer[2] > 0) ? (double)buffer[1] / (double)buffer[2] : 1.;
+
+    for (int n=0; n<nevents; ++n)
+        if (index[n] >= 0)
+            values[n] = scale*buffer[3+index[n]];
+}
+
+void Perf_counters::start()
+{
+    if (fds.empty())
+        open();
+
+    counts.assign(nstages*nevents, 0.);
+    read_counts(last);
+}
+
+void Perf_counters::end_stage(const int stage)
+{
+    if (nopen == 0)
+        return;
+
+    std::vector<double> now(last);
+    read_counts(now);
+
+    for (int n=0; n<nevents; ++n)
+        counts[stage*nevents+n] += now[n] - last[n];
+
+    last.swap(now);
+}
+
+void Perf_counters::print(const char* const* stage_names, const std::vector<double>& stage_times)
+{
+    // An event is only reported if it is available on all processes.
+    std::vector<double> available(nevents);
+    for (int n=0; n<nevents; ++n)
+        available[n] = (index[n] >= 0) ? 1. : 0.;
+    master->min(available.data(), nevents);
+
+    master->sum(counts.data(), nstages*nevents);
+
+    // The cycles lead the group, without them none of the counters is available.
+    if (available[cycles] == 0.)
+    {
+        master->print_message("Hardware performance counters are not available on all processes\n");
+        return;
+    }
+
+    const long linesize = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+    const double bytes_per_miss = (linesize > 0) ? linesize : 64.;
+
+    master->print_message("Hardware performance counters, summed over all processes, -1 if not available\n");
+    master->print_message("  %-10s %12s %12s %6s %12s %7s %10s\n", "stage", "cycles", "instructions", "ipc", "llcmisses", "miss %", "GB/s");
+
+    if (master->mpiid != 0)
+        return;
+
+    std::string filename = master->simname + ".counters";
+    FILE* pFile = std::fopen(filename.c_str(), "w");
+    if (pFile == NULL)
+        master->print_warning("\"%s\" cannot be written\n", filename.c_str());
+    else
+    {
+        std::fprintf(pFile, "%-16s", "#STAGE");
+        for (int n=0; n<nevents; ++n)
+            std::fprintf(pFile, " %16s", events[n].name);
+        std::fprintf(pFile, " %10s %10s %16s\n", "ipc", "missratio", "bandwidth");
+    }
+
+    for (int s=0; s<nstages; ++s)
+    {
+        const double* c = &counts[s*nevents];
+
+        // The memory traffic is estimated as one cache line per last level cache miss, divided by the time of the slowest process.
+        const bool has_ipc  = available[cycles] > 0. && available[instructions] > 0. && c[cycles] > 0.;
+        const bool has_miss = available[llcloads] > 0. && available[llcmisses] > 0. && c[llcloads] > 0.;
+        const bool has_bw   = available[llcmisses] > 0. && stage_times[s] > 0.;
+
+        const double ipc       = has_ipc  ? c[instructions] / c[cycles] : -1.;
+        const double missratio = has_miss ? c[llcmisses] / c[llcloads] : -1.;
+        const double bandwidth = has_bw   ? bytes_per_miss*c[llcmisses] / stage_times[s] : -1.;
+
+        master->print_message("  %-10s %12.4E %12.4E %6.2f %12.4E %7.2f %10.3f\n", stage_names[s],
+                              c[cycles], available[instructions] > 0. ? c[instructions] : -1., ipc,
+                              available[llcmisses] > 0. ? c[llcmisses] : -1.,
+                              has_miss ? 100.*missratio : -1., has_bw ? 1.e-9*bandwidth : -1.);
+
+        if (pFile == NULL)
+            continue;
+
+        // Counters that are not available are written as -1.
+        std::fprintf(pFile, "%-16s", stage_names[s]);
+        for (int n=0; n<nevents; ++n)
+            std::fprintf(pFile, " %16.8E", (available[n] > 0.) ? c[n] : -1.);
+        std::fprintf(pFile, " %10.6f %10.6f %16.8E\n", ipc, missratio, bandwidth);
+    }
+
+    if (pFile != NULL)
+        std::fclose(pFile);
+}
+#endif
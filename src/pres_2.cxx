@@ -65,6 +65,9 @@ Pres_2::~Pres_2()
 #ifndef USECUDA
 void Pres_2::exec(double dt)
 {
+    Tmp_field tmp1 = fields->get_tmp();
+    Tmp_field tmp2 = fields->get_tmp();
+
     // create the input for the pressure solver
     input(fields->sd["p"]->data,
           fields->u ->data, fields->v ->data, fields->w ->data,
@@ -73,7 +76,7 @@ void Pres_2::exec(double dt)
           dt);
 
     // solve the system
-    solve(fields->sd["p"]->data, fields->atmp["tmp1"]->data, fields->atmp["tmp2"]->data,
+    solve(fields->sd["p"]->data, tmp1->data, tmp2->data,
           grid->dz, fields->rhoref,
           grid->fftini, grid->fftouti, grid->fftinj, grid->fftoutj);
 
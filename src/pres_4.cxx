@@ -113,16 +113,17 @@ void Pres_4::exec(double dt)
        reads in case jblock does not divide by 4. */
     const int jslice = 1;
 
-    double *tmp2 = fields->atmp["tmp2"]->data;
-    double *tmp3 = fields->atmp["tmp3"]->data;
+    Tmp_field tmp1 = fields->get_tmp();
+    Tmp_field tmp2 = fields->get_tmp();
+    Tmp_field tmp3 = fields->get_tmp();
 
     const int ns = grid->iblock*jslice*(grid->kmax+4);
 
-    solve(fields->sd["p"]->data, fields->atmp["tmp1"]->data, grid->dz,
+    solve(fields->sd["p"]->data, tmp1->data, grid->dz,
           m1, m2, m3, m4,
           m5, m6, m7,
-          &tmp2[0*ns], &tmp2[1*ns], &tmp2[2*ns], &tmp2[3*ns], 
-          &tmp3[0*ns], &tmp3[1*ns], &tmp3[2*ns], &tmp3[3*ns], 
+          &tmp2->data[0*ns], &tmp2->data[1*ns], &tmp2->data[2*ns], &tmp2->data[3*ns], 
+          &tmp3->data[0*ns], &tmp3->data[1*ns], &tmp3->data[2*ns], &tmp3->data[3*ns], 
           bmati, bmatj,
           jslice);
 
@@ -25,6 +25,8 @@
 #include <sstream>
 #include <iostream>
 #include <iomanip>
+#include <memory>
+#include <algorithm>
 #include "master.h"
 #include "grid.h"
 #include "fields.h"
@@ -42,20 +44,139 @@
 using namespace netCDF;
 using namespace netCDF::exceptions;
 
+namespace
+{
+    // Levels in which the mask covers less than this fraction of the cells are sampled through index lists.
+    const double sparse_fraction = 0.25;
+
+    // Entries of the record per level that is accumulated in calc_stats.
+    namespace Record
+    {
+        enum {n, mean, m2, m3, m4, nh, meanh, meanw, cov, grad, diff, flux, size};
+    }
+
+    // Add a sample with weight wgt to the running mean and central moments of a record.
+    inline void add_moments(double* const restrict r, const double x, const double wgt)
+    {
+        const double na = r[Record::n];
+        const double n  = na + wgt;
+        const double ni = 1./n;
+
+        const double delta  = x - r[Record::mean];
+        const double delta2 = delta*delta;
+
+        r[Record::m4] += delta2*delta2*na*wgt*(na*na - na*wgt + wgt*wgt)*ni*ni*ni
+                       + 6.*delta2*wgt*wgt*r[Record::m2]*ni*ni
+                       - 4.*delta*wgt*r[Record::m3]*ni;
+        r[Record::m3] += delta2*delta*na*wgt*(na - wgt)*ni*ni
+                       - 3.*delta*wgt*r[Record::m2]*ni;
+        r[Record::m2] += delta2*na*wgt*ni;
+        r[Record::mean] += delta*wgt*ni;
+        r[Record::n] = n;
+    }
+
+    // Add a sample pair with weight wgt to the running means and co-moment of a record.
+    inline void add_covariance(double* const restrict r, const double x, const double y, const double wgt)
+    {
+        const double n  = r[Record::nh] + wgt;
+        const double ni = 1./n;
+
+        const double deltax = x - r[Record::meanh];
+        r[Record::meanh] += deltax*wgt*ni;
+        r[Record::meanw] += (y - r[Record::meanw])*wgt*ni;
+        r[Record::cov]   += wgt*deltax*(y - r[Record::meanw]);
+        r[Record::nh] = n;
+    }
+
+    // Merge record b into record a, using the pairwise formulas of Chan et al. (1979) and Pebay (2008).
+    void merge_record(double* a, const double* b)
+    {
+        // Full level moments.
+        const double na = a[Record::n];
+        const double nb = b[Record::n];
+
+        if (nb > 0. && na == 0.)
+        {
+            for (int i=Record::n; i<=Record::m4; ++i)
+                a[i] = b[i];
+        }
+        else if (nb > 0.)
+        {
+            const double n  = na + nb;
+            const double ni = 1./n;
+
+            const double delta  = b[Record::mean] - a[Record::mean];
+            const double delta2 = delta*delta;
+
+            a[Record::m4] += b[Record::m4]
+                           + delta2*delta2*na*nb*(na*na - na*nb + nb*nb)*ni*ni*ni
+                           + 6.*delta2*(na*na*b[Record::m2] + nb*nb*a[Record::m2])*ni*ni
+                           + 4.*delta*(na*b[Record::m3] - nb*a[Record::m3])*ni;
+            a[Record::m3] += b[Record::m3]
+                           + delta2*delta*na*nb*(na - nb)*ni*ni
+                           + 3.*delta*(na*b[Record::m2] - nb*a[Record::m2])*ni;
+            a[Record::m2] += b[Record::m2] + delta2*na*nb*ni;
+            a[Record::mean] += delta*nb*ni;
+            a[Record::n] = n;
+        }
+
+        // Half level co-moment.
+        const double nha = a[Record::nh];
+        const double nhb = b[Record::nh];
+
+        if (nhb > 0. && nha == 0.)
+        {
+            for (int i=Record::nh; i<=Record::cov; ++i)
+                a[i] = b[i];
+        }
+        else if (nhb > 0.)
+        {
+            const double n  = nha + nhb;
+            const double ni = 1./n;
+
+            const double deltax = b[Record::meanh] - a[Record::meanh];
+            const double deltay = b[Record::meanw] - a[Record::meanw];
+
+            a[Record::cov]   += b[Record::cov] + deltax*deltay*nha*nhb*ni;
+            a[Record::meanh] += deltax*nhb*ni;
+            a[Record::meanw] += deltay*nhb*ni;
+            a[Record::nh] = n;
+        }
+
+        // Plain sums.
+        a[Record::grad] += b[Record::grad];
+        a[Record::diff] += b[Record::diff];
+        a[Record::flux] += b[Record::flux];
+    }
+}
+
 Stats::Stats(Model* modelin, Input* inputin)
 {
     model = modelin;
     master = model->master;
 
     // set the pointers to zero
-    nmask  = 0;
-    nmaskh = 0;
+    mask    = 0;
+    maskh   = 0;
+    maskbot = 0;
+    nmask   = 0;
+    nmaskh  = 0;
 
     int nerror = 0;
     nerror += inputin->get_item(&swstats, "stats", "swstats", "", "0");
 
     if (swstats == "1")
+    {
         nerror += inputin->get_item(&sampletime, "stats", "sampletime", "");
+        nerror += inputin->get_item(&swspectra, "stats", "swspectra", "", "0");
+        if (swspectra == "1")
+        {
+            nerror += inputin->get_list(&spectraz   , "stats", "spectraz"   , "");
+            nerror += inputin->get_list(&spectralist, "stats", "spectralist", "");
+        }
+    }
+    else
+        swspectra = "0";
 
     if (!(swstats == "0" || swstats == "1"))
     {
@@ -63,12 +184,26 @@ Stats::Stats(Model* modelin, Input* inputin)
         master->print_error("\"%s\" is an illegal value for swstats\n", swstats.c_str());
     }
 
+    if (!(swspectra == "0" || swspectra == "1"))
+    {
+        ++nerror;
+        master->print_error("\"%s\" is an illegal value for swspectra\n", swspectra.c_str());
+    }
+    else if (swspectra == "1" && spectraz.empty())
+    {
+        ++nerror;
+        master->print_error("swspectra requires at least one height in spectraz\n");
+    }
+
     if (nerror)
         throw 1;
 }
 
 Stats::~Stats()
 {
+    delete[] mask;
+    delete[] maskh;
+    delete[] maskbot;
     delete[] nmask;
     delete[] nmaskh;
 
@@ -78,6 +213,8 @@ Stats::~Stats()
         delete it->second.dataFile;
         for (Prof_map::const_iterator it2=it->second.profs.begin(); it2!=it->second.profs.end(); ++it2)
             delete[] it2->second.data;
+        for (Spec_map::const_iterator it2=it->second.specs.begin(); it2!=it->second.specs.end(); ++it2)
+            delete[] it2->second.data;
     }
 }
 
@@ -97,8 +234,11 @@ void Stats::init(double ifactor)
 
     isampletime = (unsigned long)(ifactor * sampletime);
 
-    nmask  = new int[grid->kcells];
-    nmaskh = new int[grid->kcells];
+    mask    = new unsigned char[grid->ncells];
+    maskh   = new unsigned char[grid->ncells];
+    maskbot = new unsigned char[grid->ijcells];
+    nmask   = new int[grid->kcells];
+    nmaskh  = new int[grid->kcells];
 
     // set the number of stats to zero
     nstats = 0;
@@ -112,6 +252,42 @@ void Stats::create(int n)
 
     int nerror = 0;
 
+    // select the levels closest to the requested heights of the spectra
+    if (swspectra == "1")
+    {
+        for (std::vector<double>::const_iterator it=spectraz.begin(); it!=spectraz.end(); ++it)
+        {
+            if (*it < 0. || *it > grid->zsize)
+            {
+                master->print_error("spectraz = %g is outside of the domain\n", *it);
+                throw 1;
+            }
+
+            int k  = grid->kstart;
+            int kh = grid->kstart;
+            for (int kk=grid->kstart; kk<grid->kend; ++kk)
+            {
+                if (std::abs(grid->z [kk]-*it) < std::abs(grid->z [k ]-*it))
+                    k = kk;
+                if (std::abs(grid->zh[kk]-*it) < std::abs(grid->zh[kh]-*it))
+                    kh = kk;
+            }
+            spectrak .push_back(k -grid->kstart);
+            spectrakh.push_back(kh-grid->kstart);
+        }
+
+        // the fourier transforms store the wavenumbers up to the nyquist wavenumber
+        nkx = grid->itot/2 + 1;
+        nky = grid->jtot/2 + 1;
+        const double pi = std::acos((double)-1.);
+        dkx = 2.*pi / grid->xsize;
+        dky = 2.*pi / grid->ysize;
+
+        // bin the horizontal wavenumber with the coarsest spacing, such that no bin is empty
+        dkh = std::max(dkx, dky);
+        nkh = (int)(std::sqrt(std::pow((nkx-1)*dkx, 2) + std::pow((nky-1)*dky, 2)) / dkh + 0.5) + 1;
+    }
+
     for (Mask_map::iterator it=masks.begin(); it!=masks.end(); ++it)
     {
         // shortcut
@@ -170,6 +346,10 @@ void Stats::create(int n)
             z_var .putVar(&grid->z [grid->kstart]);
             zh_var.putVar(&grid->zh[grid->kstart]);
 
+            // spectra are only computed over the full field
+            if (swspectra == "1" && m->name == "default")
+                create_spectra(m);
+
             // Synchronize the NetCDF file
             // BvS: only the last netCDF4-c++ includes the NcFile->sync()
             //      for now use sync() from the netCDF-C library to support older NetCDF4-c++ versions
@@ -183,6 +363,51 @@ void Stats::create(int n)
     add_prof("areah", "Fractional area contained in mask", "-", "zh");
 }
 
+void Stats::create_spectra(Mask* m)
+{
+    m->zs_dim  = m->dataFile->addDim("zs" , spectrak .size());
+    m->zhs_dim = m->dataFile->addDim("zhs", spectrakh.size());
+    m->kx_dim  = m->dataFile->addDim("kx", nkx);
+    m->ky_dim  = m->dataFile->addDim("ky", nky);
+    m->kh_dim  = m->dataFile->addDim("kh", nkh);
+
+    NcVar zs_var  = m->dataFile->addVar("zs" , ncDouble, m->zs_dim );
+    NcVar zhs_var = m->dataFile->addVar("zhs", ncDouble, m->zhs_dim);
+    NcVar kx_var  = m->dataFile->addVar("kx" , ncDouble, m->kx_dim );
+    NcVar ky_var  = m->dataFile->addVar("ky" , ncDouble, m->ky_dim );
+    NcVar kh_var  = m->dataFile->addVar("kh" , ncDouble, m->kh_dim );
+
+    zs_var .putAtt("units", "m");
+    zs_var .putAtt("long_name", "Full level height of the spectra");
+    zhs_var.putAtt("units", "m");
+    zhs_var.putAtt("long_name", "Half level height of the spectra");
+    kx_var .putAtt("units", "m-1");
+    kx_var .putAtt("long_name", "Wavenumber in the x-direction");
+    ky_var .putAtt("units", "m-1");
+    ky_var .putAtt("long_name", "Wavenumber in the y-direction");
+    kh_var .putAtt("units", "m-1");
+    kh_var .putAtt("long_name", "Horizontal wavenumber");
+
+    std::vector<double> zs, zhs, kx(nkx), ky(nky), kh(nkh);
+    for (size_t n=0; n<spectrak.size(); ++n)
+    {
+        zs .push_back(grid->z [spectrak [n]+grid->kstart]);
+        zhs.push_back(grid->zh[spectrakh[n]+grid->kstart]);
+    }
+    for (int n=0; n<nkx; ++n)
+        kx[n] = n*dkx;
+    for (int n=0; n<nky; ++n)
+        ky[n] = n*dky;
+    for (int n=0; n<nkh; ++n)
+        kh[n] = n*dkh;
+
+    zs_var .putVar(zs .data());
+    zhs_var.putVar(zhs.data());
+    kx_var .putVar(kx .data());
+    ky_var .putVar(ky .data());
+    kh_var .putVar(kh .data());
+}
+
 unsigned long Stats::get_time_limit(unsigned long itime)
 {
     if (swstats == "0")
@@ -225,28 +450,70 @@ void Stats::exec(int iteration, double time, unsigned long itime)
         // put the data into the NetCDF file
         if (master->mpiid == 0)
         {
-            const std::vector<size_t> time_index = {static_cast<size_t>(nstats)};
+            // copy the profiles and time series, such that they can be written while the model continues
+            std::shared_ptr<std::vector<std::vector<double>>> profs = std::make_shared<std::vector<std::vector<double>>>();
+            std::shared_ptr<std::vector<double>> tseries = std::make_shared<std::vector<double>>();
+            std::shared_ptr<std::vector<std::vector<double>>> specs = std::make_shared<std::vector<std::vector<double>>>();
+
+            // The sizes are stored at creation, as NetCDF is only called by the output thread once the files exist.
+            for (Prof_map::iterator it=m->profs.begin(); it!=m->profs.end(); ++it)
+                profs->push_back(std::vector<double>(&it->second.data[grid->kstart], &it->second.data[grid->kstart] + it->second.nlev));
+
+            for (Time_series_map::iterator it=m->tseries.begin(); it!=m->tseries.end(); ++it)
+                tseries->push_back(it->second.data);
 
-            m->t_var   .putVar(time_index, &time     );
-            m->iter_var.putVar(time_index, &iteration);
+            for (Spec_map::iterator it=m->specs.begin(); it!=m->specs.end(); ++it)
+                specs->push_back(std::vector<double>(it->second.data, it->second.data + it->second.nlev*it->second.nk));
 
-            const std::vector<size_t> time_height_index = {static_cast<size_t>(nstats), 0};
-            std::vector<size_t> time_height_size  = {1, 0};
+            const size_t istat = nstats;
 
-            for (Prof_map::const_iterator it=m->profs.begin(); it!=m->profs.end(); ++it)
+            grid->exec_output([m, istat, time, iteration, profs, tseries, specs]()
             {
-                time_height_size[1] = m->profs[it->first].ncvar.getDim(1).getSize();
-                m->profs[it->first].ncvar.putVar(time_height_index, time_height_size, &m->profs[it->first].data[grid->kstart]);
-            }
+                try
+                {
+                    const std::vector<size_t> time_index = {istat};
 
-            for (Time_series_map::const_iterator it=m->tseries.begin(); it!=m->tseries.end(); ++it)
-                m->tseries[it->first].ncvar.putVar(time_index, &m->tseries[it->first].data);
+                    m->t_var   .putVar(time_index, &time     );
+                    m->iter_var.putVar(time_index, &iteration);
 
-            // Synchronize the NetCDF file
-            // BvS: only the last netCDF4-c++ includes the NcFile->sync()
-            //      for now use sync() from the netCDF-C library to support older NetCDF4-c++ versions
-            //m->dataFile->sync();
-            nc_sync(m->dataFile->getId());
+                    const std::vector<size_t> time_height_index = {istat, 0};
+                    std::vector<size_t> time_height_size  = {1, 0};
+
+                    std::vector<std::vector<double>>::const_iterator prof = profs->begin();
+                    for (Prof_map::iterator it=m->profs.begin(); it!=m->profs.end(); ++it, ++prof)
+                    {
+                        time_height_size[1] = prof->size();
+                        it->second.ncvar.putVar(time_height_index, time_height_size, prof->data());
+                    }
+
+                    std::vector<double>::const_iterator series = tseries->begin();
+                    for (Time_series_map::iterator it=m->tseries.begin(); it!=m->tseries.end(); ++it, ++series)
+                        it->second.ncvar.putVar(time_index, &(*series));
+
+                    const std::vector<size_t> time_spec_index = {istat, 0, 0};
+                    std::vector<size_t> time_spec_size = {1, 0, 0};
+
+                    std::vector<std::vector<double>>::const_iterator spec = specs->begin();
+                    for (Spec_map::iterator it=m->specs.begin(); it!=m->specs.end(); ++it, ++spec)
+                    {
+                        time_spec_size[1] = it->second.nlev;
+                        time_spec_size[2] = it->second.nk;
+                        it->second.ncvar.putVar(time_spec_index, time_spec_size, spec->data());
+                    }
+
+                    // Synchronize the NetCDF file
+                    // BvS: only the last netCDF4-c++ includes the NcFile->sync()
+                    //      for now use sync() from the netCDF-C library to support older NetCDF4-c++ versions
+                    //m->dataFile->sync();
+                    nc_sync(m->dataFile->getId());
+                }
+                catch (NcException& e)
+                {
+                    return 1;
+                }
+
+                return 0;
+            }, master->simname + "." + m->name);
         }
     }
 
@@ -295,6 +562,7 @@ void Stats::add_prof(std::string name, std::string longname, std::string unit, s
         }
 
         // and allocate the memory and initialize at zero
+        m->profs[name].nlev = (zloc == "zh") ? grid->kmax+1 : grid->kmax;
         m->profs[name].data = new double[grid->kcells];
         for (int k=0; k<grid->kcells; ++k)
             m->profs[name].data[k] = 0.;
@@ -358,39 +626,244 @@ void Stats::add_time_series(std::string name, std::string longname, std::string
     }
 }
 
-void Stats::get_mask(Field3d* mfield, Field3d* mfieldh, Mask* m)
+void Stats::add_spectra(std::string name, std::string longname, std::string unit, std::string zloc)
+{
+    if (swspectra == "0")
+        return;
+
+    // an empty list selects all variables
+    if (!spectralist.empty() && std::find(spectralist.begin(), spectralist.end(), name) == spectralist.end())
+        return;
+
+    Mask* m = &masks["default"];
+
+    const int nlev = (zloc == "zh") ? spectrakh.size() : spectrak.size();
+    const std::string dirs[] = {"x", "y", "h"};
+    const std::string dirnames[] = {"in the x-direction", "in the y-direction", "over the horizontal wavenumber"};
+    const int nks[] = {nkx, nky, nkh};
+
+    for (int n=0; n<3; ++n)
+    {
+        Spec_var& spec = m->specs[name + "spec" + dirs[n]];
+
+        // create the NetCDF variable
+        if (master->mpiid == 0)
+        {
+            std::vector<NcDim> dim_vector = {m->t_dim};
+            dim_vector.push_back((zloc == "zh") ? m->zhs_dim : m->zs_dim);
+            dim_vector.push_back((n == 0) ? m->kx_dim : (n == 1) ? m->ky_dim : m->kh_dim);
+
+            spec.ncvar = m->dataFile->addVar(name + "spec" + dirs[n], ncDouble, dim_vector);
+            spec.ncvar.putAtt("units", "(" + unit + ")2 m");
+            spec.ncvar.putAtt("long_name", "Spectral density of the " + longname + " " + dirnames[n]);
+            spec.ncvar.putAtt("_FillValue", ncDouble, NC_FILL_DOUBLE);
+        }
+
+        // and allocate the memory and initialize at zero
+        spec.nlev = nlev;
+        spec.nk   = nks[n];
+        spec.data = new double[nlev*nks[n]];
+        for (int i=0; i<nlev*nks[n]; ++i)
+            spec.data[i] = 0.;
+    }
+}
+
+void Stats::get_mask(Mask* m)
 {
-    calc_mask(mfield->data, mfieldh->data, mfieldh->databot,
-              nmask, nmaskh, &nmaskbot);
+    calc_mask(mask, maskh, maskbot);
 }
 
-// COMPUTATIONAL KERNELS BELOW
-void Stats::calc_mask(double* restrict mask, double* restrict maskh, double* restrict maskbot,
-                      int* restrict nmask, int* restrict nmaskh, int* restrict nmaskbot)
+/**
+ * This function counts the cells in the mask that has been set in mask, maskh and maskbot,
+ * fills the ghost cells of the flags and creates the index lists of the levels in which the mask
+ * is sparse, such that the statistics kernels only visit the cells inside the mask there.
+ * The ghost levels are taken as fully inside the mask.
+ */
+void Stats::calc_mask_index()
 {
-    int ijtot = grid->itot*grid->jtot;
+    calc_mask_index(mask , nmask , index , grid->kend  );
+    calc_mask_index(maskh, nmaskh, indexh, grid->kend+1);
 
+    const int jj = grid->icells;
+
+    nmaskbot = 0;
+    for (int j=grid->jstart; j<grid->jend; ++j)
+        for (int i=grid->istart; i<grid->iend; ++i)
+            nmaskbot += maskbot[i + j*jj];
+
+    master->sum(&nmaskbot, 1);
+}
+
+// COMPUTATIONAL KERNELS BELOW
+void Stats::calc_mask(unsigned char* restrict mask, unsigned char* restrict maskh, unsigned char* restrict maskbot)
+{
     // set all the mask values to 1
     for (int n=0; n<grid->ncells; ++n)
-        mask[n] = 1.;
+        mask[n] = 1;
 
     for (int n=0; n<grid->ncells; ++n)
-        maskh[n] = 1.;
+        maskh[n] = 1;
 
     for (int n=0; n<grid->ijcells; ++n)
-        maskbot[n] = 1.;
+        maskbot[n] = 1;
+}
+
+void Stats::calc_mask_index(unsigned char* restrict mask, int* restrict nmask, Mask_index& index, const int kend)
+{
+    const int jj = grid->icells;
+    const int kk = grid->ijcells;
+    const int ijtot = grid->itot*grid->jtot;
+    const int nsparse = static_cast<int>(sparse_fraction*grid->imax*grid->jmax);
+
+    index.ijk.clear();
+    index.kbegin.resize(grid->kcells+1);
+    index.sparse.resize(grid->kcells);
 
     for (int k=0; k<grid->kcells; ++k)
     {
-        nmask [k] = ijtot;
-        nmaskh[k] = ijtot;
+        index.kbegin[k] = index.ijk.size();
+        index.sparse[k] = false;
+        nmask[k] = 0;
+
+        if (k < grid->kstart || k >= kend)
+        {
+            for (int n=k*kk; n<(k+1)*kk; ++n)
+                mask[n] = 1;
+            continue;
+        }
+
+        for (int j=grid->jstart; j<grid->jend; ++j)
+            #pragma ivdep
+            for (int i=grid->istart; i<grid->iend; ++i)
+            {
+                const int ijk = i + j*jj + k*kk;
+                nmask[k] += mask[ijk];
+            }
+
+        if (nmask[k] < nsparse)
+        {
+            index.sparse[k] = true;
+            for (int j=grid->jstart; j<grid->jend; ++j)
+                for (int i=grid->istart; i<grid->iend; ++i)
+                {
+                    const int ijk = i + j*jj + k*kk;
+                    if (mask[ijk])
+                        index.ijk.push_back(ijk);
+                }
+        }
+    }
+    index.kbegin[grid->kcells] = index.ijk.size();
+
+    grid->boundary_cyclic(mask);
+
+    master->sum(nmask, grid->kcells);
+
+    for (int k=0; k<grid->kcells; ++k)
+        if (k < grid->kstart || k >= kend)
+            nmask[k] = ijtot;
+}
+
+/**
+ * This function sums f(ijk) over the cells of level k that are inside the mask at location loc.
+ * At the horizontally staggered locations the mask is interpolated from the two neighbouring cell centers.
+ */
+template<class F>
+double Stats::calc_masked_sum(const int k, const int loc[3], F f)
+{
+    const int ii = 1;
+    const int jj = grid->icells;
+    const int kk = grid->ijcells;
+
+    const unsigned char* restrict m = (loc[2] == 1) ? maskh : mask;
+    const Mask_index& mindex = (loc[2] == 1) ? indexh : index;
+
+    double sum = 0.;
+
+    if (loc[0] == 1)
+    {
+        for (int j=grid->jstart; j<grid->jend; ++j)
+            #pragma ivdep
+            for (int i=grid->istart; i<grid->iend; ++i)
+            {
+                const int ijk = i + j*jj + k*kk;
+                sum += 0.5*(m[ijk-ii]+m[ijk])*f(ijk);
+            }
+    }
+    else if (loc[1] == 1)
+    {
+        for (int j=grid->jstart; j<grid->jend; ++j)
+            #pragma ivdep
+            for (int i=grid->istart; i<grid->iend; ++i)
+            {
+                const int ijk = i + j*jj + k*kk;
+                sum += 0.5*(m[ijk-jj]+m[ijk])*f(ijk);
+            }
+    }
+    else if (mindex.sparse[k])
+    {
+        for (int n=mindex.kbegin[k]; n<mindex.kbegin[k+1]; ++n)
+            sum += f(mindex.ijk[n]);
     }
-    *nmaskbot = ijtot;
+    else
+    {
+        for (int j=grid->jstart; j<grid->jend; ++j)
+            #pragma ivdep
+            for (int i=grid->istart; i<grid->iend; ++i)
+            {
+                const int ijk = i + j*jj + k*kk;
+                sum += m[ijk]*f(ijk);
+            }
+    }
+
+    return sum;
 }
 
-void Stats::calc_area(double* restrict area, const int loc[3], int* restrict nmask)
+/**
+ * This function calls f(ijk, weight) for the cells of level k that are inside the mask at location loc.
+ */
+template<class F>
+void Stats::visit_masked(const int k, const int loc[3], F f)
+{
+    const int ii = 1;
+    const int jj = grid->icells;
+    const int kk = grid->ijcells;
+
+    const unsigned char* restrict m = (loc[2] == 1) ? maskh : mask;
+    const Mask_index& mindex = (loc[2] == 1) ? indexh : index;
+
+    if (loc[0] == 1 || loc[1] == 1)
+    {
+        const int ijh = (loc[0] == 1) ? ii : jj;
+        for (int j=grid->jstart; j<grid->jend; ++j)
+            for (int i=grid->istart; i<grid->iend; ++i)
+            {
+                const int ijk = i + j*jj + k*kk;
+                const double wgt = 0.5*(m[ijk-ijh]+m[ijk]);
+                if (wgt > 0.)
+                    f(ijk, wgt);
+            }
+    }
+    else if (mindex.sparse[k])
+    {
+        for (int n=mindex.kbegin[k]; n<mindex.kbegin[k+1]; ++n)
+            f(mindex.ijk[n], 1.);
+    }
+    else
+    {
+        for (int j=grid->jstart; j<grid->jend; ++j)
+            for (int i=grid->istart; i<grid->iend; ++i)
+            {
+                const int ijk = i + j*jj + k*kk;
+                if (m[ijk])
+                    f(ijk, 1.);
+            }
+    }
+}
+
+void Stats::calc_area(double* restrict area, const int loc[3])
 {
     const int ijtot = grid->itot*grid->jtot;
+    const int* restrict nmask = (loc[2] == 1) ? nmaskh : this->nmask;
 
     for (int k=grid->kstart; k<grid->kend+loc[2]; k++)
     {
@@ -402,23 +875,12 @@ void Stats::calc_area(double* restrict area, const int loc[3], int* restrict nma
 }
 
 void Stats::calc_mean(double* const restrict prof, const double* const restrict data,
-                      const double offset, const int loc[3],
-                      const double* const restrict mask, const int * const restrict nmask)
+                      const double offset, const int loc[3])
 {
-    const int jj = grid->icells;
-    const int kk = grid->ijcells;
+    const int* restrict nmask = (loc[2] == 1) ? nmaskh : this->nmask;
 
     for (int k=1; k<grid->kcells; k++)
-    {
-        prof[k] = 0.;
-        for (int j=grid->jstart; j<grid->jend; j++)
-#pragma ivdep
-            for (int i=grid->istart; i<grid->iend; i++)
-            {
-                const int ijk  = i + j*jj + k*kk;
-                prof[k] += mask[ijk]*(data[ijk] + offset);
-            }
-    }
+        prof[k] = calc_masked_sum(k, loc, [&](const int ijk) { return data[ijk] + offset; });
 
     master->sum(prof, grid->kcells);
 
@@ -432,12 +894,11 @@ void Stats::calc_mean(double* const restrict prof, const double* const restrict
 }
 
 void Stats::calc_mean2d(double* const restrict mean, const double* const restrict data,
-                        const double offset,
-                        const double* const restrict mask, const int * const restrict nmask)
+                        const double offset)
 {
     const int jj = grid->icells;
 
-    if (*nmask > nthres)
+    if (nmaskbot > nthres)
     {
         *mean = 0.;
         for (int j=grid->jstart; j<grid->jend; j++)
@@ -445,10 +906,10 @@ void Stats::calc_mean2d(double* const restrict mean, const double* const restric
             for (int i=grid->istart; i<grid->iend; i++)
             {
                 const int ij = i + j*jj;
-                *mean += mask[ij]*(data[ij] + offset);
+                *mean += maskbot[ij]*(data[ij] + offset);
             }
         master->sum(mean,1);
-        *mean /= (double)*nmask;
+        *mean /= (double)nmaskbot;
     }
     else
         *mean = NC_FILL_DOUBLE;
@@ -580,24 +1041,12 @@ void Stats::calc_sorted_prof(double* restrict data, double* restrict bin, double
 }
 
 // \TODO the count function assumes that the variable to count is at the mask location
-void Stats::calc_count(double* restrict data, double* restrict prof, double threshold,
-                       double* restrict mask, int* restrict nmask)
+void Stats::calc_count(double* restrict data, double* restrict prof, double threshold)
 {
-    const int jj = grid->icells;
-    const int kk = grid->ijcells;
+    const int sloc[3] = {0,0,0};
 
     for (int k=0; k<grid->kcells; ++k)
-    {
-        prof[k] = 0.;
-        for (int j=grid->jstart; j<grid->jend; ++j)
-#pragma ivdep
-            for (int i=grid->istart; i<grid->iend; ++i)
-            {
-                const int ijk = i + j*jj + k*kk;
-                if (data[ijk] > threshold)
-                    prof[k] += mask[ijk]*1.;
-            }
-    }
+        prof[k] = calc_masked_sum(k, sloc, [&](const int ijk) { return (data[ijk] > threshold) ? 1. : 0.; });
 
     master->sum(prof, grid->kcells);
 
@@ -610,352 +1059,201 @@ void Stats::calc_count(double* restrict data, double* restrict prof, double thre
     }
 }
 
-void Stats::calc_moment(double* restrict data, double* restrict datamean, double* restrict prof, double power, const int loc[3],
-                        double* restrict mask, int* restrict nmask)
+/**
+ * This function computes the mean, the central moments, the gradient, the turbulent flux and the diffusive flux
+ * of a variable in a single sweep over the field and a single collective. Per level, the mean and moments
+ * and the co-moment with w are accumulated following Welford, the contributions of the processes are
+ * combined with the pairwise merge formulas. Profiles are only stored if they have been added to the mask.
+ * @param m Pointer to the mask.
+ * @param name Name of the variable.
+ * @param data Pointer to the field.
+ * @param offset Offset that is added to the mean (the Galilean transformation).
+ * @param loc Location of the field.
+ * @param datamean Pointer to the output mean profile without offset, can be NULL.
+ * @param w Pointer to the vertical velocity, if NULL only the mean and the moments are computed.
+ * @param evisc Pointer to the eddy viscosity, if NULL the diffusive flux is computed from the gradient.
+ * @param fluxbot Pointer to the surface flux (only used if evisc is set).
+ * @param fluxtop Pointer to the top flux (only used if evisc is set).
+ * @param diffcoef Viscosity, or the turbulent Prandtl number in case evisc is set.
+ */
+void Stats::calc_stats(Mask* m, const std::string name, double* restrict data, const double offset, const int loc[3],
+                       double* restrict datamean, double* restrict w,
+                       double* restrict evisc, double* restrict fluxbot, double* restrict fluxtop, const double diffcoef)
 {
-    const int jj = grid->icells;
-    const int kk = grid->ijcells;
-
-    for (int k=grid->kstart; k<grid->kend+1; ++k)
-    {
-        prof[k] = 0.;
-        for (int j=grid->jstart; j<grid->jend; ++j)
-#pragma ivdep
-            for (int i=grid->istart; i<grid->iend; ++i)
-            {
-                const int ijk = i + j*jj + k*kk;
-                prof[k] += mask[ijk]*std::pow(data[ijk]-datamean[k], power);
-            }
-    }
+    using namespace Finite_difference::O4;
 
-    master->sum(prof, grid->kcells);
+    const int ii1 = 1;
+    const int jj1 = 1*grid->icells;
+    const int kk1 = 1*grid->ijcells;
+    const int kk2 = 2*grid->ijcells;
 
-    for (int k=1; k<grid->kcells; k++)
-    {
-        if (nmask[k] > nthres)
-            prof[k] /= (double)(nmask[k]);
-        else
-            prof[k] = NC_FILL_DOUBLE;
-    }
-}
+    const int kstart = grid->kstart;
+    const int kend   = grid->kend;
 
-void Stats::calc_flux_2nd(double* restrict data, double* restrict datamean, double* restrict w, double* restrict wmean,
-                          double* restrict prof, double* restrict tmp1, const int loc[3],
-                          double* restrict mask, int* restrict nmask)
-{
-    const int jj = grid->icells;
-    const int kk = grid->ijcells;
+    const double dxi = 1./grid->dx;
+    const double dyi = 1./grid->dy;
 
-    // set a pointer to the field that contains w, either interpolated or the original
-    double* restrict calcw = w;
+    const double* restrict dzhi  = grid->dzhi;
+    const double* restrict dzhi4 = grid->dzhi4;
 
-    // define the locations
-    const int wloc [3] = {0,0,1};
-    const int uwloc[3] = {1,0,1};
-    const int vwloc[3] = {0,1,1};
+    const bool fourth_order = (grid->swspatialorder == "4");
 
-    if (loc[0] == 1)
-    {
-        grid->interpolate_2nd(tmp1, w, wloc, uwloc);
-        calcw = tmp1;
-    }
-    else if (loc[1] == 1)
-    {
-        grid->interpolate_2nd(tmp1, w, wloc, vwloc);
-        calcw = tmp1;
-    }
+    // The horizontal shift of w towards the location of the variable.
+    const int ijh = (loc[0] == 1) ? ii1 : (loc[1] == 1) ? jj1 : 0;
+    const int ijh2 = 2*ijh;
 
-    for (int k=grid->kstart; k<grid->kend+1; ++k)
-    {
-        prof[k] = 0.;
-        for (int j=grid->jstart; j<grid->jend; ++j)
-#pragma ivdep
-            for (int i=grid->istart; i<grid->iend; ++i)
-            {
-                const int ijk  = i + j*jj + k*kk;
-                prof[k] += mask[ijk]*(0.5*(data[ijk-kk]+data[ijk])-0.5*(datamean[k-1]+datamean[k]))*(calcw[ijk]-wmean[k]);
-                // prof[k] += mask[ijk]*0.5*(data[ijk-kk]+data[ijk])*calcw[ijk];
-            }
-    }
+    // The flux, gradient and diffusive flux are computed on the half level.
+    const int halfloc[3] = {loc[0],loc[1],1};
 
-    master->sum(prof, grid->kcells);
+    std::vector<double> records(grid->kcells*Record::size, 0.);
 
     for (int k=1; k<grid->kcells; ++k)
     {
-        if (nmask[k] > nthres && datamean[k-1] != NC_FILL_DOUBLE && datamean[k] != NC_FILL_DOUBLE)
-            prof[k] /= (double)(nmask[k]);
-        else
-            prof[k] = NC_FILL_DOUBLE;
-    }
-}
+        double* const restrict r = &records[k*Record::size];
 
-void Stats::calc_flux_4th(double* restrict data, double* restrict w, double* restrict prof, double* restrict tmp1, const int loc[3],
-                          double* restrict mask, int* restrict nmask)
-{
-    using namespace Finite_difference::O4;
-
-    const int jj  = 1*grid->icells;
-    const int kk1 = 1*grid->ijcells;
-    const int kk2 = 2*grid->ijcells;
-
-    // set a pointer to the field that contains w, either interpolated or the original
-    double* restrict calcw = w;
+        visit_masked(k, loc, [&](const int ijk, const double wgt) { add_moments(r, data[ijk], wgt); });
 
-    // define the locations
-    const int wloc [3] = {0,0,1};
-    const int uwloc[3] = {1,0,1};
-    const int vwloc[3] = {0,1,1};
-
-    if (loc[0] == 1)
-    {
-        grid->interpolate_4th(tmp1, w, wloc, uwloc);
-        calcw = tmp1;
-    }
-    else if (loc[1] == 1)
-    {
-        grid->interpolate_4th(tmp1, w, wloc, vwloc);
-        calcw = tmp1;
-    }
+        if (w == 0 || k < kstart || k > kend)
+            continue;
 
-    for (int k=grid->kstart; k<grid->kend+1; ++k)
-    {
-        prof[k] = 0.;
-        for (int j=grid->jstart; j<grid->jend; ++j)
-#pragma ivdep
-            for (int i=grid->istart; i<grid->iend; ++i)
+        visit_masked(k, halfloc, [&](const int ijk, const double wgt)
+        {
+            if (fourth_order)
             {
-                const int ijk = i + j*jj + k*kk1;
-                prof[k] += mask[ijk]*(ci0*data[ijk-kk2] + ci1*data[ijk-kk1] + ci2*data[ijk] + ci3*data[ijk+kk1])*calcw[ijk];
-            }
-    }
+                const double datah = ci0*data[ijk-kk2] + ci1*data[ijk-kk1] + ci2*data[ijk] + ci3*data[ijk+kk1];
+                const double calcw = (ijh == 0) ? w[ijk] :
+                                     ci0*w[ijk-ijh2] + ci1*w[ijk-ijh] + ci2*w[ijk] + ci3*w[ijk+ijh];
 
-    master->sum(prof, grid->kcells);
+                r[Record::flux] += wgt*datah*calcw;
+                r[Record::grad] += wgt*(cg0*data[ijk-kk2] + cg1*data[ijk-kk1] + cg2*data[ijk] + cg3*data[ijk+kk1])*dzhi4[k];
+            }
+            else
+            {
+                const double datah = 0.5*(data[ijk-kk1] + data[ijk]);
+                const double calcw = 0.5*(w[ijk-ijh] + w[ijk]);
 
-    for (int k=1; k<grid->kcells; k++)
-    {
-        if (nmask[k] > nthres)
-            prof[k] /= (double)(nmask[k]);
-        else
-            prof[k] = NC_FILL_DOUBLE;
-    }
-}
+                add_covariance(r, datah, calcw, wgt);
+                r[Record::grad] += wgt*(data[ijk]-data[ijk-kk1])*dzhi[k];
+            }
 
-void Stats::calc_grad_2nd(double* restrict data, double* restrict prof, double* restrict dzhi, const int loc[3],
-                          double* restrict mask, int* restrict nmask)
-{
-    const int jj = grid->icells;
-    const int kk = grid->ijcells;
+            if (evisc == 0)
+                return;
 
-    for (int k=grid->kstart; k<grid->kend+1; ++k)
-    {
-        prof[k] = 0.;
-        for (int j=grid->jstart; j<grid->jend; ++j)
-#pragma ivdep
-            for (int i=grid->istart; i<grid->iend; ++i)
+            if (k == kstart)
+                r[Record::diff] += wgt*fluxbot[ijk-kstart*kk1];
+            else if (k == kend)
+                r[Record::diff] += wgt*fluxtop[ijk-kend*kk1];
+            else if (loc[0] == 1)
             {
-                const int ijk = i + j*jj + k*kk;
-                prof[k] += mask[ijk]*(data[ijk]-data[ijk-kk])*dzhi[k];
+                // evisc * (du/dz + dw/dx)
+                const double eviscu = 0.25*(evisc[ijk-ii1-kk1]+evisc[ijk-ii1]+evisc[ijk-kk1]+evisc[ijk]);
+                r[Record::diff] -= wgt*eviscu*( (data[ijk]-data[ijk-kk1])*dzhi[k] + (w[ijk]-w[ijk-ii1])*dxi );
             }
-    }
-
-    master->sum(prof, grid->kcells);
-
-    for (int k=1; k<grid->kcells; k++)
-    {
-        if (nmask[k] > nthres)
-            prof[k] /= (double)(nmask[k]);
-        else
-            prof[k] = NC_FILL_DOUBLE;
-    }
-}
-
-void Stats::calc_grad_4th(double* restrict data, double* restrict prof, double* restrict dzhi4, const int loc[3],
-                          double* restrict mask, int* restrict nmask)
-{
-    using namespace Finite_difference::O4;
-
-    const int jj  = 1*grid->icells;
-    const int kk1 = 1*grid->ijcells;
-    const int kk2 = 2*grid->ijcells;
-
-    for (int k=grid->kstart; k<grid->kend+1; ++k)
-    {
-        prof[k] = 0.;
-        for (int j=grid->jstart; j<grid->jend; ++j)
-#pragma ivdep
-            for (int i=grid->istart; i<grid->iend; ++i)
+            else if (loc[1] == 1)
+            {
+                // evisc * (dv/dz + dw/dy)
+                const double eviscv = 0.25*(evisc[ijk-jj1-kk1]+evisc[ijk-jj1]+evisc[ijk-kk1]+evisc[ijk]);
+                r[Record::diff] -= wgt*eviscv*( (data[ijk]-data[ijk-kk1])*dzhi[k] + (w[ijk]-w[ijk-jj1])*dyi );
+            }
+            else
             {
-                const int ijk = i + j*jj + k*kk1;
-                prof[k] += mask[ijk]*(cg0*data[ijk-kk2] + cg1*data[ijk-kk1] + cg2*data[ijk] + cg3*data[ijk+kk1])*dzhi4[k];
+                const double eviscs = 0.5*(evisc[ijk-kk1]+evisc[ijk])/diffcoef;
+                r[Record::diff] -= wgt*eviscs*(data[ijk]-data[ijk-kk1])*dzhi[k];
             }
+        });
     }
 
-    master->sum(prof, grid->kcells);
+    // Merge the records of all processes in one collective.
+    master->merge(records.data(), grid->kcells, Record::size, merge_record);
 
-    for (int k=1; k<grid->kcells; k++)
+    // Retrieve the output profiles, the ones that have not been added to the mask are skipped.
+    std::vector<double*> moments(5, static_cast<double*>(0));
+    for (int n=2; n<5; ++n)
     {
-        if (nmask[k] > nthres)
-            prof[k] /= (double)(nmask[k]);
-        else
-            prof[k] = NC_FILL_DOUBLE;
+        std::stringstream ss;
+        ss << n;
+        Prof_map::iterator it = m->profs.find(name + ss.str());
+        if (it != m->profs.end())
+            moments[n] = it->second.data;
     }
-}
 
-void Stats::calc_diff_4th(double* restrict data, double* restrict prof, double* restrict dzhi4, double visc, const int loc[3],
-                          double* restrict mask, int* restrict nmask)
-{
-    using namespace Finite_difference::O4;
+    Prof_map::iterator it = m->profs.find(name);
+    double* restrict prof = (it != m->profs.end()) ? it->second.data : 0;
 
-    const int jj  = 1*grid->icells;
-    const int kk1 = 1*grid->ijcells;
-    const int kk2 = 2*grid->ijcells;
+    const int* restrict nmask = (loc[2] == 1) ? nmaskh : this->nmask;
 
-    for (int k=grid->kstart; k<grid->kend+1; ++k)
-    {
-        prof[k] = 0.;
-        for (int j=grid->jstart; j<grid->jend; ++j)
-#pragma ivdep
-            for (int i=grid->istart; i<grid->iend; ++i)
-            {
-                const int ijk = i + j*jj + k*kk1;
-                prof[k] -= mask[ijk]*visc*(cg0*data[ijk-kk2] + cg1*data[ijk-kk1] + cg2*data[ijk] + cg3*data[ijk+kk1])*dzhi4[k];
-            }
-    }
+    // Keep a mean profile without offset for the fluxes.
+    std::vector<double> mean(grid->kcells, NC_FILL_DOUBLE);
 
-    master->sum(prof, grid->kcells);
-
-    for (int k=1; k<grid->kcells; k++)
+    for (int k=1; k<grid->kcells; ++k)
     {
+        const double* const restrict r = &records[k*Record::size];
+
         if (nmask[k] > nthres)
-            prof[k] /= (double)(nmask[k]);
-        else
-            prof[k] = NC_FILL_DOUBLE;
-    }
-}
+            mean[k] = r[Record::mean];
 
-void Stats::calc_diff_2nd(double* restrict data, double* restrict prof, double* restrict dzhi, double visc, const int loc[3],
-                          double* restrict mask, int* restrict nmask)
-{
-    const int jj = grid->icells;
-    const int kk = grid->ijcells;
+        if (prof)
+            prof[k] = (nmask[k] > nthres) ? mean[k] + offset : NC_FILL_DOUBLE;
+        if (datamean)
+            datamean[k] = mean[k];
 
-    for (int k=grid->kstart; k<grid->kend+1; ++k)
-    {
-        prof[k] = 0.;
-        for (int j=grid->jstart; j<grid->jend; ++j)
-#pragma ivdep
-            for (int i=grid->istart; i<grid->iend; ++i)
-            {
-                const int ijk = i + j*jj + k*kk;
-                prof[k] -= mask[ijk]*visc*(data[ijk] - data[ijk-kk])*dzhi[k];
-            }
+        // The moments are only computed within the domain.
+        if (k < kstart || k > kend)
+            continue;
+
+        for (int n=2; n<5; ++n)
+            if (moments[n])
+                moments[n][k] = (nmask[k] > nthres) ? r[Record::m2 + n-2] / r[Record::n] : NC_FILL_DOUBLE;
     }
 
-    master->sum(prof, grid->kcells);
+    if (w == 0)
+        return;
 
-    for (int k=1; k<grid->kcells; k++)
-    {
-        if (nmask[k] > nthres)
-            prof[k] /= (double)(nmask[k]);
-        else
-            prof[k] = NC_FILL_DOUBLE;
-    }
-}
+    it = m->profs.find(name + "grad");
+    double* restrict grad = (it != m->profs.end()) ? it->second.data : 0;
+    it = m->profs.find(name + "w");
+    double* restrict flux = (it != m->profs.end()) ? it->second.data : 0;
+    it = m->profs.find(name + "diff");
+    double* restrict diff = (it != m->profs.end()) ? it->second.data : 0;
 
+    // The mean vertical velocity is needed to shift the co-moment of the 2nd order flux.
+    it = m->profs.find("w");
+    const double* restrict wmean = (it != m->profs.end()) ? it->second.data : 0;
 
-void Stats::calc_diff_2nd(double* restrict data, double* restrict w, double* restrict evisc,
-                          double* restrict prof, double* restrict dzhi,
-                          double* restrict fluxbot, double* restrict fluxtop, double tPr, const int loc[3],
-                          double* restrict mask, int* restrict nmask)
-{
-    const int ii = 1;
-    const int jj = grid->icells;
-    const int kk = grid->ijcells;
-    const int kstart = grid->kstart;
-    const int kend = grid->kend;
+    for (int k=kstart; k<kend+1; ++k)
+    {
+        const double* const restrict r = &records[k*Record::size];
+        const bool valid = nmaskh[k] > nthres;
 
-    const double dxi = 1./grid->dx;
-    const double dyi = 1./grid->dy;
+        const double gradk = valid ? r[Record::grad] / nmaskh[k] : NC_FILL_DOUBLE;
 
-    // bottom boundary
-    prof[kstart] = 0.;
-    for (int j=grid->jstart; j<grid->jend; ++j)
-#pragma ivdep
-        for (int i=grid->istart; i<grid->iend; ++i)
-        {
-            const int ij  = i + j*jj;
-            const int ijk = i + j*jj + kstart*kk;
-            prof[kstart] += mask[ijk]*fluxbot[ij];
-        }
+        if (grad)
+            grad[k] = gradk;
 
-    // calculate the interior
-    if (loc[0] == 1)
-    {
-        for (int k=grid->kstart+1; k<grid->kend; ++k)
+        if (flux)
         {
-            prof[k] = 0.;
-            for (int j=grid->jstart; j<grid->jend; ++j)
-#pragma ivdep
-                for (int i=grid->istart; i<grid->iend; ++i)
-                {
-                    const int ijk  = i + j*jj + k*kk;
-                    // evisc * (du/dz + dw/dx)
-                    const double eviscu = 0.25*(evisc[ijk-ii-kk]+evisc[ijk-ii]+evisc[ijk-kk]+evisc[ijk]);
-                    prof[k] += -mask[ijk]*eviscu*( (data[ijk]-data[ijk-kk])*dzhi[k] + (w[ijk]-w[ijk-ii])*dxi );
-                }
-        }
-    }
-    else if (loc[1] == 1)
-    {
-        for (int k=grid->kstart+1; k<grid->kend; ++k)
-        {
-            prof[k] = 0.;
-            for (int j=grid->jstart; j<grid->jend; ++j)
-#pragma ivdep
-                for (int i=grid->istart; i<grid->iend; ++i)
-                {
-                    const int ijk = i + j*jj + k*kk;
-                    // evisc * (dv/dz + dw/dy)
-                    const double eviscv = 0.25*(evisc[ijk-jj-kk]+evisc[ijk-jj]+evisc[ijk-kk]+evisc[ijk]);
-                    prof[k] += -mask[ijk]*eviscv*( (data[ijk]-data[ijk-kk])*dzhi[k] + (w[ijk]-w[ijk-jj])*dyi );
-                }
-        }
-    }
-    else
-    {
-        for (int k=grid->kstart+1; k<grid->kend; ++k)
-        {
-            prof[k] = 0.;
-            for (int j=grid->jstart; j<grid->jend; ++j)
-#pragma ivdep
-                for (int i=grid->istart; i<grid->iend; ++i)
-                {
-                    const int ijk = i + j*jj + k*kk;
-                    const double eviscs = 0.5*(evisc[ijk-kk]+evisc[ijk])/tPr;
-                    prof[k] += -mask[ijk]*eviscs*(data[ijk]-data[ijk-kk])*dzhi[k];
-                }
+            if (fourth_order)
+                flux[k] = valid ? r[Record::flux] / nmaskh[k] : NC_FILL_DOUBLE;
+            // Shift the co-moment from the sample means to the interpolated mean profiles.
+            else if (valid && wmean && mean[k-1] != NC_FILL_DOUBLE && mean[k] != NC_FILL_DOUBLE)
+            {
+                const double meanh = 0.5*(mean[k-1] + mean[k]);
+                flux[k] = ( r[Record::cov]
+                          + r[Record::nh]*(r[Record::meanh] - meanh)*(r[Record::meanw] - wmean[k]) ) / r[Record::nh];
+            }
+            else
+                flux[k] = NC_FILL_DOUBLE;
         }
-    }
 
-    // top boundary
-    prof[kend] = 0.;
-    for (int j=grid->jstart; j<grid->jend; ++j)
-#pragma ivdep
-        for (int i=grid->istart; i<grid->iend; ++i)
+        if (diff)
         {
-            const int ij  = i + j*jj;
-            const int ijk = i + j*jj + kend*kk;
-            prof[kend] += mask[ijk]*fluxtop[ij];
+            if (!valid)
+                diff[k] = NC_FILL_DOUBLE;
+            else if (evisc)
+                diff[k] = r[Record::diff] / nmaskh[k];
+            else
+                diff[k] = -diffcoef*gradk;
         }
-
-    master->sum(prof, grid->kcells);
-
-    for (int k=1; k<grid->kcells; k++)
-    {
-        if (nmask[k] > nthres)
-            prof[k] /= (double)(nmask[k]);
-        else
-            prof[k] = NC_FILL_DOUBLE;
     }
 }
 
@@ -973,7 +1271,7 @@ void Stats::add_fluxes(double* restrict flux, double* restrict turb, double* res
 /**
  * This function calculates the total domain integrated path of variable data over maskbot
  */
-void Stats::calc_path(double* restrict data, double* restrict maskbot, int* restrict nmaskbot, double* restrict path)
+void Stats::calc_path(double* restrict data, double* restrict path)
 {
     const int jj = grid->icells;
     const int kk = grid->ijcells;
@@ -981,7 +1279,7 @@ void Stats::calc_path(double* restrict data, double* restrict maskbot, int* rest
 
     *path = 0.;
 
-    if (*nmaskbot > nthres)
+    if (nmaskbot > nthres)
     {
         // Integrate liquid water
         for (int j=grid->jstart; j<grid->jend; j++)
@@ -995,7 +1293,7 @@ void Stats::calc_path(double* restrict data, double* restrict maskbot, int* rest
                         *path += fields->rhoref[k] * data[ijk] * grid->dz[k];
                     }
             }
-        *path /= (double)*nmaskbot;
+        *path /= (double)nmaskbot;
         master->sum(path, 1);
     }
     else
@@ -1005,7 +1303,7 @@ void Stats::calc_path(double* restrict data, double* restrict maskbot, int* rest
 /**
  * This function calculates the vertical projected cover of variable data over maskbot
  */
-void Stats::calc_cover(double* restrict data, double* restrict maskbot, int* restrict nmaskbot, double* restrict cover, double threshold)
+void Stats::calc_cover(double* restrict data, double* restrict cover, double threshold)
 {
     const int jj = grid->icells;
     const int kk = grid->ijcells;
@@ -1013,7 +1311,7 @@ void Stats::calc_cover(double* restrict data, double* restrict maskbot, int* res
 
     *cover = 0.;
 
-    if (*nmaskbot > nthres)
+    if (nmaskbot > nthres)
     {
         // Per column, check if cloud present
         for (int j=grid->jstart; j<grid->jend; j++)
@@ -1031,9 +1329,116 @@ void Stats::calc_cover(double* restrict data, double* restrict maskbot, int* res
                         }
                     }
             }
-        *cover /= (double)*nmaskbot;
+        *cover /= (double)nmaskbot;
         master->sum(cover,1);
     }
     else
         *cover = NC_FILL_DOUBLE;
 }
+
+/**
+ * This function computes the spectral densities of a field at the selected heights. The field is
+ * transformed with the fourier transforms of the pressure solver, after which every process bins the
+ * squared coefficients of its block of wavenumbers. The density is normalized such that its integral over
+ * the wavenumbers equals the mean of the squared field, the mean itself is contained in the first bin.
+ */
+void Stats::calc_spectra(Mask* m, const std::string name, const double* const restrict data,
+                         const double offset, const int loc[3])
+{
+    // only the variables that are registered with add_spectra are processed
+    Spec_map::iterator itx = m->specs.find(name + "specx");
+    if (itx == m->specs.end())
+        return;
+
+    double* const restrict specx = itx->second.data;
+    double* const restrict specy = m->specs[name + "specy"].data;
+    double* const restrict spech = m->specs[name + "spech"].data;
+
+    const std::vector<int>& klist = loc[2] ? spectrakh : spectrak;
+    const int nlev = klist.size();
+
+    const int imax   = grid->imax;
+    const int jmax   = grid->jmax;
+    const int kmax   = grid->kmax;
+    const int iblock = grid->iblock;
+    const int jblock = grid->jblock;
+    const int itot   = grid->itot;
+    const int jtot   = grid->jtot;
+
+    const int jj = grid->icells;
+    const int kk = grid->ijcells;
+
+    const int jjp = imax;
+    const int kkp = imax*jmax;
+
+    Tmp_field tmp1 = fields->get_tmp();
+    Tmp_field tmp2 = fields->get_tmp();
+
+    double* const restrict fld = tmp1->data;
+
+    // write the field as a 3d array without ghost cells, as the pressure solver does
+    for (int k=0; k<kmax; k++)
+        for (int j=0; j<jmax; j++)
+#pragma ivdep
+            for (int i=0; i<imax; i++)
+            {
+                const int ijkp = i + j*jjp + k*kkp;
+                const int ijk  = i+grid->igc + (j+grid->jgc)*jj + (k+grid->kgc)*kk;
+                fld[ijkp] = data[ijk] + offset;
+            }
+
+    grid->fft_forward(fld, tmp2->data, grid->fftini, grid->fftouti, grid->fftinj, grid->fftoutj);
+
+    for (int n=0; n<nlev*nkx; ++n)
+        specx[n] = 0.;
+    for (int n=0; n<nlev*nky; ++n)
+        specy[n] = 0.;
+    for (int n=0; n<nlev*nkh; ++n)
+        spech[n] = 0.;
+
+    // the coefficients of both fourier transforms are stored in half complex format, with the real parts
+    // of the wavenumbers up to the nyquist wavenumber followed by the imaginary parts in reversed order
+    const double norm = 1. / ((double)itot*jtot*itot*jtot);
+
+    const int jjb = iblock;
+    const int kkb = iblock*jblock;
+
+    for (int n=0; n<nlev; ++n)
+    {
+        const int k = klist[n];
+        for (int j=0; j<jblock; j++)
+            for (int i=0; i<iblock; i++)
+            {
+                // swap the mpicoords, because domain is turned 90 degrees to avoid two mpi transposes
+                const int iindex = master->mpicoordy * iblock + i;
+                const int jindex = master->mpicoordx * jblock + j;
+
+                const int ik = std::min(iindex, itot-iindex);
+                const int jk = std::min(jindex, jtot-jindex);
+
+                // all wavenumbers, except for the mean and the nyquist wavenumber, occur twice in the full spectrum
+                const double wgt = ((ik == 0 || 2*ik == itot) ? 1. : 2.) * ((jk == 0 || 2*jk == jtot) ? 1. : 2.);
+
+                const double c = fld[i + j*jjb + k*kkb];
+                const double power = wgt*c*c*norm;
+
+                const int hk = (int)(std::sqrt(std::pow(ik*dkx, 2) + std::pow(jk*dky, 2)) / dkh + 0.5);
+
+                specx[n*nkx+ik] += power;
+                specy[n*nky+jk] += power;
+                spech[n*nkh+hk] += power;
+            }
+    }
+
+    master->sum(specx, nlev*nkx);
+    master->sum(specy, nlev*nky);
+    master->sum(spech, nlev*nkh);
+
+    // convert the power per wavenumber into a density
+    for (int n=0; n<nlev*nkx; ++n)
+        specx[n] /= dkx;
+    for (int n=0; n<nlev*nky; ++n)
+        specy[n] /= dky;
+    for (int n=0; n<nlev*nkh; ++n)
+        spech[n] /= dkh;
+}
@@ -213,6 +213,25 @@ namespace
                             + cosalpha * (  ci0*w[ijk-kk1] + ci1*w[ijk] + ci2*w[ijk+kk1] + ci3*w[ijk+kk2]) );
         }
     }
+
+    __global__ 
+    void calc_N2_g(double* __restrict__ N2, const double* const __restrict__ b,
+                   const double* const __restrict__ dzi,
+                   const double n2, const double cosalpha,
+                   const int istart, const int jstart, const int kstart,
+                   const int iend,   const int jend,   const int kend,
+                   const int jj,     const int kk)
+    {
+        const int i = blockIdx.x*blockDim.x + threadIdx.x + istart; 
+        const int j = blockIdx.y*blockDim.y + threadIdx.y + jstart; 
+        const int k = blockIdx.z + kstart; 
+
+        if (i < iend && j < jend && k < kend)
+        {
+            const int ijk = i + j*jj + k*kk;
+            N2[ijk] = cosalpha*0.5*(b[ijk+kk] - b[ijk-kk])*dzi[k] + n2;
+        }
+    }
 } // End namespace.
 
 #ifdef USECUDA
@@ -314,3 +333,35 @@ void Thermo_buoy::exec()
     }
 }
 #endif
+
+#ifdef USECUDA
+void Thermo_buoy::get_thermo_field(Field3d* field, Field3d* tmp, const std::string name, bool cyclic)
+{
+    const int blocki = grid->ithread_block;
+    const int blockj = grid->jthread_block;
+    const int gridi  = grid->imax/blocki + (grid->imax%blocki > 0);
+    const int gridj  = grid->jmax/blockj + (grid->jmax%blockj > 0);
+
+    dim3 gridGPU (gridi, gridj, grid->kmax);
+    dim3 blockGPU(blocki, blockj, 1);
+
+    const int offs = grid->memoffset;
+
+    if (name == "N2")
+    {
+        calc_N2_g<<<gridGPU, blockGPU>>>(
+            &field->data_g[offs], &fields->sp["b"]->data_g[offs], grid->dzi_g,
+            n2, std::cos(this->alpha),
+            grid->istart,  grid->jstart, grid->kstart,
+            grid->iend,    grid->jend,   grid->kend,
+            grid->icellsp, grid->ijcellsp);
+        cuda_check_error();
+
+        if (cyclic)
+            grid->boundary_cyclic_g(&field->data_g[offs]);
+    }
+    // The buoyancy is the prognostic variable, including the ghost cells.
+    else
+        cuda_safe_call(cudaMemcpy(field->data_g, fields->sp["b"]->data_g, grid->ncellsp*sizeof(double), cudaMemcpyDeviceToDevice));
+}
+#endif
@@ -93,17 +93,26 @@ void Thermo_buoy::exec()
 }
 #endif
 
-unsigned long Thermo_buoy::get_time_limit(unsigned long idt, const double dt)
+unsigned long Thermo_buoy::get_time_limit(unsigned long idt, const double dt, const double cflrate)
 {
     return Constants::ulhuge;
 }
 
+#ifndef USECUDA
 void Thermo_buoy::get_thermo_field(Field3d* field, Field3d* tmp, const std::string name, bool cyclic)
 {
-    calc_buoyancy(field->data, fields->sp["b"]->data);
+    if (name == "N2")
+    {
+        calc_N2(field->data, fields->sp["b"]->data, grid->dzi);
+        if (cyclic)
+            grid->boundary_cyclic(field->data);
+    }
+    else
+        calc_buoyancy(field->data, fields->sp["b"]->data);
 
     // Note: calc_buoyancy already handles the lateral ghost cells
 }
+#endif
 
 void Thermo_buoy::get_prog_vars(std::vector<std::string>* list)
 {
@@ -122,6 +131,17 @@ void Thermo_buoy::get_buoyancy_surf(Field3d *bfield)
     calc_buoyancy_fluxbot(bfield->datafluxbot, fields->sp["b"]->datafluxbot);
 }
 
+N2_functor Thermo_buoy::get_N2_functor(double* fac)
+{
+    // Same factors as in calc_N2.
+    const double cosalpha = std::cos(alpha);
+    for (int k=grid->kstart; k<grid->kend; ++k)
+        fac[k] = cosalpha*0.5*grid->dzi[k];
+
+    N2_functor N2 = {fields->sp["b"]->data, fac, grid->ijcells, n2};
+    return N2;
+}
+
 double Thermo_buoy::get_buoyancy_diffusivity()
 {
     return fields->sp["b"]->visc; 
@@ -141,6 +161,26 @@ void Thermo_buoy::calc_buoyancy(double* restrict b, double* restrict bin)
         b[n] = bin[n];
 }
 
+void Thermo_buoy::calc_N2(double* restrict N2, double* restrict b, double* restrict dzi)
+{
+    const int jj = grid->icells;
+    const int kk = grid->ijcells;
+
+    // The buoyancy acts along the slope normal with cos(alpha), the background stratification
+    // n2 is the gradient of the background buoyancy along the direction of gravity.
+    const double cosalpha = std::cos(this->alpha);
+    const double n2 = this->n2;
+
+    for (int k=grid->kstart; k<grid->kend; ++k)
+        for (int j=grid->jstart; j<grid->jend; ++j)
+            #pragma ivdep
+            for (int i=grid->istart; i<grid->iend; ++i)
+            {
+                const int ijk = i + j*jj + k*kk;
+                N2[ijk] = cosalpha*0.5*(b[ijk+kk] - b[ijk-kk])*dzi[k] + n2;
+            }
+}
+
 void Thermo_buoy::calc_buoyancy_bot(double* restrict b  , double* restrict bbot,
                                     double* restrict bin, double* restrict binbot)
 {
@@ -39,7 +39,7 @@ Thermo_disabled::~Thermo_disabled()
 {
 }
 
-unsigned long Thermo_disabled::get_time_limit(unsigned long idt, const double dt)
+unsigned long Thermo_disabled::get_time_limit(unsigned long idt, const double dt, const double cflrate)
 {
     return Constants::ulhuge;
 }
@@ -166,73 +166,31 @@ void Thermo_dry::exec()
 }
 #endif
 
-unsigned long Thermo_dry::get_time_limit(unsigned long idt, const double dt)
+unsigned long Thermo_dry::get_time_limit(unsigned long idt, const double dt, const double cflrate)
 {
     return Constants::ulhuge;
 }
 
 void Thermo_dry::exec_stats(Mask *m)
 {
+    Tmp_field tmp1 = fields->get_tmp();
+
     const double NoOffset = 0.;
 
     // calculate the buoyancy and its surface flux for the profiles
-    calc_buoyancy(fields->atmp["tmp1"]->data, fields->sp["th"]->data, thref);
-    calc_buoyancy_fluxbot(fields->atmp["tmp1"]->datafluxbot, fields->sp["th"]->datafluxbot, threfh);
+    calc_buoyancy(tmp1->data, fields->sp["th"]->data, thref);
+    calc_buoyancy_fluxbot(tmp1->datafluxbot, fields->sp["th"]->datafluxbot, threfh);
 
     // define the location
     const int sloc[] = {0,0,0};
 
-    // calculate the mean
-    stats->calc_mean(m->profs["b"].data, fields->atmp["tmp1"]->data, NoOffset, sloc,
-                     fields->atmp["tmp3"]->data, stats->nmask);
-
-    // calculate the moments
-    for (int n=2; n<5; ++n)
-    {
-        std::stringstream ss;
-        ss << n;
-        std::string sn = ss.str();
-        stats->calc_moment(fields->atmp["tmp1"]->data, m->profs["b"].data, m->profs["b"+sn].data, n, sloc,
-                           fields->atmp["tmp3"]->data, stats->nmask);
-    }
-
-    // calculate the gradients
-    if (grid->swspatialorder == "2")
-        stats->calc_grad_2nd(fields->atmp["tmp1"]->data, m->profs["bgrad"].data, grid->dzhi, sloc,
-                             fields->atmp["tmp4"]->data, stats->nmaskh);
-    else if (grid->swspatialorder == "4")
-        stats->calc_grad_4th(fields->atmp["tmp1"]->data, m->profs["bgrad"].data, grid->dzhi4, sloc,
-                             fields->atmp["tmp4"]->data, stats->nmaskh);
-
-    // calculate turbulent fluxes
-    if (grid->swspatialorder == "2")
-        stats->calc_flux_2nd(fields->atmp["tmp1"]->data, m->profs["b"].data, fields->w->data, m->profs["w"].data,
-                             m->profs["bw"].data, fields->atmp["tmp2"]->data, sloc,
-                             fields->atmp["tmp4"]->data, stats->nmaskh);
-    else if (grid->swspatialorder == "4")
-        stats->calc_flux_4th(fields->atmp["tmp1"]->data, fields->w->data, m->profs["bw"].data, fields->atmp["tmp2"]->data, sloc,
-                             fields->atmp["tmp4"]->data, stats->nmaskh);
-
-    // calculate diffusive fluxes
-    if (grid->swspatialorder == "2")
-    {
-        if (model->diff->get_switch() == "smag2")
-        {
-            Diff_smag_2* diffptr = static_cast<Diff_smag_2*>(model->diff);
-            stats->calc_diff_2nd(fields->atmp["tmp1"]->data, fields->w->data, fields->sd["evisc"]->data,
-                                 m->profs["bdiff"].data, grid->dzhi,
-                                 fields->atmp["tmp1"]->datafluxbot, fields->atmp["tmp1"]->datafluxtop, diffptr->tPr, sloc,
-                                 fields->atmp["tmp4"]->data, stats->nmaskh);
-        }
-        else
-            stats->calc_diff_2nd(fields->atmp["tmp1"]->data, m->profs["bdiff"].data, grid->dzhi, fields->sp["th"]->visc, sloc,
-                                 fields->atmp["tmp4"]->data, stats->nmaskh);
-    }
-    else if (grid->swspatialorder == "4")
-    {
-        stats->calc_diff_4th(fields->atmp["tmp1"]->data, m->profs["bdiff"].data, grid->dzhi4, fields->sp["th"]->visc, sloc,
-                             fields->atmp["tmp4"]->data, stats->nmaskh);
-    }
+    // calculate the mean, moments, gradient and fluxes, take the diffusivity of temperature for that of buoyancy
+    const bool smag = (model->diff->get_switch() == "smag2") && (grid->swspatialorder == "2");
+    Diff_smag_2* diffptr = static_cast<Diff_smag_2*>(model->diff);
+    stats->calc_stats(m, "b", tmp1->data, NoOffset, sloc, 0, fields->w->data,
+                      smag ? fields->sd["evisc"]->data : 0,
+                      tmp1->datafluxbot, tmp1->datafluxtop,
+                      smag ? diffptr->tPr : fields->sp["th"]->visc);
 
     // calculate the total fluxes
     stats->add_fluxes(m->profs["bflux"].data, m->profs["bw"].data, m->profs["bdiff"].data);
@@ -243,15 +201,20 @@ void Thermo_dry::exec_stats(Mask *m)
 
 void Thermo_dry::exec_column()
 {
-    const double NoOffset = 0.;
+    Tmp_field tmp1 = fields->get_tmp();
 
-    // Buoyancy mean
-    model->column->calc_column(model->column->profs["b"].data, fields->atmp["tmp1"]->data, NoOffset);
+    const double NoOffset = 0.;
 
+    // Buoyancy mean, computed here because the column can be written without statistics
+    calc_buoyancy(tmp1->data, fields->sp["th"]->data, thref);
+    model->column->calc_column(model->column->profs["b"].data, tmp1->data, NoOffset);
 }
 
 void Thermo_dry::exec_cross(int iotime)
 {
+    Tmp_field tmp1 = fields->get_tmp();
+    Tmp_field tmp2 = fields->get_tmp();
+
     int nerror = 0;
 
     Cross* cross = model->cross;
@@ -265,26 +228,26 @@ void Thermo_dry::exec_cross(int iotime)
         if (*it == "b")
         {
             //getThermoField(fields->s["tmp1"], fields->s["tmp2"], *it);
-            calc_buoyancy(fields->atmp["tmp1"]->data, fields->sp["th"]->data, thref);
-            nerror += cross->cross_simple(fields->atmp["tmp1"]->data, fields->atmp["tmp2"]->data, *it,iotime);
+            calc_buoyancy(tmp1->data, fields->sp["th"]->data, thref);
+            nerror += cross->cross_simple(tmp1->data, tmp2->data, *it,iotime);
         }
         else if (*it == "blngrad")
         {
             //getThermoField(fields->s["tmp1"], fields->s["tmp2"], "b");
-            calc_buoyancy(fields->atmp["tmp1"]->data, fields->sp["th"]->data, thref);
+            calc_buoyancy(tmp1->data, fields->sp["th"]->data, thref);
             // Note: tmp1 twice used as argument -> overwritten in crosspath()
-            nerror += cross->cross_lngrad(fields->atmp["tmp1"]->data, fields->atmp["tmp2"]->data, fields->atmp["tmp1"]->data, grid->dzi4, *it,iotime);
+            nerror += cross->cross_lngrad(tmp1->data, tmp2->data, tmp1->data, grid->dzi4, *it,iotime);
         }
         else if (*it == "bbot" or *it == "bfluxbot")
         {
             //getBuoyancySurf(fields->s["tmp1"]);
-            calc_buoyancy_bot(fields->atmp["tmp1"]->data, fields->atmp["tmp1"]->databot, fields->sp["th"]->data, fields->sp["th"]->databot, thref, threfh);
-            calc_buoyancy_fluxbot(fields->atmp["tmp1"]->datafluxbot, fields->sp["th"]->datafluxbot, threfh);
+            calc_buoyancy_bot(tmp1->data, tmp1->databot, fields->sp["th"]->data, fields->sp["th"]->databot, thref, threfh);
+            calc_buoyancy_fluxbot(tmp1->datafluxbot, fields->sp["th"]->datafluxbot, threfh);
 
             if (*it == "bbot")
-                nerror += cross->cross_plane(fields->atmp["tmp1"]->databot, fields->atmp["tmp1"]->data, "bbot",iotime);
+                nerror += cross->cross_plane(tmp1->databot, tmp1->data, "bbot",iotime);
             else if (*it == "bfluxbot")
-                nerror += cross->cross_plane(fields->atmp["tmp1"]->datafluxbot, fields->atmp["tmp1"]->data, "bfluxbot",iotime);
+                nerror += cross->cross_plane(tmp1->datafluxbot, tmp1->data, "bfluxbot",iotime);
         }
     }
 
@@ -294,15 +257,18 @@ void Thermo_dry::exec_cross(int iotime)
 
 void Thermo_dry::exec_dump(int iotime)
 {
+    Tmp_field tmp1 = fields->get_tmp();
+    Tmp_field tmp2 = fields->get_tmp();
+
     for (std::vector<std::string>::const_iterator it=dumplist.begin(); it<dumplist.end(); ++it)
     {
         // TODO BvS restore getThermoField(), the combination of checkThermoField with getThermoField is more elegant... 
         if (*it == "b")
-            calc_buoyancy(fields->atmp["tmp2"]->data, fields->sp["th"]->data, thref);
+            calc_buoyancy(tmp2->data, fields->sp["th"]->data, thref);
         else
             throw 1;
 
-        model->dump->save_dump(fields->atmp["tmp2"]->data, fields->atmp["tmp1"]->data, *it,iotime);
+        model->dump->save_dump(tmp2->data, tmp1->data, *it,iotime);
     }
 }
 
@@ -345,6 +311,16 @@ void Thermo_dry::get_buoyancy_surf(Field3d *bfield)
 }
 #endif
 
+N2_functor Thermo_dry::get_N2_functor(double* fac)
+{
+    // Same factors as in calc_N2.
+    for (int k=grid->kstart; k<grid->kend; ++k)
+        fac[k] = grav/thref[k]*0.5*grid->dzi[k];
+
+    N2_functor N2 = {fields->sp["th"]->data, fac, grid->ijcells, 0.};
+    return N2;
+}
+
 void Thermo_dry::get_prog_vars(std::vector<std::string>* list)
 {
     list->push_back("th");
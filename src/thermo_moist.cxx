@@ -886,10 +886,6 @@ Thermo_moist::Thermo_moist(Model* modelin, Input* inputin) : Thermo(modelin, inp
         nerror += inputin->get_item(&swmicrobudget, "thermo", "swmicrobudget", "", "0");
         nerror += inputin->get_item(&cflmax_micro,  "thermo", "cflmax_micro",  "", 2.);
 
-        // The microphysics requires three additional tmp fields
-        const int n_tmp = 7;
-        fields->set_minimum_tmp_fields(n_tmp);
-
         fields->init_prognostic_field("qr", "Rain water mixing ratio", "kg kg-1");
         fields->init_prognostic_field("nr", "Number density rain", "m-3");
         nerror += inputin->get_item(&fields->sp["qr"]->visc, "fields", "svisc", "qr");
@@ -991,6 +987,20 @@ void Thermo_moist::init()
         prefh  [k] = 0.;
     }
 
+    // look up the fields once, the names are not used anymore in the time loop
+    h.thl  = fields->get_handle(thvar);
+    h.thlt = fields->get_tendency_handle(thvar);
+    h.qt   = fields->get_handle("qt");
+    h.qtt  = fields->get_tendency_handle("qt");
+
+    if (swmicro == "2mom_warm")
+    {
+        h.qr  = fields->get_handle("qr");
+        h.qrt = fields->get_tendency_handle("qr");
+        h.nr  = fields->get_handle("nr");
+        h.nrt = fields->get_tendency_handle("nr");
+    }
+
     init_cross();
     init_dump();
 }
@@ -1060,20 +1070,22 @@ void Thermo_moist::exec()
     const int kk = grid->ijcells;
     const int kcells = grid->kcells;
 
+    Field3d* thl = fields->get_field(h.thl);
+    Field3d* qt  = fields->get_field(h.qt);
 
     // Re-calculate hydrostatic pressure and exner, pass dummy as rhoref,thvref to prevent overwriting base state
-    double *tmp2 = fields->atmp["tmp2"]->data;
+    Tmp_field tmp = fields->get_tmp();
+    double *tmp2 = tmp->data;
     if (swupdatebasestate)
         calc_base_state(pref, prefh,
                         &tmp2[0*kcells], &tmp2[1*kcells], &tmp2[2*kcells], &tmp2[3*kcells],
-                        exnref, exnrefh, fields->sp[thvar]->datamean, fields->sp["qt"]->datamean);
+                        exnref, exnrefh, thl->datamean, qt->datamean);
 
     // extend later for gravity vector not normal to surface
     if (grid->swspatialorder == "2")
     {
-        calc_buoyancy_tend_2nd(fields->wt->data, fields->sp[thvar]->data, fields->sp["qt"]->data, prefh,
-                               &fields->atmp["tmp2"]->data[0*kk], &fields->atmp["tmp2"]->data[1*kk],
-                               &fields->atmp["tmp2"]->data[2*kk], thvrefh);
+        calc_buoyancy_tend_2nd(fields->wt->data, thl->data, qt->data, prefh,
+                               &tmp2[0*kk], &tmp2[1*kk], &tmp2[2*kk], thvrefh);
     }
     //else if (grid->swspatialorder == "4")
     //{
@@ -1083,22 +1095,21 @@ void Thermo_moist::exec()
     //                           thvrefh);
     //}
 
+    // Return the tmp field before the microphysics, which checks out its own.
+    tmp.release();
+
     // 2-moment warm microphysics 
     if (swmicro == "2mom_warm")
         exec_microphysics();
 }
 #endif
 
-unsigned long Thermo_moist::get_time_limit(unsigned long idt, const double dt)
+unsigned long Thermo_moist::get_time_limit(unsigned long idt, const double dt, const double cflrate)
 {
     if (swmicro == "2mom_warm")
     {
-        double cfl = mp::calc_max_sedimentation_cfl(fields->atmp["tmp1"]->data, fields->sp["qr"]->data, fields->sp["nr"]->data,
-                                                    fields->rhoref, grid->dzi, dt,
-                                                    grid->istart, grid->jstart, grid->kstart,
-                                                    grid->iend,   grid->jend,   grid->kend,
-                                                    grid->icells, grid->ijcells);
-        grid->get_max(&cfl);
+        // The sedimentation CFL number is floored at the same value as in its calculation.
+        const double cfl = std::max(1.e-5, cflrate*dt);
         return idt * cflmax_micro / cfl;
     }
     else
@@ -1107,46 +1118,82 @@ unsigned long Thermo_moist::get_time_limit(unsigned long idt, const double dt)
     }
 }
 
+double Thermo_moist::get_cfl_rate()
+{
+    if (swmicro == "2mom_warm")
+    {
+        // The sedimentation CFL number is linear in the time step, the reduction over the processes is done by the caller.
+        Tmp_field tmp = fields->get_tmp();
+        return mp::calc_max_sedimentation_cfl(tmp->data,
+                                              fields->get_field(h.qr)->data, fields->get_field(h.nr)->data,
+                                              fields->rhoref, grid->dzi, 1.,
+                                              grid->istart, grid->jstart, grid->kstart,
+                                              grid->iend,   grid->jend,   grid->kend,
+                                              grid->icells, grid->ijcells);
+    }
+    else
+    {
+        return 0.;
+    }
+}
+
 // BvS:micro 
 void Thermo_moist::exec_microphysics()
 {
     // Switch to solve certain routines over xz-slices, to reduce calculations recurring in several microphysics routines
     bool per_slice = true;
 
+    // Get the fields from their handles, to avoid lookups by name in the many calls below
+    double* thl  = fields->get_field(h.thl )->data;
+    double* qt   = fields->get_field(h.qt  )->data;
+    double* qr   = fields->get_field(h.qr  )->data;
+    double* nr   = fields->get_field(h.nr  )->data;
+    double* thlt = fields->get_field(h.thlt)->data;
+    double* qtt  = fields->get_field(h.qtt )->data;
+    double* qrt  = fields->get_field(h.qrt )->data;
+    double* nrt  = fields->get_field(h.nrt )->data;
+
+    // Check out the tmp fields for the cloud liquid water and the intermediate slices
+    Tmp_field tmp1 = fields->get_tmp();
+    Tmp_field tmp2 = fields->get_tmp();
+    Tmp_field tmp3 = fields->get_tmp();
+    Tmp_field tmp4 = fields->get_tmp();
+    Tmp_field tmp5 = fields->get_tmp();
+
+    double* ql = tmp1->data;
+
     // Remove the negative values from the precipitation fields
-    mp::remove_neg_values(fields->sp["qr"]->data, grid->istart, grid->jstart, grid->kstart, grid->iend, grid->jend, grid->kend, grid->icells, grid->ijcells);
-    mp::remove_neg_values(fields->sp["nr"]->data, grid->istart, grid->jstart, grid->kstart, grid->iend, grid->jend, grid->kend, grid->icells, grid->ijcells);
+    mp::remove_neg_values(qr, grid->istart, grid->jstart, grid->kstart, grid->iend, grid->jend, grid->kend, grid->icells, grid->ijcells);
+    mp::remove_neg_values(nr, grid->istart, grid->jstart, grid->kstart, grid->iend, grid->jend, grid->kend, grid->icells, grid->ijcells);
 
     // Calculate the cloud liquid water concent using the saturation adjustment method
-    calc_liquid_water(fields->atmp["tmp1"]->data, fields->sp["thl"]->data, fields->sp["qt"]->data, pref);
+    calc_liquid_water(ql, thl, qt, pref);
 
     const double dt = model->timeloop->get_dt();
 
     // xz tmp slices for quantities which are used by multiple microphysics routines
     const int ikslice = grid->icells * grid->kcells;
-    double* rain_mass = &fields->atmp["tmp2"]->data[0*ikslice]; 
-    double* rain_diam = &fields->atmp["tmp2"]->data[1*ikslice]; 
-    double* mu_r      = &fields->atmp["tmp2"]->data[2*ikslice]; 
-    double* lambda_r  = &fields->atmp["tmp3"]->data[0*ikslice]; 
+    double* rain_mass = &tmp2->data[0*ikslice]; 
+    double* rain_diam = &tmp2->data[1*ikslice]; 
+    double* mu_r      = &tmp2->data[2*ikslice]; 
+    double* lambda_r  = &tmp3->data[0*ikslice]; 
 
     // xz tmp slices for intermediate calculations
-    double* tmpxz1    = &fields->atmp["tmp3"]->data[1*ikslice];
-    double* tmpxz2    = &fields->atmp["tmp3"]->data[2*ikslice];
-    double* tmpxz3    = &fields->atmp["tmp4"]->data[0*ikslice];
-    double* tmpxz4    = &fields->atmp["tmp4"]->data[1*ikslice];
-    double* tmpxz5    = &fields->atmp["tmp4"]->data[2*ikslice];
-    double* tmpxz6    = &fields->atmp["tmp5"]->data[0*ikslice];
+    double* tmpxz1    = &tmp3->data[1*ikslice];
+    double* tmpxz2    = &tmp3->data[2*ikslice];
+    double* tmpxz3    = &tmp4->data[0*ikslice];
+    double* tmpxz4    = &tmp4->data[1*ikslice];
+    double* tmpxz5    = &tmp4->data[2*ikslice];
+    double* tmpxz6    = &tmp5->data[0*ikslice];
 
     // Autoconversion; formation of rain drop by coagulating cloud droplets
-    mp::autoconversion(fields->st["qr"]->data, fields->st["nr"]->data, fields->st["qt"]->data, fields->st["thl"]->data,
-                       fields->sp["qr"]->data, fields->atmp["tmp1"]->data, fields->rhoref, exnref,
+    mp::autoconversion(qrt, nrt, qtt, thlt, qr, ql, fields->rhoref, exnref,
                        grid->istart, grid->jstart, grid->kstart, 
                        grid->iend,   grid->jend,   grid->kend, 
                        grid->icells, grid->ijcells);
 
     // Accretion; growth of raindrops collecting cloud droplets
-    mp::accretion(fields->st["qr"]->data, fields->st["qt"]->data, fields->st["thl"]->data,
-                  fields->sp["qr"]->data, fields->atmp["tmp1"]->data, fields->rhoref, exnref,
+    mp::accretion(qrt, qtt, thlt, qr, ql, fields->rhoref, exnref,
                   grid->istart, grid->jstart, grid->kstart, 
                   grid->iend,   grid->jend,   grid->kend, 
                   grid->icells, grid->ijcells);
@@ -1155,29 +1202,27 @@ void Thermo_moist::exec_microphysics()
     {
         for (int j=grid->jstart; j<grid->jend; ++j)
         {
-            mp2d::prepare_microphysics_slice(rain_mass, rain_diam, mu_r, lambda_r, fields->sp["qr"]->data, fields->sp["nr"]->data, fields->rhoref,
+            mp2d::prepare_microphysics_slice(rain_mass, rain_diam, mu_r, lambda_r, qr, nr, fields->rhoref,
                                              grid->istart, grid->iend, grid->kstart, grid->kend, grid->icells, grid->ijcells, j);
 
             // Evaporation; evaporation of rain drops in unsaturated environment
-            mp2d::evaporation(fields->st["qr"]->data, fields->st["nr"]->data,  fields->st["qt"]->data, fields->st["thl"]->data,
-                              fields->sp["qr"]->data, fields->sp["nr"]->data,  fields->atmp["tmp1"]->data,
-                              fields->sp["qt"]->data, fields->sp["thl"]->data, fields->rhoref, exnref, pref,
+            mp2d::evaporation(qrt, nrt, qtt, thlt, qr, nr, ql, qt, thl, fields->rhoref, exnref, pref,
                               rain_mass, rain_diam,
                               grid->istart, grid->jstart, grid->kstart, 
                               grid->iend,   grid->jend,   grid->kend, 
                               grid->icells, grid->ijcells, j);
 
             // Self collection and breakup; growth of raindrops by mutual (rain-rain) coagulation, and breakup by collisions
-            mp2d::selfcollection_breakup(fields->st["nr"]->data, fields->sp["qr"]->data, fields->sp["nr"]->data, fields->rhoref,
+            mp2d::selfcollection_breakup(nrt, qr, nr, fields->rhoref,
                                          rain_mass, rain_diam, lambda_r,
                                          grid->istart, grid->jstart, grid->kstart, 
                                          grid->iend,   grid->jend,   grid->kend, 
                                          grid->icells, grid->ijcells, j);
 
             // Sedimentation; sub-grid sedimentation of rain 
-            mp2d::sedimentation_ss08(fields->st["qr"]->data, fields->st["nr"]->data, 
+            mp2d::sedimentation_ss08(qrt, nrt, 
                                      tmpxz1, tmpxz2, tmpxz3, tmpxz4, tmpxz5, tmpxz6, mu_r, lambda_r,
-                                     fields->sp["qr"]->data, fields->sp["nr"]->data, 
+                                     qr, nr, 
                                      fields->rhoref, grid->dzi, grid->dz, dt,
                                      grid->istart, grid->jstart, grid->kstart, 
                                      grid->iend,   grid->jend,   grid->kend, 
@@ -1187,23 +1232,19 @@ void Thermo_moist::exec_microphysics()
     else
     {
         // Evaporation; evaporation of rain drops in unsaturated environment
-        mp::evaporation(fields->st["qr"]->data, fields->st["nr"]->data,  fields->st["qt"]->data, fields->st["thl"]->data,
-                        fields->sp["qr"]->data, fields->sp["nr"]->data,  fields->atmp["tmp1"]->data,
-                        fields->sp["qt"]->data, fields->sp["thl"]->data, fields->rhoref, exnref, pref,
+        mp::evaporation(qrt, nrt, qtt, thlt, qr, nr, ql, qt, thl, fields->rhoref, exnref, pref,
                         grid->istart, grid->jstart, grid->kstart, 
                         grid->iend,   grid->jend,   grid->kend, 
                         grid->icells, grid->ijcells);
        
         // Self collection and breakup; growth of raindrops by mutual (rain-rain) coagulation, and breakup by collisions
-        mp::selfcollection_breakup(fields->st["nr"]->data, fields->sp["qr"]->data, fields->sp["nr"]->data, fields->rhoref,
+        mp::selfcollection_breakup(nrt, qr, nr, fields->rhoref,
                                    grid->istart, grid->jstart, grid->kstart, 
                                    grid->iend,   grid->jend,   grid->kend, 
                                    grid->icells, grid->ijcells);
     
         // Sedimentation; sub-grid sedimentation of rain 
-        mp::sedimentation_ss08(fields->st["qr"]->data, fields->st["nr"]->data, 
-                               fields->atmp["tmp4"]->data, fields->atmp["tmp5"]->data,
-                               fields->sp["qr"]->data, fields->sp["nr"]->data, 
+        mp::sedimentation_ss08(qrt, nrt, tmp4->data, tmp5->data, qr, nr, 
                                fields->rhoref, grid->dzi, grid->dz, dt,
                                grid->istart, grid->jstart, grid->kstart, 
                                grid->iend,   grid->jend,   grid->kend, 
@@ -1211,29 +1252,29 @@ void Thermo_moist::exec_microphysics()
     }
 }
 
-void Thermo_moist::get_mask(Field3d *mfield, Field3d *mfieldh, Mask *m)
+void Thermo_moist::get_mask(Mask *m)
 {
+    Tmp_field tmp1 = fields->get_tmp();
+    Tmp_field tmp2 = fields->get_tmp();
+
     if (m->name == "ql")
     {
-        calc_liquid_water(fields->atmp["tmp1"]->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
-        calc_mask_ql(mfield->data, mfieldh->data, mfieldh->databot,
-                     stats->nmask, stats->nmaskh, &stats->nmaskbot,
-                     fields->atmp["tmp1"]->data);
+        calc_liquid_water(tmp1->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
+        calc_mask_ql(stats->mask, stats->maskh, stats->maskbot,
+                     tmp1->data);
     }
     else if (m->name == "qlcore")
     {
-        calc_buoyancy(fields->atmp["tmp2"]->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, fields->atmp["tmp1"]->data,thvref);
-        grid->calc_mean(fields->atmp["tmp2"]->datamean, fields->atmp["tmp2"]->data, grid->kcells);
+        calc_buoyancy(tmp2->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, tmp1->data,thvref);
+        grid->calc_mean(tmp2->datamean, tmp2->data, grid->kcells);
 
-        calc_liquid_water(fields->atmp["tmp1"]->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
-        calc_mask_qlcore(mfield->data, mfieldh->data, mfieldh->databot,
-                         stats->nmask, stats->nmaskh, &stats->nmaskbot,
-                         fields->atmp["tmp1"]->data, fields->atmp["tmp2"]->data, fields->atmp["tmp2"]->datamean);
+        calc_liquid_water(tmp1->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
+        calc_mask_qlcore(stats->mask, stats->maskh, stats->maskbot,
+                         tmp1->data, tmp2->data, tmp2->datamean);
     }
 }
 
-void Thermo_moist::calc_mask_ql(double* restrict mask, double* restrict maskh, double* restrict maskbot,
-                                int* restrict nmask, int* restrict nmaskh, int* restrict nmaskbot,
+void Thermo_moist::calc_mask_ql(unsigned char* restrict mask, unsigned char* restrict maskh, unsigned char* restrict maskbot,
                                 double* restrict ql)
 {
     const int jj = grid->icells;
@@ -1241,33 +1282,22 @@ void Thermo_moist::calc_mask_ql(double* restrict mask, double* restrict maskh, d
     const int kstart = grid->kstart;
 
     for (int k=grid->kstart; k<grid->kend; k++)
-    {
-        nmask[k] = 0;
         for (int j=grid->jstart; j<grid->jend; j++)
             #pragma ivdep
             for (int i=grid->istart; i<grid->iend; i++)
             {
                 const int ijk = i + j*jj + k*kk;
-                const int ntmp = ql[ijk] > 0.;
-                nmask[k] += ntmp;
-                mask[ijk] = (double)ntmp;
+                mask[ijk] = ql[ijk] > 0.;
             }
-    }
 
     for (int k=grid->kstart; k<grid->kend+1; k++)
-    {
-        nmaskh[k] = 0;
         for (int j=grid->jstart; j<grid->jend; j++)
             #pragma ivdep
             for (int i=grid->istart; i<grid->iend; i++)
             {
                 const int ijk = i + j*jj + k*kk;
-                const int ntmp = (ql[ijk-kk] + ql[ijk]) > 0.;
-
-                nmaskh[k] += ntmp;
-                maskh[ijk] = (double)ntmp;
+                maskh[ijk] = (ql[ijk-kk] + ql[ijk]) > 0.;
             }
-    }
 
     // Set the mask for surface projected quantities
     // In this case: ql at surface
@@ -1279,22 +1309,9 @@ void Thermo_moist::calc_mask_ql(double* restrict mask, double* restrict maskh, d
             const int ijk = i + j*jj + kstart*kk;
             maskbot[ij] = maskh[ijk];
         }
-
-    grid->boundary_cyclic(mask);
-    grid->boundary_cyclic(maskh);
-    grid->boundary_cyclic_2d(maskbot);
-
-    master->sum(nmask , grid->kcells);
-    master->sum(nmaskh, grid->kcells);
-    *nmaskbot = nmaskh[grid->kstart];
-
-    // BvS: should no longer be necessary now that the ql ghost cells are set to zero
-    //nmaskh[kstart] = 0;
-    //nmaskh[kend  ] = 0;
 }
 
-void Thermo_moist::calc_mask_qlcore(double* restrict mask, double* restrict maskh, double* restrict maskbot,
-                                    int* restrict nmask, int* restrict nmaskh, int* restrict nmaskbot,
+void Thermo_moist::calc_mask_qlcore(unsigned char* restrict mask, unsigned char* restrict maskh, unsigned char* restrict maskbot,
                                     double* restrict ql, double* restrict b, double* restrict bmean)
 {
     const int jj = grid->icells;
@@ -1302,32 +1319,22 @@ void Thermo_moist::calc_mask_qlcore(double* restrict mask, double* restrict mask
     const int kstart = grid->kstart;
 
     for (int k=grid->kstart; k<grid->kend; k++)
-    {
-        nmask[k] = 0;
         for (int j=grid->jstart; j<grid->jend; j++)
             #pragma ivdep
             for (int i=grid->istart; i<grid->iend; i++)
             {
                 const int ijk = i + j*jj + k*kk;
-                const int ntmp = (ql[ijk] > 0.)*(b[ijk]-bmean[k] > 0.);
-                nmask[k] += ntmp;
-                mask[ijk] = (double)ntmp;
+                mask[ijk] = (ql[ijk] > 0.)*(b[ijk]-bmean[k] > 0.);
             }
-    }
 
     for (int k=grid->kstart; k<grid->kend+1; k++)
-    {
-        nmaskh[k] = 0;
         for (int j=grid->jstart; j<grid->jend; j++)
             #pragma ivdep
             for (int i=grid->istart; i<grid->iend; i++)
             {
                 const int ijk = i + j*jj + k*kk;
-                const int ntmp = (ql[ijk-kk]+ql[ijk] > 0.)*(b[ijk-kk]+b[ijk]-bmean[k-1]-bmean[k] > 0.);
-                nmaskh[k] += ntmp;
-                maskh[ijk] = (double)ntmp;
+                maskh[ijk] = (ql[ijk-kk]+ql[ijk] > 0.)*(b[ijk-kk]+b[ijk]-bmean[k-1]-bmean[k] > 0.);
             }
-    }
 
     // Set the mask for surface projected quantities
     // In this case: qlcore at surface
@@ -1339,166 +1346,116 @@ void Thermo_moist::calc_mask_qlcore(double* restrict mask, double* restrict mask
             const int ijk = i + j*jj + kstart*kk;
             maskbot[ij] = maskh[ijk];
         }
-
-    grid->boundary_cyclic(mask);
-    grid->boundary_cyclic(maskh);
-    grid->boundary_cyclic_2d(maskbot);
-
-    master->sum(nmask , grid->kcells);
-    master->sum(nmaskh, grid->kcells);
-    *nmaskbot = nmaskh[grid->kstart];
 }
 
 void Thermo_moist::exec_stats(Mask *m)
 {
+    Tmp_field tmp1 = fields->get_tmp();
+    Tmp_field tmp2 = fields->get_tmp();
+    Tmp_field tmp3 = fields->get_tmp();
+    Tmp_field tmp4 = fields->get_tmp();
+    Tmp_field tmp5 = fields->get_tmp();
+
     const double NoOffset = 0.;
 
     // calc the buoyancy and its surface flux for the profiles
-    calc_buoyancy(fields->atmp["tmp1"]->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, fields->atmp["tmp2"]->data, thvref);
-    calc_buoyancy_fluxbot(fields->atmp["tmp1"]->datafluxbot, fields->sp[thvar]->databot, fields->sp[thvar]->datafluxbot, fields->sp["qt"]->databot, fields->sp["qt"]->datafluxbot, thvrefh);
+    calc_buoyancy(tmp1->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, tmp2->data, thvref);
+    calc_buoyancy_fluxbot(tmp1->datafluxbot, fields->sp[thvar]->databot, fields->sp[thvar]->datafluxbot, fields->sp["qt"]->databot, fields->sp["qt"]->datafluxbot, thvrefh);
 
     // define location
     const int sloc[] = {0,0,0};
 
-    // mean
-    stats->calc_mean(m->profs["b"].data, fields->atmp["tmp1"]->data, NoOffset, sloc,
-                     fields->atmp["tmp3"]->data, stats->nmask);
-
-    // moments
-    for (int n=2; n<5; ++n)
-    {
-        std::stringstream ss;
-        ss << n;
-        std::string sn = ss.str();
-        stats->calc_moment(fields->atmp["tmp1"]->data, m->profs["b"].data, m->profs["b"+sn].data, n, sloc,
-                           fields->atmp["tmp3"]->data, stats->nmask);
-    }
-
-    // calculate the gradients
-    if (grid->swspatialorder == "2")
-        stats->calc_grad_2nd(fields->atmp["tmp1"]->data, m->profs["bgrad"].data, grid->dzhi, sloc,
-                             fields->atmp["tmp4"]->data, stats->nmaskh);
-    else if (grid->swspatialorder == "4")
-        stats->calc_grad_4th(fields->atmp["tmp1"]->data, m->profs["bgrad"].data, grid->dzhi4, sloc,
-                             fields->atmp["tmp4"]->data, stats->nmaskh);
-
-    // calculate turbulent fluxes
-    if (grid->swspatialorder == "2")
-        stats->calc_flux_2nd(fields->atmp["tmp1"]->data, m->profs["b"].data, fields->w->data, m->profs["w"].data,
-                             m->profs["bw"].data, fields->atmp["tmp2"]->data, sloc,
-                             fields->atmp["tmp4"]->data, stats->nmaskh);
-    else if (grid->swspatialorder == "4")
-        stats->calc_flux_4th(fields->atmp["tmp1"]->data, fields->w->data, m->profs["bw"].data, fields->atmp["tmp2"]->data, sloc,
-                             fields->atmp["tmp4"]->data, stats->nmaskh);
-
-    // calculate diffusive fluxes
-    if (grid->swspatialorder == "2")
-    {
-        if (model->diff->get_switch() == "smag2")
-        {
-            Diff_smag_2 *diffptr = static_cast<Diff_smag_2 *>(model->diff);
-            stats->calc_diff_2nd(fields->atmp["tmp1"]->data, fields->w->data, fields->sd["evisc"]->data,
-                                 m->profs["bdiff"].data, grid->dzhi,
-                                 fields->atmp["tmp1"]->datafluxbot, fields->atmp["tmp1"]->datafluxtop, diffptr->tPr, sloc,
-                                 fields->atmp["tmp4"]->data, stats->nmaskh);
-        }
-        else
-        {
-            stats->calc_diff_2nd(fields->atmp["tmp1"]->data, m->profs["bdiff"].data, grid->dzhi, fields->sp[thvar]->visc, sloc,
-                                 fields->atmp["tmp4"]->data, stats->nmaskh);
-        }
-    }
-    else if (grid->swspatialorder == "4")
-    {
-        // take the diffusivity of temperature for that of buoyancy
-        stats->calc_diff_4th(fields->atmp["tmp1"]->data, m->profs["bdiff"].data, grid->dzhi4, fields->sp[thvar]->visc, sloc,
-                             fields->atmp["tmp4"]->data, stats->nmaskh);
-    }
+    // calculate the mean, moments, gradient and fluxes, take the diffusivity of temperature for that of buoyancy
+    const bool smag = (model->diff->get_switch() == "smag2") && (grid->swspatialorder == "2");
+    Diff_smag_2* diffptr = static_cast<Diff_smag_2*>(model->diff);
+    stats->calc_stats(m, "b", tmp1->data, NoOffset, sloc, 0, fields->w->data,
+                      smag ? fields->sd["evisc"]->data : 0,
+                      tmp1->datafluxbot, tmp1->datafluxtop,
+                      smag ? diffptr->tPr : fields->sp[thvar]->visc);
 
     // calculate the total fluxes
     stats->add_fluxes(m->profs["bflux"].data, m->profs["bw"].data, m->profs["bdiff"].data);
 
     // calculate the liquid water stats
-    calc_liquid_water(fields->atmp["tmp1"]->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
-    stats->calc_mean(m->profs["ql"].data, fields->atmp["tmp1"]->data, NoOffset, sloc, fields->atmp["tmp3"]->data, stats->nmask);
-    stats->calc_count(fields->atmp["tmp1"]->data, m->profs["cfrac"].data, 0.,
-                      fields->atmp["tmp3"]->data, stats->nmask);
+    calc_liquid_water(tmp1->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
+    stats->calc_mean(m->profs["ql"].data, tmp1->data, NoOffset, sloc);
+    stats->calc_count(tmp1->data, m->profs["cfrac"].data, 0.);
 
-    stats->calc_cover(fields->atmp["tmp1"]->data, fields->atmp["tmp4"]->databot, &stats->nmaskbot, &m->tseries["ccover"].data, 0.);
-    stats->calc_path (fields->atmp["tmp1"]->data, fields->atmp["tmp4"]->databot, &stats->nmaskbot, &m->tseries["lwp"].data);
+    stats->calc_cover(tmp1->data, &m->tseries["ccover"].data, 0.);
+    stats->calc_path (tmp1->data, &m->tseries["lwp"].data);
 
     // BvS:micro 
     if (swmicro == "2mom_warm")
     {
-        stats->calc_path (fields->sp["qr"]->data, fields->atmp["tmp4"]->databot, &stats->nmaskbot, &m->tseries["rwp"].data);
+        stats->calc_path (fields->sp["qr"]->data, &m->tseries["rwp"].data);
 
         if (swmicrobudget == "1")
         {
             // Autoconversion
-            mp::zero(fields->atmp["tmp2"]->data, grid->ncells);
-            mp::zero(fields->atmp["tmp5"]->data, grid->ncells);
-            mp::zero(fields->atmp["tmp6"]->data, grid->ncells);
-            mp::zero(fields->atmp["tmp7"]->data, grid->ncells);
+            mp::zero(tmp2->data, grid->ncells);
+            mp::zero(tmp3->data, grid->ncells);
+            mp::zero(tmp4->data, grid->ncells);
+            mp::zero(tmp5->data, grid->ncells);
 
-            mp::autoconversion(fields->atmp["tmp2"]->data, fields->atmp["tmp5"]->data, fields->atmp["tmp6"]->data, fields->atmp["tmp7"]->data,
-                               fields->sp["qr"]->data, fields->atmp["tmp1"]->data, fields->rhoref, exnref,
+            mp::autoconversion(tmp2->data, tmp3->data, tmp4->data, tmp5->data,
+                               fields->sp["qr"]->data, tmp1->data, fields->rhoref, exnref,
                                grid->istart, grid->jstart, grid->kstart, 
                                grid->iend,   grid->jend,   grid->kend, 
                                grid->icells, grid->ijcells);
 
-            stats->calc_mean(m->profs["auto_qrt" ].data, fields->atmp["tmp2"]->data, NoOffset, sloc, fields->atmp["tmp3"]->data, stats->nmask);
-            stats->calc_mean(m->profs["auto_nrt" ].data, fields->atmp["tmp5"]->data, NoOffset, sloc, fields->atmp["tmp3"]->data, stats->nmask);
-            stats->calc_mean(m->profs["auto_qtt" ].data, fields->atmp["tmp6"]->data, NoOffset, sloc, fields->atmp["tmp3"]->data, stats->nmask);
-            stats->calc_mean(m->profs["auto_thlt"].data, fields->atmp["tmp7"]->data, NoOffset, sloc, fields->atmp["tmp3"]->data, stats->nmask);
+            stats->calc_mean(m->profs["auto_qrt" ].data, tmp2->data, NoOffset, sloc);
+            stats->calc_mean(m->profs["auto_nrt" ].data, tmp3->data, NoOffset, sloc);
+            stats->calc_mean(m->profs["auto_qtt" ].data, tmp4->data, NoOffset, sloc);
+            stats->calc_mean(m->profs["auto_thlt"].data, tmp5->data, NoOffset, sloc);
 
             // Evaporation
-            mp::zero(fields->atmp["tmp2"]->data, grid->ncells);
-            mp::zero(fields->atmp["tmp5"]->data, grid->ncells);
-            mp::zero(fields->atmp["tmp6"]->data, grid->ncells);
-            mp::zero(fields->atmp["tmp7"]->data, grid->ncells);
+            mp::zero(tmp2->data, grid->ncells);
+            mp::zero(tmp3->data, grid->ncells);
+            mp::zero(tmp4->data, grid->ncells);
+            mp::zero(tmp5->data, grid->ncells);
 
-            mp::evaporation(fields->atmp["tmp2"]->data, fields->atmp["tmp5"]->data,  fields->atmp["tmp6"]->data, fields->atmp["tmp7"]->data,
-                            fields->sp["qr"]->data, fields->sp["nr"]->data,  fields->atmp["tmp1"]->data,
+            mp::evaporation(tmp2->data, tmp3->data,  tmp4->data, tmp5->data,
+                            fields->sp["qr"]->data, fields->sp["nr"]->data,  tmp1->data,
                             fields->sp["qt"]->data, fields->sp["thl"]->data, fields->rhoref, exnref, pref,
                             grid->istart, grid->jstart, grid->kstart, 
                             grid->iend,   grid->jend,   grid->kend, 
                             grid->icells, grid->ijcells);
 
-            stats->calc_mean(m->profs["evap_qrt" ].data, fields->atmp["tmp2"]->data, NoOffset, sloc, fields->atmp["tmp3"]->data, stats->nmask);
-            stats->calc_mean(m->profs["evap_nrt" ].data, fields->atmp["tmp5"]->data, NoOffset, sloc, fields->atmp["tmp3"]->data, stats->nmask);
-            stats->calc_mean(m->profs["evap_qtt" ].data, fields->atmp["tmp6"]->data, NoOffset, sloc, fields->atmp["tmp3"]->data, stats->nmask);
-            stats->calc_mean(m->profs["evap_thlt"].data, fields->atmp["tmp7"]->data, NoOffset, sloc, fields->atmp["tmp3"]->data, stats->nmask);
+            stats->calc_mean(m->profs["evap_qrt" ].data, tmp2->data, NoOffset, sloc);
+            stats->calc_mean(m->profs["evap_nrt" ].data, tmp3->data, NoOffset, sloc);
+            stats->calc_mean(m->profs["evap_qtt" ].data, tmp4->data, NoOffset, sloc);
+            stats->calc_mean(m->profs["evap_thlt"].data, tmp5->data, NoOffset, sloc);
 
             // Accretion
-            mp::zero(fields->atmp["tmp2"]->data, grid->ncells);
-            mp::zero(fields->atmp["tmp5"]->data, grid->ncells);
-            mp::zero(fields->atmp["tmp6"]->data, grid->ncells);
+            mp::zero(tmp2->data, grid->ncells);
+            mp::zero(tmp3->data, grid->ncells);
+            mp::zero(tmp4->data, grid->ncells);
 
-            mp::accretion(fields->atmp["tmp2"]->data, fields->atmp["tmp5"]->data, fields->atmp["tmp6"]->data,
-                          fields->sp["qr"]->data, fields->atmp["tmp1"]->data, fields->rhoref, exnref,
+            mp::accretion(tmp2->data, tmp3->data, tmp4->data,
+                          fields->sp["qr"]->data, tmp1->data, fields->rhoref, exnref,
                           grid->istart, grid->jstart, grid->kstart, 
                           grid->iend,   grid->jend,   grid->kend, 
                           grid->icells, grid->ijcells);
 
-            stats->calc_mean(m->profs["accr_qrt" ].data, fields->atmp["tmp2"]->data, NoOffset, sloc, fields->atmp["tmp3"]->data, stats->nmask);
-            stats->calc_mean(m->profs["accr_qtt" ].data, fields->atmp["tmp5"]->data, NoOffset, sloc, fields->atmp["tmp3"]->data, stats->nmask);
-            stats->calc_mean(m->profs["accr_thlt"].data, fields->atmp["tmp6"]->data, NoOffset, sloc, fields->atmp["tmp3"]->data, stats->nmask);
+            stats->calc_mean(m->profs["accr_qrt" ].data, tmp2->data, NoOffset, sloc);
+            stats->calc_mean(m->profs["accr_qtt" ].data, tmp3->data, NoOffset, sloc);
+            stats->calc_mean(m->profs["accr_thlt"].data, tmp4->data, NoOffset, sloc);
 
             // Selfcollection and breakup
-            mp::zero(fields->atmp["tmp2"]->data, grid->ncells);
+            mp::zero(tmp2->data, grid->ncells);
 
-            mp::selfcollection_breakup(fields->atmp["tmp2"]->data, fields->sp["qr"]->data, fields->sp["nr"]->data, fields->rhoref,
+            mp::selfcollection_breakup(tmp2->data, fields->sp["qr"]->data, fields->sp["nr"]->data, fields->rhoref,
                                        grid->istart, grid->jstart, grid->kstart, 
                                        grid->iend,   grid->jend,   grid->kend, 
                                        grid->icells, grid->ijcells);
 
-            stats->calc_mean(m->profs["scbr_nrt" ].data, fields->atmp["tmp2"]->data, NoOffset, sloc, fields->atmp["tmp3"]->data, stats->nmask);
+            stats->calc_mean(m->profs["scbr_nrt" ].data, tmp2->data, NoOffset, sloc);
 
             // Sedimentation
-            mp::zero(fields->atmp["tmp2"]->data, grid->ncells);
-            mp::zero(fields->atmp["tmp5"]->data, grid->ncells);
-            mp::zero(fields->atmp["tmp6"]->data, grid->ncells);
-            mp::zero(fields->atmp["tmp7"]->data, grid->ncells);
+            mp::zero(tmp2->data, grid->ncells);
+            mp::zero(tmp3->data, grid->ncells);
+            mp::zero(tmp4->data, grid->ncells);
+            mp::zero(tmp5->data, grid->ncells);
 
             // 1. Get number of substeps based on sedimentation with CFL=1
             //const double dt = model->timeloop->get_sub_time_step();
@@ -1515,8 +1472,8 @@ void Thermo_moist::exec_stats(Mask *m)
             //nsubstep *= 2;
 
             //// Sedimentation in nsubstep steps:
-            //mp::sedimentation_sub(fields->atmp["tmp2"]->data, fields->atmp["tmp5"]->data, 
-            //                      fields->atmp["tmp6"]->data, fields->atmp["tmp7"]->data,
+            //mp::sedimentation_sub(tmp2->data, tmp3->data, 
+            //                      tmp4->data, tmp5->data,
             //                      fields->sp["qr"]->data, fields->sp["nr"]->data, 
             //                      fields->rhoref, grid->dzi, grid->dzhi, dt,
             //                      grid->istart, grid->jstart, grid->kstart, 
@@ -1525,16 +1482,16 @@ void Thermo_moist::exec_stats(Mask *m)
             //                      nsubstep);
 
             const double dt = model->timeloop->get_sub_time_step();
-            mp::sedimentation_ss08(fields->atmp["tmp2"]->data, fields->atmp["tmp5"]->data, 
-                                   fields->atmp["tmp6"]->data, fields->atmp["tmp7"]->data,
+            mp::sedimentation_ss08(tmp2->data, tmp3->data, 
+                                   tmp4->data, tmp5->data,
                                    fields->sp["qr"]->data, fields->sp["nr"]->data, 
                                    fields->rhoref, grid->dzi, grid->dz, dt,
                                    grid->istart, grid->jstart, grid->kstart, 
                                    grid->iend,   grid->jend,   grid->kend, 
                                    grid->icells, grid->kcells, grid->ijcells);
 
-            stats->calc_mean(m->profs["sed_qrt"].data, fields->atmp["tmp2"]->data, NoOffset, sloc, fields->atmp["tmp3"]->data, stats->nmask);
-            stats->calc_mean(m->profs["sed_nrt"].data, fields->atmp["tmp5"]->data, NoOffset, sloc, fields->atmp["tmp3"]->data, stats->nmask);
+            stats->calc_mean(m->profs["sed_qrt"].data, tmp2->data, NoOffset, sloc);
+            stats->calc_mean(m->profs["sed_nrt"].data, tmp3->data, NoOffset, sloc);
         }
     }
 
@@ -1542,17 +1499,17 @@ void Thermo_moist::exec_stats(Mask *m)
     if (swupdatebasestate == 1)
     {
         const int kcells = grid->kcells;
-        double* restrict tmp2 = fields->atmp["tmp2"]->data;
-        calc_base_state(&tmp2[0*kcells], &tmp2[1*kcells], &tmp2[2*kcells], &tmp2[3*kcells],
-                        &tmp2[4*kcells], &tmp2[5*kcells], &tmp2[6*kcells], &tmp2[7*kcells],
+        double* restrict base = tmp2->data;
+        calc_base_state(&base[0*kcells], &base[1*kcells], &base[2*kcells], &base[3*kcells],
+                        &base[4*kcells], &base[5*kcells], &base[6*kcells], &base[7*kcells],
                         fields->sp[thvar]->datamean, fields->sp["qt"]->datamean);
 
         for (int k=0; k<kcells; ++k)
         {
-            m->profs["ph"  ].data[k] = tmp2[0*kcells+k];
-            m->profs["phh" ].data[k] = tmp2[1*kcells+k];
-            m->profs["rho" ].data[k] = tmp2[2*kcells+k];
-            m->profs["rhoh"].data[k] = tmp2[3*kcells+k];
+            m->profs["ph"  ].data[k] = base[0*kcells+k];
+            m->profs["phh" ].data[k] = base[1*kcells+k];
+            m->profs["rho" ].data[k] = base[2*kcells+k];
+            m->profs["rhoh"].data[k] = base[3*kcells+k];
         }
     }
 }
@@ -1560,18 +1517,25 @@ void Thermo_moist::exec_stats(Mask *m)
 
 void Thermo_moist::exec_column()
 {
+    Tmp_field tmp1 = fields->get_tmp();
+    Tmp_field tmp2 = fields->get_tmp();
+
     const double NoOffset = 0.;
 
-    // Buoyancy mean
-    model->column->calc_column(model->column->profs["b"].data, fields->atmp["tmp1"]->data, NoOffset);
-    // calculate the liquid water 
-    calc_liquid_water(fields->atmp["tmp1"]->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
-    model->column->calc_column(model->column->profs["ql"].data, fields->atmp["tmp1"]->data, NoOffset);
+    // Buoyancy mean, computed here because the column can be written without statistics
+    calc_buoyancy(tmp1->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, tmp2->data, thvref);
+    model->column->calc_column(model->column->profs["b"].data, tmp1->data, NoOffset);
 
+    // calculate the liquid water 
+    calc_liquid_water(tmp1->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
+    model->column->calc_column(model->column->profs["ql"].data, tmp1->data, NoOffset);
 }
 
 void Thermo_moist::exec_cross(int iotime)
 {
+    Tmp_field tmp1 = fields->get_tmp();
+    Tmp_field tmp2 = fields->get_tmp();
+
     int nerror = 0;
 
     Cross* cross = model->cross;
@@ -1584,59 +1548,59 @@ void Thermo_moist::exec_cross(int iotime)
 
         if (*it == "b")
         {
-            calc_buoyancy(fields->atmp["tmp1"]->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, fields->atmp["tmp2"]->data, thvref);
-            nerror += cross->cross_simple(fields->atmp["tmp1"]->data, fields->atmp["tmp2"]->data, *it, iotime);
+            calc_buoyancy(tmp1->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, tmp2->data, thvref);
+            nerror += cross->cross_simple(tmp1->data, tmp2->data, *it, iotime);
         }
         else if (*it == "ql")
         {
-            calc_liquid_water(fields->atmp["tmp1"]->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
-            nerror += cross->cross_simple(fields->atmp["tmp1"]->data, fields->atmp["tmp2"]->data, *it, iotime);
+            calc_liquid_water(tmp1->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
+            nerror += cross->cross_simple(tmp1->data, tmp2->data, *it, iotime);
         }
         else if (*it == "blngrad")
         {
-            calc_buoyancy(fields->atmp["tmp1"]->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, fields->atmp["tmp2"]->data, thvref);
+            calc_buoyancy(tmp1->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, tmp2->data, thvref);
             // Note: tmp1 twice used as argument -> overwritten in crosspath()
-            nerror += cross->cross_lngrad(fields->atmp["tmp1"]->data, fields->atmp["tmp2"]->data, fields->atmp["tmp1"]->data, grid->dzi4, *it, iotime);
+            nerror += cross->cross_lngrad(tmp1->data, tmp2->data, tmp1->data, grid->dzi4, *it, iotime);
         }
         else if (*it == "qlpath")
         {
-            calc_liquid_water(fields->atmp["tmp1"]->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
+            calc_liquid_water(tmp1->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
             // Note: tmp1 twice used as argument -> overwritten in crosspath()
-            nerror += cross->cross_path(fields->atmp["tmp1"]->data, fields->atmp["tmp2"]->data, fields->atmp["tmp1"]->data, "qlpath", iotime);
+            nerror += cross->cross_path(tmp1->data, tmp2->data, tmp1->data, "qlpath", iotime);
         }
         else if (*it == "qlbase")
         {
             const double ql_threshold = 0.;
-            calc_liquid_water(fields->atmp["tmp1"]->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
-            nerror += cross->cross_height_threshold(fields->atmp["tmp1"]->data, fields->atmp["tmp1"]->databot, fields->atmp["tmp2"]->data, grid->z, ql_threshold, Bottom_to_top, "qlbase", iotime);
+            calc_liquid_water(tmp1->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
+            nerror += cross->cross_height_threshold(tmp1->data, tmp1->databot, tmp2->data, grid->z, ql_threshold, Bottom_to_top, "qlbase", iotime);
         }
         else if (*it == "qltop")
         {
             const double ql_threshold = 0.;
-            calc_liquid_water(fields->atmp["tmp1"]->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
-            nerror += cross->cross_height_threshold(fields->atmp["tmp1"]->data, fields->atmp["tmp1"]->databot, fields->atmp["tmp2"]->data, grid->z, ql_threshold, Top_to_bottom, "qltop", iotime);
+            calc_liquid_water(tmp1->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
+            nerror += cross->cross_height_threshold(tmp1->data, tmp1->databot, tmp2->data, grid->z, ql_threshold, Top_to_bottom, "qltop", iotime);
         }
         else if (*it == "maxthvcloud")
         {
-            calc_liquid_water(fields->atmp["tmp1"]->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
-            calc_maximum_thv_perturbation_cloud(fields->atmp["tmp2"]->databot, fields->atmp["tmp2"]->data,
-                                                fields->sp["thl"]->data, fields->sp["qt"]->data, fields->atmp["tmp1"]->data, pref, fields->atmp["tmp2"]->datamean);
-            nerror += cross->cross_plane(fields->atmp["tmp2"]->databot, fields->atmp["tmp1"]->data, "maxthvcloud", iotime);
+            calc_liquid_water(tmp1->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
+            calc_maximum_thv_perturbation_cloud(tmp2->databot, tmp2->data,
+                                                fields->sp["thl"]->data, fields->sp["qt"]->data, tmp1->data, pref, tmp2->datamean);
+            nerror += cross->cross_plane(tmp2->databot, tmp1->data, "maxthvcloud", iotime);
         }
         else if (*it == "bbot" or *it == "bfluxbot")
         {
-            calc_buoyancy_bot(fields->atmp["tmp1"]->data, fields->atmp["tmp1"]->databot, fields->sp[thvar ]->data, fields->sp[thvar]->databot, fields->sp["qt"]->data, fields->sp["qt"]->databot, thvref, thvrefh);
-            calc_buoyancy_fluxbot(fields->atmp["tmp1"]->datafluxbot, fields->sp[thvar]->databot, fields->sp[thvar]->datafluxbot, fields->sp["qt"]->databot, fields->sp["qt"]->datafluxbot, thvrefh);
+            calc_buoyancy_bot(tmp1->data, tmp1->databot, fields->sp[thvar ]->data, fields->sp[thvar]->databot, fields->sp["qt"]->data, fields->sp["qt"]->databot, thvref, thvrefh);
+            calc_buoyancy_fluxbot(tmp1->datafluxbot, fields->sp[thvar]->databot, fields->sp[thvar]->datafluxbot, fields->sp["qt"]->databot, fields->sp["qt"]->datafluxbot, thvrefh);
 
             if (*it == "bbot")
-                nerror += cross->cross_plane(fields->atmp["tmp1"]->databot, fields->atmp["tmp1"]->data, "bbot", iotime);
+                nerror += cross->cross_plane(tmp1->databot, tmp1->data, "bbot", iotime);
             else if (*it == "bfluxbot")
-                nerror += cross->cross_plane(fields->atmp["tmp1"]->datafluxbot, fields->atmp["tmp1"]->data, "bfluxbot", iotime);
+                nerror += cross->cross_plane(tmp1->datafluxbot, tmp1->data, "bfluxbot", iotime);
         }
         // BvS:micro 
         else if (*it == "qrpath")
         {
-            nerror += cross->cross_path(fields->sp["qr"]->data, fields->atmp["tmp2"]->data, fields->atmp["tmp1"]->data, "qrpath", iotime);
+            nerror += cross->cross_path(fields->sp["qr"]->data, tmp2->data, tmp1->data, "qrpath", iotime);
         }
     }
 
@@ -1646,17 +1610,20 @@ void Thermo_moist::exec_cross(int iotime)
 
 void Thermo_moist::exec_dump(int iotime)
 {
+    Tmp_field tmp1 = fields->get_tmp();
+    Tmp_field tmp2 = fields->get_tmp();
+
     for (std::vector<std::string>::const_iterator it=dumplist.begin(); it<dumplist.end(); ++it)
     {
         // TODO BvS restore getThermoField(), the combination of checkThermoField with getThermoField is more elegant...
         if (*it == "b")
-            calc_buoyancy(fields->atmp["tmp2"]->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, fields->atmp["tmp1"]->data, thvref);
+            calc_buoyancy(tmp2->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, tmp1->data, thvref);
         else if (*it == "ql")
-            calc_liquid_water(fields->atmp["tmp2"]->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
+            calc_liquid_water(tmp2->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref);
         else
             throw 1;
 
-        model->dump->save_dump(fields->atmp["tmp2"]->data, fields->atmp["tmp1"]->data, *it, iotime);
+        model->dump->save_dump(tmp2->data, tmp1->data, *it, iotime);
     }
 }
 
@@ -1687,8 +1654,8 @@ void Thermo_moist::get_thermo_field(Field3d* fld, Field3d* tmp, const std::strin
     const int kcells = grid->kcells;
 
     // BvS: getThermoField() is called from subgrid-model, before thermo(), so re-calculate the hydrostatic pressure
-    // Pass dummy as rhoref,thvref to prevent overwriting base state
-    double* restrict tmp2 = fields->atmp["tmp2"]->data;
+    // Pass dummy as rhoref,thvref to prevent overwriting base state, tmp is only used afterwards
+    double* restrict tmp2 = tmp->data;
     if (swupdatebasestate)
         calc_base_state(pref, prefh, &tmp2[0*kcells], &tmp2[1*kcells], &tmp2[2*kcells], &tmp2[3*kcells], exnref, exnrefh,
                 fields->sp[thvar]->datamean, fields->sp["qt"]->datamean);
@@ -1725,6 +1692,16 @@ void Thermo_moist::get_buoyancy_fluxbot(Field3d *bfield)
 }
 #endif
 
+N2_functor Thermo_moist::get_N2_functor(double* fac)
+{
+    // Same factors as in calc_N2.
+    for (int k=grid->kstart; k<grid->kend; ++k)
+        fac[k] = grav/thvref[k]*0.5*grid->dzi[k];
+
+    N2_functor N2 = {fields->sp[thvar]->data, fac, grid->ijcells, 0.};
+    return N2;
+}
+
 void Thermo_moist::get_prog_vars(std::vector<std::string> *list)
 {
     list->push_back(thvar);
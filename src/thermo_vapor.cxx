@@ -240,7 +240,8 @@ void Thermo_vapor::exec()
 
 
     // Re-calculate hydrostatic pressure and exner, pass dummy as rhoref,thvref to prevent overwriting base state
-    double *tmp2 = fields->atmp["tmp2"]->data;
+    Tmp_field tmp = fields->get_tmp();
+    double *tmp2 = tmp->data;
     if (swupdatebasestate)
         calc_base_state(pref, prefh,
                         &tmp2[0*kcells], &tmp2[1*kcells], &tmp2[2*kcells], &tmp2[3*kcells],
@@ -250,7 +251,7 @@ void Thermo_vapor::exec()
     if (grid->swspatialorder == "2")
     {
         calc_buoyancy_tend_2nd(fields->wt->data, fields->sp[thvar]->data, fields->sp["qt"]->data, prefh,
-                               &fields->atmp["tmp2"]->data[0*kk], &fields->atmp["tmp2"]->data[1*kk],
+                               &tmp2[0*kk], &tmp2[1*kk],
                                thvrefh);
     }
     //else if (grid->swspatialorder == "4")
@@ -264,76 +265,31 @@ void Thermo_vapor::exec()
 }
 #endif
 
-unsigned long Thermo_vapor::get_time_limit(unsigned long idt, const double dt)
+unsigned long Thermo_vapor::get_time_limit(unsigned long idt, const double dt, const double cflrate)
 {
     return Constants::ulhuge;
 }
 
 void Thermo_vapor::exec_stats(Mask *m)
 {
+    Tmp_field tmp1 = fields->get_tmp();
+
     const double NoOffset = 0.;
 
     // calc the buoyancy and its surface flux for the profiles
-    calc_buoyancy(fields->atmp["tmp1"]->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, thvref);
-    calc_buoyancy_fluxbot(fields->atmp["tmp1"]->datafluxbot, fields->sp[thvar]->databot, fields->sp[thvar]->datafluxbot, fields->sp["qt"]->databot, fields->sp["qt"]->datafluxbot, thvrefh);
+    calc_buoyancy(tmp1->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, thvref);
+    calc_buoyancy_fluxbot(tmp1->datafluxbot, fields->sp[thvar]->databot, fields->sp[thvar]->datafluxbot, fields->sp["qt"]->databot, fields->sp["qt"]->datafluxbot, thvrefh);
 
     // define location
     const int sloc[] = {0,0,0};
 
-    // mean
-    stats->calc_mean(m->profs["b"].data, fields->atmp["tmp1"]->data, NoOffset, sloc,
-                     fields->atmp["tmp3"]->data, stats->nmask);
-
-    // moments
-    for (int n=2; n<5; ++n)
-    {
-        std::stringstream ss;
-        ss << n;
-        std::string sn = ss.str();
-        stats->calc_moment(fields->atmp["tmp1"]->data, m->profs["b"].data, m->profs["b"+sn].data, n, sloc,
-                           fields->atmp["tmp3"]->data, stats->nmask);
-    }
-
-    // calculate the gradients
-    if (grid->swspatialorder == "2")
-        stats->calc_grad_2nd(fields->atmp["tmp1"]->data, m->profs["bgrad"].data, grid->dzhi, sloc,
-                             fields->atmp["tmp4"]->data, stats->nmaskh);
-    else if (grid->swspatialorder == "4")
-        stats->calc_grad_4th(fields->atmp["tmp1"]->data, m->profs["bgrad"].data, grid->dzhi4, sloc,
-                             fields->atmp["tmp4"]->data, stats->nmaskh);
-
-    // calculate turbulent fluxes
-    if (grid->swspatialorder == "2")
-        stats->calc_flux_2nd(fields->atmp["tmp1"]->data, m->profs["b"].data, fields->w->data, m->profs["w"].data,
-                             m->profs["bw"].data, fields->atmp["tmp2"]->data, sloc,
-                             fields->atmp["tmp4"]->data, stats->nmaskh);
-    else if (grid->swspatialorder == "4")
-        stats->calc_flux_4th(fields->atmp["tmp1"]->data, fields->w->data, m->profs["bw"].data, fields->atmp["tmp2"]->data, sloc,
-                             fields->atmp["tmp4"]->data, stats->nmaskh);
-
-    // calculate diffusive fluxes
-    if (grid->swspatialorder == "2")
-    {
-        if (model->diff->get_switch() == "smag2")
-        {
-            Diff_smag_2 *diffptr = static_cast<Diff_smag_2 *>(model->diff);
-            stats->calc_diff_2nd(fields->atmp["tmp1"]->data, fields->w->data, fields->sd["evisc"]->data,
-                                 m->profs["bdiff"].data, grid->dzhi,
-                                 fields->atmp["tmp1"]->datafluxbot, fields->atmp["tmp1"]->datafluxtop, diffptr->tPr, sloc,
-                                 fields->atmp["tmp4"]->data, stats->nmaskh);
-        }
-        else
-        {
-            stats->calc_diff_2nd(fields->atmp["tmp1"]->data, m->profs["bdiff"].data, grid->dzhi, fields->sp[thvar]->visc, sloc,
-                                 fields->atmp["tmp4"]->data, stats->nmaskh);
-        }
-    }
-    else if (grid->swspatialorder == "4")
-    {
-        // take the diffusivity of temperature for that of buoyancy
-        stats->calc_diff_4th(fields->atmp["tmp1"]->data, m->profs["bdiff"].data, grid->dzhi4, fields->sp[thvar]->visc, sloc,
-                             fields->atmp["tmp4"]->data, stats->nmaskh);
-    }
+    // calculate the mean, moments, gradient and fluxes, take the diffusivity of temperature for that of buoyancy
+    const bool smag = (model->diff->get_switch() == "smag2") && (grid->swspatialorder == "2");
+    Diff_smag_2* diffptr = static_cast<Diff_smag_2*>(model->diff);
+    stats->calc_stats(m, "b", tmp1->data, NoOffset, sloc, 0, fields->w->data,
+                      smag ? fields->sd["evisc"]->data : 0,
+                      tmp1->datafluxbot, tmp1->datafluxtop,
+                      smag ? diffptr->tPr : fields->sp[thvar]->visc);
 
     // calculate the total fluxes
     stats->add_fluxes(m->profs["bflux"].data, m->profs["bw"].data, m->profs["bdiff"].data);
@@ -342,14 +298,20 @@ void Thermo_vapor::exec_stats(Mask *m)
 
 void Thermo_vapor::exec_column()
 {
+    Tmp_field tmp1 = fields->get_tmp();
+
     const double NoOffset = 0.;
 
-    // Buoyancy mean
-    model->column->calc_column(model->column->profs["b"].data, fields->atmp["tmp1"]->data, NoOffset);
+    // Buoyancy mean, computed here because the column can be written without statistics
+    calc_buoyancy(tmp1->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, thvref);
+    model->column->calc_column(model->column->profs["b"].data, tmp1->data, NoOffset);
 }
 
 void Thermo_vapor::exec_cross(int iotime)
 {
+    Tmp_field tmp1 = fields->get_tmp();
+    Tmp_field tmp2 = fields->get_tmp();
+
     int nerror = 0;
 
     Cross* cross = model->cross;
@@ -362,14 +324,14 @@ void Thermo_vapor::exec_cross(int iotime)
 
         if (*it == "b")
         {
-            calc_buoyancy(fields->atmp["tmp1"]->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, thvref);
-            nerror += cross->cross_simple(fields->atmp["tmp1"]->data, fields->atmp["tmp2"]->data, *it, iotime);
+            calc_buoyancy(tmp1->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, thvref);
+            nerror += cross->cross_simple(tmp1->data, tmp2->data, *it, iotime);
         }
         else if (*it == "blngrad")
         {
-            calc_buoyancy(fields->atmp["tmp1"]->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, thvref);
+            calc_buoyancy(tmp1->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, thvref);
             // Note: tmp1 twice used as argument -> overwritten in crosspath()
-            nerror += cross->cross_lngrad(fields->atmp["tmp1"]->data, fields->atmp["tmp2"]->data, fields->atmp["tmp1"]->data, grid->dzi4, *it, iotime);
+            nerror += cross->cross_lngrad(tmp1->data, tmp2->data, tmp1->data, grid->dzi4, *it, iotime);
         }
     }
 
@@ -379,15 +341,18 @@ void Thermo_vapor::exec_cross(int iotime)
 
 void Thermo_vapor::exec_dump(int iotime)
 {
+    Tmp_field tmp1 = fields->get_tmp();
+    Tmp_field tmp2 = fields->get_tmp();
+
     for (std::vector<std::string>::const_iterator it=dumplist.begin(); it<dumplist.end(); ++it)
     {
         // TODO BvS restore getThermoField(), the combination of checkThermoField with getThermoField is more elegant...
         if (*it == "b")
-            calc_buoyancy(fields->atmp["tmp2"]->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, thvref);
+            calc_buoyancy(tmp2->data, fields->sp[thvar]->data, fields->sp["qt"]->data, pref, thvref);
         else
             throw 1;
 
-        model->dump->save_dump(fields->atmp["tmp2"]->data, fields->atmp["tmp1"]->data, *it, iotime);
+        model->dump->save_dump(tmp2->data, tmp1->data, *it, iotime);
     }
 }
 
@@ -418,8 +383,8 @@ void Thermo_vapor::get_thermo_field(Field3d* fld, Field3d* tmp, const std::strin
     const int kcells = grid->kcells;
 
     // BvS: getThermoField() is called from subgrid-model, before thermo(), so re-calculate the hydrostatic pressure
-    // Pass dummy as rhoref,thvref to prevent overwriting base state
-    double* restrict tmp2 = fields->atmp["tmp2"]->data;
+    // Pass dummy as rhoref,thvref to prevent overwriting base state, tmp is only used afterwards
+    double* restrict tmp2 = tmp->data;
     if (swupdatebasestate)
         calc_base_state(pref, prefh, &tmp2[0*kcells], &tmp2[1*kcells], &tmp2[2*kcells], &tmp2[3*kcells], exnref, exnrefh,
                 fields->sp[thvar]->datamean, fields->sp["qt"]->datamean);
@@ -454,6 +419,16 @@ void Thermo_vapor::get_buoyancy_fluxbot(Field3d *bfield)
 }
 #endif
 
+N2_functor Thermo_vapor::get_N2_functor(double* fac)
+{
+    // Same factors as in calc_N2.
+    for (int k=grid->kstart; k<grid->kend; ++k)
+        fac[k] = grav/thvref[k]*0.5*grid->dzi[k];
+
+    N2_functor N2 = {fields->sp[thvar]->data, fac, grid->ijcells, 0.};
+    return N2;
+}
+
 void Thermo_vapor::get_prog_vars(std::vector<std::string> *list)
 {
     list->push_back(thvar);
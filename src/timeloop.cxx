@@ -62,7 +62,12 @@ Timeloop::Timeloop(Model* modelin, Input* inputin)
     n += inputin->get_item(&iotimeprec  , "time", "iotimeprec"  , "", 0               );
 
     if (master->mode == "post")
+    {
         n += inputin->get_item(&postproctime, "time", "postproctime", "");
+        n += inputin->get_item(&postprefetch, "time", "postprefetch", "", 0);
+    }
+    else
+        postprefetch = 0;
 
     // if one argument fails, then crash
     if (n > 0)
@@ -254,16 +259,16 @@ void Timeloop::exec()
 {
     if (rkorder == 3)
     {
-        for (FieldMap::const_iterator it = fields->at.begin(); it!=fields->at.end(); ++it)
-            rk3(fields->ap[it->first]->data, it->second->data, dt);
+        for (const Field_pair& p : fields->prognostic_pairs)
+            rk3(p.fld->data, p.fldt->data, dt);
 
         substep = (substep+1) % 3;
     }
 
     if (rkorder == 4)
     {
-        for (FieldMap::const_iterator it = fields->at.begin(); it!=fields->at.end(); ++it)
-            rk4(fields->ap[it->first]->data, it->second->data, dt);
+        for (const Field_pair& p : fields->prognostic_pairs)
+            rk4(p.fld->data, p.fldt->data, dt);
 
         substep = (substep+1) % 5;
     }
@@ -474,3 +479,14 @@ void Timeloop::step_post_proc_time()
     if (itime > iendtime)
         loop = false;
 }
+
+// Return the output time that is processed n post processing steps from now, or -1 if that is after the end time.
+int Timeloop::get_post_proc_iotime(const int n)
+{
+    const unsigned long itimenext = itime + n*ipostproctime;
+
+    if (itimenext > iendtime)
+        return -1;
+
+    return (int)(itimenext/iiotimeprec);
+}